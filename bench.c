@@ -0,0 +1,755 @@
+/*
+ * Microbenchmarks for the library's pixel kernels
+ * Runs against the emulator backend so it works on any machine.
+ */
+
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#define MAX_RESULTS 64
+#define MIN_SAMPLE_NS 500000  // Batch fast kernels so each sample is at least 0.5ms
+
+// Hardware counters collected with --perf
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTERS
+};
+
+static const char *perf_names[PERF_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+typedef struct {
+    int fds[PERF_COUNTERS];      // -1 when a counter could not be opened
+    uint64_t ids[PERF_COUNTERS];
+} perf_group_t;
+
+typedef struct {
+    const char *name;
+    double items;          // Work items per iteration (pixels, bytes, ...)
+    const char *unit;      // What an item is
+    double bytes;          // Packed framebuffer bytes per iteration (0 if not applicable)
+    void (*setup)(inky_t *display);
+    void (*run)(inky_t *display);
+} benchmark_t;
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    double items;
+    double bytes;
+    int reps;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    bool has_counters;
+    double counters[PERF_COUNTERS];  // Per call, < 0 when unavailable
+} result_t;
+
+static volatile uint32_t sink;  // Keeps results of read-only kernels alive
+static uint8_t region_out[INKY_WIDTH * INKY_HEIGHT / 2 + 1];
+static char ppm_path[] = "/tmp/inky_bench.ppm";
+
+// Kernels
+
+static void bench_clear(inky_t *display) {
+    inky_clear(display, INKY_BLUE);
+}
+
+static void bench_set_pixel(inky_t *display) {
+    uint16_t width = inky_get_width(display);
+    uint16_t height = inky_get_height(display);
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            inky_set_pixel(display, x, y, (x ^ y) & 7);
+        }
+    }
+}
+
+static void bench_get_pixel(inky_t *display) {
+    uint16_t width = inky_get_width(display);
+    uint16_t height = inky_get_height(display);
+    uint32_t sum = 0;
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            sum += inky_get_pixel(display, x, y);
+        }
+    }
+    sink = sum;
+}
+
+static void setup_pattern(inky_t *display) {
+    bench_set_pixel(display);
+}
+
+// Odd x offset so every pixel has to be re-nibbled
+static void bench_extract_region(inky_t *display) {
+    inky_extract_region(display, 101, 100, 200, 35, region_out);
+    sink = region_out[0];
+}
+
+static void bench_extract_full(inky_t *display) {
+    inky_extract_region(display, 0, 0, inky_get_width(display), inky_get_height(display), region_out);
+    sink = region_out[0];
+}
+
+static void bench_save_ppm(inky_t *display) {
+    inky_emulator_save_ppm(display, ppm_path);
+}
+
+static void bench_stats_record(inky_t *display) {
+    for (uint32_t i = 0; i < 1000; i++) {
+        inky_stats_record(display, INKY_UPDATE_PARTIAL, INKY_PHASE_TRANSFER, i * 37);
+    }
+}
+
+static void bench_trace_disabled(inky_t *display) {
+    (void)display;
+    for (int i = 0; i < 1000; i++) {
+        INKY_TRACE_BEGIN("bench");
+        INKY_TRACE_END("bench");
+    }
+}
+
+#define FRAME_PIXELS (INKY_WIDTH * INKY_HEIGHT)
+#define FRAME_BYTES  (INKY_WIDTH * INKY_HEIGHT / 2)
+
+// Typical dashboard: white page, header bar, rows of text-like glyph
+// blocks and a couple of chart lines
+static void setup_dashboard(inky_t *display) {
+    uint16_t width = inky_get_width(display);
+    inky_clear(display, INKY_WHITE);
+    for (uint16_t y = 0; y < 40; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            inky_set_pixel(display, x, y, INKY_BLUE);
+        }
+    }
+    for (uint16_t y = 60; y < 260; y++) {
+        for (uint16_t x = 20; x < 380; x++) {
+            uint16_t line = (y - 60) % 25, col = (x - 20) % 9;
+            bool glyph = line < 14 && col < 6 && ((x * 7 + y * 3 + x / 9 * 5) % 5) < 3;
+            inky_set_pixel(display, x, y, glyph ? INKY_BLACK : INKY_WHITE);
+        }
+    }
+    for (uint16_t x = 20; x < width - 20; x++) {
+        uint16_t y1 = 380 - (uint16_t)((x * 37) % 90);
+        uint16_t y2 = 420 - (uint16_t)((x * 13) % 50);
+        inky_set_pixel(display, x, y1, INKY_RED);
+        inky_set_pixel(display, x, y2, INKY_GREEN);
+        inky_set_pixel(display, x, 440, INKY_BLACK);
+    }
+}
+
+static uint8_t codec_buf[FRAME_BYTES + FRAME_BYTES / 8 + 1024];
+static size_t codec_len;
+
+static void setup_encoded(inky_t *display) {
+    setup_dashboard(display);
+    codec_len = inky_buffer_encode(display, 0, 0, inky_get_width(display), inky_get_height(display),
+                                   codec_buf, sizeof(codec_buf));
+}
+
+static void bench_rle_encode(inky_t *display) {
+    codec_len = inky_buffer_encode(display, 0, 0, inky_get_width(display), inky_get_height(display),
+                                   codec_buf, sizeof(codec_buf));
+    sink = (uint32_t)codec_len;
+}
+
+static void bench_rle_decode(inky_t *display) {
+    sink = inky_buffer_decode(display, 0, 0, codec_buf, codec_len);
+}
+
+// Text block re-decoded one pixel to the right, so every byte is re-nibbled
+static void setup_encoded_region(inky_t *display) {
+    setup_dashboard(display);
+    codec_len = inky_buffer_encode(display, 20, 60, 360, 200, codec_buf, sizeof(codec_buf));
+}
+
+static void bench_rle_decode_region(inky_t *display) {
+    sink = inky_buffer_decode(display, 21, 60, codec_buf, codec_len);
+}
+
+static void bench_raw_copy(inky_t *display) {
+    memcpy(region_out, display->buffer, FRAME_BYTES);
+    sink = region_out[FRAME_BYTES / 2];
+}
+
+#ifdef HAVE_ZLIB
+static void bench_zlib_compress(inky_t *display) {
+    uLongf len = sizeof(codec_buf);
+    compress2(codec_buf, &len, display->buffer, FRAME_BYTES, Z_BEST_SPEED);
+    codec_len = len;
+    sink = (uint32_t)len;
+}
+
+static void setup_zlib(inky_t *display) {
+    setup_dashboard(display);
+    bench_zlib_compress(display);
+}
+
+static void bench_zlib_uncompress(inky_t *display) {
+    uLongf len = FRAME_BYTES;
+    uncompress(display->buffer, &len, codec_buf, codec_len);
+    sink = (uint32_t)len;
+}
+#endif
+
+// Encoded sizes of the dashboard frame, printed alongside the timings
+static void print_codec_sizes(inky_t *display) {
+    setup_encoded(display);
+    printf("Dashboard frame: raw %d bytes, rle %zu bytes (%.1fx)", FRAME_BYTES, codec_len,
+           (double)FRAME_BYTES / codec_len);
+#ifdef HAVE_ZLIB
+    setup_zlib(display);
+    printf(", zlib -1 %zu bytes (%.1fx)", codec_len, (double)FRAME_BYTES / codec_len);
+#endif
+    printf("\n");
+}
+
+static uint64_t hash_tiles[INKY_WIDTH * INKY_HEIGHT / (INKY_HASH_TILE_W * INKY_HASH_TILE_H) + 64];
+
+static void bench_hash_frame(inky_t *display) {
+    sink = (uint32_t)inky_hash_frame(display, hash_tiles);
+}
+
+// Resampling a 1080p photo-like source to the panel (fit), rows consumed
+// as they come out
+#define PHOTO_W 1920
+#define PHOTO_H 1080
+
+static uint8_t *photo;
+
+static void setup_photo(inky_t *display) {
+    (void)display;
+    if (photo) return;
+    photo = malloc((size_t)PHOTO_W * PHOTO_H * 3);
+    if (!photo) return;
+    for (uint32_t y = 0; y < PHOTO_H; y++) {
+        for (uint32_t x = 0; x < PHOTO_W; x++) {
+            uint8_t *p = photo + ((size_t)y * PHOTO_W + x) * 3;
+            p[0] = (uint8_t)(x * 255 / PHOTO_W);
+            p[1] = (uint8_t)(y * 255 / PHOTO_H);
+            p[2] = (uint8_t)((x ^ y) * 31);
+        }
+    }
+}
+
+static void photo_row(uint16_t y, const float *rgb, void *user_data) {
+    (void)user_data;
+    sink += (uint32_t)rgb[y % INKY_WIDTH];
+}
+
+static void resample_photo(inky_t *display, inky_filter_t filter) {
+    if (!photo) return;
+    inky_resampler_t *r = inky_resampler_create(display, PHOTO_W, PHOTO_H, filter, INKY_SCALE_FIT,
+                                                photo_row, NULL);
+    for (uint32_t y = 0; y < PHOTO_H; y++) {
+        inky_resampler_push_row(r, photo + (size_t)y * PHOTO_W * 3);
+    }
+    inky_resampler_finish(r);
+    inky_resampler_destroy(r);
+}
+
+static void bench_resample_box(inky_t *display) { resample_photo(display, INKY_FILTER_BOX); }
+static void bench_resample_bilinear(inky_t *display) { resample_photo(display, INKY_FILTER_BILINEAR); }
+static void bench_resample_lanczos(inky_t *display) { resample_photo(display, INKY_FILTER_LANCZOS); }
+
+// Quantizing a panel's worth of photo pixels
+static inky_palette_t *palette;
+
+static void setup_palette(inky_t *display) {
+    setup_photo(display);
+    if (!palette) palette = inky_palette_create();
+}
+
+static void bench_palette_lookup(inky_t *display) {
+    (void)display;
+    if (!photo || !palette) return;
+    uint32_t total = 0;
+    for (const uint8_t *p = photo; p < photo + FRAME_PIXELS * 3; p += 3) {
+        total += inky_palette_lookup(palette, p[0], p[1], p[2]);
+    }
+    sink = total;
+}
+
+static void bench_palette_nearest(inky_t *display) {
+    (void)display;
+    if (!photo || !palette) return;
+    uint32_t total = 0;
+    for (const uint8_t *p = photo; p < photo + FRAME_PIXELS * 3; p += 3) {
+        total += inky_palette_nearest(palette, p[0], p[1], p[2]);
+    }
+    sink = total;
+}
+
+static const benchmark_t benchmarks[] = {
+    {"clear",              FRAME_PIXELS, "pixel", FRAME_BYTES,  NULL,          bench_clear},
+    {"set_pixel_sweep",    FRAME_PIXELS, "pixel", FRAME_BYTES,  NULL,          bench_set_pixel},
+    {"get_pixel_sweep",    FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_pattern, bench_get_pixel},
+    {"extract_region",     200 * 35,     "pixel", 200 * 35 / 2, setup_pattern, bench_extract_region},
+    {"extract_full",       FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_pattern, bench_extract_full},
+    {"save_ppm",           FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_pattern, bench_save_ppm},
+    {"stats_record",       1000,         "event", 0,            NULL,          bench_stats_record},
+    {"trace_disabled",     2000,         "event", 0,            NULL,          bench_trace_disabled},
+    {"rle_encode",         FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_dashboard, bench_rle_encode},
+    {"rle_decode",         FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_encoded, bench_rle_decode},
+    {"rle_decode_region",  360 * 200,    "pixel", 360 * 200 / 2, setup_encoded_region, bench_rle_decode_region},
+    {"hash_frame",         FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_dashboard, bench_hash_frame},
+    {"raw_copy",           FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_dashboard, bench_raw_copy},
+    {"resample_box",       PHOTO_W * PHOTO_H, "pixel", 0,  setup_photo,   bench_resample_box},
+    {"resample_bilinear",  PHOTO_W * PHOTO_H, "pixel", 0,  setup_photo,   bench_resample_bilinear},
+    {"resample_lanczos",   PHOTO_W * PHOTO_H, "pixel", 0,  setup_photo,   bench_resample_lanczos},
+    {"palette_lookup",     FRAME_PIXELS, "pixel", 0,            setup_palette, bench_palette_lookup},
+    {"palette_nearest",    FRAME_PIXELS, "pixel", 0,            setup_palette, bench_palette_nearest},
+#ifdef HAVE_ZLIB
+    {"zlib_compress",      FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_dashboard, bench_zlib_compress},
+    {"zlib_uncompress",    FRAME_PIXELS, "pixel", FRAME_BYTES,  setup_zlib,    bench_zlib_uncompress},
+#endif
+};
+
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+// Timing helpers
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double *sorted, int count, double pct) {
+    int index = (int)(pct / 100.0 * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+// Hardware performance counters
+//
+// All counters are opened as one group so they cover exactly the same
+// instructions. Any failure (no PMU, perf_event_paranoid, containers) just
+// leaves the benchmark with wall-clock numbers.
+
+#ifdef __linux__
+static const uint64_t perf_configs[PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static bool perf_open(perf_group_t *group) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        group->fds[i] = -1;
+    }
+    
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = perf_configs[i];
+        attr.disabled = (i == 0);  // The leader starts the whole group
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : group->fds[0], 0);
+        if (fd < 0) {
+            if (i == 0) {
+                fprintf(stderr, "Hardware counters unavailable (%s) - wall-clock only\n", strerror(errno));
+                return false;
+            }
+            fprintf(stderr, "Counter %s unavailable (%s)\n", perf_names[i], strerror(errno));
+            continue;
+        }
+        
+        group->fds[i] = fd;
+        ioctl(fd, PERF_EVENT_IOC_ID, &group->ids[i]);
+    }
+    
+    return true;
+}
+
+static void perf_close(perf_group_t *group) {
+    for (int i = PERF_COUNTERS - 1; i >= 0; i--) {
+        if (group->fds[i] >= 0) close(group->fds[i]);
+        group->fds[i] = -1;
+    }
+}
+
+static void perf_start(perf_group_t *group) {
+    ioctl(group->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Stop the group and store counts divided by calls (scaled if multiplexed)
+static bool perf_stop(perf_group_t *group, double calls, double *counters) {
+    ioctl(group->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    
+    struct {
+        uint64_t nr;
+        uint64_t time_enabled;
+        uint64_t time_running;
+        struct { uint64_t value; uint64_t id; } values[PERF_COUNTERS];
+    } data;
+    
+    if (read(group->fds[0], &data, sizeof(data)) <= 0 || data.time_running == 0) {
+        return false;
+    }
+    
+    double scale = (double)data.time_enabled / data.time_running;
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        counters[i] = -1;
+        for (uint64_t j = 0; j < data.nr && j < PERF_COUNTERS; j++) {
+            if (group->fds[i] >= 0 && data.values[j].id == group->ids[i]) {
+                counters[i] = data.values[j].value * scale / calls;
+            }
+        }
+    }
+    return true;
+}
+#else
+static bool perf_open(perf_group_t *group) {
+    (void)group;
+    fprintf(stderr, "Hardware counters need Linux perf_event_open - wall-clock only\n");
+    return false;
+}
+static void perf_close(perf_group_t *group) { (void)group; }
+static void perf_start(perf_group_t *group) { (void)group; }
+static bool perf_stop(perf_group_t *group, double calls, double *counters) {
+    (void)group; (void)calls; (void)counters;
+    return false;
+}
+#endif
+
+// Library kernels print progress lines; keep them out of the report
+static int quiet_stdout(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+// Returns false if the benchmark could not run
+static bool run_benchmark(inky_t *display, const benchmark_t *bench, int warmup, int reps,
+                          perf_group_t *perf, result_t *result) {
+    double *samples = malloc(reps * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "%s: no memory for %d samples\n", bench->name, reps);
+        return false;
+    }
+    
+    if (bench->setup) bench->setup(display);
+    
+    int saved = quiet_stdout();
+    for (int i = 0; i < warmup; i++) {
+        bench->run(display);
+    }
+    
+    // Calibrate how many calls make up one sample
+    uint64_t start = now_ns();
+    bench->run(display);
+    uint64_t single = now_ns() - start;
+    int batch = single >= MIN_SAMPLE_NS ? 1 : (int)(MIN_SAMPLE_NS / (single + 1)) + 1;
+    
+    if (perf) perf_start(perf);
+    for (int i = 0; i < reps; i++) {
+        start = now_ns();
+        for (int j = 0; j < batch; j++) {
+            bench->run(display);
+        }
+        samples[i] = (double)(now_ns() - start) / batch;
+    }
+    result->has_counters = perf && perf_stop(perf, (double)reps * batch, result->counters);
+    restore_stdout(saved);
+    
+    qsort(samples, reps, sizeof(double), compare_double);
+    result->name = bench->name;
+    result->unit = bench->unit;
+    result->items = bench->items;
+    result->bytes = bench->bytes;
+    result->reps = reps;
+    result->median_ns = percentile(samples, reps, 50);
+    result->p99_ns = percentile(samples, reps, 99);
+    result->min_ns = samples[0];
+    
+    free(samples);
+    return true;
+}
+
+// JSON output and baseline comparison
+
+static int write_json(const char *filename, const result_t *results, int count) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        perror("Failed to open JSON output");
+        return -1;
+    }
+    
+    fprintf(fp, "{\n  \"benchmarks\": [\n");
+    for (int i = 0; i < count; i++) {
+        const result_t *r = &results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"reps\": %d, \"items\": %.0f, \"unit\": \"%s\", "
+                    "\"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, \"ns_per_item\": %.3f",
+                r->name, r->reps, r->items, r->unit, r->median_ns, r->p99_ns, r->min_ns,
+                r->median_ns / r->items);
+        if (r->has_counters) {
+            fprintf(fp, ", \"perf\": {");
+            bool first = true;
+            for (int c = 0; c < PERF_COUNTERS; c++) {
+                if (r->counters[c] < 0) continue;
+                fprintf(fp, "%s\"%s_per_item\": %.4f", first ? "" : ", ",
+                        perf_names[c], r->counters[c] / r->items);
+                if (r->bytes > 0) {
+                    fprintf(fp, ", \"%s_per_byte\": %.4f", perf_names[c], r->counters[c] / r->bytes);
+                }
+                first = false;
+            }
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    
+    fclose(fp);
+    return 0;
+}
+
+// Find "median_ns" for a named benchmark in a file written by write_json()
+static bool baseline_median(const char *json, const char *name, double *median) {
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    
+    const char *entry = strstr(json, key);
+    if (!entry) return false;
+    
+    const char *field = strstr(entry, "\"median_ns\":");
+    const char *end = strchr(entry, '}');
+    if (!field || (end && field > end)) return false;
+    
+    *median = strtod(field + strlen("\"median_ns\":"), NULL);
+    return *median > 0;
+}
+
+static char *read_file(const char *filename) {
+    FILE *fp = fopen(filename, "r");
+    if (!fp) return NULL;
+    
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    char *data = malloc(size + 1);
+    if (data) {
+        size_t got = fread(data, 1, size, fp);
+        data[got] = '\0';
+    }
+    fclose(fp);
+    return data;
+}
+
+// Returns the number of benchmarks slower than the baseline by more than threshold percent
+static int compare_baseline(const char *filename, const result_t *results, int count, double threshold) {
+    char *json = read_file(filename);
+    if (!json) {
+        fprintf(stderr, "No baseline at %s - skipping comparison\n", filename);
+        return 0;
+    }
+    
+    int regressions = 0;
+    printf("\nComparison against %s (threshold %.0f%%)\n", filename, threshold);
+    for (int i = 0; i < count; i++) {
+        double base;
+        if (!baseline_median(json, results[i].name, &base)) {
+            printf("  %-18s   (not in baseline)\n", results[i].name);
+            continue;
+        }
+        
+        double change = (results[i].median_ns - base) / base * 100.0;
+        bool regressed = change > threshold;
+        printf("  %-18s %+7.1f%%%s\n", results[i].name, change, regressed ? "  REGRESSION" : "");
+        regressions += regressed;
+    }
+    
+    free(json);
+    return regressions;
+}
+
+static void print_counters(const result_t *results, int count) {
+    printf("\nHardware counters (per item / per byte)\n");
+    printf("%-18s %14s %14s %8s %16s %16s\n", "benchmark", "cycles", "instructions", "IPC",
+           "cache misses", "branch misses");
+    
+    for (int i = 0; i < count; i++) {
+        const result_t *r = &results[i];
+        if (!r->has_counters) {
+            printf("%-18s   (no counters)\n", r->name);
+            continue;
+        }
+        
+        printf("%-18s", r->name);
+        for (int c = 0; c < PERF_COUNTERS; c++) {
+            if (c == PERF_CACHE_MISSES) {
+                double ipc = (r->counters[PERF_CYCLES] > 0 && r->counters[PERF_INSTRUCTIONS] >= 0)
+                           ? r->counters[PERF_INSTRUCTIONS] / r->counters[PERF_CYCLES] : 0;
+                printf(" %8.2f", ipc);
+            }
+            int width = c < PERF_CACHE_MISSES ? 14 : 16;
+            if (r->counters[c] < 0) {
+                printf(" %*s", width, "n/a");
+            } else if (r->bytes > 0) {
+                char cell[40];
+                snprintf(cell, sizeof(cell), "%.2f/%.2f", r->counters[c] / r->items, r->counters[c] / r->bytes);
+                printf(" %*s", width, cell);
+            } else {
+                printf(" %*.2f", width, r->counters[c] / r->items);
+            }
+        }
+        printf("\n");
+    }
+}
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("Options:\n");
+    printf("  --reps N          Timed repetitions per benchmark (default: 50)\n");
+    printf("  --warmup N        Untimed warm-up repetitions (default: 5)\n");
+    printf("  --filter TEXT     Only run benchmarks whose name contains TEXT\n");
+    printf("  --json FILE       Write results as JSON\n");
+    printf("  --baseline FILE   Compare medians against a previous JSON run\n");
+    printf("  --threshold PCT   Allowed slowdown before failing (default: 25)\n");
+    printf("  --perf            Collect hardware counters (cycles, instructions,\n");
+    printf("                    cache misses, branch misses) with perf_event_open\n");
+}
+
+int main(int argc, char *argv[]) {
+    int reps = 50;
+    int warmup = 5;
+    const char *filter = NULL;
+    const char *json_file = NULL;
+    const char *baseline_file = NULL;
+    double threshold = 25.0;
+    bool use_perf = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_file = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            use_perf = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (reps < 1) reps = 1;
+    if (warmup < 0) warmup = 0;
+    
+    inky_t *display = inky_init(true);
+    if (!display) {
+        fprintf(stderr, "Failed to initialize emulator display\n");
+        return 1;
+    }
+    
+    perf_group_t perf_group;
+    perf_group_t *perf = NULL;
+    if (use_perf && perf_open(&perf_group)) {
+        perf = &perf_group;
+    }
+    
+    result_t results[MAX_RESULTS];
+    int count = 0;
+    int failed = 0;
+    
+    printf("Inky Benchmarks (%d reps, %d warm-up)\n", reps, warmup);
+    printf("%-18s %12s %12s %12s\n", "benchmark", "median", "p99", "per item");
+    
+    for (size_t i = 0; i < BENCHMARK_COUNT && count < MAX_RESULTS; i++) {
+        if (filter && !strstr(benchmarks[i].name, filter)) continue;
+        
+        result_t *r = &results[count];
+        if (!run_benchmark(display, &benchmarks[i], warmup, reps, perf, r)) {
+            failed++;
+            continue;
+        }
+        count++;
+        printf("%-18s %10.1fus %10.1fus %9.2fns/%s\n", r->name,
+               r->median_ns / 1000.0, r->p99_ns / 1000.0, r->median_ns / r->items, r->unit);
+    }
+    
+    if (!filter || strstr(filter, "rle") || strstr(filter, "zlib")) {
+        print_codec_sizes(display);
+    }
+    
+    if (perf) {
+        print_counters(results, count);
+        perf_close(perf);
+    }
+    
+    inky_destroy(display);
+    unlink(ppm_path);
+    
+    if (json_file && write_json(json_file, results, count) == 0) {
+        printf("Wrote %s\n", json_file);
+    }
+    
+    int regressions = 0;
+    if (baseline_file) {
+        regressions = compare_baseline(baseline_file, results, count, threshold);
+        if (regressions > 0) {
+            printf("%d benchmark(s) regressed\n", regressions);
+        }
+    }
+    
+    return regressions > 0 || failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,539 @@
+/*
+ * Batch converter: images to panel-ready packed frames
+ * Decodes, scales, dithers and packs every input on a pool of worker
+ * threads. Runs on the emulator backend, so any Linux box will do.
+ */
+
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Inputs are netpbm images (P5 grayscale, P6 RGB, 8 or 16 bit). Each worker
+// streams its image a row at a time through an inky_resampler_t: source rows
+// are read and pushed, and every panel row the resampler finishes is
+// dithered against the palette (one lookup table load per pixel) and packed
+// at once, so a worker holds one source row, the resampler's row window and
+// a few panel rows no matter how large the image is.
+
+#define MAX_SOURCE_WIDTH   16384   // Caps the per-worker source row buffer
+#define IO_BUFFER_SIZE     65536
+
+typedef enum {
+    FORMAT_RAW,   // buffer_size packed bytes, as in display->buffer
+    FORMAT_RLE    // inky_buffer_encode() stream
+} output_format_t;
+
+typedef struct {
+    const char *output_dir;
+    output_format_t format;
+    inky_filter_t filter;
+    inky_scale_mode_t mode;
+    inky_palette_t *palette;    // Shared by all workers (lookups are read-only)
+    bool dither;
+    bool verbose;
+} options_t;
+
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t next;         // Next path to claim (atomic)
+    const options_t *options;
+} job_t;
+
+typedef struct {
+    pthread_t thread;
+    job_t *job;
+    inky_t *display;     // Emulated panel whose buffer receives the packed frame
+    
+    // Per-worker buffers, reused for every image
+    uint8_t *src_row;
+    size_t src_row_capacity;
+    uint8_t *rgb_row;    // Source row as 8-bit RGB, for the resampler
+    float *err;          // Two rows of dithering error
+    uint8_t *io_buffer;
+    uint8_t *encoded;
+    size_t encoded_capacity;
+    
+    // Results
+    size_t images;
+    size_t failures;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} worker_t;
+
+typedef struct {
+    FILE *fp;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;   // 1 (P5) or 3 (P6)
+    uint32_t sample_bytes;
+    uint32_t maxval;
+} image_t;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [options] INPUT...\n", prog_name);
+    printf("INPUT is a .ppm/.pgm/.pnm file or a directory of them\n");
+    printf("Options:\n");
+    printf("  --list FILE     Read input paths from FILE, one per line (- for stdin)\n");
+    printf("  --output DIR    Directory for converted frames (default: .)\n");
+    printf("  --format F      raw (packed 4bpp, .inky) or rle (inky_buffer_encode, .inkyrle)\n");
+    printf("  --jobs N        Worker threads (default: one per core)\n");
+    printf("  --mode M        fit (letterbox, default), fill (crop to cover), crop (no scaling)\n");
+    printf("                  or stretch (ignore aspect ratio)\n");
+    printf("  --filter F      box (default), bilinear or lanczos\n");
+    printf("  --stretch       Same as --mode stretch\n");
+    printf("  --palette FILE  Measured panel colors, one \"R G B\" line per color\n");
+    printf("  --no-dither     Nearest color instead of Floyd-Steinberg dithering\n");
+    printf("  --verbose       Print every converted image\n");
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Input collection
+
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t capacity;
+} path_list_t;
+
+static bool add_path(path_list_t *list, const char *path) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        char **paths = realloc(list->paths, capacity * sizeof(char *));
+        if (!paths) return false;
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    list->paths[list->count] = strdup(path);
+    return list->paths[list->count++] != NULL;
+}
+
+static bool is_image_name(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot && (strcasecmp(dot, ".ppm") == 0 || strcasecmp(dot, ".pgm") == 0 ||
+                   strcasecmp(dot, ".pnm") == 0);
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool add_input(path_list_t *list, const char *path) {
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return add_path(list, path);
+    }
+    
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    
+    size_t first = list->count;
+    struct dirent *entry;
+    char full[4096];
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_image_name(entry->d_name)) continue;
+        snprintf(full, sizeof(full), "%s/%s", path, entry->d_name);
+        if (!add_path(list, full)) break;
+    }
+    closedir(dir);
+    
+    // Directory order is arbitrary; sorted input gives stable output
+    qsort(list->paths + first, list->count - first, sizeof(char *), compare_paths);
+    return true;
+}
+
+static bool add_list_file(path_list_t *list, const char *filename) {
+    FILE *fp = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] && !add_path(list, line)) break;
+    }
+    
+    if (fp != stdin) fclose(fp);
+    return true;
+}
+
+// Netpbm decoding
+
+static bool read_header_value(FILE *fp, uint32_t *value) {
+    int c = fgetc(fp);
+    while (c != EOF && (isspace(c) || c == '#')) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = fgetc(fp);
+        }
+        c = fgetc(fp);
+    }
+    
+    uint64_t v = 0;
+    bool digits = false;
+    while (c != EOF && isdigit(c)) {
+        v = v * 10 + (uint64_t)(c - '0');
+        if (v > UINT32_MAX) return false;
+        digits = true;
+        c = fgetc(fp);
+    }
+    *value = (uint32_t)v;
+    return digits;  // The single whitespace after the last value is consumed
+}
+
+static bool open_image(worker_t *w, const char *path, image_t *img) {
+    img->fp = fopen(path, "rb");
+    if (!img->fp) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    setvbuf(img->fp, (char *)w->io_buffer, _IOFBF, IO_BUFFER_SIZE);
+    
+    char magic[2];
+    if (fread(magic, 1, 2, img->fp) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6') ||
+        !read_header_value(img->fp, &img->width) || !read_header_value(img->fp, &img->height) ||
+        !read_header_value(img->fp, &img->maxval) ||
+        img->width == 0 || img->height == 0 || img->maxval == 0 || img->maxval > 65535) {
+        fprintf(stderr, "%s: not a binary PPM/PGM image\n", path);
+        fclose(img->fp);
+        return false;
+    }
+    if (img->width > MAX_SOURCE_WIDTH) {
+        fprintf(stderr, "%s: %u pixels wide, limit is %d\n", path, img->width, MAX_SOURCE_WIDTH);
+        fclose(img->fp);
+        return false;
+    }
+    
+    img->channels = magic[1] == '6' ? 3 : 1;
+    img->sample_bytes = img->maxval > 255 ? 2 : 1;
+    
+    size_t row_bytes = (size_t)img->width * img->channels * img->sample_bytes;
+    if (row_bytes > w->src_row_capacity) {
+        uint8_t *row = realloc(w->src_row, row_bytes);
+        if (!row) {
+            fclose(img->fp);
+            return false;
+        }
+        w->src_row = row;
+        w->src_row_capacity = row_bytes;
+    }
+    return true;
+}
+
+// Source row to 8-bit RGB
+static void expand_row(worker_t *w, const image_t *img) {
+    const uint8_t *p = w->src_row;
+    uint32_t scale = img->maxval;
+    
+    for (uint32_t x = 0; x < img->width; x++) {
+        for (uint32_t c = 0; c < 3; c++) {
+            uint32_t ch = img->channels == 3 ? c : 0;
+            const uint8_t *s = p + ((size_t)x * img->channels + ch) * img->sample_bytes;
+            uint32_t v = img->sample_bytes == 2 ? (uint32_t)(s[0] << 8 | s[1]) : s[0];
+            w->rgb_row[x * 3 + c] = (uint8_t)(scale == 255 ? v : v * 255 / scale);
+        }
+    }
+}
+
+static uint8_t to_byte(float v) {
+    return v <= 0 ? 0 : v >= 255 ? 255 : (uint8_t)(v + 0.5f);
+}
+
+// Dither and pack one finished panel row
+static void quantize_row(uint16_t y, const float *row, void *user_data) {
+    worker_t *w = user_data;
+    bool dither = w->job->options->dither;
+    const inky_palette_t *palette = w->job->options->palette;
+    uint32_t width = w->display->width;
+    size_t err_stride = (size_t)(width + 2) * 3;
+    float *cur = w->err + (y & 1) * err_stride;
+    float *next = w->err + ((y + 1) & 1) * err_stride;
+    memset(next, 0, err_stride * sizeof(float));
+    
+    uint8_t *packed = w->display->buffer + (size_t)y * width / 2;
+    for (uint32_t x = 0; x < width; x++) {
+        float rgb[3] = {row[x * 3], row[x * 3 + 1], row[x * 3 + 2]};
+        if (dither) {
+            for (int c = 0; c < 3; c++) rgb[c] += cur[(x + 1) * 3 + c];
+        }
+        uint8_t color = inky_palette_lookup(palette, to_byte(rgb[0]), to_byte(rgb[1]), to_byte(rgb[2]));
+        if (dither) {
+            const uint8_t *shown = inky_palette_get_rgb(palette, color);
+            for (int c = 0; c < 3; c++) {
+                float e = rgb[c] - shown[c];
+                cur[(x + 2) * 3 + c] += e * (7.0f / 16);
+                next[x * 3 + c] += e * (3.0f / 16);
+                next[(x + 1) * 3 + c] += e * (5.0f / 16);
+                next[(x + 2) * 3 + c] += e * (1.0f / 16);
+            }
+        }
+        
+        if (x & 1) {
+            packed[x / 2] = (packed[x / 2] & 0xF0) | color;
+        } else {
+            packed[x / 2] = (uint8_t)(color << 4) | (packed[x / 2] & 0x0F);
+        }
+    }
+}
+
+// Decode, scale, quantize and pack one image into w->display->buffer
+static bool convert_image(worker_t *w, const char *path, const options_t *options) {
+    image_t img;
+    if (!open_image(w, path, &img)) return false;
+    
+    inky_resampler_t *resampler = inky_resampler_create(w->display, img.width, img.height,
+                                                        options->filter, options->mode,
+                                                        quantize_row, w);
+    if (!resampler) {
+        fprintf(stderr, "%s: cannot resample %ux%u\n", path, img.width, img.height);
+        fclose(img.fp);
+        return false;
+    }
+    memset(w->err, 0, 2 * (size_t)(w->display->width + 2) * 3 * sizeof(float));
+    
+    size_t row_bytes = (size_t)img.width * img.channels * img.sample_bytes;
+    bool ok = true;
+    for (uint32_t y = 0; y < img.height; y++) {
+        if (fread(w->src_row, 1, row_bytes, img.fp) != row_bytes) {
+            fprintf(stderr, "%s: truncated image data\n", path);
+            ok = false;
+            break;
+        }
+        w->bytes_in += row_bytes;
+        expand_row(w, &img);
+        inky_resampler_push_row(resampler, w->rgb_row);
+    }
+    if (ok && inky_resampler_finish(resampler) < 0) ok = false;
+    
+    inky_resampler_destroy(resampler);
+    fclose(img.fp);
+    return ok;
+}
+
+static bool write_output(worker_t *w, const char *path, const options_t *options) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    int stem = dot ? (int)(dot - base) : (int)strlen(base);
+    
+    char out_path[4096];
+    snprintf(out_path, sizeof(out_path), "%s/%.*s%s", options->output_dir, stem, base,
+             options->format == FORMAT_RLE ? ".inkyrle" : ".inky");
+    
+    const uint8_t *data = w->display->buffer;
+    size_t len = w->display->buffer_size;
+    if (options->format == FORMAT_RLE) {
+        len = inky_buffer_encode(w->display, 0, 0, w->display->width, w->display->height,
+                                 w->encoded, w->encoded_capacity);
+        data = w->encoded;
+    }
+    
+    FILE *fp = fopen(out_path, "wb");
+    bool ok = fp && len > 0 && fwrite(data, 1, len, fp) == len;
+    if (fp && fclose(fp) != 0) ok = false;
+    if (!ok) {
+        fprintf(stderr, "%s: %s\n", out_path, strerror(errno));
+        return false;
+    }
+    
+    w->bytes_out += len;
+    if (options->verbose) {
+        printf("%s -> %s (%zu bytes)\n", path, out_path, len);
+    }
+    return true;
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = arg;
+    job_t *job = w->job;
+    
+    for (;;) {
+        size_t index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->count) break;
+        
+        const char *path = job->paths[index];
+        if (convert_image(w, path, job->options) && write_output(w, path, job->options)) {
+            w->images++;
+        } else {
+            w->failures++;
+        }
+    }
+    return NULL;
+}
+
+static bool worker_init(worker_t *w, job_t *job) {
+    memset(w, 0, sizeof(*w));
+    w->job = job;
+    w->display = inky_init(true);
+    if (!w->display) return false;
+    
+    size_t width = w->display->width;
+    w->rgb_row = malloc(MAX_SOURCE_WIDTH * 3);
+    w->err = malloc(2 * (width + 2) * 3 * sizeof(float));
+    w->io_buffer = malloc(IO_BUFFER_SIZE);
+    w->encoded_capacity = inky_buffer_encode_bound(w->display->width, w->display->height);
+    w->encoded = malloc(w->encoded_capacity);
+    return w->rgb_row && w->err && w->io_buffer && w->encoded;
+}
+
+static void worker_free(worker_t *w) {
+    inky_destroy(w->display);
+    free(w->src_row);
+    free(w->rgb_row);
+    free(w->err);
+    free(w->io_buffer);
+    free(w->encoded);
+}
+
+int main(int argc, char *argv[]) {
+    options_t options = {".", FORMAT_RAW, INKY_FILTER_BOX, INKY_SCALE_FIT, NULL, true, false};
+    const char *palette_file = NULL;
+    path_list_t inputs = {NULL, 0, 0};
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    bool ok = true;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            ok = add_list_file(&inputs, argv[++i]) && ok;
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.output_dir = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char *format = argv[++i];
+            if (strcmp(format, "raw") == 0) {
+                options.format = FORMAT_RAW;
+            } else if (strcmp(format, "rle") == 0) {
+                options.format = FORMAT_RLE;
+            } else {
+                fprintf(stderr, "Unknown format: %s\n", format);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (strcmp(mode, "fit") == 0) {
+                options.mode = INKY_SCALE_FIT;
+            } else if (strcmp(mode, "fill") == 0) {
+                options.mode = INKY_SCALE_FILL;
+            } else if (strcmp(mode, "crop") == 0) {
+                options.mode = INKY_SCALE_CROP;
+            } else if (strcmp(mode, "stretch") == 0) {
+                options.mode = INKY_SCALE_STRETCH;
+            } else {
+                fprintf(stderr, "Unknown mode: %s\n", mode);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            const char *filter = argv[++i];
+            if (strcmp(filter, "box") == 0) {
+                options.filter = INKY_FILTER_BOX;
+            } else if (strcmp(filter, "bilinear") == 0) {
+                options.filter = INKY_FILTER_BILINEAR;
+            } else if (strcmp(filter, "lanczos") == 0) {
+                options.filter = INKY_FILTER_LANCZOS;
+            } else {
+                fprintf(stderr, "Unknown filter: %s\n", filter);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stretch") == 0) {
+            options.mode = INKY_SCALE_STRETCH;
+        } else if (strcmp(argv[i], "--palette") == 0 && i + 1 < argc) {
+            palette_file = argv[++i];
+        } else if (strcmp(argv[i], "--no-dither") == 0) {
+            options.dither = false;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            options.verbose = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            ok = add_input(&inputs, argv[i]) && ok;
+        }
+    }
+    
+    if (inputs.count == 0) {
+        fprintf(stderr, "No input images\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (jobs < 1) jobs = 1;
+    if ((size_t)jobs > inputs.count) jobs = (long)inputs.count;
+    
+    options.palette = inky_palette_create();
+    if (!options.palette || (palette_file && inky_palette_load(options.palette, palette_file) != 0)) {
+        inky_palette_destroy(options.palette);
+        return 1;
+    }
+    
+    job_t job = {inputs.paths, inputs.count, 0, &options};
+    worker_t *workers = calloc((size_t)jobs, sizeof(worker_t));
+    if (!workers) return 1;
+    
+    double start = now_s();
+    long started = 0;
+    for (long i = 0; i < jobs; i++) {
+        if (!worker_init(&workers[i], &job)) {
+            fprintf(stderr, "Failed to set up worker %ld\n", i);
+            worker_free(&workers[i]);
+            break;
+        }
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            worker_free(&workers[i]);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "No workers could be started\n");
+        return 1;
+    }
+    
+    size_t images = 0, failures = 0;
+    uint64_t bytes_in = 0, bytes_out = 0;
+    for (long i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        images += workers[i].images;
+        failures += workers[i].failures;
+        bytes_in += workers[i].bytes_in;
+        bytes_out += workers[i].bytes_out;
+        worker_free(&workers[i]);
+    }
+    double elapsed = now_s() - start;
+    
+    printf("Converted %zu images (%zu failed) with %ld workers in %.2f s: %.1f images/s\n",
+           images, failures, started, elapsed, elapsed > 0 ? images / elapsed : 0.0);
+    printf("Read %.1f MB of pixels, wrote %.1f MB\n", bytes_in / 1e6, bytes_out / 1e6);
+    
+    for (size_t i = 0; i < inputs.count; i++) {
+        free(inputs.paths[i]);
+    }
+    free(inputs.paths);
+    free(workers);
+    inky_palette_destroy(options.palette);
+    return ok && failures == 0 ? 0 : 1;
+}
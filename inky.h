@@ -25,12 +25,42 @@
 #define INKY_BUTTON_C 2
 #define INKY_BUTTON_D 3
 
+// Update types
+typedef enum {
+    INKY_UPDATE_FULL = 0,
+    INKY_UPDATE_PARTIAL = 1
+} inky_update_type_t;
+#define INKY_UPDATE_TYPES 2
+
+// Temperature value when the controller sensor could not be read
+#define INKY_TEMP_UNKNOWN (-128)
+
 // Opaque display context - implementation details hidden
 typedef struct inky_display inky_t;
 
+// Per-display configuration for inky_init_ex()
+// Start from inky_config_default() and override what differs, e.g. a second
+// panel on /dev/spidev1.0 with its own RESET/BUSY/DC/CS lines.
+typedef struct {
+    bool emulator;
+    const char *spi_device;   // Default "/dev/spidev0.0"
+    const char *gpio_device;  // Default "/dev/gpiochip0"
+    uint32_t spi_speed_hz;    // Default 3 MHz
+    int reset_pin;            // BCM numbering
+    int busy_pin;
+    int dc_pin;
+    int cs_pin;
+} inky_config_t;
+
+// Fill a config with the Inky Impression HAT defaults
+void inky_config_default(inky_config_t *config);
+
 // Initialize display (emulator or hardware based on parameter)
 inky_t* inky_init(bool emulator);
 
+// Initialize display with explicit pins and devices (strings are copied)
+inky_t* inky_init_ex(const inky_config_t *config);
+
 // Clean up and free resources
 void inky_destroy(inky_t *display);
 
@@ -49,6 +79,11 @@ void inky_set_border(inky_t *display, uint8_t color);
 // Update the physical display with buffer contents
 void inky_update(inky_t *display);
 
+// Update several panels at once
+// Frames are sent one after another, then all panels refresh at the same
+// time, so the call takes about one refresh rather than one per panel
+void inky_update_many(inky_t **displays, size_t count);
+
 // Update only a specific region of the display (faster than full update)
 // x, y: top-left corner of the region to update
 // width, height: dimensions of the region to update
@@ -63,14 +98,424 @@ bool inky_should_full_refresh(inky_t *display);
 // Get the number of partial updates since last full refresh
 int inky_get_partial_count(inky_t *display);
 
+// Unchanged content
+// Updates whose pixels (and border, for full updates) match what was last
+// sent are skipped and counted in inky_stats_t.skipped. A full update after
+// partial updates always goes out, since it clears their ghosting. While
+// force is set every update is sent regardless.
+void inky_set_force_update(inky_t *display, bool force);
+
+// Power management
+// By default the controller is put into deep sleep after every update and
+// woken with a short reset plus a cached register replay before the next one.
+void inky_set_auto_sleep(inky_t *display, bool enable);
+
+// Put the controller into deep sleep now (the next update wakes it)
+void inky_sleep(inky_t *display);
+
+// Time taken by the most recent wake from deep sleep until the controller
+// was ready for data, in microseconds (0 if it has not been woken yet)
+uint32_t inky_get_wake_latency_us(inky_t *display);
+
+// Refresh timing
+// Refresh durations are learned per update type and temperature band; the
+// busy wait sleeps through most of the predicted time before polling BUSY.
+
+// Predicted duration in milliseconds of a refresh at the current temperature
+uint32_t inky_estimate_refresh_ms(inky_t *display, inky_update_type_t type);
+
+// Milliseconds until the refresh in progress is expected to finish
+// (0 when idle). Safe to call from another thread while an update blocks.
+uint32_t inky_get_refresh_eta_ms(inky_t *display);
+
+// Last panel temperature read from the controller in degrees C
+// (INKY_TEMP_UNKNOWN if the sensor has not been read or is unavailable)
+int inky_get_temperature(inky_t *display);
+
+// Update statistics
+// Every hardware update is split into phases whose durations are collected
+// into power-of-two histograms (bucket i counts durations in [2^i, 2^(i+1))
+// microseconds; bucket 0 also holds 0us).
+typedef enum {
+    INKY_PHASE_SETUP = 0,     // Wake from sleep, temperature read
+    INKY_PHASE_WINDOW,        // Partial window set
+    INKY_PHASE_TRANSFER,      // Pixel data over SPI
+    INKY_PHASE_PON,           // Power on settle
+    INKY_PHASE_REFRESH,       // DRF until BUSY released
+    INKY_PHASE_POF,           // Power off settle
+    INKY_PHASE_EXTRACT,       // Region extraction for partial updates
+    INKY_PHASE_COUNT
+} inky_phase_t;
+
+#define INKY_HIST_BUCKETS 27  // Up to ~67 seconds
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t buckets[INKY_HIST_BUCKETS];
+} inky_histogram_t;
+
+// Milestones of the most recent update on the display clock (CLOCK_MONOTONIC
+// on hardware), in microseconds; 0 until reached. Transfer is the pixel data
+// sent over SPI, busy the end of the refresh (BUSY released) and complete
+// the panel powered off again.
+typedef struct {
+    uint64_t submit_us;
+    uint64_t transfer_us;
+    uint64_t busy_us;
+    uint64_t complete_us;
+} inky_update_timeline_t;
+
+typedef struct {
+    inky_histogram_t phases[INKY_UPDATE_TYPES][INKY_PHASE_COUNT];
+    uint64_t updates[INKY_UPDATE_TYPES];
+    uint64_t skipped[INKY_UPDATE_TYPES];  // Updates dropped because nothing changed
+    uint64_t bytes_sent;      // SPI payload bytes including commands
+    uint64_t commands_sent;
+    uint64_t syscalls;        // SPI writes and GPIO ioctls
+    inky_update_timeline_t last_update;
+} inky_stats_t;
+
+// Copy the statistics collected so far. Returns 0 on success, -1 on error
+int inky_get_stats(inky_t *display, inky_stats_t *stats);
+
+// Clear all statistics
+void inky_reset_stats(inky_t *display);
+
+// Short name of a phase ("setup", "transfer", ...)
+const char *inky_phase_name(inky_phase_t phase);
+
+// Approximate percentile (0-100) of a histogram in microseconds
+uint32_t inky_histogram_percentile(const inky_histogram_t *hist, double percentile);
+
+// Tracing
+// Begin/end events for updates, controller commands, busy waits and button
+// callbacks are collected into an in-memory ring and written out as Chrome
+// trace JSON (chrome://tracing, ui.perfetto.dev). Timestamps are
+// CLOCK_MONOTONIC microseconds. When tracing is off each event costs one
+// predictable branch.
+
+// Start collecting; capacity (events, rounded up to a power of two) is fixed
+// by the first call. Returns 0 on success, -1 on allocation failure
+int inky_trace_enable(size_t capacity);
+
+// Stop collecting (buffered events are kept until flushed)
+void inky_trace_disable(void);
+
+// Write events collected since the last flush. Returns the event count or -1
+int inky_trace_flush(const char *filename);
+
+// Application spans on the same timeline (name must stay valid until flushed)
+void inky_trace_begin(const char *name);
+void inky_trace_end(const char *name);
+void inky_trace_instant(const char *name);
+
+// Clocks
+// The emulator can simulate refresh latency against an injectable clock:
+// real time, real time sped up by a factor, or a virtual clock that only
+// moves when slept on or advanced (hours of traffic in milliseconds).
+typedef struct inky_clock inky_clock_t;
+
+typedef enum {
+    INKY_CLOCK_REAL = 0,
+    INKY_CLOCK_SCALED,
+    INKY_CLOCK_VIRTUAL
+} inky_clock_mode_t;
+
+// scale is only used by INKY_CLOCK_SCALED (e.g. 60 = one minute per second)
+inky_clock_t *inky_clock_create(inky_clock_mode_t mode, double scale);
+void inky_clock_destroy(inky_clock_t *clock);
+
+// Current time in microseconds (NULL clock = CLOCK_MONOTONIC)
+uint64_t inky_clock_now_us(inky_clock_t *clock);
+
+// Sleep on the clock (virtual clocks advance instantly)
+void inky_clock_sleep_us(inky_clock_t *clock, uint64_t us);
+
+// Fast-forward a virtual clock (no-op for other modes)
+void inky_clock_advance_us(inky_clock_t *clock, uint64_t us);
+
+inky_clock_mode_t inky_clock_get_mode(inky_clock_t *clock);
+
+// Emulator refresh timing model
+// With a clock attached, emulated updates take as long as the real panel
+// would - data transfer at the SPI speed, power on/off settle and a refresh
+// that depends on update type, updated area and temperature - and feed the
+// same refresh estimates and statistics as hardware. Without a clock
+// (default) emulated updates return instantly. The clock is not owned.
+void inky_emulator_set_clock(inky_t *display, inky_clock_t *clock);
+
+// Panel temperature used by the emulator timing model (default 22C)
+void inky_emulator_set_temperature(inky_t *display, int celsius);
+
 // Save current display buffer as PPM image (works with both emulator and hardware)
+// Emulator frames include simulated ghosting from partial refreshes and
+// carry their ghost score in a "# ghost_score" header comment.
 // Returns 0 on success, -1 on error
 int inky_emulator_save_ppm(inky_t *display, const char *filename);
 
+// How visible partial refresh ghosting is on the current emulated frame:
+// 0 = clean, 100 = every pixel shows a full-strength black/white residue.
+// Always 0 on hardware.
+double inky_emulator_ghost_score(inky_t *display);
+
+// Live shared-memory framebuffer (emulator, Linux)
+// The emulator publishes every refreshed frame as RGB rows in a shared
+// segment: a header page followed by height rows of stride bytes. Only rows
+// that changed are rewritten. seq is odd while a frame is being written and
+// even once it is complete, and doubles as a futex word viewers can sleep on.
+// The dirty rectangle covers what changed between seq - 2 and seq; a viewer
+// that skipped frames should treat the whole frame as dirty.
+#define INKY_SHM_MAGIC   0x594b4e49  // "INKY"
+#define INKY_SHM_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;         // Bytes per RGB row
+    uint32_t data_offset;    // Pixel rows start this far into the segment
+    uint32_t seq;            // Futex word: odd = writing, even = stable
+    uint32_t dirty_x;
+    uint32_t dirty_y;
+    uint32_t dirty_w;        // 0 if the last refresh changed nothing
+    uint32_t dirty_h;
+    uint32_t rows_written;   // Rows rewritten by the last refresh
+    uint64_t frame;          // Completed frames
+    uint64_t timestamp_us;   // Display clock when the frame completed
+} inky_shm_header_t;
+
+// Publish an emulated display. name = shm_open() name (e.g. "/inky"), or
+// NULL for an anonymous memfd to hand to another process.
+// Returns the segment fd (owned by the display) or -1. A named segment is
+// unlinked again by inky_emulator_unshare() / inky_destroy().
+int inky_emulator_share(inky_t *display, const char *name);
+void inky_emulator_unshare(inky_t *display);
+
+// Viewer side: map a segment by shm_open() name or by fd (read-only)
+const inky_shm_header_t *inky_shm_open(const char *name);
+const inky_shm_header_t *inky_shm_map(int fd);
+void inky_shm_close(const inky_shm_header_t *shm);
+const uint8_t *inky_shm_pixels(const inky_shm_header_t *shm);
+
+// Wait until a complete frame newer than last_seq is published.
+// Returns its seq, or -1 on timeout (timeout_ms < 0 waits forever).
+int64_t inky_shm_wait(const inky_shm_header_t *shm, uint32_t last_seq, int timeout_ms);
+
+// Reading a stable frame: the writer may start the next one at any time,
+// so copy the header fields and pixels you need between these two and
+// repeat while retry returns true:
+//     do {
+//         seq = inky_shm_read_begin(shm);
+//         ...copy dirty_*, pixels...
+//     } while (inky_shm_read_retry(shm, seq));
+// begin waits out a frame being written and returns the (even) seq the
+// copy belongs to. Never act on a copy before retry has returned false.
+uint32_t inky_shm_read_begin(const inky_shm_header_t *shm);
+bool inky_shm_read_retry(const inky_shm_header_t *shm, uint32_t seq);
+
+// Run-length codec for packed framebuffers
+// E-ink frames are mostly flat color, so runs of identical packed bytes
+// compress well. The encoded form carries the rectangle size and can be
+// decoded straight into any display at any position.
+size_t inky_buffer_encode_bound(uint16_t width, uint16_t height);
+// Encode a rectangle of the display (0, 0, width, height = whole panel).
+// Returns the encoded size, or 0 if out is smaller than the bound or the
+// rectangle is out of range.
+size_t inky_buffer_encode(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                          uint8_t *out, size_t capacity);
+// Decode into the display with the top-left corner at (x, y). Returns 0, or -1
+// for a corrupt stream or a rectangle that does not fit.
+int inky_buffer_decode(inky_t *display, uint16_t x, uint16_t y, const uint8_t *in, size_t len);
+
+// Pre-rendered frame cache (emulator and hardware)
+// A file of page-aligned packed frames for content that is shown again and
+// again. Showing a cached frame is a full update that transmits straight from
+// the read-only mapping (hardware). On both backends display->buffer holds
+// the frame afterwards, replacing whatever was drawn there, so partial
+// updates continue from what the panel shows.
+typedef struct inky_frame_cache inky_frame_cache_t;
+
+// Append the display's current buffer as a new frame, creating the file if
+// needed. Returns the frame index, or -1 on error
+int inky_frame_cache_append(const char *filename, inky_t *display);
+inky_frame_cache_t *inky_frame_cache_open(const char *filename);
+void inky_frame_cache_close(inky_frame_cache_t *cache);
+size_t inky_frame_cache_count(inky_frame_cache_t *cache);
+// Packed pixels of a frame inside the mapping (NULL if index is out of range)
+const uint8_t *inky_frame_cache_frame(inky_frame_cache_t *cache, size_t index);
+// Full update with a cached frame. Returns 0, or -1 if the index is out of
+// range or the cache was made for a different panel size
+int inky_frame_cache_show(inky_t *display, inky_frame_cache_t *cache, size_t index);
+
+// Frame recording (emulator and hardware)
+// Every inky_update()/inky_update_region() is appended to the file as the
+// frame the panel now shows: an XOR delta against the previous frame,
+// run-length encoded, with a keyframe every keyframe_interval frames and a
+// seek index written when recording stops. A file cut short by a crash is
+// still readable up to its last complete frame.
+typedef struct {
+    uint64_t frames;
+    uint64_t keyframes;
+    uint64_t bytes;        // File size so far
+    uint64_t total_us;     // Time spent recording
+    uint64_t max_us;       // Slowest single frame
+} inky_record_stats_t;
+
+// keyframe_interval 0 = default (64). Returns 0 on success, -1 on error.
+int inky_record_start(inky_t *display, const char *filename, uint32_t keyframe_interval);
+void inky_record_stop(inky_t *display);
+int inky_record_get_stats(inky_t *display, inky_record_stats_t *stats);
+
+// Reading recordings back
+typedef struct inky_recording inky_recording_t;
+
+typedef struct {
+    uint64_t timestamp_us;     // Microseconds since recording started
+    inky_update_type_t type;
+    uint16_t x, y, width, height;   // Updated region (whole panel for full updates)
+    bool keyframe;
+    uint32_t encoded_size;     // Bytes this frame takes in the file
+} inky_record_frame_t;
+
+inky_recording_t *inky_recording_open(const char *filename);
+void inky_recording_close(inky_recording_t *recording);
+size_t inky_recording_frame_count(inky_recording_t *recording);
+// Wall-clock time (microseconds since the epoch) when recording started
+uint64_t inky_recording_start_time_us(inky_recording_t *recording);
+int inky_recording_frame_info(inky_recording_t *recording, size_t index, inky_record_frame_t *info);
+// Reconstruct frame `index` into the display buffer (decodes from the nearest keyframe)
+int inky_recording_seek(inky_recording_t *recording, size_t index, inky_t *display);
+
 // Get display dimensions
 uint16_t inky_get_width(inky_t *display);
 uint16_t inky_get_height(inky_t *display);
 
+// Primitives
+// Drawn straight into the buffer as horizontal runs and clipped to the
+// panel; coordinates may lie partly or wholly off screen. Line endpoints,
+// rectangle corners and circle centers are pixels, and an outline is the
+// outermost pixels of the matching filled shape.
+typedef struct {
+    int x, y;
+} inky_point_t;
+
+void inky_draw_line(inky_t *display, int x0, int y0, int x1, int y1, uint8_t color);
+// Covers both endpoint pixels; width 1 is inky_draw_line()
+void inky_draw_thick_line(inky_t *display, int x0, int y0, int x1, int y1, int width, uint8_t color);
+void inky_draw_rect(inky_t *display, int x, int y, int width, int height, uint8_t color);
+void inky_fill_rect(inky_t *display, int x, int y, int width, int height, uint8_t color);
+// 2 * radius + 1 pixels across (radii up to 32767)
+void inky_draw_circle(inky_t *display, int cx, int cy, int radius, uint8_t color);
+void inky_fill_circle(inky_t *display, int cx, int cy, int radius, uint8_t color);
+void inky_draw_ellipse(inky_t *display, int cx, int cy, int rx, int ry, uint8_t color);
+void inky_fill_ellipse(inky_t *display, int cx, int cy, int rx, int ry, uint8_t color);
+// Convex, concave or self-intersecting (nonzero winding). Vertices are pixel
+// corners: a pixel is filled when its center is inside, so polygons sharing
+// an edge neither overlap nor leave a gap. Returns -1 if out of memory.
+int inky_fill_polygon(inky_t *display, const inky_point_t *points, size_t count, uint8_t color);
+// Recolor the 4-connected region of the pixel's color. Returns -1 if out of
+// memory (the region may be partly filled).
+int inky_flood_fill(inky_t *display, int x, int y, uint8_t color);
+
+// Deferred drawing
+// Commands are recorded into a list, binned into screen tiles and drawn into
+// the buffer by inky_draw_list_execute() on a pool of threads, one tile at a
+// time; within a tile commands keep the order they were recorded in. Nothing
+// touches the buffer until execute. Coordinates may lie partly or wholly off
+// screen.
+typedef struct inky_draw_list inky_draw_list_t;
+
+typedef struct {
+    uint16_t x, y, width, height;
+} inky_rect_t;
+
+// Custom drawing, called once per tile with the part of the command's
+// rectangle inside it; it must only write pixels within `clip` and may run
+// on any pool thread, concurrently with other tiles
+typedef void (*inky_draw_callback_t)(inky_t *display, const inky_rect_t *clip, void *user_data);
+
+// threads: pool size including the caller of execute (0 = online CPUs)
+inky_draw_list_t *inky_draw_list_create(inky_t *display, int threads);
+void inky_draw_list_destroy(inky_draw_list_t *list);
+void inky_draw_list_clear(inky_draw_list_t *list, uint8_t color);
+void inky_draw_list_pixel(inky_draw_list_t *list, int x, int y, uint8_t color);
+void inky_draw_list_fill_rect(inky_draw_list_t *list, int x, int y, int width, int height, uint8_t color);
+void inky_draw_list_line(inky_draw_list_t *list, int x0, int y0, int x1, int y1, uint8_t color);
+void inky_draw_list_callback(inky_draw_list_t *list, int x, int y, int width, int height,
+                             inky_draw_callback_t callback, void *user_data);
+// Draw everything recorded so far; the list is kept until reset.
+// Returns 0, or -1 if commands were lost to an allocation failure.
+int inky_draw_list_execute(inky_draw_list_t *list);
+void inky_draw_list_reset(inky_draw_list_t *list);
+size_t inky_draw_list_count(inky_draw_list_t *list);
+int inky_draw_list_threads(inky_draw_list_t *list);
+
+// Resampling
+// Scales a source image to the panel while it streams in: RGB rows are
+// pushed top to bottom and every finished panel row is passed to the
+// callback in order, as three floats (0-255) per pixel across the whole
+// panel width. Only a window of filtered rows is kept, never the image.
+#define INKY_RESAMPLE_MAX_SOURCE 65535
+
+typedef enum {
+    INKY_FILTER_BOX,         // Average over each output pixel's footprint
+    INKY_FILTER_BILINEAR,    // Triangle, widened when shrinking
+    INKY_FILTER_LANCZOS      // Lanczos-3, widened when shrinking; sharpest
+} inky_filter_t;
+
+typedef enum {
+    INKY_SCALE_FIT,          // Whole image, aspect kept, white margins
+    INKY_SCALE_FILL,         // Panel covered, aspect kept, overflow cropped evenly
+    INKY_SCALE_CROP,         // No scaling: the centered panel-sized part (margins if smaller)
+    INKY_SCALE_STRETCH       // Panel covered, aspect ignored
+} inky_scale_mode_t;
+
+typedef struct inky_resampler inky_resampler_t;
+typedef void (*inky_resample_row_callback_t)(uint16_t y, const float *rgb, void *user_data);
+
+// Target size is inky_get_width() x inky_get_height() of the display
+inky_resampler_t *inky_resampler_create(inky_t *display, uint32_t src_width, uint32_t src_height,
+                                        inky_filter_t filter, inky_scale_mode_t mode,
+                                        inky_resample_row_callback_t callback, void *user_data);
+void inky_resampler_destroy(inky_resampler_t *resampler);
+// One row of src_width RGB pixels; ready panel rows are emitted before it returns
+int inky_resampler_push_row(inky_resampler_t *resampler, const uint8_t *rgb);
+// After the last row: 0 if every panel row was emitted, -1 if rows were missing
+int inky_resampler_finish(inky_resampler_t *resampler);
+// Where the image lands on the panel, and the filtered rows kept in memory
+void inky_resampler_get_layout(inky_resampler_t *resampler, inky_rect_t *image, uint32_t *window_rows);
+
+// Palette
+// The RGB each panel color shows as, and a table from RGB to the
+// perceptually nearest color (CIELAB distance) so quantizing a pixel is one
+// table load. A palette starts from the nominal colors and can be
+// calibrated with colors measured off a real panel; given to a display it
+// also sets the colors emulated frames are rendered in.
+#define INKY_PALETTE_COLORS 7     // BLACK to ORANGE; CLEAN is not drawable
+
+typedef struct inky_palette inky_palette_t;
+
+inky_palette_t *inky_palette_create(void);
+void inky_palette_destroy(inky_palette_t *palette);
+// Replace the colors (in color order) and rebuild the table. Returns 0 or -1
+int inky_palette_calibrate(inky_palette_t *palette, const uint8_t rgb[INKY_PALETTE_COLORS][3]);
+// Calibrate from a text file of one "R G B" line per color, BLACK first
+// (# starts a comment). Returns 0, or -1 if unreadable or malformed
+int inky_palette_load(inky_palette_t *palette, const char *filename);
+// The three RGB bytes of a color (NULL if out of range)
+const uint8_t *inky_palette_get_rgb(const inky_palette_t *palette, uint8_t color);
+// Nearest color to the center of the 8x8x8 block the value falls in
+uint8_t inky_palette_lookup(const inky_palette_t *palette, uint8_t r, uint8_t g, uint8_t b);
+// Exact nearest color; blocks split between colors fall back to a Lab search
+uint8_t inky_palette_nearest(const inky_palette_t *palette, uint8_t r, uint8_t g, uint8_t b);
+// Render the display's emulated frames (PPM, shared memory) in the palette's
+// colors; the colors are copied. NULL restores the nominal colors
+void inky_set_palette(inky_t *display, const inky_palette_t *palette);
+
 // Button support (hardware only - no-op on emulator)
 // Callback function type for button presses
 typedef void (*inky_button_callback_t)(int button, void *user_data);
@@ -78,10 +523,15 @@ typedef void (*inky_button_callback_t)(int button, void *user_data);
 // Initialize button GPIO (call once at startup)
 int inky_button_init(void);
 
-// Set callback function for button presses
+// Set callback function for button presses. With GPIO edge events (Linux
+// 5.10+) the callback runs on the library's button thread as soon as the
+// kernel reports a debounced press. Callbacks run on the thread that sees
+// the edge, so slow work belongs in the main loop via the event queue below.
 void inky_button_set_callback(inky_button_callback_t callback, void *user_data);
 
-// Poll for button events (call regularly in main loop)
+// Poll for button events (call regularly in main loop). Only needed on
+// kernels without GPIO v2 edge events, and in emulator mode to run the
+// long-press and repeat timers; otherwise a no-op
 void inky_button_poll(void);
 
 // Check if a specific button is currently pressed
@@ -93,5 +543,186 @@ void inky_button_cleanup(void);
 // Emulator-only function to simulate button presses for testing
 // Only works when buttons are initialized - no-op on hardware
 void inky_button_emulate_press(int button);
+void inky_button_emulate_release(int button);
+
+// Button event queue
+// Every debounced edge is queued with its monotonic timestamp (microseconds,
+// CLOCK_MONOTONIC) in a lock-free single-producer/single-consumer ring, so
+// presses made while the application is busy (e.g. during a 30 second
+// refresh) are kept until it drains them. Gestures are derived from the
+// edges: LONG_PRESS once a button is held for the long-press time, then
+// REPEAT at the repeat interval while it stays down; DOUBLE_PRESS on the
+// PRESS of a second short press within the double-press window.
+typedef enum {
+    INKY_BUTTON_EVENT_PRESS = 0,
+    INKY_BUTTON_EVENT_RELEASE,
+    INKY_BUTTON_EVENT_LONG_PRESS,
+    INKY_BUTTON_EVENT_REPEAT,
+    INKY_BUTTON_EVENT_DOUBLE_PRESS
+} inky_button_event_type_t;
+
+typedef struct {
+    uint64_t timestamp_us;
+    int button;                      // INKY_BUTTON_A..D
+    inky_button_event_type_t type;
+} inky_button_event_t;
+
+// Drain up to `max` queued events (oldest first) from one consumer thread
+size_t inky_button_read_events(inky_button_event_t *events, size_t max);
+
+// eventfd that is readable while events are queued, for poll()/epoll
+// (-1 where unavailable). Reading events clears it.
+int inky_button_get_event_fd(void);
+
+const char *inky_button_event_name(inky_button_event_type_t type);
+
+// Independent button sets (one per HAT)
+// The inky_button_* functions above operate on a default set opened with
+// inky_button_config_default(); these take an explicit handle instead.
+typedef struct inky_buttons inky_buttons_t;
+
+typedef struct {
+    bool emulator;            // Default true on non-Linux platforms
+    const char *gpio_device;  // Default "/dev/gpiochip0"
+    int pins[4];              // BCM numbers for A, B, C, D
+} inky_button_config_t;
+
+void inky_button_config_default(inky_button_config_t *config);
+inky_buttons_t *inky_buttons_open(const inky_button_config_t *config);  // NULL = defaults
+void inky_buttons_close(inky_buttons_t *buttons);
+void inky_buttons_set_callback(inky_buttons_t *buttons, inky_button_callback_t callback, void *user_data);
+void inky_buttons_poll(inky_buttons_t *buttons);
+bool inky_buttons_is_pressed(inky_buttons_t *buttons, int button);
+void inky_buttons_emulate_press(inky_buttons_t *buttons, int button);
+void inky_buttons_emulate_release(inky_buttons_t *buttons, int button);
+size_t inky_buttons_read_events(inky_buttons_t *buttons, inky_button_event_t *events, size_t max);
+int inky_buttons_get_event_fd(inky_buttons_t *buttons);
+uint64_t inky_buttons_get_dropped(inky_buttons_t *buttons);  // Events lost to a full queue
+
+// Gesture timing in milliseconds (defaults 800, 400, 200); 0 disables
+// long press (and with it repeat), double press or repeat respectively
+void inky_buttons_set_gesture_timing(inky_buttons_t *buttons, uint32_t long_press_ms,
+                                     uint32_t double_press_ms, uint32_t repeat_ms);
+
+// Scripted input (emulator mode)
+// Emulated edges and gesture timers run on `clock` (NULL = CLOCK_MONOTONIC);
+// share the display's clock so a virtual clock drives both. A script has
+// one event per line, "<time_ms> <A-D> <press|release|hold> [hold_ms]",
+// with times from the start of the replay or "+<ms>" after the previous
+// line, and '#' comments. Events are injected by inky_buttons_poll() (or an
+// event loop) when the clock reaches them, through the same path as real
+// edges. A pipe may be fed while the replay runs; it is not closed.
+void inky_buttons_set_clock(inky_buttons_t *buttons, inky_clock_t *clock);
+int inky_buttons_replay(inky_buttons_t *buttons, const char *filename);
+int inky_buttons_replay_fd(inky_buttons_t *buttons, int fd);
+bool inky_buttons_replay_active(inky_buttons_t *buttons);  // Events or holds still to come
+void inky_buttons_replay_stop(inky_buttons_t *buttons);
+
+// Event loop (Linux)
+// One thread serves a display and its buttons: a single epoll instance
+// watches the BUSY line, the button event queue, a timerfd for scheduled
+// work and any fds the application adds. Updates started through the loop
+// return once the frame is sent; the refresh completes in the background
+// and the update callback runs when it is on the glass. Timers and update
+// phases run on the display clock (virtual clocks are fast-forwarded when
+// the loop is otherwise idle).
+typedef struct inky_loop inky_loop_t;
+typedef void (*inky_loop_fd_callback_t)(inky_loop_t *loop, int fd, uint32_t events, void *user_data);
+typedef void (*inky_loop_timer_callback_t)(inky_loop_t *loop, int timer_id, void *user_data);
+typedef void (*inky_loop_button_callback_t)(inky_loop_t *loop, const inky_button_event_t *event, void *user_data);
+typedef void (*inky_loop_update_callback_t)(inky_loop_t *loop, inky_t *display, void *user_data);
+
+// Either argument may be NULL. Destroying the loop finishes an update in
+// progress (blocking) so the panel is powered off.
+inky_loop_t *inky_loop_create(inky_t *display, inky_buttons_t *buttons);
+void inky_loop_destroy(inky_loop_t *loop);
+
+// epoll fd that is readable whenever inky_loop_dispatch() has work, for
+// nesting inside another event loop (libuv, GLib, asio...)
+int inky_loop_get_fd(inky_loop_t *loop);
+
+// Wait up to timeout_ms (-1 = forever, 0 = don't wait) and run whatever is
+// ready; returns the number of callbacks and update steps run, -1 on error
+int inky_loop_dispatch(inky_loop_t *loop, int timeout_ms);
+int inky_loop_run(inky_loop_t *loop);   // Dispatch until inky_loop_stop()
+void inky_loop_stop(inky_loop_t *loop);
+
+// Application fds (events are EPOLLIN/EPOLLOUT/...)
+int inky_loop_add_fd(inky_loop_t *loop, int fd, uint32_t events,
+                     inky_loop_fd_callback_t callback, void *user_data);
+int inky_loop_remove_fd(inky_loop_t *loop, int fd);
+
+// Timers, e.g. for scheduled updates; interval 0 = one-shot. Returns an id.
+int inky_loop_add_timer(inky_loop_t *loop, uint32_t delay_ms, uint32_t interval_ms,
+                        inky_loop_timer_callback_t callback, void *user_data);
+void inky_loop_cancel_timer(inky_loop_t *loop, int timer_id);
+
+// Drain the button event queue into a handler (NULL leaves it to the application)
+void inky_loop_set_button_handler(inky_loop_t *loop, inky_loop_button_callback_t callback, void *user_data);
+
+// Non-blocking updates. Requests made while one is running are merged (full
+// wins, regions grow to their bounding box) and start when it completes.
+// Returns 1 if started, 0 if queued or skipped (content unchanged), -1 on error.
+int inky_loop_update(inky_loop_t *loop);
+int inky_loop_update_region(inky_loop_t *loop, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+bool inky_loop_is_updating(inky_loop_t *loop);
+void inky_loop_set_update_callback(inky_loop_t *loop, inky_loop_update_callback_t callback, void *user_data);
+
+// Display server (Linux)
+// One process owns the panel and draws for the others. Clients connect to
+// a Unix SOCK_SEQPACKET socket and submit frames or regions; the pixels
+// travel as a sealed memfd passed with SCM_RIGHTS, laid out like the
+// display buffer, so the socket only carries a small header and the server
+// reads the rectangle straight out of the client's pages. Requests that
+// arrive while the panel refreshes are merged into the next update (full
+// wins, regions grow to their bounding box, later pixels overwrite earlier
+// ones), and each request is answered once it is on the glass.
+#define INKY_SERVER_SOCKET      "/run/inky.sock"
+#define INKY_SERVER_MAX_CLIENTS 32
+
+typedef struct inky_server inky_server_t;
+typedef struct inky_client inky_client_t;
+
+typedef struct {
+    uint32_t clients;        // Connected now
+    uint64_t connections;    // Accepted since start
+    uint64_t requests;       // Frames and regions accepted
+    uint64_t rejected;       // Refused: not sealed, too small or out of bounds
+    uint64_t updates;        // Panel updates completed (requests - updates were merged)
+    uint64_t unchanged;      // Updates skipped: the panel already showed the pixels
+} inky_server_stats_t;
+
+// Serve the loop's display on a socket (NULL = INKY_SERVER_SOCKET). A stale
+// socket file is replaced; fails if another server is listening on it. The
+// server drives the display's updates and takes over the loop's update
+// callback. Returns NULL on error.
+inky_server_t *inky_server_create(inky_loop_t *loop, inky_t *display, const char *path);
+// Disconnects every client and removes the socket file
+void inky_server_destroy(inky_server_t *server);
+// Called after each update the server started is on the glass
+void inky_server_set_update_callback(inky_server_t *server, inky_loop_update_callback_t callback,
+                                     void *user_data);
+void inky_server_get_stats(inky_server_t *server, inky_server_stats_t *stats);
+
+// Client side. A canvas is any display of the panel's size to draw into,
+// usually an emulated one from inky_init(true); only its buffer is sent.
+inky_client_t *inky_client_connect(const char *path);    // NULL = INKY_SERVER_SOCKET
+void inky_client_disconnect(inky_client_t *client);
+// Readable when answers from the server are waiting (for poll/epoll)
+int inky_client_get_fd(inky_client_t *client);
+// Queue the whole canvas (full update) or a rectangle of it (partial
+// update) without waiting. Returns a request id > 0, or -1 on error.
+int inky_client_submit(inky_client_t *client, inky_t *canvas);
+int inky_client_submit_region(inky_client_t *client, inky_t *canvas,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+// Wait up to timeout_ms (-1 = forever) for a request to reach the glass.
+// Returns 0 once it has, 1 on timeout, -1 if it was rejected, the update
+// carrying it failed or the server went away. An answer for one request
+// also settles every earlier one.
+int inky_client_wait(inky_client_t *client, int id, int timeout_ms);
+// Submit and wait. Returns 0 or -1
+int inky_client_update(inky_client_t *client, inky_t *canvas);
+int inky_client_update_region(inky_client_t *client, inky_t *canvas,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 
 #endif // INKY_H
\ No newline at end of file
@@ -4,11 +4,20 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <time.h>
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
 
 #ifdef __linux__
 #include <linux/gpio.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #else
 #include <sys/ioctl.h>  // For ioctl stub definitions
 // Stub definitions for non-Linux platforms
@@ -33,6 +42,36 @@ struct gpiohandle_data {
 
 #define GPIO_DEVICE "/dev/gpiochip0"
 #define DEBOUNCE_MS 50  // 50ms debounce time
+#define POLL_INTERVAL_US (DEBOUNCE_MS * 1000 / 5)  // Polled lines are sampled at a fifth of it
+
+// Gesture defaults (inky_buttons_set_gesture_timing)
+#define DEFAULT_LONG_PRESS_MS   800
+#define DEFAULT_DOUBLE_PRESS_MS 400
+#define DEFAULT_REPEAT_MS       200
+
+#define EVENT_RING_SIZE 256  // Power of two
+
+#define SCRIPT_LINE_MAX 256
+
+// Scripted input actions
+typedef enum {
+    SCRIPT_PRESS,
+    SCRIPT_RELEASE,
+    SCRIPT_HOLD
+} script_action_t;
+
+typedef struct {
+    uint64_t at_us;           // On the buttons' clock
+    int button;
+    script_action_t action;
+    uint32_t hold_ms;
+} script_event_t;
+
+// Edge events with kernel debounce need the GPIO v2 character device uAPI
+// (Linux 5.10); older kernels and headers fall back to polled v1 handles
+#if defined(__linux__) && defined(GPIO_V2_GET_LINE_IOCTL)
+#define BUTTON_EVENTS 1
+#endif
 
 // Button state structure
 typedef struct {
@@ -41,17 +80,67 @@ typedef struct {
     bool last_state;
     uint64_t last_change_time;
     bool is_pressed;
+    
+    // Gesture tracking, owned by the thread that sees the edges
+    uint64_t press_us;        // Start of the current press
+    uint64_t release_us;      // End of the last plain press, 0 = no double pending
+    uint64_t timer_us;        // Next long-press/repeat deadline, 0 = none
+    bool long_fired;          // Current press already reported LONG_PRESS
+    bool double_fired;        // Current press already reported DOUBLE_PRESS
 } button_state_t;
 
-// Global button state
-static struct {
-    bool initialized;
+// One set of four buttons (one per HAT)
+struct inky_buttons {
     bool emulator_mode;
     int gpio_chip_fd;
     button_state_t buttons[4];
     inky_button_callback_t callback;
     void *user_data;
-} button_ctx = {0};
+    
+    // Event mode: one v2 line request for all four buttons, watched by a
+    // thread that runs the callback (request_fd < 0 when polling)
+    int request_fd;
+    uint64_t next_poll_us;  // Polling: when the lines are next sampled
+    inky_buttons_line_reader_t read_line;  // Polling: replaces the GPIO handles when set
+    void *read_line_data;
+#ifdef BUTTON_EVENTS
+    int epoll_fd;
+    int stop_fd;           // eventfd that ends the thread
+    pthread_t thread;
+#endif
+    
+    // Event ring: a single producer (whichever thread sees edges: the button
+    // thread, the poll caller or the emulator) and a single consumer
+    // (inky_buttons_read_events). Indices run freely and wrap by masking.
+    inky_button_event_t ring[EVENT_RING_SIZE];
+    uint32_t ring_head;    // Next event to read, written by the consumer
+    uint32_t ring_tail;    // Next slot to fill, written by the producer
+    uint64_t dropped;      // Events lost to a full ring
+    int notify_fd;         // eventfd readable while events are queued (-1 if unavailable)
+    
+    uint32_t long_press_ms;
+    uint32_t double_press_ms;
+    uint32_t repeat_ms;
+    
+    // Emulator mode: time source for emulated edges and gesture timers, and
+    // the script being replayed (script_fd < 0 when none). One event is
+    // parsed ahead; input is only read when that slot is empty.
+    inky_clock_t *clock;
+    uint64_t tick_us;              // Gesture timers have run up to here
+    int script_fd;
+    bool script_owned;             // Opened by inky_buttons_replay(), closed at the end
+    uint64_t script_base_us;       // Clock time of script time 0
+    uint64_t script_prev_ms;       // Time of the previous line, for "+N"
+    int script_line;
+    char script_buf[SCRIPT_LINE_MAX];
+    size_t script_len;
+    bool script_ready;             // script_next holds a parsed event
+    script_event_t script_next;
+    uint64_t release_at_us[4];     // End of a scripted hold, 0 = none
+};
+
+// Default instance behind the inky_button_* API
+static inky_buttons_t *default_buttons = NULL;
 
 // Get current time in milliseconds
 static uint64_t get_time_ms(void) {
@@ -60,6 +149,11 @@ static uint64_t get_time_ms(void) {
     return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+// Emulated time: the buttons' clock (CLOCK_MONOTONIC without one)
+static uint64_t buttons_now(inky_buttons_t *ctx) {
+    return inky_clock_now_us(ctx->clock);
+}
+
 // Read GPIO value - returns true when button is pressed
 static bool read_button_gpio(int fd) {
 #ifdef __linux__
@@ -74,115 +168,583 @@ static bool read_button_gpio(int fd) {
 #endif
 }
 
-int inky_button_init(void) {
-    if (button_ctx.initialized) {
-        return 0;  // Already initialized
+void inky_button_config_default(inky_button_config_t *config) {
+    if (!config) return;
+
+#ifdef __linux__
+    config->emulator = false;
+#else
+    // Non-Linux platforms use emulator mode
+    config->emulator = true;
+#endif
+    config->gpio_device = GPIO_DEVICE;
+    config->pins[0] = INKY_BUTTON_A_PIN;
+    config->pins[1] = INKY_BUTTON_B_PIN;
+    config->pins[2] = INKY_BUTTON_C_PIN;
+    config->pins[3] = INKY_BUTTON_D_PIN;
+}
+
+// Producer side of the event ring. Never blocks: when the consumer has
+// fallen a full ring behind the event is dropped and counted.
+static void push_event(inky_buttons_t *ctx, int button, inky_button_event_type_t type, uint64_t timestamp_us) {
+    uint32_t tail = ctx->ring_tail;
+    uint32_t head = __atomic_load_n(&ctx->ring_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= EVENT_RING_SIZE) {
+        __atomic_fetch_add(&ctx->dropped, 1, __ATOMIC_RELAXED);
+        return;
     }
     
-#ifndef __linux__
-    // Non-Linux platforms use emulator mode
-    button_ctx.emulator_mode = true;
-    printf("Button support initialized (emulator mode)\n");
-    goto init_common;
+    inky_button_event_t *ev = &ctx->ring[tail & (EVENT_RING_SIZE - 1)];
+    ev->timestamp_us = timestamp_us;
+    ev->button = button;
+    ev->type = type;
+    __atomic_store_n(&ctx->ring_tail, tail + 1, __ATOMIC_RELEASE);
+
+#ifdef __linux__
+    if (ctx->notify_fd >= 0) {
+        uint64_t one = 1;
+        if (write(ctx->notify_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated: the fd is readable anyway
+        }
+    }
 #endif
+}
+
+// Record a debounced edge: queue PRESS/RELEASE (and DOUBLE_PRESS for a
+// second plain press soon after the first), arm the long-press timer and run
+// the callback for presses
+static void button_edge(inky_buttons_t *ctx, int index, bool pressed, uint64_t timestamp_us) {
+    button_state_t *btn = &ctx->buttons[index];
+    if (pressed == __atomic_load_n(&btn->is_pressed, __ATOMIC_RELAXED)) return;
+    
+    btn->last_state = pressed;
+    btn->last_change_time = timestamp_us / 1000;
+    __atomic_store_n(&btn->is_pressed, pressed, __ATOMIC_RELEASE);
+    
+    uint32_t long_ms = __atomic_load_n(&ctx->long_press_ms, __ATOMIC_RELAXED);
+    uint32_t double_ms = __atomic_load_n(&ctx->double_press_ms, __ATOMIC_RELAXED);
+    if (pressed) {
+        push_event(ctx, index, INKY_BUTTON_EVENT_PRESS, timestamp_us);
+        btn->double_fired = btn->release_us != 0 && timestamp_us - btn->release_us <= (uint64_t)double_ms * 1000;
+        if (btn->double_fired) {
+            push_event(ctx, index, INKY_BUTTON_EVENT_DOUBLE_PRESS, timestamp_us);
+        }
+        btn->press_us = timestamp_us;
+        btn->long_fired = false;
+        btn->timer_us = long_ms ? timestamp_us + (uint64_t)long_ms * 1000 : 0;
+    } else {
+        push_event(ctx, index, INKY_BUTTON_EVENT_RELEASE, timestamp_us);
+        // Only a plain short press can start a double press
+        btn->release_us = (btn->long_fired || btn->double_fired) ? 0 : timestamp_us;
+        btn->timer_us = 0;
+    }
+    
+    if (pressed && ctx->callback) {
+        INKY_TRACE_BEGIN_ARG("button_callback", index);
+        ctx->callback(index, ctx->user_data);
+        INKY_TRACE_END("button_callback");
+    }
+}
+
+// Fire due long-press/repeat timers; returns the next deadline (0 = none).
+// Events carry the deadline as their timestamp, not the time of the check.
+static uint64_t buttons_tick(inky_buttons_t *ctx, uint64_t now_us) {
+    uint32_t repeat_ms = __atomic_load_n(&ctx->repeat_ms, __ATOMIC_RELAXED);
+    uint64_t next = 0;
+    if (now_us > ctx->tick_us) {
+        ctx->tick_us = now_us;
+    }
+    
+    for (int i = 0; i < 4; i++) {
+        button_state_t *btn = &ctx->buttons[i];
+        if (!btn->is_pressed || btn->timer_us == 0) continue;
+        
+        if (now_us >= btn->timer_us) {
+            push_event(ctx, i, btn->long_fired ? INKY_BUTTON_EVENT_REPEAT : INKY_BUTTON_EVENT_LONG_PRESS,
+                       btn->timer_us);
+            btn->long_fired = true;
+            if (repeat_ms == 0) {
+                btn->timer_us = 0;
+                continue;
+            }
+            // A late check skips missed repeats rather than bursting them out
+            btn->timer_us += (uint64_t)repeat_ms * 1000;
+            if (btn->timer_us <= now_us) {
+                btn->timer_us = now_us + (uint64_t)repeat_ms * 1000;
+            }
+        }
+        if (next == 0 || btn->timer_us < next) {
+            next = btn->timer_us;
+        }
+    }
+    return next;
+}
+
+#ifdef BUTTON_EVENTS
+// Sleeps in epoll_wait until a line changes or the set is closed
+static void *button_thread(void *arg) {
+    inky_buttons_t *ctx = arg;
+    struct gpio_v2_line_event events[16];
     
-    // Button GPIO pins
-    int button_pins[4] = {
-        INKY_BUTTON_A_PIN,
-        INKY_BUTTON_B_PIN,
-        INKY_BUTTON_C_PIN,
-        INKY_BUTTON_D_PIN
-    };
+    uint64_t deadline = 0;
     
+    for (;;) {
+        // Sleep until an edge or the next long-press/repeat deadline
+        int timeout = -1;
+        if (deadline) {
+            uint64_t now = inky_time_us();
+            timeout = deadline > now ? (int)((deadline - now + 999) / 1000) : 0;
+        }
+        
+        struct epoll_event ready[2];
+        int n = epoll_wait(ctx->epoll_fd, ready, 2, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Button event wait failed");
+            return NULL;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            if (ready[i].data.fd == ctx->stop_fd) return NULL;
+        }
+        
+        ssize_t len = n > 0 ? read(ctx->request_fd, events, sizeof(events)) : 0;
+        for (ssize_t k = 0; k < len / (ssize_t)sizeof(events[0]); k++) {
+            for (int b = 0; b < 4; b++) {
+                if ((int)events[k].offset != ctx->buttons[b].gpio_pin) continue;
+                // Lines are requested active-low: rising means pressed
+                bool pressed = events[k].id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+                INKY_TRACE_BEGIN_ARG("button_edge", b);
+                button_edge(ctx, b, pressed, events[k].timestamp_ns / 1000);
+                INKY_TRACE_END("button_edge");
+            }
+        }
+        deadline = buttons_tick(ctx, inky_time_us());
+    }
+}
+
+// Request all four lines with both-edge events and kernel debounce
+static int buttons_open_events(inky_buttons_t *ctx, const inky_button_config_t *config) {
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    for (int i = 0; i < 4; i++) {
+        req.offsets[i] = config->pins[i];
+    }
+    req.num_lines = 4;
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_ACTIVE_LOW |
+                       GPIO_V2_LINE_FLAG_BIAS_PULL_UP |
+                       GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    req.config.num_attrs = 1;
+    req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+    req.config.attrs[0].attr.debounce_period_us = DEBOUNCE_MS * 1000;
+    req.config.attrs[0].mask = 0xF;
+    snprintf(req.consumer, sizeof(req.consumer), "inky_buttons");
+    
+    if (ioctl(ctx->gpio_chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        return -1;
+    }
+    ctx->request_fd = req.fd;
+    
+    // Initial state; edges from here on arrive as events
+    struct gpio_v2_line_values values = {0, 0xF};
+    ioctl(ctx->request_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values);
+    uint64_t now = get_time_ms();
+    for (int i = 0; i < 4; i++) {
+        ctx->buttons[i].gpio_pin = config->pins[i];
+        ctx->buttons[i].gpio_fd = -1;
+        ctx->buttons[i].last_state = (values.bits >> i) & 1;
+        ctx->buttons[i].is_pressed = ctx->buttons[i].last_state;
+        ctx->buttons[i].last_change_time = now;
+    }
+    
+    ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ctx->stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct epoll_event line_ev = {.events = EPOLLIN, .data.fd = ctx->request_fd};
+    struct epoll_event stop_ev = {.events = EPOLLIN, .data.fd = ctx->stop_fd};
+    if (ctx->epoll_fd < 0 || ctx->stop_fd < 0 ||
+        epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ctx->request_fd, &line_ev) < 0 ||
+        epoll_ctl(ctx->epoll_fd, EPOLL_CTL_ADD, ctx->stop_fd, &stop_ev) < 0 ||
+        pthread_create(&ctx->thread, NULL, button_thread, ctx) != 0) {
+        perror("Failed to start button event thread");
+        if (ctx->epoll_fd >= 0) close(ctx->epoll_fd);
+        if (ctx->stop_fd >= 0) close(ctx->stop_fd);
+        close(ctx->request_fd);
+        ctx->request_fd = -1;
+        return -1;
+    }
+    
+    printf("Button support initialized with edge events (A=GPIO%d, B=GPIO%d, C=GPIO%d, D=GPIO%d, %dms debounce)\n",
+           config->pins[0], config->pins[1], config->pins[2], config->pins[3], DEBOUNCE_MS);
+    return 0;
+}
+
+static void buttons_close_events(inky_buttons_t *ctx) {
+    uint64_t one = 1;
+    if (write(ctx->stop_fd, &one, sizeof(one)) == sizeof(one)) {
+        pthread_join(ctx->thread, NULL);
+    }
+    close(ctx->epoll_fd);
+    close(ctx->stop_fd);
+    close(ctx->request_fd);
+    ctx->request_fd = -1;
+}
+#endif
+
+static int buttons_open_gpio(inky_buttons_t *ctx, const inky_button_config_t *config) {
     // Open GPIO chip
-    button_ctx.gpio_chip_fd = open(GPIO_DEVICE, O_RDONLY);
-    if (button_ctx.gpio_chip_fd < 0) {
+    ctx->gpio_chip_fd = open(config->gpio_device, O_RDONLY);
+    if (ctx->gpio_chip_fd < 0) {
         perror("Failed to open GPIO chip for buttons");
         return -1;
     }
-    
-    button_ctx.emulator_mode = false;  // Hardware mode
+
+#ifdef BUTTON_EVENTS
+    if (buttons_open_events(ctx, config) == 0) {
+        return 0;
+    }
+    printf("GPIO edge events unavailable (%s), polling buttons instead\n", strerror(errno));
+#endif
     
     // Initialize each button
     for (int i = 0; i < 4; i++) {
-        button_ctx.buttons[i].gpio_pin = button_pins[i];
+        ctx->buttons[i].gpio_pin = config->pins[i];
         
         // Request GPIO line for input with pull-up
         struct gpiohandle_request req;
-        req.lineoffsets[0] = button_pins[i];
+        req.lineoffsets[0] = config->pins[i];
         req.lines = 1;
         req.flags = GPIOHANDLE_REQUEST_INPUT | GPIOHANDLE_REQUEST_BIAS_PULL_UP;
         snprintf(req.consumer_label, sizeof(req.consumer_label), "inky_btn_%c", 'A' + i);
         
-        if (ioctl(button_ctx.gpio_chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0) {
+        if (ioctl(ctx->gpio_chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0) {
             fprintf(stderr, "Failed to request GPIO line for button %c\n", 'A' + i);
             
             // Clean up already initialized buttons
             for (int j = 0; j < i; j++) {
-                close(button_ctx.buttons[j].gpio_fd);
+                close(ctx->buttons[j].gpio_fd);
             }
-            close(button_ctx.gpio_chip_fd);
+            close(ctx->gpio_chip_fd);
             return -1;
         }
         
-        button_ctx.buttons[i].gpio_fd = req.fd;
+        ctx->buttons[i].gpio_fd = req.fd;
         
         // Initialize state by reading actual GPIO value
-        button_ctx.buttons[i].last_state = read_button_gpio(button_ctx.buttons[i].gpio_fd);
-        button_ctx.buttons[i].last_change_time = get_time_ms();
-        button_ctx.buttons[i].is_pressed = false;
+        ctx->buttons[i].last_state = read_button_gpio(ctx->buttons[i].gpio_fd);
+        ctx->buttons[i].last_change_time = get_time_ms();
+        ctx->buttons[i].is_pressed = false;
         
         printf("Button %c initialized: GPIO=%d, initial_state=%d\n", 
-               'A' + i, button_pins[i], button_ctx.buttons[i].last_state);
+               'A' + i, config->pins[i], ctx->buttons[i].last_state);
     }
+    ctx->next_poll_us = inky_time_us();
     
     printf("Button support initialized (A=GPIO%d, B=GPIO%d, C=GPIO%d, D=GPIO%d)\n",
-           INKY_BUTTON_A_PIN, INKY_BUTTON_B_PIN, INKY_BUTTON_C_PIN, INKY_BUTTON_D_PIN);
-    
-    goto init_common;
+           config->pins[0], config->pins[1], config->pins[2], config->pins[3]);
+    return 0;
+}
 
-init_common:
-    // Common initialization for both hardware and emulator
-    if (button_ctx.emulator_mode) {
+inky_buttons_t *inky_buttons_open(const inky_button_config_t *config) {
+    inky_button_config_t defaults;
+    if (!config) {
+        inky_button_config_default(&defaults);
+        config = &defaults;
+    }
+    
+    inky_buttons_t *ctx = calloc(1, sizeof(inky_buttons_t));
+    if (!ctx) {
+        return NULL;
+    }
+    
+    ctx->emulator_mode = config->emulator;
+    ctx->request_fd = -1;
+    ctx->long_press_ms = DEFAULT_LONG_PRESS_MS;
+    ctx->double_press_ms = DEFAULT_DOUBLE_PRESS_MS;
+    ctx->repeat_ms = DEFAULT_REPEAT_MS;
+    ctx->script_fd = -1;
+#ifdef __linux__
+    ctx->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    ctx->notify_fd = -1;
+#endif
+    
+    if (ctx->emulator_mode) {
         // Initialize emulator button states
         for (int i = 0; i < 4; i++) {
-            button_ctx.buttons[i].gpio_pin = -1;  // No GPIO
-            button_ctx.buttons[i].gpio_fd = -1;   // No file descriptor
-            button_ctx.buttons[i].last_state = false;  // Not pressed
-            button_ctx.buttons[i].last_change_time = get_time_ms();
-            button_ctx.buttons[i].is_pressed = false;
+            ctx->buttons[i].gpio_pin = -1;  // No GPIO
+            ctx->buttons[i].gpio_fd = -1;   // No file descriptor
+            ctx->buttons[i].last_state = false;  // Not pressed
+            ctx->buttons[i].last_change_time = get_time_ms();
+            ctx->buttons[i].is_pressed = false;
+        }
+        printf("Button support initialized (emulator mode)\n");
+    } else if (buttons_open_gpio(ctx, config) < 0) {
+        if (ctx->notify_fd >= 0) close(ctx->notify_fd);
+        free(ctx);
+        return NULL;
+    }
+    
+    ctx->callback = NULL;
+    ctx->user_data = NULL;
+    
+    return ctx;
+}
+
+inky_buttons_t *inky_buttons_open_polled(inky_buttons_line_reader_t read_line, void *user_data) {
+    if (!read_line) return NULL;
+    
+    inky_button_config_t config;
+    inky_button_config_default(&config);
+    config.emulator = true;
+    inky_buttons_t *ctx = inky_buttons_open(&config);
+    if (!ctx) return NULL;
+    
+    // Set up like buttons_open_gpio() without edge events, minus the handles
+    ctx->emulator_mode = false;
+    ctx->read_line = read_line;
+    ctx->read_line_data = user_data;
+    for (int i = 0; i < 4; i++) {
+        ctx->buttons[i].last_state = read_line(i, user_data);
+        ctx->buttons[i].last_change_time = get_time_ms();
+    }
+    ctx->next_poll_us = inky_time_us();
+    return ctx;
+}
+
+void inky_buttons_set_callback(inky_buttons_t *ctx, inky_button_callback_t callback, void *user_data) {
+    if (!ctx) return;
+    
+    ctx->callback = callback;
+    ctx->user_data = user_data;
+}
+
+// Scripted input
+//
+// One event per line: "<time_ms> <button> <action> [hold_ms]". Times count
+// from the start of the replay, or from the previous line with a leading
+// '+'. Buttons are A-D, actions press, release or hold (press, then release
+// hold_ms later). '#' starts a comment.
+
+static void script_close(inky_buttons_t *ctx) {
+    if (ctx->script_owned && ctx->script_fd >= 0) {
+        close(ctx->script_fd);
+    }
+    ctx->script_fd = -1;
+    ctx->script_owned = false;
+}
+
+static void script_parse(inky_buttons_t *ctx, char *line) {
+    char *comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    
+    char time_s[32], button_s[16], action_s[16];
+    unsigned hold_ms = 0;
+    int fields = sscanf(line, "%31s %15s %15s %u", time_s, button_s, action_s, &hold_ms);
+    if (fields <= 0) return;  // Blank line
+    
+    bool relative = time_s[0] == '+';
+    char *end;
+    uint64_t ms = strtoull(time_s + relative, &end, 10);
+    int button = toupper((unsigned char)button_s[0]) - 'A';
+    script_event_t *ev = &ctx->script_next;
+    
+    if (fields < 3 || *end != '\0' || end == time_s + relative ||
+        button < 0 || button > 3 || button_s[1] != '\0') {
+        fprintf(stderr, "Input script line %d: expected \"<time_ms> <A-D> <action> [hold_ms]\"\n", ctx->script_line);
+        return;
+    }
+    if (strcmp(action_s, "press") == 0) {
+        ev->action = SCRIPT_PRESS;
+    } else if (strcmp(action_s, "release") == 0) {
+        ev->action = SCRIPT_RELEASE;
+    } else if (strcmp(action_s, "hold") == 0 && fields == 4) {
+        ev->action = SCRIPT_HOLD;
+    } else {
+        fprintf(stderr, "Input script line %d: unknown action \"%s\"\n", ctx->script_line, action_s);
+        return;
+    }
+    
+    ctx->script_prev_ms = relative ? ctx->script_prev_ms + ms : ms;
+    ev->at_us = ctx->script_base_us + ctx->script_prev_ms * 1000;
+    ev->button = button;
+    ev->hold_ms = hold_ms;
+    ctx->script_ready = true;
+}
+
+// Parse ahead to the next event, reading only input that is already there
+static void script_fill(inky_buttons_t *ctx) {
+    while (!ctx->script_ready && ctx->script_fd >= 0) {
+        char *newline = memchr(ctx->script_buf, '\n', ctx->script_len);
+        if (newline) {
+            *newline = '\0';
+            ctx->script_line++;
+            script_parse(ctx, ctx->script_buf);
+            size_t used = (size_t)(newline + 1 - ctx->script_buf);
+            memmove(ctx->script_buf, newline + 1, ctx->script_len - used);
+            ctx->script_len -= used;
+            continue;
+        }
+        
+        if (ctx->script_len == SCRIPT_LINE_MAX - 1) {
+            fprintf(stderr, "Input script line %d: too long, skipped\n", ++ctx->script_line);
+            ctx->script_len = 0;
+        }
+        
+        // A pipe may not have the next line yet
+        struct pollfd pfd = {.fd = ctx->script_fd, .events = POLLIN};
+        if (poll(&pfd, 1, 0) <= 0) return;
+        
+        ssize_t len = read(ctx->script_fd, ctx->script_buf + ctx->script_len,
+                           SCRIPT_LINE_MAX - 1 - ctx->script_len);
+        if (len < 0 && (errno == EINTR || errno == EAGAIN)) return;
+        if (len <= 0) {
+            // End of input: the last line may lack its newline
+            ctx->script_buf[ctx->script_len] = '\0';
+            if (ctx->script_len > 0) {
+                ctx->script_line++;
+                ctx->script_len = 0;
+                script_parse(ctx, ctx->script_buf);
+            }
+            script_close(ctx);
+            return;
+        }
+        ctx->script_len += (size_t)len;
+    }
+}
+
+// Inject scripted edges due by `now` through button_edge(), with gesture
+// timers run up to each one first so events stay in time order. Input that
+// arrives late (a slow pipe) is stamped with the time it is seen.
+static void script_advance(inky_buttons_t *ctx, uint64_t now) {
+    for (;;) {
+        script_fill(ctx);
+        
+        int release = -1;
+        uint64_t at = 0;
+        for (int i = 0; i < 4; i++) {
+            if (ctx->release_at_us[i] && (at == 0 || ctx->release_at_us[i] < at)) {
+                at = ctx->release_at_us[i];
+                release = i;
+            }
+        }
+        bool line = ctx->script_ready && (at == 0 || ctx->script_next.at_us < at);
+        if (line) {
+            at = ctx->script_next.at_us;
+        }
+        if (at == 0 || at > now) return;
+        
+        uint64_t timestamp = at > ctx->tick_us ? at : ctx->tick_us;
+        buttons_tick(ctx, timestamp);
+        
+        if (!line) {
+            ctx->release_at_us[release] = 0;
+            button_edge(ctx, release, false, timestamp);
+            continue;
+        }
+        
+        script_event_t ev = ctx->script_next;
+        ctx->script_ready = false;
+        if (ev.action == SCRIPT_RELEASE) {
+            ctx->release_at_us[ev.button] = 0;
+            button_edge(ctx, ev.button, false, timestamp);
+        } else {
+            button_edge(ctx, ev.button, true, timestamp);
+            if (ev.action == SCRIPT_HOLD) {
+                ctx->release_at_us[ev.button] = timestamp + (uint64_t)ev.hold_ms * 1000 + 1;
+            }
         }
     }
+}
+
+void inky_buttons_set_clock(inky_buttons_t *ctx, inky_clock_t *clock) {
+    if (!ctx || !ctx->emulator_mode) return;
+    ctx->clock = clock;
+    ctx->tick_us = 0;
+}
+
+bool inky_buttons_replay_active(inky_buttons_t *ctx) {
+    if (!ctx) return false;
+    
+    bool holding = false;
+    for (int i = 0; i < 4; i++) {
+        holding = holding || ctx->release_at_us[i] != 0;
+    }
+    return ctx->script_fd >= 0 || ctx->script_ready || holding;
+}
+
+void inky_buttons_replay_stop(inky_buttons_t *ctx) {
+    if (!ctx) return;
     
-    button_ctx.initialized = true;
-    button_ctx.callback = NULL;
-    button_ctx.user_data = NULL;
+    script_close(ctx);
+    ctx->script_ready = false;
+    ctx->script_len = 0;
+    memset(ctx->release_at_us, 0, sizeof(ctx->release_at_us));
+}
+
+// owned: close fd once the script ends. Set before the first fill, which
+// already reaches the end of a script without events
+static int buttons_replay_start(inky_buttons_t *ctx, int fd, bool owned) {
+    if (!ctx || fd < 0) return -1;
+    if (!ctx->emulator_mode) {
+        printf("WARNING: Scripted input only works in emulator mode\n");
+        return -1;
+    }
     
+    inky_buttons_replay_stop(ctx);
+    ctx->script_fd = fd;
+    ctx->script_owned = owned;
+    ctx->script_base_us = buttons_now(ctx);
+    ctx->script_prev_ms = 0;
+    ctx->script_line = 0;
+    script_fill(ctx);
     return 0;
 }
 
-void inky_button_set_callback(inky_button_callback_t callback, void *user_data) {
-    if (!button_ctx.initialized) return;
+int inky_buttons_replay_fd(inky_buttons_t *ctx, int fd) {
+    return buttons_replay_start(ctx, fd, false);
+}
+
+int inky_buttons_replay(inky_buttons_t *ctx, const char *filename) {
+    if (!ctx || !filename) return -1;
     
-    button_ctx.callback = callback;
-    button_ctx.user_data = user_data;
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror("Failed to open input script");
+        return -1;
+    }
+    if (buttons_replay_start(ctx, fd, true) < 0) {
+        close(fd);
+        return -1;
+    }
+    return 0;
 }
 
-void inky_button_poll(void) {
-    if (!button_ctx.initialized) return;
+void inky_buttons_poll(inky_buttons_t *ctx) {
+    if (!ctx) return;
+    
+    // Edge events and their timers are handled by the button thread
+    if (ctx->request_fd >= 0) {
+        return;
+    }
     
-    // Emulator mode doesn't need to poll - emulated presses are handled directly
-    if (button_ctx.emulator_mode) {
+    // Emulated presses are recorded directly; polling replays scripted
+    // input and runs the long-press and repeat timers
+    if (ctx->emulator_mode) {
+        uint64_t now = buttons_now(ctx);
+        script_advance(ctx, now);
+        buttons_tick(ctx, now);
         return;
     }
     
     uint64_t current_time = get_time_ms();
+    ctx->next_poll_us = inky_time_us() + POLL_INTERVAL_US;
     
     for (int i = 0; i < 4; i++) {
-        button_state_t *btn = &button_ctx.buttons[i];
+        button_state_t *btn = &ctx->buttons[i];
         
         // Read current GPIO state
-        bool current_state = read_button_gpio(btn->gpio_fd);
+        bool current_state = ctx->read_line ? ctx->read_line(i, ctx->read_line_data)
+                                            : read_button_gpio(btn->gpio_fd);
         
         // Removed verbose GPIO state debug output
         
@@ -196,62 +758,91 @@ void inky_button_poll(void) {
         if ((current_time - btn->last_change_time) >= DEBOUNCE_MS) {
             bool new_pressed = current_state;  // With pull-up bias, pressed = GPIO low = false, so use direct state
             
-            // Detect button press (transition from not pressed to pressed)
-            if (new_pressed && !btn->is_pressed) {
-                btn->is_pressed = true;
-                printf("DEBUG: Button %c PRESS detected (GPIO:%d, pressed:%d)\n", 'A' + i, current_state, new_pressed);
-                
-                // Call callback if registered
-                if (button_ctx.callback) {
-                    button_ctx.callback(i, button_ctx.user_data);
-                }
-            }
-            // Detect button release
-            else if (!new_pressed && btn->is_pressed) {
-                btn->is_pressed = false;
-                printf("DEBUG: Button %c RELEASE detected (GPIO:%d, pressed:%d)\n", 'A' + i, current_state, new_pressed);
+            // Detect button press or release; the edge is timestamped when
+            // the level settled, not when the debounce period ran out
+            if (new_pressed != btn->is_pressed) {
+                INKY_TRACE_BEGIN_ARG("button_edge", i);
+                button_edge(ctx, i, new_pressed, btn->last_change_time * 1000);
+                INKY_TRACE_END("button_edge");
             }
         }
     }
+    
+    buttons_tick(ctx, inky_time_us());
+}
+
+uint64_t inky_buttons_poll_deadline_us(inky_buttons_t *ctx) {
+    if (!ctx || ctx->request_fd >= 0) return 0;
+    
+    // Polled GPIO lines: due once the interval since the last sample is up
+    if (!ctx->emulator_mode) {
+        return ctx->next_poll_us;
+    }
+    
+    uint64_t next = ctx->script_ready ? ctx->script_next.at_us : 0;
+    for (int i = 0; i < 4; i++) {
+        uint64_t timer = ctx->buttons[i].is_pressed ? ctx->buttons[i].timer_us : 0;
+        if (timer && (next == 0 || timer < next)) {
+            next = timer;
+        }
+        uint64_t release = ctx->release_at_us[i];
+        if (release && (next == 0 || release < next)) {
+            next = release;
+        }
+    }
+    return next;
 }
 
-bool inky_button_is_pressed(int button) {
-    if (!button_ctx.initialized || button < 0 || button >= 4) {
+inky_clock_t *inky_buttons_clock(inky_buttons_t *ctx) {
+    return ctx ? ctx->clock : NULL;
+}
+
+int inky_buttons_script_fd(inky_buttons_t *ctx) {
+    return ctx && !ctx->script_ready ? ctx->script_fd : -1;
+}
+
+bool inky_buttons_is_pressed(inky_buttons_t *ctx, int button) {
+    if (!ctx || button < 0 || button >= 4) {
         return false;
     }
     
-    return button_ctx.buttons[button].is_pressed;
+    return __atomic_load_n(&ctx->buttons[button].is_pressed, __ATOMIC_ACQUIRE);
 }
 
-void inky_button_cleanup(void) {
-    if (!button_ctx.initialized) return;
+void inky_buttons_close(inky_buttons_t *ctx) {
+    if (!ctx) return;
+
+#ifdef BUTTON_EVENTS
+    if (ctx->request_fd >= 0) {
+        buttons_close_events(ctx);
+    }
+#endif
     
-    if (!button_ctx.emulator_mode) {
+    if (!ctx->emulator_mode) {
         // Close all button GPIO file descriptors (hardware mode only)
         for (int i = 0; i < 4; i++) {
-            if (button_ctx.buttons[i].gpio_fd > 0) {
-                close(button_ctx.buttons[i].gpio_fd);
-                button_ctx.buttons[i].gpio_fd = 0;
+            if (ctx->buttons[i].gpio_fd > 0) {
+                close(ctx->buttons[i].gpio_fd);
             }
         }
         
         // Close GPIO chip
-        if (button_ctx.gpio_chip_fd > 0) {
-            close(button_ctx.gpio_chip_fd);
-            button_ctx.gpio_chip_fd = 0;
+        if (ctx->gpio_chip_fd > 0) {
+            close(ctx->gpio_chip_fd);
         }
     }
     
-    button_ctx.initialized = false;
-    button_ctx.emulator_mode = false;
-    button_ctx.callback = NULL;
-    button_ctx.user_data = NULL;
+    if (ctx->notify_fd >= 0) {
+        close(ctx->notify_fd);
+    }
+    inky_buttons_replay_stop(ctx);
     
+    free(ctx);
     printf("Button support cleaned up\n");
 }
 
-void inky_button_emulate_press(int button) {
-    if (!button_ctx.initialized) {
+void inky_buttons_emulate_press(inky_buttons_t *ctx, int button) {
+    if (!ctx) {
         printf("WARNING: Buttons not initialized - call inky_button_init() first\n");
         return;
     }
@@ -261,7 +852,7 @@ void inky_button_emulate_press(int button) {
         return;
     }
     
-    if (!button_ctx.emulator_mode) {
+    if (!ctx->emulator_mode) {
         printf("WARNING: inky_button_emulate_press() only works in emulator mode\n");
         return;
     }
@@ -269,16 +860,136 @@ void inky_button_emulate_press(int button) {
     const char *button_names[] = {"A", "B", "C", "D"};
     printf("Emulating button %s press\n", button_names[button]);
     
-    // Trigger the callback immediately
-    if (button_ctx.callback) {
-        button_ctx.callback(button, button_ctx.user_data);
+    // A press of a button that is still down releases it first
+    uint64_t now = buttons_now(ctx);
+    if (ctx->buttons[button].is_pressed) {
+        button_edge(ctx, button, false, now);
     }
     
-    // Update the button state for is_pressed() queries
-    button_ctx.buttons[button].is_pressed = true;
-    button_ctx.buttons[button].last_change_time = get_time_ms();
+    // Queues PRESS and triggers the callback immediately
+    button_edge(ctx, button, true, now);
     
     // Note: In emulator mode, we don't automatically release the button
-    // The application can call inky_button_emulate_press again or 
-    // check inky_button_is_pressed() to manage state
-}
\ No newline at end of file
+    // The application can call inky_button_emulate_release(), or
+    // inky_button_emulate_press() again, to end the press
+}
+
+void inky_buttons_emulate_release(inky_buttons_t *ctx, int button) {
+    if (!ctx || button < 0 || button >= 4 || !ctx->emulator_mode) {
+        return;
+    }
+    
+    // Timers due before the release still fire, in order
+    uint64_t now = buttons_now(ctx);
+    buttons_tick(ctx, now);
+    button_edge(ctx, button, false, now);
+}
+
+size_t inky_buttons_read_events(inky_buttons_t *ctx, inky_button_event_t *events, size_t max) {
+    if (!ctx || !events) return 0;
+
+#ifdef __linux__
+    // Clear the notification before draining: an event pushed after this
+    // read sets it again, so the fd can never be idle with events queued
+    if (ctx->notify_fd >= 0) {
+        uint64_t count;
+        if (read(ctx->notify_fd, &count, sizeof(count)) < 0) {
+            // EAGAIN: nothing was signalled
+        }
+    }
+#endif
+    
+    uint32_t head = ctx->ring_head;
+    uint32_t tail = __atomic_load_n(&ctx->ring_tail, __ATOMIC_ACQUIRE);
+    size_t count = tail - head;
+    if (count > max) count = max;
+    
+    for (size_t i = 0; i < count; i++) {
+        events[i] = ctx->ring[(head + i) & (EVENT_RING_SIZE - 1)];
+    }
+    __atomic_store_n(&ctx->ring_head, head + (uint32_t)count, __ATOMIC_RELEASE);
+
+#ifdef __linux__
+    // Caller took fewer than were queued: keep the fd readable
+    if (ctx->notify_fd >= 0 && head + count != tail) {
+        uint64_t one = 1;
+        if (write(ctx->notify_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated: the fd is readable anyway
+        }
+    }
+#endif
+    return count;
+}
+
+int inky_buttons_get_event_fd(inky_buttons_t *ctx) {
+    return ctx ? ctx->notify_fd : -1;
+}
+
+uint64_t inky_buttons_get_dropped(inky_buttons_t *ctx) {
+    return ctx ? __atomic_load_n(&ctx->dropped, __ATOMIC_RELAXED) : 0;
+}
+
+void inky_buttons_set_gesture_timing(inky_buttons_t *ctx, uint32_t long_press_ms,
+                                     uint32_t double_press_ms, uint32_t repeat_ms) {
+    if (!ctx) return;
+    __atomic_store_n(&ctx->long_press_ms, long_press_ms, __ATOMIC_RELAXED);
+    __atomic_store_n(&ctx->double_press_ms, double_press_ms, __ATOMIC_RELAXED);
+    __atomic_store_n(&ctx->repeat_ms, repeat_ms, __ATOMIC_RELAXED);
+}
+
+const char *inky_button_event_name(inky_button_event_type_t type) {
+    switch (type) {
+        case INKY_BUTTON_EVENT_PRESS:        return "PRESS";
+        case INKY_BUTTON_EVENT_RELEASE:      return "RELEASE";
+        case INKY_BUTTON_EVENT_LONG_PRESS:   return "LONG_PRESS";
+        case INKY_BUTTON_EVENT_REPEAT:       return "REPEAT";
+        case INKY_BUTTON_EVENT_DOUBLE_PRESS: return "DOUBLE_PRESS";
+    }
+    return "UNKNOWN";
+}
+
+// Process-wide convenience API on top of a default instance
+
+int inky_button_init(void) {
+    if (default_buttons) {
+        return 0;  // Already initialized
+    }
+    
+    default_buttons = inky_buttons_open(NULL);
+    return default_buttons ? 0 : -1;
+}
+
+void inky_button_set_callback(inky_button_callback_t callback, void *user_data) {
+    inky_buttons_set_callback(default_buttons, callback, user_data);
+}
+
+void inky_button_poll(void) {
+    inky_buttons_poll(default_buttons);
+}
+
+bool inky_button_is_pressed(int button) {
+    return inky_buttons_is_pressed(default_buttons, button);
+}
+
+void inky_button_cleanup(void) {
+    if (!default_buttons) return;
+    
+    inky_buttons_close(default_buttons);
+    default_buttons = NULL;
+}
+
+void inky_button_emulate_press(int button) {
+    inky_buttons_emulate_press(default_buttons, button);
+}
+
+void inky_button_emulate_release(int button) {
+    inky_buttons_emulate_release(default_buttons, button);
+}
+
+size_t inky_button_read_events(inky_button_event_t *events, size_t max) {
+    return inky_buttons_read_events(default_buttons, events, max);
+}
+
+int inky_button_get_event_fd(void) {
+    return inky_buttons_get_event_fd(default_buttons);
+}
@@ -0,0 +1,178 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Pre-rendered frame cache
+//
+// File layout (host byte order):
+//   cache_header_t, padded to data_offset (one page)
+//   frames: buffer_size packed 4bpp bytes each, every frame starting on a
+//   page boundary frame_stride bytes after the previous one
+//
+// Frames are appended one at a time from a display's buffer. Readers map the
+// whole file read-only; showing a frame points the update at the mapping, so
+// the pixels go from the page cache to the SPI driver without a copy into
+// display->buffer and the first show of a frame costs only its page faults.
+
+#define CACHE_MAGIC   "INKYFC01"
+#define CACHE_VERSION 1
+#define CACHE_MIN_PAGE 4096
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint16_t width;
+    uint16_t height;
+    uint32_t buffer_size;
+    uint32_t frame_stride;   // buffer_size rounded up to the page size
+    uint32_t data_offset;    // First frame, also page-aligned
+    uint32_t frame_count;
+} cache_header_t;
+
+struct inky_frame_cache {
+    uint8_t *map;
+    size_t map_size;
+    cache_header_t header;
+};
+
+static size_t page_round(size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t align = page > CACHE_MIN_PAGE ? (size_t)page : CACHE_MIN_PAGE;
+    return (size + align - 1) / align * align;
+}
+
+static bool read_header(int fd, cache_header_t *header) {
+    return pread(fd, header, sizeof(*header), 0) == (ssize_t)sizeof(*header) &&
+           memcmp(header->magic, CACHE_MAGIC, 8) == 0 && header->version == CACHE_VERSION &&
+           header->frame_stride >= header->buffer_size && header->data_offset >= sizeof(*header);
+}
+
+int inky_frame_cache_append(const char *filename, inky_t *display) {
+    if (!filename || !display) return -1;
+    
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror("Failed to open frame cache");
+        return -1;
+    }
+    
+    struct stat st;
+    cache_header_t header;
+    if (fstat(fd, &st) == 0 && st.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, 8);
+        header.version = CACHE_VERSION;
+        header.width = display->width;
+        header.height = display->height;
+        header.buffer_size = (uint32_t)display->buffer_size;
+        header.frame_stride = (uint32_t)page_round(display->buffer_size);
+        header.data_offset = (uint32_t)page_round(sizeof(header));
+    } else if (!read_header(fd, &header) || header.width != display->width ||
+               header.height != display->height || header.buffer_size != display->buffer_size) {
+        fprintf(stderr, "%s is not a frame cache for this panel\n", filename);
+        close(fd);
+        return -1;
+    }
+    
+    // Frame first, then the count that makes it visible to readers
+    uint32_t index = header.frame_count;
+    off_t offset = (off_t)header.data_offset + (off_t)index * header.frame_stride;
+    header.frame_count++;
+    if (pwrite(fd, display->buffer, display->buffer_size, offset) != (ssize_t)display->buffer_size ||
+        ftruncate(fd, offset + header.frame_stride) < 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        perror("Failed to write frame cache");
+        close(fd);
+        return -1;
+    }
+    
+    close(fd);
+    return (int)index;
+}
+
+inky_frame_cache_t *inky_frame_cache_open(const char *filename) {
+    if (!filename) return NULL;
+    
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open frame cache");
+        return NULL;
+    }
+    
+    inky_frame_cache_t *cache = calloc(1, sizeof(inky_frame_cache_t));
+    struct stat st;
+    if (!cache || !read_header(fd, &cache->header) || fstat(fd, &st) < 0 ||
+        (uint64_t)st.st_size < cache->header.data_offset +
+                               (uint64_t)cache->header.frame_count * cache->header.frame_stride) {
+        fprintf(stderr, "Not a frame cache: %s\n", filename);
+        free(cache);
+        close(fd);
+        return NULL;
+    }
+    
+    cache->map_size = (size_t)st.st_size;
+    cache->map = mmap(NULL, cache->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping keeps the file open
+    if (cache->map == MAP_FAILED) {
+        perror("Failed to map frame cache");
+        free(cache);
+        return NULL;
+    }
+    
+#ifdef MADV_SEQUENTIAL
+    // Frames are read front to back by the SPI transfer
+    madvise(cache->map, cache->map_size, MADV_SEQUENTIAL);
+#endif
+    return cache;
+}
+
+void inky_frame_cache_close(inky_frame_cache_t *cache) {
+    if (!cache) return;
+    munmap(cache->map, cache->map_size);
+    free(cache);
+}
+
+size_t inky_frame_cache_count(inky_frame_cache_t *cache) {
+    return cache ? cache->header.frame_count : 0;
+}
+
+const uint8_t *inky_frame_cache_frame(inky_frame_cache_t *cache, size_t index) {
+    if (!cache || index >= cache->header.frame_count) return NULL;
+    return cache->map + cache->header.data_offset + index * cache->header.frame_stride;
+}
+
+int inky_frame_cache_show(inky_t *display, inky_frame_cache_t *cache, size_t index) {
+    const uint8_t *frame = inky_frame_cache_frame(cache, index);
+    if (!display || !frame) return -1;
+    if (cache->header.width != display->width || cache->header.height != display->height ||
+        cache->header.buffer_size != display->buffer_size) {
+        fprintf(stderr, "Frame cache is %ux%u, display is %ux%u\n", cache->header.width,
+                cache->header.height, display->width, display->height);
+        return -1;
+    }
+    
+    INKY_TRACE_BEGIN_ARG("frame_cache_show", (int64_t)index);
+    if (display->is_emulator) {
+        // The emulator's buffer is its glass: it has to hold the frame
+        memcpy(display->buffer, frame, display->buffer_size);
+        inky_update(display);
+    } else {
+        // Full updates only read the buffer, so the mapping can stand in for
+        // it and the SPI transfer runs straight from the page cache. The copy
+        // afterwards keeps the buffer matching the glass and the content
+        // hashes, as on the emulator, so later partial updates and
+        // inky_get_pixel() start from the frame shown
+        uint8_t *buffer = display->buffer;
+        display->buffer = (uint8_t *)frame;
+        inky_update(display);
+        display->buffer = buffer;
+        memcpy(display->buffer, frame, display->buffer_size);
+    }
+    INKY_TRACE_END("frame_cache_show");
+    return 0;
+}
@@ -0,0 +1,273 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// Display server client
+//
+// Every submit builds a fresh memfd the size of the display buffer, writes
+// the rows the rectangle touches (the rest stays a hole and costs no
+// memory), seals it and hands it over; the server never sees a buffer the
+// client can still change. An update's answer settles every request up to
+// its seq, so the client tracks the latest request settled by an update
+// and the ranges of requests that failed: refused on their own, or settled
+// by a failed update. Only the last CLIENT_FAILURES are kept; a wait on an
+// older failure reads as done.
+
+#ifdef __linux__
+
+#define CLIENT_FAILURES 16
+
+struct inky_client {
+    int fd;
+    uint16_t width, height;    // Panel size from the server's hello
+    size_t frame_size;
+    uint32_t next_seq;
+    uint32_t done_seq;         // Latest request an update settled
+    struct {
+        uint32_t first, last;
+    } failed[CLIENT_FAILURES]; // Ring of failed request ranges
+    unsigned failed_count;     // Ranges ever recorded
+    bool closed;               // Server went away
+};
+
+static void client_record_failure(inky_client_t *client, uint32_t first, uint32_t last) {
+    unsigned slot = client->failed_count++ % CLIENT_FAILURES;
+    client->failed[slot].first = first;
+    client->failed[slot].last = last;
+}
+
+static bool client_failed(const inky_client_t *client, uint32_t seq) {
+    unsigned count = client->failed_count < CLIENT_FAILURES ? client->failed_count : CLIENT_FAILURES;
+    for (unsigned i = 0; i < count; i++) {
+        if (seq >= client->failed[i].first && seq <= client->failed[i].last) return true;
+    }
+    return false;
+}
+
+// Read one answer; false once the connection is gone
+static bool client_receive(inky_client_t *client, int flags) {
+    inky_msg_t msg;
+    ssize_t n = recv(client->fd, &msg, sizeof(msg), flags);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return true;
+    if (n != sizeof(msg) || msg.magic != INKY_SERVER_MAGIC || msg.version != INKY_SERVER_VERSION) {
+        client->closed = true;
+        return false;
+    }
+    
+    if (msg.type == INKY_MSG_HELLO) {
+        client->width = msg.width;
+        client->height = msg.height;
+    } else if (msg.type == INKY_MSG_DONE && (msg.flags & INKY_MSG_REJECTED)) {
+        client_record_failure(client, msg.seq, msg.seq);
+    } else if (msg.type == INKY_MSG_DONE && msg.seq > client->done_seq) {
+        // Everything accepted since the previous update's answer was in this one
+        if (msg.status < 0) {
+            client_record_failure(client, client->done_seq + 1, msg.seq);
+        }
+        client->done_seq = msg.seq;
+    }
+    return true;
+}
+
+inky_client_t *inky_client_connect(const char *path) {
+    if (!path) path = INKY_SERVER_SOCKET;
+    
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) return NULL;
+    strcpy(addr.sun_path, path);
+    
+    inky_client_t *client = calloc(1, sizeof(inky_client_t));
+    if (!client) return NULL;
+    client->next_seq = 1;
+    client->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (client->fd < 0 || connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Failed to connect to display server");
+        if (client->fd >= 0) close(client->fd);
+        free(client);
+        return NULL;
+    }
+    
+    // The hello says what size of canvas the server takes
+    if (!client_receive(client, 0) || client->width == 0) {
+        fprintf(stderr, "Display server at %s did not answer\n", path);
+        close(client->fd);
+        free(client);
+        return NULL;
+    }
+    client->frame_size = ((size_t)client->width * client->height + 1) / 2;
+    return client;
+}
+
+void inky_client_disconnect(inky_client_t *client) {
+    if (!client) return;
+    close(client->fd);
+    free(client);
+}
+
+int inky_client_get_fd(inky_client_t *client) {
+    return client ? client->fd : -1;
+}
+
+static int client_send(inky_client_t *client, inky_t *canvas, bool full,
+                       uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!client || !canvas || client->closed) return -1;
+    if (canvas->width != client->width || canvas->height != client->height) {
+        fprintf(stderr, "Canvas is %ux%u, panel is %ux%u\n", canvas->width, canvas->height,
+                client->width, client->height);
+        return -1;
+    }
+    if (full) {
+        x = y = 0;
+        width = canvas->width;
+        height = canvas->height;
+    } else if (width == 0 || height == 0 || (uint32_t)x + width > canvas->width ||
+               (uint32_t)y + height > canvas->height) {
+        return -1;
+    }
+    
+    int fd = memfd_create("inky-frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        perror("Failed to create frame memfd");
+        return -1;
+    }
+    
+    // Bytes of the rows the rectangle covers, then the seals (a writable
+    // mapping would block F_SEAL_WRITE, so it goes first)
+    size_t first = ((size_t)y * canvas->width + x) / 2;
+    size_t last = (((size_t)y + height - 1) * canvas->width + x + width + 1) / 2;
+    uint8_t *map = MAP_FAILED;
+    bool ok = ftruncate(fd, client->frame_size) == 0 &&
+              (map = mmap(NULL, client->frame_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED;
+    if (ok) {
+        if (full || width == canvas->width) {
+            memcpy(map + first, canvas->buffer + first, last - first);
+        } else {
+            for (uint32_t row = y; row < (uint32_t)y + height; row++) {
+                size_t start = ((size_t)row * canvas->width + x) / 2;
+                size_t end = ((size_t)row * canvas->width + x + width + 1) / 2;
+                memcpy(map + start, canvas->buffer + start, end - start);
+            }
+        }
+        munmap(map, client->frame_size);
+        ok = fcntl(fd, F_ADD_SEALS, INKY_SERVER_SEALS) == 0;
+    }
+    if (!ok) {
+        perror("Failed to prepare frame memfd");
+        close(fd);
+        return -1;
+    }
+    
+    uint32_t seq = client->next_seq++;
+    if (client->next_seq > INT32_MAX) client->next_seq = 1;
+    inky_msg_t msg = {
+        .magic = INKY_SERVER_MAGIC, .version = INKY_SERVER_VERSION, .type = INKY_MSG_SUBMIT,
+        .seq = seq, .flags = full ? INKY_MSG_FULL : 0, .x = x, .y = y, .width = width, .height = height
+    };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {&msg, sizeof(msg)};
+    struct msghdr hdr = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = control.buf, .msg_controllen = sizeof(control.buf)
+    };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&hdr);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    
+    // The server has its own reference once the message is queued
+    ssize_t sent;
+    do {
+        sent = sendmsg(client->fd, &hdr, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    close(fd);
+    if (sent != sizeof(msg)) {
+        client->closed = true;
+        return -1;
+    }
+    return (int)seq;
+}
+
+int inky_client_submit(inky_client_t *client, inky_t *canvas) {
+    return client_send(client, canvas, true, 0, 0, 0, 0);
+}
+
+int inky_client_submit_region(inky_client_t *client, inky_t *canvas,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    return client_send(client, canvas, false, x, y, width, height);
+}
+
+int inky_client_wait(inky_client_t *client, int id, int timeout_ms) {
+    if (!client || id <= 0) return -1;
+    
+    uint64_t deadline = inky_time_us() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000;
+    for (;;) {
+        // Drain whatever has arrived
+        while (!client->closed && client_receive(client, MSG_DONTWAIT)) {
+            struct pollfd pfd = {client->fd, POLLIN, 0};
+            if (poll(&pfd, 1, 0) <= 0) break;
+        }
+        if (client_failed(client, (uint32_t)id)) return -1;
+        if (client->done_seq >= (uint32_t)id) return 0;
+        if (client->closed) return -1;
+        
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            uint64_t now = inky_time_us();
+            if (now >= deadline) return 1;
+            wait_ms = (int)((deadline - now + 999) / 1000);
+        }
+        struct pollfd pfd = {client->fd, POLLIN, 0};
+        if (poll(&pfd, 1, wait_ms) < 0 && errno != EINTR) return -1;
+    }
+}
+
+int inky_client_update(inky_client_t *client, inky_t *canvas) {
+    int id = inky_client_submit(client, canvas);
+    return id > 0 && inky_client_wait(client, id, -1) == 0 ? 0 : -1;
+}
+
+int inky_client_update_region(inky_client_t *client, inky_t *canvas,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    int id = inky_client_submit_region(client, canvas, x, y, width, height);
+    return id > 0 && inky_client_wait(client, id, -1) == 0 ? 0 : -1;
+}
+
+#else
+
+// The display client needs Unix sockets and memfd sealing
+inky_client_t *inky_client_connect(const char *path) { (void)path; return NULL; }
+void inky_client_disconnect(inky_client_t *client) { (void)client; }
+int inky_client_get_fd(inky_client_t *client) { (void)client; return -1; }
+int inky_client_submit(inky_client_t *client, inky_t *canvas) { (void)client; (void)canvas; return -1; }
+int inky_client_submit_region(inky_client_t *client, inky_t *canvas,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    (void)client; (void)canvas; (void)x; (void)y; (void)width; (void)height;
+    return -1;
+}
+int inky_client_wait(inky_client_t *client, int id, int timeout_ms) {
+    (void)client; (void)id; (void)timeout_ms;
+    return -1;
+}
+int inky_client_update(inky_client_t *client, inky_t *canvas) { (void)client; (void)canvas; return -1; }
+int inky_client_update_region(inky_client_t *client, inky_t *canvas,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    (void)client; (void)canvas; (void)x; (void)y; (void)width; (void)height;
+    return -1;
+}
+
+#endif
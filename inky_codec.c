@@ -0,0 +1,307 @@
+#include "inky_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Run-length codec for packed 4bpp buffers
+//
+// Token stream: pairs of
+//   varint literal length, literal bytes, varint run length, run byte (if run > 0)
+// over packed bytes (two pixels each). Runs shorter than INKY_RLE_MIN_RUN stay
+// in the literal. The same stream, applied with XOR against a previous frame,
+// is what the frame recorder stores.
+//
+// inky_buffer_encode() output starts with a small header so it can be
+// decoded without knowing the rectangle:
+//   'I' 'R' version, varint width, varint height, token stream
+
+#define RLE_MAGIC0  'I'
+#define RLE_MAGIC1  'R'
+#define RLE_VERSION 1
+#define RLE_HEADER_MAX 9   // Magic, version and two 3-byte varints
+
+// Length of the run of byte v starting at p (at most n)
+static size_t scan_run(const uint8_t *p, size_t n, uint8_t v) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i pattern = _mm_set1_epi8((char)v);
+    while (i + 16 <= n) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern));
+        if (mask != 0xFFFF) {
+            return i + (size_t)__builtin_ctz(~mask);
+        }
+        i += 16;
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t pattern = vdupq_n_u8(v);
+    while (i + 16 <= n) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(p + i), pattern);
+        uint8x8_t both = vand_u8(vget_low_u8(eq), vget_high_u8(eq));
+        if (vget_lane_u64(vreinterpret_u64_u8(both), 0) != UINT64_MAX) break;
+        i += 16;
+    }
+#endif
+    while (i < n && p[i] == v) i++;
+    return i;
+}
+
+// Length of the run where cur[i] ^ prev[i] == v
+static size_t scan_run_xor(const uint8_t *cur, const uint8_t *prev, size_t n, uint8_t v) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i pattern = _mm_set1_epi8((char)v);
+    while (i + 16 <= n) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(cur + i)),
+                                  _mm_loadu_si128((const __m128i *)(prev + i)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, pattern));
+        if (mask != 0xFFFF) {
+            return i + (size_t)__builtin_ctz(~mask);
+        }
+        i += 16;
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t pattern = vdupq_n_u8(v);
+    while (i + 16 <= n) {
+        uint8x16_t eq = vceqq_u8(veorq_u8(vld1q_u8(cur + i), vld1q_u8(prev + i)), pattern);
+        uint8x8_t both = vand_u8(vget_low_u8(eq), vget_high_u8(eq));
+        if (vget_lane_u64(vreinterpret_u64_u8(both), 0) != UINT64_MAX) break;
+        i += 16;
+    }
+#endif
+    while (i < n && (uint8_t)(cur[i] ^ prev[i]) == v) i++;
+    return i;
+}
+
+static size_t put_varint(uint8_t *out, size_t value) {
+    size_t o = 0;
+    while (value >= 0x80) {
+        out[o++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[o++] = (uint8_t)value;
+    return o;
+}
+
+static bool get_varint(const uint8_t *in, size_t len, size_t *pos, size_t *value) {
+    size_t v = 0;
+    for (int shift = 0; *pos < len && shift < 64; shift += 7) {
+        uint8_t b = in[(*pos)++];
+        v |= (size_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t inky_rle_bound(size_t n) {
+    // Literal/run pairs never cost more than the bytes they cover, plus the final pair
+    return n + n / 64 + 32;
+}
+
+static size_t emit_literal(uint8_t *out, const uint8_t *cur, const uint8_t *prev, size_t start, size_t end) {
+    size_t o = put_varint(out, end - start);
+    if (prev) {
+        for (size_t k = start; k < end; k++) out[o++] = cur[k] ^ prev[k];
+    } else {
+        memcpy(out + o, cur + start, end - start);
+        o += end - start;
+    }
+    return o;
+}
+
+size_t inky_rle_encode(const uint8_t *cur, const uint8_t *prev, size_t n, uint8_t *out) {
+    size_t o = 0, lit_start = 0, i = 0;
+    
+    while (i < n) {
+        uint8_t v = prev ? cur[i] ^ prev[i] : cur[i];
+        size_t run = prev ? scan_run_xor(cur + i, prev + i, n - i, v) : scan_run(cur + i, n - i, v);
+        
+        if (run < INKY_RLE_MIN_RUN) {
+            i += run;  // Too short to pay for itself, stays in the literal
+            continue;
+        }
+        
+        o += emit_literal(out + o, cur, prev, lit_start, i);
+        o += put_varint(out + o, run);
+        out[o++] = v;
+        i = lit_start = i + run;
+    }
+    
+    if (lit_start < n) {
+        o += emit_literal(out + o, cur, prev, lit_start, n);
+        o += put_varint(out + o, 0);
+    }
+    
+    return o;
+}
+
+// Decode into a byte sink: either a flat buffer or a rectangle of a display
+typedef struct {
+    uint8_t *flat;           // Non-NULL: write bytes here
+    bool xor;
+    inky_t *display;         // Otherwise: rectangle of this display
+    uint16_t x, y, width;
+    size_t pixels;           // width * height
+} rle_sink_t;
+
+static void rect_put_pixel(inky_t *display, size_t pixel, uint8_t color) {
+    size_t byte = pixel / 2;
+    if (pixel & 1) {
+        display->buffer[byte] = (display->buffer[byte] & 0xF0) | (color & 0x0F);
+    } else {
+        display->buffer[byte] = (display->buffer[byte] & 0x0F) | (uint8_t)(color << 4);
+    }
+}
+
+// Write count bytes (src, or the fill byte when src is NULL) at packed byte
+// offset o of the rectangle
+static void rect_write(const rle_sink_t *sink, size_t o, const uint8_t *src, uint8_t fill, size_t count) {
+    inky_t *display = sink->display;
+    size_t row_pixels = sink->width;
+    
+    if (!(sink->x & 1) && !(row_pixels & 1)) {
+        // Byte-aligned rectangle: whole spans per display row
+        size_t row_bytes = row_pixels / 2;
+        while (count > 0) {
+            size_t row = o / row_bytes, col = o % row_bytes;
+            size_t span = row_bytes - col < count ? row_bytes - col : count;
+            uint8_t *dst = display->buffer + ((size_t)(sink->y + row) * display->width + sink->x) / 2 + col;
+            if (src) {
+                memcpy(dst, src, span);
+                src += span;
+            } else {
+                memset(dst, fill, span);
+            }
+            o += span;
+            count -= span;
+        }
+        return;
+    }
+    
+    // Odd offset or width: place pixel by pixel, walking the rectangle
+    size_t p = o * 2;
+    size_t row = p / row_pixels, col = p % row_pixels;
+    size_t pixel = (size_t)(sink->y + row) * display->width + sink->x + col;
+    size_t end = count * 2 < sink->pixels - p ? p + count * 2 : sink->pixels;  // Drops padding nibble
+    for (size_t k = 0; p < end; p++, k++) {
+        uint8_t b = src ? src[k / 2] : fill;
+        rect_put_pixel(display, pixel, (k & 1) ? b & 0x0F : b >> 4);
+        pixel++;
+        if (++col == row_pixels) {
+            col = 0;
+            pixel += display->width - row_pixels;
+        }
+    }
+}
+
+static bool rle_decode_sink(const uint8_t *in, size_t len, const rle_sink_t *sink, size_t n) {
+    size_t pos = 0, o = 0;
+    
+    while (o < n) {
+        size_t lit, run;
+        if (!get_varint(in, len, &pos, &lit) || lit > n - o || lit > len - pos) return false;
+        if (sink->flat && sink->xor) {
+            for (size_t k = 0; k < lit; k++) sink->flat[o + k] ^= in[pos + k];
+        } else if (sink->flat) {
+            memcpy(sink->flat + o, in + pos, lit);
+        } else if (lit) {
+            rect_write(sink, o, in + pos, 0, lit);
+        }
+        pos += lit;
+        o += lit;
+        
+        if (!get_varint(in, len, &pos, &run) || run > n - o) return false;
+        if (run > 0) {
+            if (pos >= len) return false;
+            uint8_t v = in[pos++];
+            if (sink->flat && sink->xor) {
+                if (v) {
+                    for (size_t k = 0; k < run; k++) sink->flat[o + k] ^= v;
+                }
+            } else if (sink->flat) {
+                memset(sink->flat + o, v, run);
+            } else {
+                rect_write(sink, o, NULL, v, run);
+            }
+            o += run;
+        }
+    }
+    
+    return pos == len;
+}
+
+bool inky_rle_decode(const uint8_t *in, size_t len, uint8_t *dst, size_t n, bool xor) {
+    rle_sink_t sink = {dst, xor, NULL, 0, 0, 0, 0};
+    return rle_decode_sink(in, len, &sink, n);
+}
+
+size_t inky_buffer_encode_bound(uint16_t width, uint16_t height) {
+    return RLE_HEADER_MAX + inky_rle_bound(((size_t)width * height + 1) / 2);
+}
+
+size_t inky_buffer_encode(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                          uint8_t *out, size_t capacity) {
+    if (!display || !out || width == 0 || height == 0) return 0;
+    if (x + width > display->width || y + height > display->height) return 0;
+    if (capacity < inky_buffer_encode_bound(width, height)) return 0;
+    
+    INKY_TRACE_BEGIN("buffer_encode");
+    size_t o = 0;
+    out[o++] = RLE_MAGIC0;
+    out[o++] = RLE_MAGIC1;
+    out[o++] = RLE_VERSION;
+    o += put_varint(out + o, width);
+    o += put_varint(out + o, height);
+    
+    size_t n = ((size_t)width * height + 1) / 2;
+    if (x == 0 && y == 0 && width == display->width && height == display->height) {
+        // Whole panel: straight from the framebuffer
+        o += inky_rle_encode(display->buffer, NULL, n, out + o);
+    } else {
+        uint8_t *region = malloc(n);
+        if (!region) {
+            INKY_TRACE_END("buffer_encode");
+            return 0;
+        }
+        inky_extract_region(display, x, y, width, height, region);
+        o += inky_rle_encode(region, NULL, n, out + o);
+        free(region);
+    }
+    
+    INKY_TRACE_END("buffer_encode");
+    return o;
+}
+
+int inky_buffer_decode(inky_t *display, uint16_t x, uint16_t y, const uint8_t *in, size_t len) {
+    if (!display || !in || len < 5) return -1;
+    if (in[0] != RLE_MAGIC0 || in[1] != RLE_MAGIC1 || in[2] != RLE_VERSION) return -1;
+    
+    size_t pos = 3, width, height;
+    if (!get_varint(in, len, &pos, &width) || !get_varint(in, len, &pos, &height)) return -1;
+    // Sizes come from the stream: bound them before any arithmetic on them
+    if (width == 0 || height == 0 || width > display->width || height > display->height ||
+        x > display->width || y > display->height ||
+        width > (size_t)(display->width - x) || height > (size_t)(display->height - y)) {
+        return -1;
+    }
+    
+    INKY_TRACE_BEGIN("buffer_decode");
+    size_t n = (width * height + 1) / 2;
+    rle_sink_t sink = {NULL, false, display, x, y, (uint16_t)width, width * height};
+    if (x == 0 && y == 0 && width == display->width && height == display->height) {
+        sink.flat = display->buffer;  // Whole panel: straight into the framebuffer
+    }
+    
+    // A corrupt stream may leave the target partly written
+    bool ok = rle_decode_sink(in + pos, len - pos, &sink, n);
+    INKY_TRACE_END("buffer_decode");
+    return ok ? 0 : -1;
+}
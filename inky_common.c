@@ -1,11 +1,34 @@
 #include "inky_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <string.h>
 #include <time.h>
 
+void inky_config_default(inky_config_t *config) {
+    if (!config) return;
+    
+    config->emulator = false;
+    config->spi_device = INKY_SPI_DEVICE;
+    config->gpio_device = INKY_GPIO_DEVICE;
+    config->spi_speed_hz = INKY_SPI_SPEED_HZ;
+    config->reset_pin = INKY_RESET_PIN;
+    config->busy_pin = INKY_BUSY_PIN;
+    config->dc_pin = INKY_DC_PIN;
+    config->cs_pin = INKY_CS_PIN;
+}
+
+inky_t* inky_init(bool emulator) {
+    inky_config_t config;
+    inky_config_default(&config);
+    config.emulator = emulator;
+    
+    // Backend-specific initialization is in inky_emulator.c / inky_hardware.c
+    return inky_init_ex(&config);
+}
+
 // Initialize common display structure
-inky_t* inky_init_common(bool emulator) {
+inky_t* inky_init_common(const inky_config_t *config) {
     inky_t *display = calloc(1, sizeof(inky_t));
     if (!display) {
         return NULL;
@@ -13,16 +36,30 @@ inky_t* inky_init_common(bool emulator) {
     
     display->width = INKY_WIDTH;
     display->height = INKY_HEIGHT;
-    display->is_emulator = emulator;
+    display->is_emulator = config->emulator;
     display->border_color = INKY_WHITE;
     display->h_flip = false;
     display->v_flip = false;
+    memcpy(display->palette_rgb, inky_palette_rgb, sizeof(display->palette_rgb));
+    
+    // Devices and pins (unset fields fall back to the HAT defaults)
+    snprintf(display->spi_device, sizeof(display->spi_device), "%s",
+             config->spi_device ? config->spi_device : INKY_SPI_DEVICE);
+    snprintf(display->gpio_device, sizeof(display->gpio_device), "%s",
+             config->gpio_device ? config->gpio_device : INKY_GPIO_DEVICE);
+    display->spi_speed_hz = config->spi_speed_hz ? config->spi_speed_hz : INKY_SPI_SPEED_HZ;
+    display->reset_pin = config->reset_pin;
+    display->busy_pin = config->busy_pin;
+    display->dc_pin = config->dc_pin;
+    display->cs_pin = config->cs_pin;
     
     // Calculate buffer size - 4 bits per pixel, packed
     display->buffer_size = (display->width * display->height + 1) / 2;
     display->buffer = calloc(display->buffer_size, 1);
     
-    if (!display->buffer) {
+    // Nothing is known about what the glass shows until the first update
+    if (!display->buffer || !inky_hash_init(display)) {
+        free(display->buffer);
         free(display);
         return NULL;
     }
@@ -32,7 +69,16 @@ inky_t* inky_init_common(bool emulator) {
     
     // Initialize partial update tracking
     display->partial_update_count = 0;
-    display->last_full_refresh = time(NULL);
+    display->last_full_refresh_us = inky_time_us();
+    
+    // Deep sleep after each update; the register shadow is filled by the backend
+    display->auto_sleep = true;
+    display->asleep = false;
+    display->init_seq_valid = false;
+    
+    // Nothing known about refresh timing yet
+    display->temperature = INKY_TEMP_UNKNOWN;
+    inky_refresh_model_init(&display->refresh_model);
     
     return display;
 }
@@ -40,13 +86,28 @@ inky_t* inky_init_common(bool emulator) {
 void inky_destroy_common(inky_t *display) {
     if (!display) return;
     
+    inky_record_stop(display);
+    
     if (display->buffer) {
         free(display->buffer);
     }
     
+    free(display->tile_hash);
     free(display);
 }
 
+// Monotonic time in microseconds
+uint64_t inky_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Time on the display's clock (the emulator can run on a virtual one)
+uint64_t inky_display_now_us(inky_t *display) {
+    return inky_clock_now_us(display->clock);
+}
+
 void inky_clear(inky_t *display, uint8_t color) {
     if (!display || !display->buffer) return;
     
@@ -87,9 +148,48 @@ uint8_t inky_get_pixel(inky_t *display, uint16_t x, uint16_t y) {
     }
 }
 
+// Copy a rectangle out of the display buffer into a tightly packed 4-bit
+// buffer of (width * height + 1) / 2 bytes, as sent for partial updates
+void inky_extract_region(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                         uint8_t *region_buffer) {
+    // Copy pixels from the region to the temporary buffer
+    size_t pixel_idx = 0;
+    for (uint16_t row = y; row < y + height; row++) {
+        for (uint16_t col = x; col < x + width; col++) {
+            // Get pixel from main buffer
+            size_t main_pixel_idx = row * display->width + col;
+            size_t main_byte_idx = main_pixel_idx / 2;
+            uint8_t pixel_value;
+            
+            if (main_pixel_idx & 1) {
+                // Odd pixel - low nibble
+                pixel_value = display->buffer[main_byte_idx] & 0x0F;
+            } else {
+                // Even pixel - high nibble
+                pixel_value = (display->buffer[main_byte_idx] >> 4) & 0x0F;
+            }
+            
+            // Store in region buffer
+            size_t region_byte_idx = pixel_idx / 2;
+            if (pixel_idx & 1) {
+                // Odd pixel - low nibble
+                region_buffer[region_byte_idx] = (region_buffer[region_byte_idx] & 0xF0) | (pixel_value & 0x0F);
+            } else {
+                // Even pixel - high nibble
+                region_buffer[region_byte_idx] = (region_buffer[region_byte_idx] & 0x0F) | ((pixel_value & 0x0F) << 4);
+            }
+            
+            pixel_idx++;
+        }
+    }
+}
+
 void inky_set_border(inky_t *display, uint8_t color) {
     if (!display) return;
     display->border_color = color & 0x07;
+    
+    // Border lives in the CDI register - rebuild the cached init stream
+    display->init_seq_valid = false;
 }
 
 uint16_t inky_get_width(inky_t *display) {
@@ -102,34 +202,115 @@ uint16_t inky_get_height(inky_t *display) {
     return display->height;
 }
 
-void inky_update(inky_t *display) {
-    if (!display) return;
+// Content already on the glass: count the update and leave the panel alone
+static bool skip_unchanged_full(inky_t *display) {
+    if (!inky_hash_full_unchanged(display)) return false;
     
+    display->stats.skipped[INKY_UPDATE_FULL]++;
+    printf("%s: Full update skipped (content unchanged)\n", display->is_emulator ? "Emulator" : "Display");
+    return true;
+}
+
+// Bookkeeping shared by inky_update() and inky_update_many()
+static void begin_full_update(inky_t *display) {
     // Reset partial update tracking for full refresh
     display->partial_update_count = 0;
-    display->last_full_refresh = time(NULL);
+    display->last_full_refresh_us = inky_display_now_us(display);
+    display->stats.updates[INKY_UPDATE_FULL]++;
+    inky_stats_begin_update(display);
+    inky_record_frame(display, INKY_UPDATE_FULL, 0, 0, display->width, display->height);
     
     if (display->is_emulator) {
         printf("Emulator: Full display update (ghosting cleared)\n");
     } else {
         printf("Full display update (partial count reset, ghosting cleared)\n");
+    }
+}
+
+bool inky_prepare_full_update(inky_t *display) {
+    if (skip_unchanged_full(display)) {
+        return false;
+    }
+    begin_full_update(display);
+    return true;
+}
+
+void inky_update(inky_t *display) {
+    if (!display) return;
+    
+    INKY_TRACE_BEGIN("inky_update");
+    if (!inky_prepare_full_update(display)) {
+        INKY_TRACE_END("inky_update");
+        return;
+    }
+    if (display->is_emulator) {
+        // Emulated ghosting and refresh timing are implemented in emulator backend
+        inky_emu_update_many(&display, 1);
+    } else {
         // Hardware update is implemented in hardware backend
         inky_hw_update(display);
     }
+    INKY_TRACE_END("inky_update");
 }
 
-void inky_update_region(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
-    if (!display) return;
+void inky_update_many(inky_t **displays, size_t count) {
+    if (!displays || count == 0) return;
+    
+    inky_t **hardware = malloc(2 * count * sizeof(inky_t *));
+    if (!hardware) {
+        // Fall back to one panel at a time
+        for (size_t i = 0; i < count; i++) {
+            inky_update(displays[i]);
+        }
+        return;
+    }
+    inky_t **emulated = hardware + count;
+    
+    INKY_TRACE_BEGIN_ARG("inky_update_many", (int64_t)count);
+    
+    size_t hw_count = 0, emu_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!displays[i] || skip_unchanged_full(displays[i])) continue;
+        
+        begin_full_update(displays[i]);
+        if (displays[i]->is_emulator) {
+            emulated[emu_count++] = displays[i];
+        } else {
+            hardware[hw_count++] = displays[i];
+        }
+    }
     
+    if (hw_count > 0) {
+        inky_hw_update_many(hardware, hw_count);
+    }
+    if (emu_count > 0) {
+        inky_emu_update_many(emulated, emu_count);
+    }
+    
+    INKY_TRACE_END("inky_update_many");
+    free(hardware);
+}
+
+bool inky_prepare_region_update(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
     // Validate coordinates
     if (x >= display->width || y >= display->height || 
         x + width > display->width || y + height > display->height) {
         printf("ERROR: Region coordinates out of bounds\n");
-        return;
+        return false;
+    }
+    
+    if (inky_hash_region_unchanged(display, x, y, width, height)) {
+        display->stats.skipped[INKY_UPDATE_PARTIAL]++;
+        printf("%s: Partial update (%d,%d) %dx%d skipped (content unchanged)\n",
+               display->is_emulator ? "Emulator" : "Display", x, y, width, height);
+        return false;
     }
     
     // Increment partial update counter
     display->partial_update_count++;
+    display->stats.updates[INKY_UPDATE_PARTIAL]++;
+    inky_stats_begin_update(display);
+    inky_record_frame(display, INKY_UPDATE_PARTIAL, x, y, width, height);
     
     // Warn about potential ghosting
     if (display->partial_update_count >= 5) {
@@ -138,51 +319,176 @@ void inky_update_region(inky_t *display, uint16_t x, uint16_t y, uint16_t width,
         printf("Consider calling inky_update() for full refresh to clear ghosting.\n");
     }
     
+    printf("%sPartial update #%d region (%d,%d) %dx%d\n", display->is_emulator ? "Emulator: " : "",
+           display->partial_update_count, x, y, width, height);
+    return true;
+}
+
+void inky_update_region(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!display) return;
+    
+    INKY_TRACE_BEGIN("inky_update_region");
+    if (!inky_prepare_region_update(display, x, y, width, height)) {
+        INKY_TRACE_END("inky_update_region");
+        return;
+    }
+    
     if (display->is_emulator) {
-        printf("Emulator: Partial update #%d region (%d,%d) %dx%d\n", 
-               display->partial_update_count, x, y, width, height);
+        // Emulated ghosting and refresh timing are implemented in emulator backend
+        inky_emu_partial_update(display, x, y, width, height);
     } else {
-        printf("Partial update #%d region (%d,%d) %dx%d\n", 
-               display->partial_update_count, x, y, width, height);
         // Hardware partial update is implemented in hardware backend
         inky_hw_partial_update(display, x, y, width, height);
     }
+    
+    INKY_TRACE_END("inky_update_region");
+}
+
+void inky_set_auto_sleep(inky_t *display, bool enable) {
+    if (!display) return;
+    display->auto_sleep = enable;
+}
+
+void inky_sleep(inky_t *display) {
+    if (!display) return;
+    
+    if (!display->is_emulator) {
+        inky_hw_sleep(display);
+    }
+}
+
+uint32_t inky_get_wake_latency_us(inky_t *display) {
+    if (!display) return 0;
+    return display->wake_latency_us;
+}
+
+uint32_t inky_estimate_refresh_ms(inky_t *display, inky_update_type_t type) {
+    if (!display || type >= INKY_UPDATE_TYPES) return 0;
+    return inky_refresh_predict_ms(&display->refresh_model, type, display->temperature);
+}
+
+uint32_t inky_get_refresh_eta_ms(inky_t *display) {
+    if (!display) return 0;
+    
+    uint64_t deadline = __atomic_load_n(&display->refresh_deadline_us, __ATOMIC_ACQUIRE);
+    uint64_t now = inky_display_now_us(display);
+    if (deadline == 0 || deadline <= now) return 0;
+    return (uint32_t)((deadline - now) / 1000);
+}
+
+int inky_get_temperature(inky_t *display) {
+    if (!display) return INKY_TEMP_UNKNOWN;
+    return display->temperature;
+}
+
+void inky_emulator_set_clock(inky_t *display, inky_clock_t *clock) {
+    if (!display || !display->is_emulator) return;
+    
+    // Keep the full refresh timer continuous across the switch
+    uint64_t since_full = inky_display_now_us(display) - display->last_full_refresh_us;
+    display->clock = clock;
+    display->last_full_refresh_us = inky_display_now_us(display) - since_full;
+}
+
+void inky_emulator_set_temperature(inky_t *display, int celsius) {
+    if (!display || !display->is_emulator) return;
+    display->temperature = celsius;
+}
+
+// Color palette - RGB values for each color
+const uint8_t inky_palette_rgb[8][3] = {
+    {57, 48, 57},       // BLACK
+    {255, 255, 255},    // WHITE
+    {58, 91, 70},       // GREEN
+    {61, 59, 94},       // BLUE
+    {156, 72, 75},      // RED
+    {208, 190, 71},     // YELLOW
+    {177, 106, 73},     // ORANGE
+    {255, 255, 255}     // CLEAN (white)
+};
+
+double inky_emulator_ghost_score(inky_t *display) {
+    if (!display || !display->ghost) return 0.0;
+    
+    // Distance between palette entries, relative to black/white
+    double distance[8][8];
+    double max_distance = 0.0;
+    for (int a = 0; a < 8; a++) {
+        for (int b = 0; b < 8; b++) {
+            double sum = 0.0;
+            for (int c = 0; c < 3; c++) {
+                double d = (double)display->palette_rgb[a][c] - display->palette_rgb[b][c];
+                sum += d * d;
+            }
+            distance[a][b] = sqrt(sum);
+            if (distance[a][b] > max_distance) max_distance = distance[a][b];
+        }
+    }
+    
+    // Mean visible residue: strength times how far the old color is from the current one
+    double total = 0.0;
+    size_t i = 0;
+    for (uint16_t y = 0; y < display->height; y++) {
+        for (uint16_t x = 0; x < display->width; x++, i++) {
+            const inky_ghost_t *g = &display->ghost[i];
+            if (g->level == 0) continue;
+            
+            uint8_t color = inky_get_pixel(display, x, y) & 7;
+            total += g->level * distance[color][g->residue & 7];
+        }
+    }
+    
+    return 100.0 * total / ((double)INKY_GHOST_MAX * max_distance * i);
+}
+
+// Render one row as RGB (3 bytes per pixel), including emulated ghosting
+void inky_render_rgb_row(inky_t *display, uint16_t y, uint8_t *rgb) {
+    const inky_ghost_t *ghost = display->ghost ? &display->ghost[(size_t)y * display->width] : NULL;
+    
+    for (uint16_t x = 0; x < display->width; x++, rgb += 3) {
+        uint8_t color = inky_get_pixel(display, x, y);
+        if (color > 7) color = 7;  // Clamp to valid range
+        
+        if (ghost && ghost[x].level) {
+            // Blend the residue of earlier partial refreshes back in
+            const uint8_t *old = display->palette_rgb[ghost[x].residue & 7];
+            double alpha = INKY_GHOST_MAX_BLEND * ghost[x].level / INKY_GHOST_MAX;
+            for (int c = 0; c < 3; c++) {
+                rgb[c] = (uint8_t)(display->palette_rgb[color][c] * (1.0 - alpha) + old[c] * alpha + 0.5);
+            }
+        } else {
+            memcpy(rgb, display->palette_rgb[color], 3);
+        }
+    }
 }
 
 int inky_emulator_save_ppm(inky_t *display, const char *filename) {
     if (!display || !filename) return -1;
     
-    // Color palette - RGB values for each color
-    static const uint8_t color_palette[8][3] = {
-        {57, 48, 57},       // BLACK
-        {255, 255, 255},    // WHITE
-        {58, 91, 70},       // GREEN
-        {61, 59, 94},       // BLUE
-        {156, 72, 75},      // RED
-        {208, 190, 71},     // YELLOW
-        {177, 106, 73},     // ORANGE
-        {255, 255, 255}     // CLEAN (white)
-    };
-    
     FILE *fp = fopen(filename, "wb");
     if (!fp) {
         perror("Failed to open file");
         return -1;
     }
     
-    // Write PPM header
-    fprintf(fp, "P6\n%d %d\n255\n", display->width, display->height);
+    // Write PPM header (emulator frames carry their ghost score as a comment)
+    fprintf(fp, "P6\n");
+    if (display->ghost) {
+        fprintf(fp, "# ghost_score %.4f\n", inky_emulator_ghost_score(display));
+    }
+    fprintf(fp, "%d %d\n255\n", display->width, display->height);
     
-    // Write pixel data
+    // Write pixel data one row at a time
+    uint8_t *row = malloc((size_t)display->width * 3);
+    if (!row) {
+        fclose(fp);
+        return -1;
+    }
     for (uint16_t y = 0; y < display->height; y++) {
-        for (uint16_t x = 0; x < display->width; x++) {
-            uint8_t color = inky_get_pixel(display, x, y);
-            if (color > 7) color = 7;  // Clamp to valid range
-            
-            // Write RGB values from palette
-            fwrite(color_palette[color], 1, 3, fp);
-        }
+        inky_render_rgb_row(display, y, row);
+        fwrite(row, 1, (size_t)display->width * 3, fp);
     }
+    free(row);
     
     fclose(fp);
     printf("Saved display image to %s\n", filename);
@@ -192,8 +498,8 @@ int inky_emulator_save_ppm(inky_t *display, const char *filename) {
 bool inky_should_full_refresh(inky_t *display) {
     if (!display) return false;
     
-    time_t current_time = time(NULL);
-    double seconds_since_refresh = difftime(current_time, display->last_full_refresh);
+    uint64_t now = inky_display_now_us(display);
+    double seconds_since_refresh = (now - display->last_full_refresh_us) / 1e6;
     
     // Recommend full refresh if:
     // 1. 5 or more partial updates have occurred, OR
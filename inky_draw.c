@@ -0,0 +1,438 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Deferred drawing
+//
+// Commands are recorded into a list and binned into screen tiles as they
+// arrive. A tile is DRAW_TILE_W pixels wide (an even number, so with an even
+// panel width every tile covers whole bytes of every row it touches) and
+// DRAW_TILE_H rows high, so no two tiles ever write the same byte of the
+// packed buffer and tiles can be rasterized concurrently without locks.
+// Each tile's bin lists command indices in recording order, which keeps the
+// painter's order within the tile.
+//
+// Tiles are handed out by a small work-stealing pool: every thread owns a
+// contiguous range of the non-empty tiles, takes work from the end of its
+// own range and, once that is empty, steals from the front of the others'.
+// Ranges are single 64-bit words updated with compare-and-swap, so owner and
+// thieves never block each other.
+
+#define DRAW_TILE_W      64
+#define DRAW_TILE_H      32
+#define DRAW_MAX_THREADS 16
+
+typedef enum {
+    DRAW_FILL_RECT,
+    DRAW_PIXEL,
+    DRAW_LINE,
+    DRAW_CALLBACK
+} draw_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t color;
+    int16_t x0, y0, x1, y1;  // Rect: inclusive corners, line: endpoints
+    inky_draw_callback_t callback;
+    void *user_data;
+} draw_cmd_t;
+
+typedef struct {
+    uint32_t *items;         // Command indices, ascending
+    uint32_t count;
+    uint32_t capacity;
+} draw_bin_t;
+
+typedef struct {
+    uint64_t range;          // head << 32 | tail into the tile order (atomic)
+    char pad[56];            // One cache line per queue
+} draw_queue_t;
+
+typedef struct {
+    inky_draw_list_t *list;
+    int index;
+} draw_worker_t;
+
+struct inky_draw_list {
+    inky_t *display;
+    
+    draw_cmd_t *cmds;
+    size_t count;
+    size_t capacity;
+    bool failed;             // A command was lost to an allocation failure
+    
+    draw_bin_t *bins;
+    uint32_t *order;         // Non-empty tiles of the current execute
+    int tiles_x, tiles_y;
+    int tile_w, tile_h;
+    
+    // Pool: threads - 1 workers plus the caller of inky_draw_list_execute()
+    int threads;
+    pthread_t workers[DRAW_MAX_THREADS];
+    draw_worker_t worker_args[DRAW_MAX_THREADS];
+    draw_queue_t queues[DRAW_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    int running;
+    bool stopping;
+};
+
+// Rasterizers: each command is drawn only where it meets the tile's clip,
+// through the same span and line code as the immediate primitives
+
+static void raster_rect(inky_t *display, const draw_cmd_t *cmd, const inky_clip_t *clip) {
+    int y0 = cmd->y0 > clip->y0 ? cmd->y0 : clip->y0;
+    int y1 = cmd->y1 + 1 < clip->y1 ? cmd->y1 + 1 : clip->y1;
+    for (int y = y0; y < y1; y++) {
+        inky_clip_span(display, clip, y, cmd->x0, cmd->x1 + 1, cmd->color);
+    }
+}
+
+static void raster_cmd(inky_t *display, const draw_cmd_t *cmd, const inky_clip_t *clip) {
+    switch (cmd->op) {
+    case DRAW_FILL_RECT:
+    case DRAW_PIXEL:
+        raster_rect(display, cmd, clip);
+        break;
+    case DRAW_LINE:
+        inky_raster_line(display, clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->color);
+        break;
+    case DRAW_CALLBACK: {
+        int x0 = cmd->x0 > clip->x0 ? cmd->x0 : clip->x0;
+        int x1 = cmd->x1 + 1 < clip->x1 ? cmd->x1 + 1 : clip->x1;
+        int y0 = cmd->y0 > clip->y0 ? cmd->y0 : clip->y0;
+        int y1 = cmd->y1 + 1 < clip->y1 ? cmd->y1 + 1 : clip->y1;
+        if (x0 < x1 && y0 < y1) {
+            inky_rect_t rect = {(uint16_t)x0, (uint16_t)y0, (uint16_t)(x1 - x0), (uint16_t)(y1 - y0)};
+            cmd->callback(display, &rect, cmd->user_data);
+        }
+        break;
+    }
+    }
+}
+
+static void raster_tile(inky_draw_list_t *list, uint32_t tile) {
+    int tx = (int)(tile % (uint32_t)list->tiles_x), ty = (int)(tile / (uint32_t)list->tiles_x);
+    inky_clip_t clip = {tx * list->tile_w, ty * list->tile_h,
+                        (tx + 1) * list->tile_w, (ty + 1) * list->tile_h};
+    if (clip.x1 > list->display->width) clip.x1 = list->display->width;
+    if (clip.y1 > list->display->height) clip.y1 = list->display->height;
+    
+    const draw_bin_t *bin = &list->bins[tile];
+    for (uint32_t i = 0; i < bin->count; i++) {
+        raster_cmd(list->display, &list->cmds[bin->items[i]], &clip);
+    }
+}
+
+// Work stealing
+
+// Owners take from the tail, thieves from the head; one CAS decides a race
+// for the last tile
+static bool queue_take(draw_queue_t *queue, bool steal, uint32_t *index) {
+    uint64_t range = __atomic_load_n(&queue->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t head = (uint32_t)(range >> 32), tail = (uint32_t)range;
+        if (head >= tail) return false;
+        
+        uint64_t next = steal ? ((uint64_t)(head + 1) << 32) | tail
+                              : ((uint64_t)head << 32) | (tail - 1);
+        if (__atomic_compare_exchange_n(&queue->range, &range, next, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *index = steal ? head : tail - 1;
+            return true;
+        }
+    }
+}
+
+static void run_tiles(inky_draw_list_t *list, int self) {
+    uint32_t index;
+    while (queue_take(&list->queues[self], false, &index)) {
+        raster_tile(list, list->order[index]);
+    }
+    
+    // Own range done: steal until every range is empty
+    for (int round = 1; round < list->threads; round++) {
+        draw_queue_t *victim = &list->queues[(self + round) % list->threads];
+        while (queue_take(victim, true, &index)) {
+            raster_tile(list, list->order[index]);
+        }
+    }
+}
+
+static void *worker_main(void *arg) {
+    draw_worker_t *worker = arg;
+    inky_draw_list_t *list = worker->list;
+    uint64_t seen = 0;
+    
+    pthread_mutex_lock(&list->lock);
+    for (;;) {
+        while (!list->stopping && list->generation == seen) {
+            pthread_cond_wait(&list->start, &list->lock);
+        }
+        if (list->stopping) break;
+        seen = list->generation;
+        pthread_mutex_unlock(&list->lock);
+        
+        run_tiles(list, worker->index);
+        
+        pthread_mutex_lock(&list->lock);
+        if (--list->running == 0) {
+            pthread_cond_signal(&list->done);
+        }
+    }
+    pthread_mutex_unlock(&list->lock);
+    return NULL;
+}
+
+// Recording
+
+static void bin_add(inky_draw_list_t *list, uint32_t tile, uint32_t cmd_index) {
+    draw_bin_t *bin = &list->bins[tile];
+    if (bin->count == bin->capacity) {
+        uint32_t capacity = bin->capacity ? bin->capacity * 2 : 16;
+        uint32_t *items = realloc(bin->items, capacity * sizeof(uint32_t));
+        if (!items) {
+            list->failed = true;
+            return;
+        }
+        bin->items = items;
+        bin->capacity = capacity;
+    }
+    bin->items[bin->count++] = cmd_index;
+}
+
+// Append a command covering [x0, x1] x [y0, y1] (already on screen) and
+// bin it into every tile it touches
+static void record(inky_draw_list_t *list, const draw_cmd_t *cmd, int x0, int y0, int x1, int y1) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        draw_cmd_t *cmds = realloc(list->cmds, capacity * sizeof(draw_cmd_t));
+        if (!cmds) {
+            list->failed = true;
+            return;
+        }
+        list->cmds = cmds;
+        list->capacity = capacity;
+    }
+    
+    uint32_t index = (uint32_t)list->count;
+    list->cmds[list->count++] = *cmd;
+    
+    for (int ty = y0 / list->tile_h; ty <= y1 / list->tile_h; ty++) {
+        for (int tx = x0 / list->tile_w; tx <= x1 / list->tile_w; tx++) {
+            uint32_t tile = (uint32_t)(ty * list->tiles_x + tx);
+            
+            // A rectangle hiding the whole tile makes what came before invisible
+            int right = (tx + 1) * list->tile_w, bottom = (ty + 1) * list->tile_h;
+            if (right > list->display->width) right = list->display->width;
+            if (bottom > list->display->height) bottom = list->display->height;
+            if (cmd->op == DRAW_FILL_RECT && cmd->x0 <= tx * list->tile_w && cmd->x1 >= right - 1 &&
+                cmd->y0 <= ty * list->tile_h && cmd->y1 >= bottom - 1) {
+                list->bins[tile].count = 0;
+            }
+            bin_add(list, tile, index);
+        }
+    }
+}
+
+inky_draw_list_t *inky_draw_list_create(inky_t *display, int threads) {
+    if (!display || !display->buffer) return NULL;
+    
+    if (threads <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+    if (threads > DRAW_MAX_THREADS) threads = DRAW_MAX_THREADS;
+    
+    inky_draw_list_t *list = calloc(1, sizeof(inky_draw_list_t));
+    if (!list) return NULL;
+    list->display = display;
+    
+    // Rows only start on a byte boundary when the width is even; otherwise
+    // the whole panel is one tile
+    if (display->width % 2 == 0) {
+        list->tile_w = DRAW_TILE_W;
+        list->tile_h = DRAW_TILE_H;
+    } else {
+        list->tile_w = display->width;
+        list->tile_h = display->height;
+    }
+    list->tiles_x = (display->width + list->tile_w - 1) / list->tile_w;
+    list->tiles_y = (display->height + list->tile_h - 1) / list->tile_h;
+    size_t tiles = (size_t)list->tiles_x * list->tiles_y;
+    list->bins = calloc(tiles, sizeof(draw_bin_t));
+    list->order = calloc(tiles, sizeof(uint32_t));
+    if (!list->bins || !list->order) {
+        free(list->bins);
+        free(list->order);
+        free(list);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&list->lock, NULL);
+    pthread_cond_init(&list->start, NULL);
+    pthread_cond_init(&list->done, NULL);
+    list->threads = 1;
+    for (int i = 1; i < threads; i++) {
+        list->worker_args[i].list = list;
+        list->worker_args[i].index = i;
+        if (pthread_create(&list->workers[i], NULL, worker_main, &list->worker_args[i]) != 0) {
+            fprintf(stderr, "Draw list: started %d of %d threads\n", i, threads);
+            break;
+        }
+        list->threads++;
+    }
+    
+    return list;
+}
+
+void inky_draw_list_destroy(inky_draw_list_t *list) {
+    if (!list) return;
+    
+    pthread_mutex_lock(&list->lock);
+    list->stopping = true;
+    pthread_cond_broadcast(&list->start);
+    pthread_mutex_unlock(&list->lock);
+    for (int i = 1; i < list->threads; i++) {
+        pthread_join(list->workers[i], NULL);
+    }
+    pthread_mutex_destroy(&list->lock);
+    pthread_cond_destroy(&list->start);
+    pthread_cond_destroy(&list->done);
+    
+    size_t tiles = (size_t)list->tiles_x * list->tiles_y;
+    for (size_t i = 0; i < tiles; i++) {
+        free(list->bins[i].items);
+    }
+    free(list->bins);
+    free(list->order);
+    free(list->cmds);
+    free(list);
+}
+
+void inky_draw_list_reset(inky_draw_list_t *list) {
+    if (!list) return;
+    
+    size_t tiles = (size_t)list->tiles_x * list->tiles_y;
+    for (size_t i = 0; i < tiles; i++) {
+        list->bins[i].count = 0;
+    }
+    list->count = 0;
+    list->failed = false;
+}
+
+size_t inky_draw_list_count(inky_draw_list_t *list) {
+    return list ? list->count : 0;
+}
+
+int inky_draw_list_threads(inky_draw_list_t *list) {
+    return list ? list->threads : 0;
+}
+
+// Clamp [a, b] (either order) to [0, limit), false when it misses entirely
+static bool clamp_range(int a, int b, int limit, int *lo, int *hi) {
+    *lo = a < b ? a : b;
+    *hi = a < b ? b : a;
+    if (*hi < 0 || *lo >= limit) return false;
+    if (*lo < 0) *lo = 0;
+    if (*hi >= limit) *hi = limit - 1;
+    return true;
+}
+
+static void record_box(inky_draw_list_t *list, draw_cmd_t *cmd, int x0, int y0, int x1, int y1) {
+    int bx0, bx1, by0, by1;
+    if (!clamp_range(x0, x1, list->display->width, &bx0, &bx1) ||
+        !clamp_range(y0, y1, list->display->height, &by0, &by1)) {
+        return;  // Off screen
+    }
+    if (cmd->op != DRAW_LINE) {
+        cmd->x0 = (int16_t)bx0; cmd->x1 = (int16_t)bx1;
+        cmd->y0 = (int16_t)by0; cmd->y1 = (int16_t)by1;
+    }
+    record(list, cmd, bx0, by0, bx1, by1);
+}
+
+void inky_draw_list_clear(inky_draw_list_t *list, uint8_t color) {
+    if (!list) return;
+    inky_draw_list_fill_rect(list, 0, 0, list->display->width, list->display->height, color);
+}
+
+void inky_draw_list_pixel(inky_draw_list_t *list, int x, int y, uint8_t color) {
+    if (!list) return;
+    draw_cmd_t cmd = {.op = DRAW_PIXEL, .color = color};
+    record_box(list, &cmd, x, y, x, y);
+}
+
+void inky_draw_list_fill_rect(inky_draw_list_t *list, int x, int y, int width, int height, uint8_t color) {
+    if (!list || width <= 0 || height <= 0) return;
+    draw_cmd_t cmd = {.op = DRAW_FILL_RECT, .color = color};
+    record_box(list, &cmd, x, y, x + width - 1, y + height - 1);
+}
+
+void inky_draw_list_line(inky_draw_list_t *list, int x0, int y0, int x1, int y1, uint8_t color) {
+    if (!list) return;
+    if (x0 < INT16_MIN || x0 > INT16_MAX || y0 < INT16_MIN || y0 > INT16_MAX ||
+        x1 < INT16_MIN || x1 > INT16_MAX || y1 < INT16_MIN || y1 > INT16_MAX) {
+        return;
+    }
+    draw_cmd_t cmd = {.op = DRAW_LINE, .color = color,
+                      .x0 = (int16_t)x0, .y0 = (int16_t)y0, .x1 = (int16_t)x1, .y1 = (int16_t)y1};
+    record_box(list, &cmd, x0, y0, x1, y1);
+}
+
+void inky_draw_list_callback(inky_draw_list_t *list, int x, int y, int width, int height,
+                             inky_draw_callback_t callback, void *user_data) {
+    if (!list || !callback || width <= 0 || height <= 0) return;
+    draw_cmd_t cmd = {.op = DRAW_CALLBACK, .callback = callback, .user_data = user_data};
+    record_box(list, &cmd, x, y, x + width - 1, y + height - 1);
+}
+
+int inky_draw_list_execute(inky_draw_list_t *list) {
+    if (!list) return -1;
+    
+    INKY_TRACE_BEGIN_ARG("draw_list_execute", (int64_t)list->count);
+    uint32_t tiles = 0;
+    uint32_t total = (uint32_t)(list->tiles_x * list->tiles_y);
+    for (uint32_t i = 0; i < total; i++) {
+        if (list->bins[i].count > 0) {
+            list->order[tiles++] = i;
+        }
+    }
+    
+    // Contiguous ranges keep neighbouring tiles (and their commands) together
+    for (int i = 0; i < list->threads; i++) {
+        uint64_t head = (uint64_t)tiles * i / list->threads;
+        uint64_t tail = (uint64_t)tiles * (i + 1) / list->threads;
+        __atomic_store_n(&list->queues[i].range, (head << 32) | tail, __ATOMIC_RELAXED);
+    }
+    
+    if (list->threads == 1 || tiles < 2) {
+        run_tiles(list, 0);
+    } else {
+        pthread_mutex_lock(&list->lock);
+        list->generation++;
+        list->running = list->threads - 1;
+        pthread_cond_broadcast(&list->start);
+        pthread_mutex_unlock(&list->lock);
+        
+        run_tiles(list, 0);
+        
+        pthread_mutex_lock(&list->lock);
+        while (list->running > 0) {
+            pthread_cond_wait(&list->done, &list->lock);
+        }
+        pthread_mutex_unlock(&list->lock);
+    }
+    INKY_TRACE_END("draw_list_execute");
+    
+    if (list->failed) {
+        fprintf(stderr, "Draw list: commands were dropped (out of memory)\n");
+        return -1;
+    }
+    return 0;
+}
@@ -3,23 +3,287 @@
 #include <stdlib.h>
 #include <string.h>
 
-inky_t* inky_init(bool emulator) {
-    if (!emulator) {
+inky_t* inky_init_ex(const inky_config_t *config) {
+    if (!config || !config->emulator) {
         // Hardware initialization is in inky_hardware.c
         return NULL;
     }
     
     // Use common initialization
-    return inky_init_common(true);
+    inky_t *display = inky_init_common(config);
+    if (!display) return NULL;
+    
+    display->temperature = INKY_EMU_DEFAULT_TEMP;
+    display->shm_fd = -1;
+    display->ghost = calloc((size_t)display->width * display->height, sizeof(inky_ghost_t));
+    if (!display->ghost) {
+        inky_destroy_common(display);
+        return NULL;
+    }
+    
+    return display;
 }
 
 void inky_destroy(inky_t *display) {
     if (!display) return;
     
-    // Use common cleanup (no hardware-specific cleanup needed for emulator)
+    inky_emulator_unshare(display);
+    free(display->ghost);
     inky_destroy_common(display);
 }
 
+// Emulated ghosting
+//
+// A partial refresh only nudges particles toward the new color, so every
+// pixel it changes keeps some of the color it had before. The residue builds
+// up over repeated partial refreshes, fades a little each time a partial
+// refresh drives the pixel without changing it, and a full refresh clears it.
+
+static void ghost_full_refresh(inky_t *display) {
+    inky_ghost_t *g = display->ghost;
+    for (uint16_t y = 0; y < display->height; y++) {
+        for (uint16_t x = 0; x < display->width; x++, g++) {
+            g->shown = inky_get_pixel(display, x, y);
+            g->level = 0;
+        }
+    }
+}
+
+static void ghost_partial_refresh(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    for (uint16_t row = y; row < y + height; row++) {
+        inky_ghost_t *g = &display->ghost[(size_t)row * display->width + x];
+        for (uint16_t col = x; col < x + width; col++, g++) {
+            uint8_t color = inky_get_pixel(display, col, row);
+            if (color != g->shown) {
+                g->residue = g->shown;
+                g->level = g->level > INKY_GHOST_MAX - INKY_GHOST_STEP ? INKY_GHOST_MAX : g->level + INKY_GHOST_STEP;
+                g->shown = color;
+            } else {
+                g->level -= g->level / 4;
+            }
+        }
+    }
+}
+
+// Emulated refresh timing
+//
+// Approximates how long a UC8159 panel takes so code written against the
+// emulator sees realistic latency. Refreshes slow down sharply in the cold
+// (waveforms get longer) and a little less sharply in the heat.
+
+static uint32_t emu_refresh_ms(inky_t *display, inky_update_type_t type, uint32_t area) {
+    double factor = 1.0;
+    if (display->temperature < 20) {
+        factor = 1.0 + 0.04 * (20 - display->temperature);
+    } else if (display->temperature > 20) {
+        factor = 1.0 - 0.01 * (display->temperature - 20);
+        if (factor < 0.85) factor = 0.85;
+    }
+    
+    double ms;
+    if (type == INKY_UPDATE_FULL) {
+        ms = INKY_EMU_FULL_REFRESH_MS;
+    } else {
+        uint32_t total = (uint32_t)display->width * display->height;
+        ms = INKY_EMU_PARTIAL_BASE_MS + (double)INKY_EMU_PARTIAL_AREA_MS * area / total;
+    }
+    return (uint32_t)(ms * factor);
+}
+
+static uint64_t emu_transfer_us(inky_t *display, size_t bytes) {
+    return (uint64_t)bytes * 8 * 1000000 / display->spi_speed_hz;
+}
+
+// Sleep on the display clock and charge the time to a phase
+static void emu_phase(inky_t *display, inky_update_type_t type, inky_phase_t phase, uint64_t us) {
+    inky_clock_sleep_us(display->clock, us);
+    inky_stats_record(display, type, phase, us);
+}
+
+static void emu_start_refresh(inky_t *display, inky_update_type_t type) {
+    uint64_t start = inky_display_now_us(display);
+    uint32_t predicted_ms = inky_refresh_predict_ms(&display->refresh_model, type, display->temperature);
+    display->refresh_start_us = start;
+    __atomic_store_n(&display->refresh_deadline_us, start + (uint64_t)predicted_ms * 1000,
+                     __ATOMIC_RELEASE);
+}
+
+static void emu_finish_refresh(inky_t *display, inky_update_type_t type, uint32_t actual_ms) {
+    inky_refresh_record(&display->refresh_model, type, display->temperature, actual_ms);
+    inky_stats_record(display, type, INKY_PHASE_REFRESH, (uint64_t)actual_ms * 1000);
+    display->stats.last_update.busy_us = inky_display_now_us(display);
+    __atomic_store_n(&display->refresh_deadline_us, 0, __ATOMIC_RELEASE);
+}
+
+// Without a clock an update takes no time: every milestone is reached at once
+static void emu_untimed(inky_t *display) {
+    inky_update_timeline_t *timeline = &display->stats.last_update;
+    timeline->transfer_us = timeline->busy_us = timeline->complete_us = timeline->submit_us;
+}
+
+// Mirrors inky_hw_update_many() for the panels of a batch that run on
+// `clock`: transfers in turn, shared settle delays, overlapping refreshes.
+// Every sleep and timestamp counts on that clock, which is each panel's own,
+// so start, busy and ETA times never mix time bases.
+static void emu_time_full(inky_t **displays, size_t count, inky_clock_t *clock) {
+    const inky_update_type_t type = INKY_UPDATE_FULL;
+    
+    INKY_TRACE_BEGIN("emu_refresh");
+    uint32_t longest_ms = 0;
+    for (size_t i = 0; i < count; i++) {
+        inky_t *display = displays[i];
+        if (display->clock != clock) continue;
+        uint64_t transfer_us = emu_transfer_us(display, display->buffer_size);
+        display->stats.bytes_sent += display->buffer_size;
+        inky_clock_sleep_us(clock, transfer_us);
+        inky_stats_record(display, type, INKY_PHASE_TRANSFER, transfer_us);
+        display->stats.last_update.transfer_us = inky_clock_now_us(clock);
+        
+        uint32_t ms = emu_refresh_ms(display, type, 0);
+        if (ms > longest_ms) longest_ms = ms;
+    }
+    
+    inky_clock_sleep_us(clock, INKY_SETTLE_US);
+    for (size_t i = 0; i < count; i++) {
+        if (displays[i]->clock != clock) continue;
+        inky_stats_record(displays[i], type, INKY_PHASE_PON, INKY_SETTLE_US);
+        emu_start_refresh(displays[i], type);
+    }
+    
+    inky_clock_sleep_us(clock, (uint64_t)longest_ms * 1000);
+    for (size_t i = 0; i < count; i++) {
+        if (displays[i]->clock != clock) continue;
+        emu_finish_refresh(displays[i], type, emu_refresh_ms(displays[i], type, 0));
+    }
+    
+    inky_clock_sleep_us(clock, INKY_SETTLE_US);
+    for (size_t i = 0; i < count; i++) {
+        if (displays[i]->clock != clock) continue;
+        inky_stats_record(displays[i], type, INKY_PHASE_POF, INKY_SETTLE_US);
+        displays[i]->stats.last_update.complete_us = inky_clock_now_us(clock);
+        inky_shm_publish(displays[i], 0, displays[i]->height);
+    }
+    INKY_TRACE_END("emu_refresh");
+}
+
+static void emu_time_partial(inky_t *display, uint16_t width, uint16_t height) {
+    const inky_update_type_t type = INKY_UPDATE_PARTIAL;
+    
+    INKY_TRACE_BEGIN("emu_refresh");
+    size_t bytes = (size_t)((width + 1) / 2) * height;
+    display->stats.bytes_sent += bytes;
+    emu_phase(display, type, INKY_PHASE_TRANSFER, emu_transfer_us(display, bytes));
+    display->stats.last_update.transfer_us = inky_display_now_us(display);
+    emu_phase(display, type, INKY_PHASE_PON, INKY_SETTLE_US);
+    
+    uint32_t ms = emu_refresh_ms(display, type, (uint32_t)width * height);
+    emu_start_refresh(display, type);
+    inky_clock_sleep_us(display->clock, (uint64_t)ms * 1000);
+    emu_finish_refresh(display, type, ms);
+    
+    emu_phase(display, type, INKY_PHASE_POF, INKY_SETTLE_US);
+    display->stats.last_update.complete_us = inky_display_now_us(display);
+    INKY_TRACE_END("emu_refresh");
+}
+
+// Emulated full refresh: ghosting, timing (with a clock), then the new frame
+// goes out to the shared framebuffer once the refresh would be visible.
+// Panels sharing a clock refresh together on it; panels on different clocks
+// are timed one clock after another, and panels without one at once.
+void inky_emu_update_many(inky_t **displays, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        ghost_full_refresh(displays[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        inky_clock_t *clock = displays[i]->clock;
+        bool timed = false;  // Clock already handled with an earlier panel
+        for (size_t j = 0; j < i && !timed; j++) {
+            timed = displays[j]->clock == clock;
+        }
+        if (clock && !timed) {
+            emu_time_full(displays, count, clock);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!displays[i]->clock) {
+            inky_shm_publish(displays[i], 0, displays[i]->height);
+            emu_untimed(displays[i]);
+        }
+    }
+}
+
+void inky_emu_partial_update(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    ghost_partial_refresh(display, x, y, width, height);
+    if (display->clock) {
+        emu_time_partial(display, width, height);
+    }
+    inky_shm_publish(display, y, height);
+    if (!display->clock) emu_untimed(display);
+}
+
+// Non-blocking emulated update for inky_loop: the phases of
+// emu_time_full()/emu_time_partial() as deadlines on the display clock.
+// Without a clock the update completes in begin, as it does when blocking.
+uint64_t inky_emu_update_begin(inky_t *display, inky_update_type_t type,
+                               uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    display->async_type = type;
+    display->async_x = x;
+    display->async_y = y;
+    display->async_width = width;
+    display->async_height = height;
+    
+    size_t bytes;
+    if (type == INKY_UPDATE_FULL) {
+        ghost_full_refresh(display);
+        bytes = display->buffer_size;
+    } else {
+        ghost_partial_refresh(display, x, y, width, height);
+        bytes = (size_t)((width + 1) / 2) * height;
+    }
+    
+    if (!display->clock) {
+        inky_shm_publish(display, y, height);
+        emu_untimed(display);
+        display->async_phase = INKY_ASYNC_IDLE;
+        return 0;
+    }
+    
+    uint64_t transfer_us = emu_transfer_us(display, bytes);
+    display->stats.bytes_sent += bytes;
+    inky_stats_record(display, type, INKY_PHASE_TRANSFER, transfer_us);
+    display->async_phase = INKY_ASYNC_PON;
+    display->async_phase_start_us = inky_display_now_us(display) + transfer_us;
+    display->stats.last_update.transfer_us = display->async_phase_start_us;
+    return display->async_phase_start_us + INKY_SETTLE_US;
+}
+
+uint64_t inky_emu_update_step(inky_t *display) {
+    inky_update_type_t type = display->async_type;
+    uint32_t area = type == INKY_UPDATE_FULL ? 0 : (uint32_t)display->async_width * display->async_height;
+    
+    switch (display->async_phase) {
+    case INKY_ASYNC_PON:
+        inky_stats_record(display, type, INKY_PHASE_PON, INKY_SETTLE_US);
+        emu_start_refresh(display, type);
+        display->async_phase = INKY_ASYNC_REFRESH;
+        return display->refresh_start_us + (uint64_t)emu_refresh_ms(display, type, area) * 1000;
+    case INKY_ASYNC_REFRESH:
+        emu_finish_refresh(display, type, emu_refresh_ms(display, type, area));
+        display->async_phase = INKY_ASYNC_POF;
+        display->async_phase_start_us = inky_display_now_us(display);
+        return display->async_phase_start_us + INKY_SETTLE_US;
+    case INKY_ASYNC_POF:
+        inky_stats_record(display, type, INKY_PHASE_POF, INKY_SETTLE_US);
+        display->stats.last_update.complete_us = inky_display_now_us(display);
+        inky_shm_publish(display, display->async_y, display->async_height);
+        display->async_phase = INKY_ASYNC_IDLE;
+        return 0;
+    case INKY_ASYNC_IDLE:
+    default:
+        return 0;
+    }
+}
+
 // Stub functions for hardware operations (not used in emulator)
 bool inky_hw_init_gpio(inky_t *display) { (void)display; return true; }
 void inky_hw_setup(inky_t *display) { (void)display; }
@@ -27,10 +291,23 @@ void inky_hw_reset(inky_t *display) { (void)display; }
 void inky_hw_send_command(inky_t *display, uint8_t command) { (void)display; (void)command; }
 void inky_hw_send_data(inky_t *display, const uint8_t *data, size_t len) { (void)display; (void)data; (void)len; }
 void inky_hw_busy_wait(inky_t *display) { (void)display; }
+void inky_hw_refresh_wait(inky_t *display, inky_update_type_t type) { (void)display; (void)type; }
+int inky_hw_read_temperature(inky_t *display) { (void)display; return INKY_TEMP_UNKNOWN; }
 void inky_hw_update(inky_t *display) { (void)display; }
+void inky_hw_update_many(inky_t **displays, size_t count) { (void)displays; (void)count; }
+void inky_hw_sleep(inky_t *display) { (void)display; }
+void inky_hw_wake(inky_t *display) { (void)display; }
 void inky_hw_set_partial_window(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) { 
     (void)display; (void)x; (void)y; (void)width; (void)height; 
 }
 void inky_hw_partial_update(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) { 
     (void)display; (void)x; (void)y; (void)width; (void)height; 
-}
\ No newline at end of file
+}
+uint64_t inky_hw_update_begin(inky_t *display, inky_update_type_t type,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    (void)display; (void)type; (void)x; (void)y; (void)width; (void)height;
+    return 0;
+}
+uint64_t inky_hw_update_step(inky_t *display) { (void)display; return 0; }
+int inky_hw_busy_fd(inky_t *display) { (void)display; return -1; }
+void inky_hw_busy_drain(inky_t *display) { (void)display; }
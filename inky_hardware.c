@@ -27,6 +27,7 @@
 #define SPI_IOC_WR_BITS_PER_WORD 0
 #define SPI_IOC_WR_MAX_SPEED_HZ 0
 #define SPI_NO_CS 0
+#define SPI_IOC_MESSAGE(n) 0
 
 struct gpiohandle_request {
     uint32_t lineoffsets[64];
@@ -40,28 +41,33 @@ struct gpiohandle_request {
 struct gpiohandle_data {
     uint8_t values[64];
 };
+
+struct spi_ioc_transfer {
+    uint64_t tx_buf;
+    uint64_t rx_buf;
+    uint32_t len;
+};
 #endif
 
-#define SPI_DEVICE "/dev/spidev0.0"
-#define GPIO_DEVICE "/dev/gpiochip0"
-#define SPI_SPEED_HZ 3000000
 #define SPI_MODE 0
 #define SPI_BITS_PER_WORD 8
 
-inky_t* inky_init(bool emulator) {
-    if (emulator) {
+inky_t* inky_init_ex(const inky_config_t *config) {
+    if (!config) return NULL;
+    
+    if (config->emulator) {
         fprintf(stderr, "Error: This is the hardware build. Use the emulator build for emulation.\n");
         return NULL;
     }
     
     // Use common initialization
-    inky_t *display = inky_init_common(false);
+    inky_t *display = inky_init_common(config);
     if (!display) {
         return NULL;
     }
     
     // Initialize SPI
-    display->spi_fd = open(SPI_DEVICE, O_RDWR);
+    display->spi_fd = open(display->spi_device, O_RDWR);
     if (display->spi_fd < 0) {
         perror("Failed to open SPI device");
         inky_destroy_common(display);
@@ -71,7 +77,7 @@ inky_t* inky_init(bool emulator) {
     // Configure SPI
     uint8_t mode = SPI_MODE | SPI_NO_CS;  // Disable hardware CS, we'll control it via GPIO
     uint8_t bits = SPI_BITS_PER_WORD;
-    uint32_t speed = SPI_SPEED_HZ;
+    uint32_t speed = display->spi_speed_hz;
     
     if (ioctl(display->spi_fd, SPI_IOC_WR_MODE, &mode) < 0 ||
         ioctl(display->spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
@@ -111,7 +117,7 @@ void inky_destroy(inky_t *display) {
 }
 
 bool inky_hw_init_gpio(inky_t *display) {
-    display->gpio_chip_fd = open(GPIO_DEVICE, O_RDONLY);
+    display->gpio_chip_fd = open(display->gpio_device, O_RDONLY);
     if (display->gpio_chip_fd < 0) {
         perror("Failed to open GPIO chip");
         return false;
@@ -119,7 +125,7 @@ bool inky_hw_init_gpio(inky_t *display) {
     
     // Request RESET GPIO line
     struct gpiohandle_request reset_req;
-    reset_req.lineoffsets[0] = INKY_RESET_PIN;
+    reset_req.lineoffsets[0] = display->reset_pin;
     reset_req.lines = 1;
     reset_req.flags = GPIOHANDLE_REQUEST_OUTPUT;
     reset_req.default_values[0] = 1;  // Reset high
@@ -133,7 +139,7 @@ bool inky_hw_init_gpio(inky_t *display) {
     
     // Request DC GPIO line
     struct gpiohandle_request dc_req;
-    dc_req.lineoffsets[0] = INKY_DC_PIN;
+    dc_req.lineoffsets[0] = display->dc_pin;
     dc_req.lines = 1;
     dc_req.flags = GPIOHANDLE_REQUEST_OUTPUT;
     dc_req.default_values[0] = 0;  // DC low
@@ -148,7 +154,7 @@ bool inky_hw_init_gpio(inky_t *display) {
     
     // Request CS GPIO line
     struct gpiohandle_request cs_req;
-    cs_req.lineoffsets[0] = INKY_CS_PIN;
+    cs_req.lineoffsets[0] = display->cs_pin;
     cs_req.lines = 1;
     cs_req.flags = GPIOHANDLE_REQUEST_OUTPUT;
     cs_req.default_values[0] = 1;  // CS high (inactive)
@@ -161,10 +167,29 @@ bool inky_hw_init_gpio(inky_t *display) {
         return false;
     }
     display->cs_line = cs_req.fd;
+
+#ifdef __linux__
+    // Request BUSY with rising-edge events where the chip supports them, so an
+    // event loop can sleep until a refresh finishes; values can still be read
+    // from the event fd for the polled waits
+    struct gpioevent_request busy_ev;
+    memset(&busy_ev, 0, sizeof(busy_ev));
+    busy_ev.lineoffset = display->busy_pin;
+    busy_ev.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    busy_ev.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+    strcpy(busy_ev.consumer_label, "inky_busy");
+    
+    if (ioctl(display->gpio_chip_fd, GPIO_GET_LINEEVENT_IOCTL, &busy_ev) == 0) {
+        fcntl(busy_ev.fd, F_SETFL, O_NONBLOCK);
+        display->busy_line = busy_ev.fd;
+        display->busy_events = true;
+        return true;
+    }
+#endif
     
     // Request BUSY pin as input
     struct gpiohandle_request busy_req;
-    busy_req.lineoffsets[0] = INKY_BUSY_PIN;
+    busy_req.lineoffsets[0] = display->busy_pin;
     busy_req.lines = 1;
     busy_req.flags = GPIOHANDLE_REQUEST_INPUT;
     strcpy(busy_req.consumer_label, "inky_busy");
@@ -196,6 +221,11 @@ static int gpio_get_value(int fd) {
 void inky_hw_send_command(inky_t *display, uint8_t command) {
     if (!display || display->is_emulator) return;
     
+    INKY_TRACE_BEGIN_ARG("send_command", command);
+    display->stats.commands_sent++;
+    display->stats.bytes_sent++;
+    display->stats.syscalls += 4;  // DC, CS low, write, CS high
+    
     // Set DC low for command
     gpio_set_value(display->dc_line, 0);
     
@@ -207,6 +237,7 @@ void inky_hw_send_command(inky_t *display, uint8_t command) {
     
     // Set CS high (inactive)
     gpio_set_value(display->cs_line, 1);
+    INKY_TRACE_END("send_command");
 }
 
 void inky_hw_send_data(inky_t *display, const uint8_t *data, size_t len) {
@@ -225,47 +256,273 @@ void inky_hw_send_data(inky_t *display, const uint8_t *data, size_t len) {
         size_t to_send = (len - offset) > chunk_size ? chunk_size : (len - offset);
         write(display->spi_fd, data + offset, to_send);
         offset += to_send;
+        display->stats.syscalls++;
     }
+    display->stats.bytes_sent += len;
+    display->stats.syscalls += 3;  // DC, CS low, CS high
     
     // Set CS high (inactive)
     gpio_set_value(display->cs_line, 1);
 }
 
-void inky_hw_busy_wait(inky_t *display) {
-    if (!display || display->is_emulator) return;
-    
-    // Wait for busy pin to go high
+// Poll BUSY until the controller reports ready or the timeout expires
+static bool hw_wait_ready(inky_t *display, double timeout_s, useconds_t poll_us) {
     struct timespec start, now;
     clock_gettime(CLOCK_MONOTONIC, &start);
+    bool ready = false;
     
+    INKY_TRACE_BEGIN("busy_wait");
     while (1) {
+        display->stats.syscalls++;
         if (gpio_get_value(display->busy_line) == 1) {
-            break;  // Display is ready
+            ready = true;  // Display is ready
+            break;
         }
         
         clock_gettime(CLOCK_MONOTONIC, &now);
         double elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
-        if (elapsed > 40.0) {
-            fprintf(stderr, "Warning: Busy wait timeout after 40 seconds\n");
+        if (elapsed > timeout_s) {
             break;
         }
         
-        usleep(10000);  // Sleep for 10ms
+        usleep(poll_us);
     }
+    INKY_TRACE_END("busy_wait");
+    
+    return ready;
 }
 
-void inky_hw_reset(inky_t *display) {
+// After a reset the controller pulls BUSY low while it boots. BUSY may still
+// read high (ready) from before the pulse for a moment, so wait for it to
+// drop first; if it is never seen low, the bound doubles as the post-reset
+// delay. Returns false if BUSY stayed high
+static bool hw_wait_busy_low(inky_t *display, uint32_t timeout_us) {
+    uint64_t deadline = inky_time_us() + timeout_us;
+    for (;;) {
+        display->stats.syscalls++;
+        if (gpio_get_value(display->busy_line) == 0) return true;
+        if (inky_time_us() >= deadline) return false;
+        usleep(100);
+    }
+}
+
+void inky_hw_busy_wait(inky_t *display) {
     if (!display || display->is_emulator) return;
     
-    // Reset sequence
+    if (!hw_wait_ready(display, INKY_BUSY_TIMEOUT_MS / 1000.0, 10000)) {  // Poll every 10ms
+        fprintf(stderr, "Warning: Busy wait timeout after 40 seconds\n");
+    }
+}
+
+// Send DRF and note when the refresh started so the wait can be deferred
+// (several panels can be refreshing at once)
+static void hw_start_refresh(inky_t *display, inky_update_type_t type) {
+    inky_hw_send_command(display, UC8159_DRF);
+    
+    uint64_t start = inky_time_us();
+    uint32_t predicted_ms = inky_refresh_predict_ms(&display->refresh_model, type, display->temperature);
+    display->refresh_start_us = start;
+    __atomic_store_n(&display->refresh_deadline_us, start + (uint64_t)predicted_ms * 1000,
+                     __ATOMIC_RELEASE);
+}
+
+// Learn from a finished (or timed-out) refresh and clear the ETA
+static void hw_finish_refresh(inky_t *display, inky_update_type_t type, bool ready, uint32_t predicted_ms) {
+    uint64_t start = display->refresh_start_us;
+    uint32_t elapsed_ms = (uint32_t)((inky_time_us() - start) / 1000);
+    
+    if (!ready) {
+        fprintf(stderr, "Warning: Refresh not finished after %u ms (predicted %u ms)\n",
+                elapsed_ms, predicted_ms);
+    }
+    
+    // A timed-out sample still pushes the prediction up for next time
+    inky_refresh_record(&display->refresh_model, type, display->temperature, elapsed_ms);
+    inky_stats_phase_end(display, type, INKY_PHASE_REFRESH, start);
+    display->stats.last_update.busy_us = inky_display_now_us(display);
+    __atomic_store_n(&display->refresh_deadline_us, 0, __ATOMIC_RELEASE);
+}
+
+// Wait for refreshes started together with hw_start_refresh(), using the
+// learned duration for each panel's type and temperature: sleep through most
+// of it, then poll every BUSY line that is due every 10ms. Each panel is
+// finished (and its duration recorded) as soon as its own BUSY releases, so
+// waiting on one panel never counts toward another's refresh time. A
+// refresh is pending while its ETA is set.
+static void hw_refresh_wait_many(inky_t **displays, size_t count, inky_update_type_t type) {
+    INKY_TRACE_BEGIN("busy_wait");
+    for (;;) {
+        uint64_t now = inky_time_us();
+        uint64_t next = 0;
+        for (size_t i = 0; i < count; i++) {
+            inky_t *display = displays[i];
+            if (__atomic_load_n(&display->refresh_deadline_us, __ATOMIC_ACQUIRE) == 0) continue;
+            
+            inky_refresh_plan_t plan;
+            inky_refresh_plan(&display->refresh_model, type, display->temperature, &plan);
+            uint64_t presleep_end = display->refresh_start_us + (uint64_t)plan.presleep_ms * 1000;
+            uint64_t timeout_end = display->refresh_start_us + (uint64_t)plan.timeout_ms * 1000;
+            uint64_t check = now + 10000;  // Poll every 10ms
+            if (now < presleep_end) {
+                check = presleep_end;
+            } else {
+                display->stats.syscalls++;
+                bool ready = gpio_get_value(display->busy_line) == 1;
+                if (ready || now >= timeout_end) {
+                    hw_finish_refresh(display, type, ready, plan.predicted_ms);
+                    continue;
+                }
+            }
+            if (check > timeout_end) check = timeout_end;
+            if (next == 0 || check < next) next = check;
+        }
+        if (next == 0) break;
+        
+        now = inky_time_us();
+        if (next > now) {
+            usleep(next - now);
+        }
+    }
+    INKY_TRACE_END("busy_wait");
+}
+
+void inky_hw_refresh_wait(inky_t *display, inky_update_type_t type) {
+    if (!display || display->is_emulator) return;
+    
+    hw_refresh_wait_many(&display, 1, type);
+}
+
+// Read the controller's internal temperature sensor
+// Returns INKY_TEMP_UNKNOWN when nothing plausible comes back (e.g. MISO not wired)
+int inky_hw_read_temperature(inky_t *display) {
+    if (!display || display->is_emulator) return INKY_TEMP_UNKNOWN;
+    
+    inky_hw_send_command(display, UC8159_TSR);
+    
+    uint8_t rx[2] = {0, 0};
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.rx_buf = (uintptr_t)rx;
+    xfer.len = sizeof(rx);
+    
+    gpio_set_value(display->dc_line, 1);
+    gpio_set_value(display->cs_line, 0);
+    int ret = ioctl(display->spi_fd, SPI_IOC_MESSAGE(1), &xfer);
+    gpio_set_value(display->cs_line, 1);
+    display->stats.syscalls += 4;
+    
+    if (ret < 0) {
+        return INKY_TEMP_UNKNOWN;
+    }
+    
+    // Floating or grounded data line reads back as all ones or all zeros
+    if ((rx[0] == 0xFF && rx[1] == 0xFF) || (rx[0] == 0x00 && rx[1] == 0x00)) {
+        return INKY_TEMP_UNKNOWN;
+    }
+    
+    // Integer degrees in two's complement, LSB half-degree bit in rx[1]
+    int temperature = (int8_t)rx[0];
+    if (temperature < -20 || temperature > 70) {
+        return INKY_TEMP_UNKNOWN;
+    }
+    
+    return temperature;
+}
+
+static void hw_reset_pulse(inky_t *display, useconds_t low_us, useconds_t high_us) {
     gpio_set_value(display->reset_line, 0);  // Reset low
-    usleep(100000);  // 100ms
+    usleep(low_us);
     gpio_set_value(display->reset_line, 1);  // Reset high
-    usleep(100000);  // 100ms
+    usleep(high_us);
+}
+
+void inky_hw_reset(inky_t *display) {
+    if (!display || display->is_emulator) return;
+    
+    // Cold reset sequence
+    hw_reset_pulse(display, INKY_RESET_COLD_LOW_US, INKY_RESET_COLD_HIGH_US);
     
     inky_hw_busy_wait(display);
 }
 
+// Fill the register shadow with the power-on configuration
+static void hw_init_shadow(inky_t *display) {
+    inky_reg_shadow_t *regs = &display->regs;
+    
+    // Resolution Setting (600x448)
+    regs->tres[0] = (display->width >> 8) & 0xFF;
+    regs->tres[1] = display->width & 0xFF;
+    regs->tres[2] = (display->height >> 8) & 0xFF;
+    regs->tres[3] = display->height & 0xFF;
+    
+    // Panel Setting
+    // 0b11 = 600x448 resolution
+    regs->psr[0] = (0x03 << 6) | 0x2F;  // Resolution 600x448, other settings
+    regs->psr[1] = 0x08;                // 7-color mode
+    
+    // Power Settings
+    regs->pwr[0] = 0x07;
+    regs->pwr[1] = 0x00;
+    regs->pwr[2] = 0x23;
+    regs->pwr[3] = 0x23;
+    
+    regs->pll = 0x3C;   // PLL Control
+    regs->tse = 0x00;   // TSE
+    regs->tcon = 0x22;  // TCON
+    regs->dam = 0x00;   // DAM - Disable external flash
+    regs->pws = 0xAA;   // PWS
+    regs->pfs = 0x00;   // Power off sequence
+    
+    display->init_seq_valid = false;
+}
+
+static size_t hw_append_register(uint8_t *seq, size_t pos, uint8_t command, const uint8_t *data, uint8_t len) {
+    seq[pos++] = command;
+    seq[pos++] = len;
+    memcpy(seq + pos, data, len);
+    return pos + len;
+}
+
+// Encode the register shadow as a (command, length, data...) byte stream
+static void hw_build_init_sequence(inky_t *display) {
+    inky_reg_shadow_t *regs = &display->regs;
+    uint8_t *seq = display->init_seq;
+    size_t pos = 0;
+    
+    // VCOM and Data Interval carries the border color
+    regs->cdi = (display->border_color << 5) | 0x17;
+    
+    pos = hw_append_register(seq, pos, UC8159_TRES, regs->tres, sizeof(regs->tres));
+    pos = hw_append_register(seq, pos, UC8159_PSR, regs->psr, sizeof(regs->psr));
+    pos = hw_append_register(seq, pos, UC8159_PWR, regs->pwr, sizeof(regs->pwr));
+    pos = hw_append_register(seq, pos, UC8159_PLL, &regs->pll, 1);
+    pos = hw_append_register(seq, pos, UC8159_TSE, &regs->tse, 1);
+    pos = hw_append_register(seq, pos, UC8159_CDI, &regs->cdi, 1);
+    pos = hw_append_register(seq, pos, UC8159_TCON, &regs->tcon, 1);
+    pos = hw_append_register(seq, pos, UC8159_DAM, &regs->dam, 1);
+    pos = hw_append_register(seq, pos, UC8159_PWS, &regs->pws, 1);
+    pos = hw_append_register(seq, pos, UC8159_PFS, &regs->pfs, 1);
+    
+    display->init_seq_len = pos;
+    display->init_seq_valid = true;
+}
+
+// Replay the cached init stream, rebuilding it first if the shadow changed
+static void hw_replay_init(inky_t *display) {
+    if (!display->init_seq_valid) {
+        hw_build_init_sequence(display);
+    }
+    
+    size_t pos = 0;
+    while (pos < display->init_seq_len) {
+        uint8_t command = display->init_seq[pos];
+        uint8_t len = display->init_seq[pos + 1];
+        inky_hw_send_command(display, command);
+        inky_hw_send_data(display, &display->init_seq[pos + 2], len);
+        pos += 2 + len;
+    }
+}
+
 void inky_hw_setup(inky_t *display) {
     if (!display || display->is_emulator) return;
     
@@ -273,85 +530,104 @@ void inky_hw_setup(inky_t *display) {
     inky_hw_reset(display);
     
     // Send initialization commands
+    hw_init_shadow(display);
+    hw_replay_init(display);
+    display->asleep = false;
+}
+
+void inky_hw_sleep(inky_t *display) {
+    if (!display || display->is_emulator || display->asleep) return;
+    
+    // Deep sleep - only a hardware reset brings the controller back
+    inky_hw_send_command(display, UC8159_DSLP);
+    uint8_t check = UC8159_DSLP_CHECK;
+    inky_hw_send_data(display, &check, 1);
+    display->asleep = true;
+}
+
+void inky_hw_wake(inky_t *display) {
+    if (!display || display->is_emulator) return;
     
-    // Resolution Setting (600x448)
-    inky_hw_send_command(display, UC8159_TRES);
-    uint8_t res_data[4] = {
-        (display->width >> 8) & 0xFF,
-        display->width & 0xFF,
-        (display->height >> 8) & 0xFF,
-        display->height & 0xFF
-    };
-    inky_hw_send_data(display, res_data, 4);
+    if (!display->asleep) {
+        // Awake already - only resend registers if the shadow changed
+        if (!display->init_seq_valid) {
+            hw_replay_init(display);
+        }
+        return;
+    }
     
-    // Panel Setting
-    // 0b11 = 600x448 resolution
-    inky_hw_send_command(display, UC8159_PSR);
-    uint8_t psr_data[2] = {
-        (0x03 << 6) | 0x2F,  // Resolution 600x448, other settings
-        0x08                  // 7-color mode
-    };
-    inky_hw_send_data(display, psr_data, 2);
+    uint64_t start = inky_time_us();
     
-    // Power Settings
-    inky_hw_send_command(display, UC8159_PWR);
-    uint8_t pwr_data[4] = {0x07, 0x00, 0x23, 0x23};
-    inky_hw_send_data(display, pwr_data, 4);
-    
-    // PLL Control
-    inky_hw_send_command(display, UC8159_PLL);
-    uint8_t pll_data = 0x3C;
-    inky_hw_send_data(display, &pll_data, 1);
-    
-    // TSE
-    inky_hw_send_command(display, UC8159_TSE);
-    uint8_t tse_data = 0x00;
-    inky_hw_send_data(display, &tse_data, 1);
-    
-    // VCOM and Data Interval
-    inky_hw_send_command(display, UC8159_CDI);
-    uint8_t cdi_data = (display->border_color << 5) | 0x17;
-    inky_hw_send_data(display, &cdi_data, 1);
-    
-    // TCON
-    inky_hw_send_command(display, UC8159_TCON);
-    uint8_t tcon_data = 0x22;
-    inky_hw_send_data(display, &tcon_data, 1);
-    
-    // DAM - Disable external flash
-    inky_hw_send_command(display, UC8159_DAM);
-    uint8_t dam_data = 0x00;
-    inky_hw_send_data(display, &dam_data, 1);
-    
-    // PWS
-    inky_hw_send_command(display, UC8159_PWS);
-    uint8_t pws_data = 0xAA;
-    inky_hw_send_data(display, &pws_data, 1);
-    
-    // Power off sequence
-    inky_hw_send_command(display, UC8159_PFS);
-    uint8_t pfs_data = 0x00;
-    inky_hw_send_data(display, &pfs_data, 1);
+    hw_reset_pulse(display, INKY_RESET_WAKE_LOW_US, INKY_RESET_WAKE_HIGH_US);
+    hw_wait_busy_low(display, INKY_RESET_WAKE_BUSY_US);
+    if (!hw_wait_ready(display, 1.0, 200)) {  // Poll every 200us
+        fprintf(stderr, "Warning: Controller not ready after wake, falling back to cold reset\n");
+        inky_hw_setup(display);
+    } else {
+        hw_replay_init(display);
+        display->asleep = false;
+    }
+    
+    display->wake_latency_us = (uint32_t)(inky_time_us() - start);
 }
 
 void inky_hw_update(inky_t *display) {
     if (!display || display->is_emulator) return;
     
-    // Send display data
-    inky_hw_send_command(display, UC8159_DTM1);
-    inky_hw_send_data(display, display->buffer, display->buffer_size);
-    
-    // Power on
-    inky_hw_send_command(display, UC8159_PON);
+    inky_hw_update_many(&display, 1);
+}
+
+// Full update of several panels with overlapping refreshes
+// Frames go out one after another (panels may share a bus), the settle
+// delays are paid once, and every refresh runs at the same time.
+void inky_hw_update_many(inky_t **displays, size_t count) {
+    const inky_update_type_t type = INKY_UPDATE_FULL;
+    
+    for (size_t i = 0; i < count; i++) {
+        inky_t *display = displays[i];
+        uint64_t t = inky_time_us();
+        
+        inky_hw_wake(display);
+        display->temperature = inky_hw_read_temperature(display);
+        t = inky_stats_phase_end(display, type, INKY_PHASE_SETUP, t);
+        
+        // Send display data
+        inky_hw_send_command(display, UC8159_DTM1);
+        inky_hw_send_data(display, display->buffer, display->buffer_size);
+        inky_stats_phase_end(display, type, INKY_PHASE_TRANSFER, t);
+        display->stats.last_update.transfer_us = inky_display_now_us(display);
+        
+        // Power on
+        inky_hw_send_command(display, UC8159_PON);
+    }
+    uint64_t settle_start = inky_time_us();
     usleep(200000);  // 200ms
+    for (size_t i = 0; i < count; i++) {
+        inky_stats_phase_end(displays[i], type, INKY_PHASE_PON, settle_start);
+    }
     
     // Display refresh
-    inky_hw_send_command(display, UC8159_DRF);
-    inky_hw_busy_wait(display);  // This can take up to 32 seconds
+    for (size_t i = 0; i < count; i++) {
+        hw_start_refresh(displays[i], INKY_UPDATE_FULL);
+    }
+    hw_refresh_wait_many(displays, count, INKY_UPDATE_FULL);  // This can take up to 32 seconds
     
     // Power off
-    inky_hw_send_command(display, UC8159_POF);
+    for (size_t i = 0; i < count; i++) {
+        inky_hw_send_command(displays[i], UC8159_POF);
+    }
+    settle_start = inky_time_us();
     usleep(200000);  // 200ms
+    for (size_t i = 0; i < count; i++) {
+        inky_stats_phase_end(displays[i], type, INKY_PHASE_POF, settle_start);
+        displays[i]->stats.last_update.complete_us = inky_display_now_us(displays[i]);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        if (displays[i]->auto_sleep) {
+            inky_hw_sleep(displays[i]);
+        }
+    }
 }
 
 void inky_hw_set_partial_window(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
@@ -394,14 +670,20 @@ void inky_hw_partial_update(inky_t *display, uint16_t x, uint16_t y, uint16_t wi
     
     printf("Starting partial update for region (%d,%d) %dx%d\n", x, y, width, height);
     
-    // Set up the display for partial update
-    inky_hw_setup(display);
+    const inky_update_type_t type = INKY_UPDATE_PARTIAL;
+    uint64_t t = inky_time_us();
+    
+    // Make sure the controller is awake and configured
+    inky_hw_wake(display);
+    display->temperature = inky_hw_read_temperature(display);
+    t = inky_stats_phase_end(display, type, INKY_PHASE_SETUP, t);
     
     // Set partial window
     inky_hw_set_partial_window(display, x, y, width, height);
     
     // Enter partial update mode
     inky_hw_send_command(display, UC8159_PARTIAL_IN);
+    t = inky_stats_phase_end(display, type, INKY_PHASE_WINDOW, t);
     
     // Extract the region data from the full buffer
     size_t region_size = (width * height + 1) / 2;  // 4-bit packed pixels
@@ -410,58 +692,175 @@ void inky_hw_partial_update(inky_t *display, uint16_t x, uint16_t y, uint16_t wi
         printf("ERROR: Failed to allocate region buffer\n");
         return;
     }
-    
-    // Copy pixels from the region to the temporary buffer
-    size_t pixel_idx = 0;
-    for (uint16_t row = y; row < y + height; row++) {
-        for (uint16_t col = x; col < x + width; col++) {
-            // Get pixel from main buffer
-            size_t main_pixel_idx = row * display->width + col;
-            size_t main_byte_idx = main_pixel_idx / 2;
-            uint8_t pixel_value;
-            
-            if (main_pixel_idx & 1) {
-                // Odd pixel - low nibble
-                pixel_value = display->buffer[main_byte_idx] & 0x0F;
-            } else {
-                // Even pixel - high nibble
-                pixel_value = (display->buffer[main_byte_idx] >> 4) & 0x0F;
-            }
-            
-            // Store in region buffer
-            size_t region_byte_idx = pixel_idx / 2;
-            if (pixel_idx & 1) {
-                // Odd pixel - low nibble
-                region_buffer[region_byte_idx] = (region_buffer[region_byte_idx] & 0xF0) | (pixel_value & 0x0F);
-            } else {
-                // Even pixel - high nibble
-                region_buffer[region_byte_idx] = (region_buffer[region_byte_idx] & 0x0F) | ((pixel_value & 0x0F) << 4);
-            }
-            
-            pixel_idx++;
-        }
-    }
+    inky_extract_region(display, x, y, width, height, region_buffer);
+    t = inky_stats_phase_end(display, type, INKY_PHASE_EXTRACT, t);
     
     // Send region data
     inky_hw_send_command(display, UC8159_DTM1);
     inky_hw_send_data(display, region_buffer, region_size);
+    inky_stats_phase_end(display, type, INKY_PHASE_TRANSFER, t);
+    display->stats.last_update.transfer_us = inky_display_now_us(display);
     
     // Power on
     inky_hw_send_command(display, UC8159_PON);
+    t = inky_time_us();
     usleep(200000);  // 200ms
+    inky_stats_phase_end(display, type, INKY_PHASE_PON, t);
     
     // Display refresh (should be faster for partial updates)
-    inky_hw_send_command(display, UC8159_DRF);
-    inky_hw_busy_wait(display);  // Partial updates are typically 2-4 seconds
+    hw_start_refresh(display, type);
+    inky_hw_refresh_wait(display, type);  // Partial updates are typically 2-4 seconds
     
     // Power off
     inky_hw_send_command(display, UC8159_POF);
+    t = inky_time_us();
     usleep(200000);  // 200ms
+    inky_stats_phase_end(display, type, INKY_PHASE_POF, t);
+    display->stats.last_update.complete_us = inky_display_now_us(display);
     
     // Exit partial update mode
     inky_hw_send_command(display, UC8159_PARTIAL_OUT);
     
+    if (display->auto_sleep) {
+        inky_hw_sleep(display);
+    }
+    
     free(region_buffer);
     printf("Partial update completed\n");
 }
 
+// Non-blocking update for inky_loop: the sequence of inky_hw_update_many()
+// and inky_hw_partial_update() for one panel, with the settle delays and the
+// refresh wait handed back as deadlines instead of slept through
+uint64_t inky_hw_update_begin(inky_t *display, inky_update_type_t type,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!display || display->is_emulator) return 0;
+    
+    uint64_t t = inky_time_us();
+    inky_hw_wake(display);
+    display->temperature = inky_hw_read_temperature(display);
+    t = inky_stats_phase_end(display, type, INKY_PHASE_SETUP, t);
+    
+    if (type == INKY_UPDATE_PARTIAL) {
+        inky_hw_set_partial_window(display, x, y, width, height);
+        inky_hw_send_command(display, UC8159_PARTIAL_IN);
+        t = inky_stats_phase_end(display, type, INKY_PHASE_WINDOW, t);
+        
+        size_t region_size = ((size_t)width * height + 1) / 2;  // 4-bit packed pixels
+        uint8_t *region_buffer = malloc(region_size);
+        if (!region_buffer) {
+            printf("ERROR: Failed to allocate region buffer\n");
+            inky_hw_send_command(display, UC8159_PARTIAL_OUT);
+            return 0;
+        }
+        inky_extract_region(display, x, y, width, height, region_buffer);
+        t = inky_stats_phase_end(display, type, INKY_PHASE_EXTRACT, t);
+        
+        inky_hw_send_command(display, UC8159_DTM1);
+        inky_hw_send_data(display, region_buffer, region_size);
+        free(region_buffer);
+    } else {
+        inky_hw_send_command(display, UC8159_DTM1);
+        inky_hw_send_data(display, display->buffer, display->buffer_size);
+    }
+    inky_stats_phase_end(display, type, INKY_PHASE_TRANSFER, t);
+    display->stats.last_update.transfer_us = inky_display_now_us(display);
+    
+    // The frame has been sent: the caller may draw the next one from here on
+    inky_hw_send_command(display, UC8159_PON);
+    display->async_type = type;
+    display->async_phase = INKY_ASYNC_PON;
+    display->async_phase_start_us = inky_time_us();
+    return display->async_phase_start_us + INKY_SETTLE_US;
+}
+
+// When to look at BUSY next: with edge events only the timeout needs a
+// timer, otherwise sleep through the predicted time and then check every 10ms
+static uint64_t hw_refresh_next_check(inky_t *display, const inky_refresh_plan_t *plan) {
+    uint64_t start = display->refresh_start_us;
+    uint64_t timeout_end = start + (uint64_t)plan->timeout_ms * 1000;
+    if (display->busy_events) {
+        return timeout_end;
+    }
+    
+    uint64_t presleep_end = start + (uint64_t)plan->presleep_ms * 1000;
+    uint64_t next = inky_time_us() + 10000;
+    if (next < presleep_end) next = presleep_end;
+    return next < timeout_end ? next : timeout_end;
+}
+
+uint64_t inky_hw_update_step(inky_t *display) {
+    if (!display || display->is_emulator) return 0;
+    
+    inky_update_type_t type = display->async_type;
+    inky_refresh_plan_t plan;
+    inky_refresh_plan(&display->refresh_model, type, display->temperature, &plan);
+    
+    switch (display->async_phase) {
+    case INKY_ASYNC_PON: {
+        inky_stats_phase_end(display, type, INKY_PHASE_PON, display->async_phase_start_us);
+        // Edges left over from earlier busy waits must not end this refresh
+        inky_hw_busy_drain(display);
+        hw_start_refresh(display, type);
+        display->async_phase = INKY_ASYNC_REFRESH;
+        return hw_refresh_next_check(display, &plan);
+    }
+    case INKY_ASYNC_REFRESH: {
+        uint64_t timeout_end = display->refresh_start_us + (uint64_t)plan.timeout_ms * 1000;
+        display->stats.syscalls++;
+        bool ready = gpio_get_value(display->busy_line) == 1;
+        if (!ready && inky_time_us() < timeout_end) {
+            return hw_refresh_next_check(display, &plan);
+        }
+        
+        hw_finish_refresh(display, type, ready, plan.predicted_ms);
+        inky_hw_send_command(display, UC8159_POF);
+        display->async_phase = INKY_ASYNC_POF;
+        display->async_phase_start_us = inky_time_us();
+        return display->async_phase_start_us + INKY_SETTLE_US;
+    }
+    case INKY_ASYNC_POF:
+        inky_stats_phase_end(display, type, INKY_PHASE_POF, display->async_phase_start_us);
+        display->stats.last_update.complete_us = inky_display_now_us(display);
+        if (type == INKY_UPDATE_PARTIAL) {
+            inky_hw_send_command(display, UC8159_PARTIAL_OUT);
+        }
+        if (display->auto_sleep) {
+            inky_hw_sleep(display);
+        }
+        display->async_phase = INKY_ASYNC_IDLE;
+        return 0;
+    case INKY_ASYNC_IDLE:
+    default:
+        return 0;
+    }
+}
+
+int inky_hw_busy_fd(inky_t *display) {
+    return display && display->busy_events ? display->busy_line : -1;
+}
+
+void inky_hw_busy_drain(inky_t *display) {
+#ifdef __linux__
+    if (!display || !display->busy_events) return;
+    
+    struct gpioevent_data events[16];
+    while (read(display->busy_line, events, sizeof(events)) == (ssize_t)sizeof(events)) {
+        // Full batch: there may be more
+    }
+#else
+    (void)display;
+#endif
+}
+
+// Stub functions for emulator timing (not used on hardware)
+void inky_emu_update_many(inky_t **displays, size_t count) { (void)displays; (void)count; }
+void inky_emu_partial_update(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    (void)display; (void)x; (void)y; (void)width; (void)height;
+}
+uint64_t inky_emu_update_begin(inky_t *display, inky_update_type_t type,
+                               uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    (void)display; (void)type; (void)x; (void)y; (void)width; (void)height;
+    return 0;
+}
+uint64_t inky_emu_update_step(inky_t *display) { (void)display; return 0; }
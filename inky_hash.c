@@ -0,0 +1,156 @@
+#include "inky_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Content hashes of what the panel shows
+//
+// The buffer is split into tiles of INKY_HASH_TILE_W x INKY_HASH_TILE_H
+// pixels, each with a 64-bit hash of its packed bytes as last transmitted
+// (0 = unknown). The full frame hash combines the tile hashes and the border
+// color. A full update is a no-op when the frame hash matches and no partial
+// update has touched the glass since; a partial update is a no-op when every
+// tile it overlaps still matches. Tiles only partly covered by a partial
+// update are forgotten unless their hash did not change, so a skip is never
+// decided on pixels that were not sent.
+
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3 0x165667B19E3779F9ULL
+
+static inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+// One xxHash64-style round per 8-byte word
+static inline uint64_t hash_round(uint64_t h, uint64_t word) {
+    word *= HASH_PRIME2;
+    word = rotl64(word, 31) * HASH_PRIME1;
+    return rotl64(h ^ word, 27) * HASH_PRIME1 + HASH_PRIME3;
+}
+
+static uint64_t hash_final(uint64_t h) {
+    h ^= h >> 33;
+    h *= HASH_PRIME2;
+    h ^= h >> 29;
+    h *= HASH_PRIME3;
+    h ^= h >> 32;
+    return h ? h : 1;  // 0 is reserved for "unknown"
+}
+
+static uint64_t hash_bytes(uint64_t h, const uint8_t *p, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = hash_round(h, word);
+    }
+    if (i < n) {
+        uint64_t word = 0;
+        memcpy(&word, p + i, n - i);
+        h = hash_round(h, word ^ (uint64_t)(n - i) << 56);
+    }
+    return h;
+}
+
+static uint16_t tile_cols(const inky_t *display) {
+    return (display->width + INKY_HASH_TILE_W - 1) / INKY_HASH_TILE_W;
+}
+
+static uint16_t tile_rows(const inky_t *display) {
+    return (display->height + INKY_HASH_TILE_H - 1) / INKY_HASH_TILE_H;
+}
+
+static uint64_t hash_tile(const inky_t *display, uint16_t col, uint16_t row) {
+    // Tile width is even, so tiles start on byte boundaries
+    size_t row_bytes = display->width / 2;
+    size_t x0 = (size_t)col * INKY_HASH_TILE_W / 2;
+    size_t x1 = x0 + INKY_HASH_TILE_W / 2 < row_bytes ? x0 + INKY_HASH_TILE_W / 2 : row_bytes;
+    uint16_t y0 = row * INKY_HASH_TILE_H;
+    uint16_t y1 = y0 + INKY_HASH_TILE_H < display->height ? y0 + INKY_HASH_TILE_H : display->height;
+    
+    uint64_t h = HASH_PRIME3 + ((uint64_t)col << 32 | row);
+    for (uint16_t y = y0; y < y1; y++) {
+        h = hash_bytes(h, display->buffer + (size_t)y * row_bytes + x0, x1 - x0);
+    }
+    return hash_final(h);
+}
+
+bool inky_hash_init(inky_t *display) {
+    display->tile_hash = calloc((size_t)tile_cols(display) * tile_rows(display), sizeof(uint64_t));
+    display->frame_hash = 0;
+    return display->tile_hash != NULL;
+}
+
+uint64_t inky_hash_frame(inky_t *display, uint64_t *tiles) {
+    uint16_t cols = tile_cols(display), rows = tile_rows(display);
+    uint64_t h = HASH_PRIME1 ^ display->border_color;
+    
+    for (uint16_t row = 0; row < rows; row++) {
+        for (uint16_t col = 0; col < cols; col++) {
+            uint64_t t = hash_tile(display, col, row);
+            tiles[(size_t)row * cols + col] = t;
+            h = hash_round(h, t);
+        }
+    }
+    return hash_final(h);
+}
+
+bool inky_hash_full_unchanged(inky_t *display) {
+    if (!display->tile_hash) return false;
+    
+    INKY_TRACE_BEGIN("hash_frame");
+    uint64_t previous = display->frame_hash;
+    display->frame_hash = inky_hash_frame(display, display->tile_hash);
+    INKY_TRACE_END("hash_frame");
+    
+    // After partial updates a full refresh is wanted for the ghosting it clears
+    return !display->force_update && display->partial_update_count == 0 &&
+           previous != 0 && previous == display->frame_hash;
+}
+
+bool inky_hash_region_unchanged(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!display->tile_hash) return false;
+    
+    INKY_TRACE_BEGIN("hash_region");
+    uint16_t cols = tile_cols(display);
+    uint16_t col0 = x / INKY_HASH_TILE_W, col1 = (x + width - 1) / INKY_HASH_TILE_W;
+    uint16_t row0 = y / INKY_HASH_TILE_H, row1 = (y + height - 1) / INKY_HASH_TILE_H;
+    
+    bool unchanged = true;
+    for (uint16_t row = row0; row <= row1 && unchanged; row++) {
+        for (uint16_t col = col0; col <= col1 && unchanged; col++) {
+            uint64_t stored = display->tile_hash[(size_t)row * cols + col];
+            unchanged = stored != 0 && stored == hash_tile(display, col, row);
+        }
+    }
+    
+    if (unchanged && !display->force_update) {
+        INKY_TRACE_END("hash_region");
+        return true;
+    }
+    
+    // The region goes out: tiles it covers completely now show the buffer,
+    // tiles it only clips are unknown unless they did not change at all
+    for (uint16_t row = row0; row <= row1; row++) {
+        for (uint16_t col = col0; col <= col1; col++) {
+            uint64_t *stored = &display->tile_hash[(size_t)row * cols + col];
+            uint64_t now = hash_tile(display, col, row);
+            uint32_t tx = (uint32_t)col * INKY_HASH_TILE_W, ty = (uint32_t)row * INKY_HASH_TILE_H;
+            uint32_t tx1 = tx + INKY_HASH_TILE_W < display->width ? tx + INKY_HASH_TILE_W : display->width;
+            uint32_t ty1 = ty + INKY_HASH_TILE_H < display->height ? ty + INKY_HASH_TILE_H : display->height;
+            bool covered = tx >= x && ty >= y && tx1 <= (uint32_t)x + width && ty1 <= (uint32_t)y + height;
+            if (covered || now != *stored) {
+                *stored = covered ? now : 0;
+            }
+        }
+    }
+    display->frame_hash = 0;
+    
+    INKY_TRACE_END("hash_region");
+    return false;
+}
+
+void inky_set_force_update(inky_t *display, bool force) {
+    if (!display) return;
+    display->force_update = force;
+}
@@ -39,18 +39,112 @@
 #define UC8159_PARTIAL_IN     0x91  // Enter Partial Update Mode  
 #define UC8159_PARTIAL_OUT    0x92  // Exit Partial Update Mode
 
+// Check code that must follow UC8159_DSLP for the controller to accept it
+#define UC8159_DSLP_CHECK 0xA5
+
+// Reset pulse timings (microseconds)
+// Cold boot keeps the conservative timings; waking from deep sleep only needs
+// the reset to register before BUSY takes over signalling readiness.
+#define INKY_RESET_COLD_LOW_US  100000
+#define INKY_RESET_COLD_HIGH_US 100000
+#define INKY_RESET_WAKE_LOW_US  1000
+#define INKY_RESET_WAKE_HIGH_US 1000
+#define INKY_RESET_WAKE_BUSY_US 10000  // Longest wait for BUSY to drop after the pulse
+
+// Emulator timing model
+#define INKY_EMU_DEFAULT_TEMP    22     // Celsius
+#define INKY_EMU_FULL_REFRESH_MS 28000  // Full refresh at 20C and above
+#define INKY_EMU_PARTIAL_BASE_MS 1500   // Partial refresh of a tiny region...
+#define INKY_EMU_PARTIAL_AREA_MS 2500   // ...plus this much for the whole panel
+#define INKY_SETTLE_US           200000 // PON/POF settle delay
+
+// Content hash tiles (even width keeps tiles byte-aligned)
+#define INKY_HASH_TILE_W 64
+#define INKY_HASH_TILE_H 16
+
+// Emulator ghosting model
+#define INKY_GHOST_STEP       64   // Residue left by each partial color change
+#define INKY_GHOST_MAX        255
+#define INKY_GHOST_MAX_BLEND  0.4  // Share of the old color at full residue
+
+// Hard limit on any BUSY wait
+#define INKY_BUSY_TIMEOUT_MS 40000
+
+// Refresh duration model - temperature bands (plus one for unknown)
+#define INKY_TEMP_BANDS 10
+#define INKY_REFRESH_MIN_SAMPLES 3  // Samples needed before trusting a band
+
+// Size of the cached init byte stream (command, length, data... per register)
+#define INKY_INIT_SEQ_MAX 64
+
 // GPIO Pin definitions (Raspberry Pi BCM numbering)
 #define INKY_RESET_PIN 27  // BCM27 (Physical Pin 13)
 #define INKY_BUSY_PIN  17  // BCM17 (Physical Pin 11)
 #define INKY_DC_PIN    22  // BCM22 (Physical Pin 15)
 #define INKY_CS_PIN    8   // BCM8/CE0 (Physical Pin 24)
 
+// Default devices
+#define INKY_SPI_DEVICE "/dev/spidev0.0"
+#define INKY_GPIO_DEVICE "/dev/gpiochip0"
+#define INKY_SPI_SPEED_HZ 3000000
+#define INKY_DEVICE_PATH_MAX 64
+
 // Button GPIO Pin definitions (Raspberry Pi BCM numbering)
 #define INKY_BUTTON_A_PIN 5   // BCM5 (Physical Pin 29)
 #define INKY_BUTTON_B_PIN 6   // BCM6 (Physical Pin 31)
 #define INKY_BUTTON_C_PIN 16  // BCM16 (Physical Pin 36)
 #define INKY_BUTTON_D_PIN 24  // BCM24 (Physical Pin 18)
 
+// Shadow of the UC8159 configuration registers written during setup
+typedef struct {
+    uint8_t tres[4];
+    uint8_t psr[2];
+    uint8_t pwr[4];
+    uint8_t pll;
+    uint8_t tse;
+    uint8_t cdi;
+    uint8_t tcon;
+    uint8_t dam;
+    uint8_t pws;
+    uint8_t pfs;
+} inky_reg_shadow_t;
+
+// Observed refresh durations for one update type and temperature band
+typedef struct {
+    uint32_t mean_ms;
+    uint32_t dev_ms;   // Mean absolute deviation
+    uint32_t samples;
+} inky_refresh_cell_t;
+
+typedef struct {
+    inky_refresh_cell_t cells[INKY_UPDATE_TYPES][INKY_TEMP_BANDS + 1];
+} inky_refresh_model_t;
+
+// How to wait for one refresh
+typedef struct {
+    uint32_t predicted_ms;
+    uint32_t presleep_ms;   // Sleep this long before polling BUSY
+    uint32_t timeout_ms;
+} inky_refresh_plan_t;
+
+// Frame recorder state (inky_record.c)
+typedef struct inky_recorder inky_recorder_t;
+
+// Phase of a non-blocking update (inky_loop.c)
+typedef enum {
+    INKY_ASYNC_IDLE = 0,
+    INKY_ASYNC_PON,         // Power on sent, waiting out the settle delay
+    INKY_ASYNC_REFRESH,     // DRF sent, waiting for BUSY (or the emulated duration)
+    INKY_ASYNC_POF          // Power off sent, waiting out the settle delay
+} inky_async_phase_t;
+
+// Emulated ghosting state per pixel
+typedef struct {
+    uint8_t shown;     // Color the last refresh drove the pixel to
+    uint8_t residue;   // Earlier color still faintly visible
+    uint8_t level;     // Residue strength, 0 (clean) to INKY_GHOST_MAX
+} inky_ghost_t;
+
 // Internal display structure (implementation exposed to backends)
 struct inky_display {
     // Display properties
@@ -66,10 +160,18 @@ struct inky_display {
     bool is_emulator;
     
     // Hardware specific (only used when !is_emulator)
+    char spi_device[INKY_DEVICE_PATH_MAX];
+    char gpio_device[INKY_DEVICE_PATH_MAX];
+    uint32_t spi_speed_hz;
+    int reset_pin;
+    int busy_pin;
+    int dc_pin;
+    int cs_pin;
     int spi_fd;
     int gpio_chip_fd;
     int reset_line;
     int busy_line;
+    bool busy_events;               // busy_line is a line event fd, readable when BUSY rises
     int dc_line;
     int cs_line;
     
@@ -79,12 +181,197 @@ struct inky_display {
     
     // Partial update tracking (for ghosting prevention)
     int partial_update_count;
-    time_t last_full_refresh;
+    uint64_t last_full_refresh_us;  // On the display clock
+    
+    // Hashes of what the glass shows (see inky_hash.c), 0 = unknown
+    uint64_t *tile_hash;
+    uint64_t frame_hash;            // Tiles plus border at the last full update
+    bool force_update;              // Send even when nothing changed
+    
+    // Time source (NULL = CLOCK_MONOTONIC; emulator may use a scaled/virtual clock)
+    inky_clock_t *clock;
+    
+    // Emulated ghosting (NULL on hardware)
+    inky_ghost_t *ghost;
+    
+    // Colors emulated frames are rendered in (nominal, or set by inky_set_palette)
+    uint8_t palette_rgb[8][3];
+    
+    // Live shared-memory framebuffer (emulator only, see inky_shm.c)
+    int shm_fd;
+    inky_shm_header_t *shm;
+    size_t shm_size;
+    uint8_t *shm_row;    // Scratch row for rendering before comparing
+    char shm_name[INKY_DEVICE_PATH_MAX];  // Unlinked on unshare (empty for memfd)
+    
+    // Frame recording (NULL when not recording)
+    inky_recorder_t *recorder;
+    
+    // Power management (deep sleep between updates)
+    bool auto_sleep;
+    bool asleep;
+    inky_reg_shadow_t regs;
+    bool init_seq_valid;            // false when regs changed since the stream was built
+    uint8_t init_seq[INKY_INIT_SEQ_MAX];
+    size_t init_seq_len;
+    uint32_t wake_latency_us;
+    
+    // Refresh timing (temperature-aware busy wait)
+    int temperature;                // Last controller reading, INKY_TEMP_UNKNOWN if none
+    inky_refresh_model_t refresh_model;
+    uint64_t refresh_start_us;      // When DRF was sent for the refresh in progress
+    uint64_t refresh_deadline_us;   // Predicted end of the refresh in progress, 0 when idle
+    
+    // Non-blocking update in progress (driven by inky_loop)
+    inky_async_phase_t async_phase;
+    inky_update_type_t async_type;
+    uint16_t async_x, async_y, async_width, async_height;
+    uint64_t async_phase_start_us;  // On the display clock
+    
+    // Update statistics
+    inky_stats_t stats;
 };
 
 // Common functions (shared between emulator and hardware)
-inky_t* inky_init_common(bool emulator);
+inky_t* inky_init_common(const inky_config_t *config);
 void inky_destroy_common(inky_t *display);
+uint64_t inky_time_us(void);
+uint64_t inky_display_now_us(inky_t *display);
+void inky_extract_region(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                         uint8_t *region_buffer);
+
+// Bookkeeping before an update goes to a backend; false when it is skipped
+// (content unchanged) or, for regions, out of bounds
+bool inky_prepare_full_update(inky_t *display);
+bool inky_prepare_region_update(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+// Refresh duration model
+void inky_refresh_model_init(inky_refresh_model_t *model);
+int inky_refresh_temp_band(int temperature);
+uint32_t inky_refresh_predict_ms(const inky_refresh_model_t *model,
+                                 inky_update_type_t type, int temperature);
+void inky_refresh_plan(const inky_refresh_model_t *model, inky_update_type_t type,
+                       int temperature, inky_refresh_plan_t *plan);
+void inky_refresh_record(inky_refresh_model_t *model, inky_update_type_t type,
+                         int temperature, uint32_t duration_ms);
+
+// Drawing (inky_shapes.c)
+typedef struct {
+    int x0, y0, x1, y1;      // Exclusive right and bottom
+} inky_clip_t;
+
+// Pixels [x0, x1) of row y in one color, already clipped
+void inky_fill_span(inky_t *display, uint16_t y, uint16_t x0, uint16_t x1, uint8_t color);
+// The clipping stage every primitive's runs pass through
+void inky_clip_span(inky_t *display, const inky_clip_t *clip, int y, int x0, int x1, uint8_t color);
+// Pixels of a line don't depend on the clip, so a line can be drawn in pieces
+void inky_raster_line(inky_t *display, const inky_clip_t *clip, int x0, int y0, int x1, int y1, uint8_t color);
+
+// Statistics
+void inky_stats_record(inky_t *display, inky_update_type_t type, inky_phase_t phase, uint64_t duration_us);
+// Record now - start_us for a phase and return now (to chain phases)
+uint64_t inky_stats_phase_end(inky_t *display, inky_update_type_t type, inky_phase_t phase, uint64_t start_us);
+// Start a new stats.last_update timeline at the current display time
+void inky_stats_begin_update(inky_t *display);
+
+// Tracing
+extern int inky_trace_active;
+void inky_trace_event(char phase, const char *name, bool has_arg, int64_t arg);
+
+#define INKY_TRACING() __builtin_expect(__atomic_load_n(&inky_trace_active, __ATOMIC_RELAXED), 0)
+#define INKY_TRACE_BEGIN(name) \
+    do { if (INKY_TRACING()) inky_trace_event('B', (name), false, 0); } while (0)
+#define INKY_TRACE_END(name) \
+    do { if (INKY_TRACING()) inky_trace_event('E', (name), false, 0); } while (0)
+#define INKY_TRACE_BEGIN_ARG(name, value) \
+    do { if (INKY_TRACING()) inky_trace_event('B', (name), true, (value)); } while (0)
+
+// Content hashes: each check also records the content about to be sent
+bool inky_hash_init(inky_t *display);
+uint64_t inky_hash_frame(inky_t *display, uint64_t *tiles);
+bool inky_hash_full_unchanged(inky_t *display);
+bool inky_hash_region_unchanged(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+// Palette used for PPM output and ghost scoring
+extern const uint8_t inky_palette_rgb[8][3];  // Nominal colors
+void inky_render_rgb_row(inky_t *display, uint16_t y, uint8_t *rgb);
+
+// Run-length codec core (inky_codec.c): cur XOR prev (prev NULL = plain)
+#define INKY_RLE_MIN_RUN 4
+size_t inky_rle_bound(size_t n);
+size_t inky_rle_encode(const uint8_t *cur, const uint8_t *prev, size_t n, uint8_t *out);
+bool inky_rle_decode(const uint8_t *in, size_t len, uint8_t *dst, size_t n, bool xor);
+
+// Frame recorder: append what the panel shows after this update
+void inky_record_frame(inky_t *display, inky_update_type_t type,
+                       uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+// Shared-memory framebuffer: republish rows [y, y + height) if shared
+void inky_shm_publish(inky_t *display, uint16_t y, uint16_t height);
+
+// Display server protocol (inky_server.c, inky_client.c). One fixed-size
+// message per SOCK_SEQPACKET packet in host byte order; a SUBMIT carries
+// exactly one memfd of at least buffer_size bytes in display->buffer layout,
+// sealed against writes and resizing.
+#define INKY_SERVER_MAGIC   0x594B4E49   // "INKY"
+#define INKY_SERVER_VERSION 1
+#define INKY_SERVER_SEALS   (F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+typedef enum {
+    INKY_MSG_HELLO = 1,      // Server -> client on connect: panel width and height
+    INKY_MSG_SUBMIT,         // Client -> server: rectangle (or full frame) in the memfd
+    INKY_MSG_DONE            // Server -> client: the update holding seq and every earlier
+                             // accepted request finished (status < 0: it failed)
+} inky_msg_type_t;
+
+#define INKY_MSG_FULL     0x1  // SUBMIT: full update, rectangle ignored
+#define INKY_MSG_REJECTED 0x2  // DONE: seq alone was refused, with status < 0
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t seq;            // Client's request id
+    int32_t status;          // DONE: 0 or -errno
+    uint32_t flags;
+    uint16_t x, y, width, height;
+} inky_msg_t;
+
+// Emulator-specific internal functions (refresh timing model)
+void inky_emu_update_many(inky_t **displays, size_t count);
+void inky_emu_partial_update(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+// Non-blocking updates: begin runs everything up to power on, step runs the
+// next phase once its time has come. Both return the display-clock time the
+// next step is due, or 0 once the update is complete.
+uint64_t inky_emu_update_begin(inky_t *display, inky_update_type_t type,
+                               uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+uint64_t inky_emu_update_step(inky_t *display);
+uint64_t inky_hw_update_begin(inky_t *display, inky_update_type_t type,
+                              uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+uint64_t inky_hw_update_step(inky_t *display);
+
+// fd that becomes readable when BUSY rises (reading drains it), -1 if none
+int inky_hw_busy_fd(inky_t *display);
+void inky_hw_busy_drain(inky_t *display);
+
+// Real CLOCK_MONOTONIC time at which a clock reaches `t` (0 for virtual clocks)
+uint64_t inky_clock_real_time_us(inky_clock_t *clock, uint64_t t);
+
+// Buttons: time inky_buttons_poll() next has work to do (debounce sampling,
+// a gesture timer or scripted input), 0 when the button thread does it.
+// Emulated buttons count on inky_buttons_clock(), others on CLOCK_MONOTONIC.
+uint64_t inky_buttons_poll_deadline_us(inky_buttons_t *buttons);
+inky_clock_t *inky_buttons_clock(inky_buttons_t *buttons);
+
+// Buttons: a polled set that reads its lines through `read_line` (true =
+// pressed) instead of GPIO handles, so the fallback path for chips without
+// edge events runs without the hardware
+typedef bool (*inky_buttons_line_reader_t)(int button, void *user_data);
+inky_buttons_t *inky_buttons_open_polled(inky_buttons_line_reader_t read_line, void *user_data);
+
+// Script fd to wait on while a replay needs more input, else -1
+int inky_buttons_script_fd(inky_buttons_t *buttons);
 
 // Hardware-specific internal functions
 bool inky_hw_init_gpio(inky_t *display);
@@ -93,7 +380,14 @@ void inky_hw_reset(inky_t *display);
 void inky_hw_send_command(inky_t *display, uint8_t command);
 void inky_hw_send_data(inky_t *display, const uint8_t *data, size_t len);
 void inky_hw_busy_wait(inky_t *display);
+void inky_hw_refresh_wait(inky_t *display, inky_update_type_t type);
+int inky_hw_read_temperature(inky_t *display);
 void inky_hw_update(inky_t *display);
+void inky_hw_update_many(inky_t **displays, size_t count);
+
+// Power management hardware functions
+void inky_hw_sleep(inky_t *display);
+void inky_hw_wake(inky_t *display);
 
 // Partial update hardware functions
 void inky_hw_set_partial_window(inky_t *display, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
@@ -0,0 +1,510 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+// Event loop for one display and its buttons
+//
+// One epoll instance watches a timerfd, the BUSY line (edge events), the
+// button event queue's eventfd and any fds the application registers.
+// Updates started through the loop never block: the backend runs everything
+// up to power on, then each remaining phase (settle, refresh, settle) is a
+// deadline. The timerfd is armed for the nearest deadline of the update in
+// progress, the application's timers and polled buttons, so the epoll fd is
+// readable exactly when dispatch has work, which is what lets it nest inside
+// another loop.
+//
+// Deadlines are on the display clock. A scaled clock is converted to real
+// time for the timerfd; on a virtual clock, dispatch jumps the clock to the
+// next deadline whenever no fd is ready.
+
+#define LOOP_MAX_FDS     64      // Room for a display server's clients
+#define LOOP_MAX_TIMERS  16
+#define LOOP_MAX_EVENTS  16
+
+#ifdef __linux__
+
+typedef struct {
+    int fd;
+    inky_loop_fd_callback_t callback;
+    void *user_data;
+} loop_fd_t;
+
+typedef struct {
+    int id;                 // 0 = free slot
+    uint64_t deadline_us;   // Display clock
+    uint64_t interval_us;   // 0 = one-shot
+    inky_loop_timer_callback_t callback;
+    void *user_data;
+} loop_timer_t;
+
+struct inky_loop {
+    int epoll_fd;
+    int timer_fd;
+    inky_t *display;
+    inky_buttons_t *buttons;
+    int script_fd;          // Replay input being waited on, -1 = none
+    bool running;
+    
+    loop_fd_t fds[LOOP_MAX_FDS];
+    size_t fd_count;
+    loop_timer_t timers[LOOP_MAX_TIMERS];
+    int next_timer_id;
+    
+    inky_loop_button_callback_t button_callback;
+    void *button_user_data;
+    inky_loop_update_callback_t update_callback;
+    void *update_user_data;
+    
+    // Update in progress: next backend step, 0 when idle
+    uint64_t update_deadline_us;
+    
+    // Requests made while an update runs are merged and started after it:
+    // a full update wins, regions grow to their bounding box
+    bool pending;
+    bool pending_full;
+    uint16_t pending_x0, pending_y0, pending_x1, pending_y1;
+};
+
+static uint64_t loop_now_us(inky_loop_t *loop) {
+    return loop->display ? inky_display_now_us(loop->display) : inky_time_us();
+}
+
+static inky_clock_t *loop_clock(inky_loop_t *loop) {
+    return loop->display ? loop->display->clock : NULL;
+}
+
+static int loop_watch(inky_loop_t *loop, int fd, uint32_t events) {
+    struct epoll_event ev = {.events = events, .data.fd = fd};
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+inky_loop_t *inky_loop_create(inky_t *display, inky_buttons_t *buttons) {
+    inky_loop_t *loop = calloc(1, sizeof(inky_loop_t));
+    if (!loop) {
+        return NULL;
+    }
+    
+    loop->display = display;
+    loop->buttons = buttons;
+    loop->script_fd = -1;
+    loop->next_timer_id = 1;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    
+    int busy_fd = display ? inky_hw_busy_fd(display) : -1;
+    if (loop->epoll_fd < 0 || loop->timer_fd < 0 ||
+        loop_watch(loop, loop->timer_fd, EPOLLIN) < 0 ||
+        (busy_fd >= 0 && loop_watch(loop, busy_fd, EPOLLIN) < 0)) {
+        perror("Failed to create event loop");
+        if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+        if (loop->timer_fd >= 0) close(loop->timer_fd);
+        free(loop);
+        return NULL;
+    }
+    
+    return loop;
+}
+
+static void loop_update_done(inky_loop_t *loop);
+
+void inky_loop_destroy(inky_loop_t *loop) {
+    if (!loop) return;
+    
+    // Finish an update in progress so the panel is powered off properly
+    while (loop->update_deadline_us) {
+        uint64_t now = loop_now_us(loop);
+        if (loop->update_deadline_us > now) {
+            inky_clock_sleep_us(loop_clock(loop), loop->update_deadline_us - now);
+        }
+        loop->update_deadline_us = loop->display->is_emulator ? inky_emu_update_step(loop->display)
+                                                              : inky_hw_update_step(loop->display);
+    }
+    
+    close(loop->timer_fd);
+    close(loop->epoll_fd);
+    free(loop);
+}
+
+int inky_loop_get_fd(inky_loop_t *loop) {
+    return loop ? loop->epoll_fd : -1;
+}
+
+int inky_loop_add_fd(inky_loop_t *loop, int fd, uint32_t events,
+                     inky_loop_fd_callback_t callback, void *user_data) {
+    if (!loop || fd < 0 || !callback || loop->fd_count == LOOP_MAX_FDS) return -1;
+    
+    if (loop_watch(loop, fd, events) < 0) {
+        perror("Failed to watch fd");
+        return -1;
+    }
+    loop->fds[loop->fd_count].fd = fd;
+    loop->fds[loop->fd_count].callback = callback;
+    loop->fds[loop->fd_count].user_data = user_data;
+    loop->fd_count++;
+    return 0;
+}
+
+int inky_loop_remove_fd(inky_loop_t *loop, int fd) {
+    if (!loop) return -1;
+    
+    for (size_t i = 0; i < loop->fd_count; i++) {
+        if (loop->fds[i].fd != fd) continue;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        loop->fds[i] = loop->fds[--loop->fd_count];
+        return 0;
+    }
+    return -1;
+}
+
+void inky_loop_set_button_handler(inky_loop_t *loop, inky_loop_button_callback_t callback, void *user_data) {
+    if (!loop || !loop->buttons) return;
+    
+    // The queue is only drained while a handler is set; otherwise it is left
+    // to the application and its fd must not keep the loop awake
+    int fd = inky_buttons_get_event_fd(loop->buttons);
+    if (fd >= 0 && !loop->button_callback && callback) {
+        loop_watch(loop, fd, EPOLLIN);
+    } else if (fd >= 0 && loop->button_callback && !callback) {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    loop->button_callback = callback;
+    loop->button_user_data = user_data;
+}
+
+void inky_loop_set_update_callback(inky_loop_t *loop, inky_loop_update_callback_t callback, void *user_data) {
+    if (!loop) return;
+    loop->update_callback = callback;
+    loop->update_user_data = user_data;
+}
+
+int inky_loop_add_timer(inky_loop_t *loop, uint32_t delay_ms, uint32_t interval_ms,
+                        inky_loop_timer_callback_t callback, void *user_data) {
+    if (!loop || !callback) return -1;
+    
+    for (int i = 0; i < LOOP_MAX_TIMERS; i++) {
+        loop_timer_t *timer = &loop->timers[i];
+        if (timer->id) continue;
+        timer->id = loop->next_timer_id++;
+        timer->deadline_us = loop_now_us(loop) + (uint64_t)delay_ms * 1000;
+        timer->interval_us = (uint64_t)interval_ms * 1000;
+        timer->callback = callback;
+        timer->user_data = user_data;
+        return timer->id;
+    }
+    return -1;
+}
+
+void inky_loop_cancel_timer(inky_loop_t *loop, int timer_id) {
+    if (!loop || timer_id <= 0) return;
+    
+    for (int i = 0; i < LOOP_MAX_TIMERS; i++) {
+        if (loop->timers[i].id == timer_id) {
+            loop->timers[i].id = 0;
+        }
+    }
+}
+
+static int loop_start_update(inky_loop_t *loop, bool full, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    inky_t *display = loop->display;
+    inky_update_type_t type = full ? INKY_UPDATE_FULL : INKY_UPDATE_PARTIAL;
+    if (full) {
+        x = y = 0;
+        width = display->width;
+        height = display->height;
+    }
+    
+    INKY_TRACE_BEGIN_ARG("loop_update_begin", type);
+    bool prepared = full ? inky_prepare_full_update(display)
+                         : inky_prepare_region_update(display, x, y, width, height);
+    if (prepared) {
+        loop->update_deadline_us = display->is_emulator ? inky_emu_update_begin(display, type, x, y, width, height)
+                                                        : inky_hw_update_begin(display, type, x, y, width, height);
+    }
+    INKY_TRACE_END("loop_update_begin");
+    
+    if (prepared && loop->update_deadline_us == 0) {
+        loop_update_done(loop);
+    }
+    return prepared ? 1 : 0;
+}
+
+static int loop_request_update(inky_loop_t *loop, bool full, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!loop || !loop->display) return -1;
+    
+    if (loop->update_deadline_us == 0) {
+        return loop_start_update(loop, full, x, y, width, height);
+    }
+    
+    if (!loop->pending) {
+        loop->pending = true;
+        loop->pending_full = full;
+        loop->pending_x0 = x;
+        loop->pending_y0 = y;
+        loop->pending_x1 = x + width;
+        loop->pending_y1 = y + height;
+    } else if (full) {
+        loop->pending_full = true;
+    } else {
+        if (x < loop->pending_x0) loop->pending_x0 = x;
+        if (y < loop->pending_y0) loop->pending_y0 = y;
+        if (x + width > loop->pending_x1) loop->pending_x1 = x + width;
+        if (y + height > loop->pending_y1) loop->pending_y1 = y + height;
+    }
+    return 0;
+}
+
+int inky_loop_update(inky_loop_t *loop) {
+    return loop_request_update(loop, true, 0, 0, 0, 0);
+}
+
+int inky_loop_update_region(inky_loop_t *loop, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    return loop_request_update(loop, false, x, y, width, height);
+}
+
+bool inky_loop_is_updating(inky_loop_t *loop) {
+    return loop && (loop->update_deadline_us != 0 || loop->pending);
+}
+
+static void loop_update_done(inky_loop_t *loop) {
+    if (loop->update_callback) {
+        loop->update_callback(loop, loop->display, loop->update_user_data);
+    }
+    
+    if (loop->pending && loop->update_deadline_us == 0) {
+        loop->pending = false;
+        loop_start_update(loop, loop->pending_full, loop->pending_x0, loop->pending_y0,
+                          loop->pending_x1 - loop->pending_x0, loop->pending_y1 - loop->pending_y0);
+    }
+}
+
+// Earliest deadline on the display clock (0 = none)
+static uint64_t loop_next_deadline(inky_loop_t *loop) {
+    uint64_t next = loop->update_deadline_us;
+    for (int i = 0; i < LOOP_MAX_TIMERS; i++) {
+        uint64_t t = loop->timers[i].id ? loop->timers[i].deadline_us : 0;
+        if (t && (next == 0 || t < next)) {
+            next = t;
+        }
+    }
+    return next;
+}
+
+// Arm the timerfd for an absolute CLOCK_MONOTONIC time (0 = disarm)
+static void loop_arm(inky_loop_t *loop, uint64_t real_us) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (real_us) {
+        // A deadline already passed still has to fire: 0 would disarm
+        spec.it_value.tv_sec = real_us / 1000000;
+        spec.it_value.tv_nsec = (long)(real_us % 1000000) * 1000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static int loop_drain_buttons(inky_loop_t *loop) {
+    inky_button_event_t events[16];
+    size_t count;
+    int handled = 0;
+    
+    while (loop->button_callback &&
+           (count = inky_buttons_read_events(loop->buttons, events, 16)) > 0) {
+        for (size_t i = 0; i < count && loop->button_callback; i++) {
+            loop->button_callback(loop, &events[i], loop->button_user_data);
+            handled++;
+        }
+    }
+    return handled;
+}
+
+// Run everything that is due: button polling, update phases, timers
+static int loop_run_due(inky_loop_t *loop) {
+    int handled = 0;
+    
+    uint64_t poll_deadline = inky_buttons_poll_deadline_us(loop->buttons);
+    if (poll_deadline && poll_deadline <= inky_clock_now_us(inky_buttons_clock(loop->buttons))) {
+        inky_buttons_poll(loop->buttons);
+        handled += loop_drain_buttons(loop);
+    }
+    
+    while (loop->update_deadline_us && loop->update_deadline_us <= loop_now_us(loop)) {
+        inky_t *display = loop->display;
+        loop->update_deadline_us = display->is_emulator ? inky_emu_update_step(display)
+                                                        : inky_hw_update_step(display);
+        if (loop->update_deadline_us == 0) {
+            loop_update_done(loop);
+        }
+        handled++;
+    }
+    
+    uint64_t now = loop_now_us(loop);
+    for (int i = 0; i < LOOP_MAX_TIMERS; i++) {
+        loop_timer_t *timer = &loop->timers[i];
+        if (!timer->id || timer->deadline_us > now) continue;
+        
+        // Reschedule before the callback so it may cancel or re-add timers
+        int id = timer->id;
+        inky_loop_timer_callback_t callback = timer->callback;
+        void *user_data = timer->user_data;
+        if (timer->interval_us) {
+            timer->deadline_us += timer->interval_us;
+            if (timer->deadline_us <= now) {
+                timer->deadline_us = now + timer->interval_us;  // Skip missed ticks
+            }
+        } else {
+            timer->id = 0;
+        }
+        callback(loop, id, user_data);
+        handled++;
+    }
+    return handled;
+}
+
+int inky_loop_dispatch(inky_loop_t *loop, int timeout_ms) {
+    if (!loop) return -1;
+    
+    inky_clock_t *clock = loop_clock(loop);
+    uint64_t deadline = loop_next_deadline(loop);
+    
+    // Button work counts on the buttons' clock; on the display's own clock it
+    // is scheduled (and fast-forwarded to) like the loop's other deadlines
+    inky_clock_t *button_clock = inky_buttons_clock(loop->buttons);
+    uint64_t poll_deadline = inky_buttons_poll_deadline_us(loop->buttons);
+    if (poll_deadline && button_clock == clock) {
+        if (deadline == 0 || poll_deadline < deadline) {
+            deadline = poll_deadline;
+        }
+        poll_deadline = 0;
+    }
+    uint64_t real_deadline = deadline ? inky_clock_real_time_us(clock, deadline) : 0;
+    poll_deadline = poll_deadline ? inky_clock_real_time_us(button_clock, poll_deadline) : 0;
+    if (poll_deadline && (real_deadline == 0 || poll_deadline < real_deadline)) {
+        real_deadline = poll_deadline;
+    }
+    loop_arm(loop, real_deadline);
+    
+    // A replay reading from a pipe waits here for its next line
+    int script_fd = inky_buttons_script_fd(loop->buttons);
+    if (script_fd != loop->script_fd) {
+        if (loop->script_fd >= 0) {
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, loop->script_fd, NULL);
+        }
+        loop->script_fd = script_fd >= 0 && loop_watch(loop, script_fd, EPOLLIN) == 0 ? script_fd : -1;
+    }
+    
+    // Virtual time only moves when nothing else is ready
+    bool virtual_due = deadline && inky_clock_get_mode(clock) == INKY_CLOCK_VIRTUAL;
+    
+    struct epoll_event ready[LOOP_MAX_EVENTS];
+    int n = epoll_wait(loop->epoll_fd, ready, LOOP_MAX_EVENTS, virtual_due ? 0 : timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (n == 0 && virtual_due && timeout_ms != 0) {
+        uint64_t now = inky_clock_now_us(clock);
+        if (deadline > now) {
+            inky_clock_advance_us(clock, deadline - now);
+        }
+    }
+    
+    int handled = 0;
+    int busy_fd = loop->display ? inky_hw_busy_fd(loop->display) : -1;
+    int button_fd = loop->buttons ? inky_buttons_get_event_fd(loop->buttons) : -1;
+    for (int i = 0; i < n; i++) {
+        int fd = ready[i].data.fd;
+        if (fd == loop->timer_fd) {
+            uint64_t expirations;
+            if (read(loop->timer_fd, &expirations, sizeof(expirations)) < 0) {
+                // EAGAIN: re-armed since it fired
+            }
+        } else if (fd == busy_fd) {
+            // BUSY rose: check the refresh now rather than at its timeout
+            inky_hw_busy_drain(loop->display);
+            if (loop->update_deadline_us && loop->display->async_phase == INKY_ASYNC_REFRESH) {
+                loop->update_deadline_us = loop_now_us(loop);
+            }
+        } else if (fd == button_fd) {
+            handled += loop_drain_buttons(loop);
+        } else if (fd == loop->script_fd) {
+            inky_buttons_poll(loop->buttons);
+            handled += loop_drain_buttons(loop);
+        } else {
+            for (size_t k = 0; k < loop->fd_count; k++) {
+                if (loop->fds[k].fd != fd) continue;
+                loop->fds[k].callback(loop, fd, ready[i].events, loop->fds[k].user_data);
+                handled++;
+                break;
+            }
+        }
+    }
+    
+    return handled + loop_run_due(loop);
+}
+
+int inky_loop_run(inky_loop_t *loop) {
+    if (!loop) return -1;
+    
+    loop->running = true;
+    while (loop->running) {
+        if (inky_loop_dispatch(loop, -1) < 0) {
+            perror("Event loop wait failed");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void inky_loop_stop(inky_loop_t *loop) {
+    if (!loop) return;
+    loop->running = false;
+}
+
+#else
+
+// The event loop needs epoll and timerfd
+inky_loop_t *inky_loop_create(inky_t *display, inky_buttons_t *buttons) {
+    (void)display; (void)buttons;
+    fprintf(stderr, "Event loop not supported on this platform\n");
+    return NULL;
+}
+void inky_loop_destroy(inky_loop_t *loop) { (void)loop; }
+int inky_loop_get_fd(inky_loop_t *loop) { (void)loop; return -1; }
+int inky_loop_add_fd(inky_loop_t *loop, int fd, uint32_t events,
+                     inky_loop_fd_callback_t callback, void *user_data) {
+    (void)loop; (void)fd; (void)events; (void)callback; (void)user_data;
+    return -1;
+}
+int inky_loop_remove_fd(inky_loop_t *loop, int fd) { (void)loop; (void)fd; return -1; }
+void inky_loop_set_button_handler(inky_loop_t *loop, inky_loop_button_callback_t callback, void *user_data) {
+    (void)loop; (void)callback; (void)user_data;
+}
+void inky_loop_set_update_callback(inky_loop_t *loop, inky_loop_update_callback_t callback, void *user_data) {
+    (void)loop; (void)callback; (void)user_data;
+}
+int inky_loop_add_timer(inky_loop_t *loop, uint32_t delay_ms, uint32_t interval_ms,
+                        inky_loop_timer_callback_t callback, void *user_data) {
+    (void)loop; (void)delay_ms; (void)interval_ms; (void)callback; (void)user_data;
+    return -1;
+}
+void inky_loop_cancel_timer(inky_loop_t *loop, int timer_id) { (void)loop; (void)timer_id; }
+int inky_loop_update(inky_loop_t *loop) { (void)loop; return -1; }
+int inky_loop_update_region(inky_loop_t *loop, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    (void)loop; (void)x; (void)y; (void)width; (void)height;
+    return -1;
+}
+bool inky_loop_is_updating(inky_loop_t *loop) { (void)loop; return false; }
+int inky_loop_dispatch(inky_loop_t *loop, int timeout_ms) { (void)loop; (void)timeout_ms; return -1; }
+int inky_loop_run(inky_loop_t *loop) { (void)loop; return -1; }
+void inky_loop_stop(inky_loop_t *loop) { (void)loop; }
+
+#endif
@@ -0,0 +1,206 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Panel palette and RGB lookup table
+//
+// The nearest panel color to an RGB value is the one at the smallest
+// CIELAB distance (sRGB, D65). Lab needs a gamma expansion and three cube
+// roots per pixel, so the answer is precomputed for a 32x32x32 grid of
+// cells, each 8x8x8 RGB values: one byte per cell, 32 KB, which stays in
+// L1 cache while an image is quantized.
+//
+// A cell holds the color nearest to its center. Cells whose eight corner
+// values do not all map to that same color straddle a boundary between
+// two colors and are flagged; inky_palette_lookup() ignores the flag and
+// returns the center's color, inky_palette_nearest() resolves flagged
+// cells with the per-pixel Lab search. The index of a color cannot be
+// interpolated between cells, so this is where the exact answer comes from.
+
+#define LUT_BITS   5
+#define LUT_SIZE   (1 << LUT_BITS)
+#define CELL_SIZE  (256 >> LUT_BITS)
+#define LUT_EDGE   0x80      // Cell straddles a boundary between colors
+
+struct inky_palette {
+    uint8_t rgb[INKY_PALETTE_COLORS][3];
+    float lab[INKY_PALETTE_COLORS][3];
+    float linear[256];                     // sRGB value to linear light
+    uint8_t lut[LUT_SIZE * LUT_SIZE * LUT_SIZE];
+};
+
+// Color conversion
+
+static double srgb_to_linear(double v) {
+    v /= 255.0;
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static float lab_f(float t) {
+    return t > 216.0f / 24389 ? cbrtf(t) : (24389.0f / 27 * t + 16) / 116;
+}
+
+// Linear RGB to CIELAB (D65 white)
+static void linear_to_lab(float r, float g, float b, float lab[3]) {
+    float fx = lab_f((0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / 0.95047f);
+    float fy = lab_f(0.2126729f * r + 0.7151522f * g + 0.0721750f * b);
+    float fz = lab_f((0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / 1.08883f);
+    lab[0] = 116 * fy - 16;
+    lab[1] = 500 * (fx - fy);
+    lab[2] = 200 * (fy - fz);
+}
+
+static uint8_t nearest_lab(const inky_palette_t *palette, const float lab[3]) {
+    uint8_t best = 0;
+    float best_dist = INFINITY;
+    for (uint8_t p = 0; p < INKY_PALETTE_COLORS; p++) {
+        float dl = lab[0] - palette->lab[p][0];
+        float da = lab[1] - palette->lab[p][1];
+        float db = lab[2] - palette->lab[p][2];
+        float d = dl * dl + da * da + db * db;
+        if (d < best_dist) {
+            best_dist = d;
+            best = p;
+        }
+    }
+    return best;
+}
+
+static uint8_t nearest_linear(const inky_palette_t *palette, float r, float g, float b) {
+    float lab[3];
+    linear_to_lab(r, g, b, lab);
+    return nearest_lab(palette, lab);
+}
+
+static void build_lut(inky_palette_t *palette) {
+    for (int p = 0; p < INKY_PALETTE_COLORS; p++) {
+        linear_to_lab(palette->linear[palette->rgb[p][0]], palette->linear[palette->rgb[p][1]],
+                      palette->linear[palette->rgb[p][2]], palette->lab[p]);
+    }
+    
+    // Linear light of each cell's center and of its first and last values
+    float center[LUT_SIZE], corner[LUT_SIZE][2];
+    for (int i = 0; i < LUT_SIZE; i++) {
+        center[i] = (float)srgb_to_linear(i * CELL_SIZE + (CELL_SIZE - 1) / 2.0);
+        corner[i][0] = palette->linear[i * CELL_SIZE];
+        corner[i][1] = palette->linear[i * CELL_SIZE + CELL_SIZE - 1];
+    }
+    
+    uint8_t *cell = palette->lut;
+    for (int r = 0; r < LUT_SIZE; r++) {
+        for (int g = 0; g < LUT_SIZE; g++) {
+            for (int b = 0; b < LUT_SIZE; b++, cell++) {
+                uint8_t color = nearest_linear(palette, center[r], center[g], center[b]);
+                *cell = color;
+                for (int k = 0; k < 8 && *cell == color; k++) {
+                    if (nearest_linear(palette, corner[r][k >> 2], corner[g][(k >> 1) & 1],
+                                       corner[b][k & 1]) != color) {
+                        *cell |= LUT_EDGE;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static inline uint8_t lut_entry(const inky_palette_t *palette, uint8_t r, uint8_t g, uint8_t b) {
+    int shift = 8 - LUT_BITS;
+    return palette->lut[(r >> shift) << (2 * LUT_BITS) | (g >> shift) << LUT_BITS | b >> shift];
+}
+
+// Palette objects
+
+inky_palette_t *inky_palette_create(void) {
+    inky_palette_t *palette = malloc(sizeof(inky_palette_t));
+    if (!palette) return NULL;
+    
+    for (int v = 0; v < 256; v++) {
+        palette->linear[v] = (float)srgb_to_linear(v);
+    }
+    memcpy(palette->rgb, inky_palette_rgb, sizeof(palette->rgb));
+    build_lut(palette);
+    return palette;
+}
+
+void inky_palette_destroy(inky_palette_t *palette) {
+    free(palette);
+}
+
+int inky_palette_calibrate(inky_palette_t *palette, const uint8_t rgb[INKY_PALETTE_COLORS][3]) {
+    if (!palette || !rgb) return -1;
+    
+    memcpy(palette->rgb, rgb, sizeof(palette->rgb));
+    build_lut(palette);
+    return 0;
+}
+
+int inky_palette_load(inky_palette_t *palette, const char *filename) {
+    if (!palette || !filename) return -1;
+    
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        perror("Failed to open palette");
+        return -1;
+    }
+    
+    uint8_t rgb[INKY_PALETTE_COLORS][3];
+    int count = 0, line_no = 0;
+    char line[256];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        line_no++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        
+        int r, g, b;
+        char extra;
+        int fields = sscanf(line, "%d %d %d %c", &r, &g, &b, &extra);
+        if (fields <= 0) continue;  // Blank or comment only
+        if (fields != 3 || r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255 ||
+            count == INKY_PALETTE_COLORS) {
+            fprintf(stderr, "%s:%d: expected \"R G B\" (0-255) for each of %d colors\n",
+                    filename, line_no, INKY_PALETTE_COLORS);
+            ok = false;
+            break;
+        }
+        rgb[count][0] = (uint8_t)r;
+        rgb[count][1] = (uint8_t)g;
+        rgb[count][2] = (uint8_t)b;
+        count++;
+    }
+    fclose(fp);
+    
+    if (ok && count != INKY_PALETTE_COLORS) {
+        fprintf(stderr, "%s: %d colors, expected %d\n", filename, count, INKY_PALETTE_COLORS);
+        ok = false;
+    }
+    return ok ? inky_palette_calibrate(palette, (const uint8_t (*)[3])rgb) : -1;
+}
+
+const uint8_t *inky_palette_get_rgb(const inky_palette_t *palette, uint8_t color) {
+    if (!palette || color >= INKY_PALETTE_COLORS) return NULL;
+    return palette->rgb[color];
+}
+
+uint8_t inky_palette_lookup(const inky_palette_t *palette, uint8_t r, uint8_t g, uint8_t b) {
+    return lut_entry(palette, r, g, b) & ~LUT_EDGE;
+}
+
+uint8_t inky_palette_nearest(const inky_palette_t *palette, uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t entry = lut_entry(palette, r, g, b);
+    if (!(entry & LUT_EDGE)) return entry;
+    return nearest_linear(palette, palette->linear[r], palette->linear[g], palette->linear[b]);
+}
+
+void inky_set_palette(inky_t *display, const inky_palette_t *palette) {
+    if (!display) return;
+    
+    if (palette) {
+        memcpy(display->palette_rgb, palette->rgb, sizeof(palette->rgb));
+        memcpy(display->palette_rgb[INKY_CLEAN], palette->rgb[INKY_WHITE], 3);
+    } else {
+        memcpy(display->palette_rgb, inky_palette_rgb, sizeof(display->palette_rgb));
+    }
+}
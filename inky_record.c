@@ -0,0 +1,390 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// Frame recorder
+//
+// File layout (host byte order, little-endian on every supported target):
+//   rec_file_header_t
+//   frames: rec_frame_header_t + payload, one per update
+//   index:  rec_index_entry_t per frame, then rec_trailer_t (only after a clean stop)
+//
+// A payload is the new frame XORed with the previous one (keyframes: with
+// zeros) and run-length encoded with the buffer codec (inky_codec.c).
+// Unchanged areas XOR to long zero runs, so a small partial update costs a
+// few dozen bytes. Readers without an intact trailer scan the frame chain.
+
+#define REC_FILE_MAGIC   "INKYREC1"
+#define REC_INDEX_MAGIC  "INKYIDX1"
+#define REC_FRAME_MAGIC  0x4d415246  // "FRAM"
+#define REC_FLAG_KEY     0x01
+#define REC_FLAG_PARTIAL 0x02
+#define REC_DEFAULT_KEYFRAME_INTERVAL 64
+
+typedef struct {
+    char magic[8];
+    uint16_t width;
+    uint16_t height;
+    uint32_t buffer_size;
+    uint32_t keyframe_interval;
+    uint32_t reserved;
+    uint64_t start_wall_us;
+} rec_file_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint8_t flags;
+    uint8_t reserved;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint16_t reserved2;
+    uint64_t timestamp_us;
+    uint32_t payload_size;
+    uint32_t reserved3;
+} rec_frame_header_t;
+
+typedef struct {
+    uint64_t offset;
+    rec_frame_header_t header;
+} rec_index_entry_t;
+
+typedef struct {
+    uint64_t index_offset;
+    uint32_t count;
+    uint32_t reserved;
+    char magic[8];
+} rec_trailer_t;
+
+struct inky_recorder {
+    FILE *fp;
+    uint8_t *shown;        // Frame the panel shows now
+    uint8_t *next;         // Frame being recorded
+    uint8_t *encoded;
+    size_t encoded_capacity;
+    uint32_t keyframe_interval;
+    uint64_t start_us;     // Display clock when recording started
+    uint64_t offset;       // End of the last complete frame
+    rec_index_entry_t *index;
+    size_t index_capacity;
+    inky_record_stats_t stats;
+};
+
+struct inky_recording {
+    FILE *fp;
+    rec_file_header_t header;
+    rec_index_entry_t *index;
+    size_t count;
+    uint8_t *payload;
+    size_t payload_capacity;
+};
+
+int inky_record_start(inky_t *display, const char *filename, uint32_t keyframe_interval) {
+    if (!display || !filename) return -1;
+    inky_record_stop(display);
+    
+    inky_recorder_t *rec = calloc(1, sizeof(inky_recorder_t));
+    if (!rec) return -1;
+    
+    rec->encoded_capacity = inky_rle_bound(display->buffer_size);
+    rec->shown = calloc(display->buffer_size, 1);
+    rec->next = malloc(display->buffer_size);
+    rec->encoded = malloc(rec->encoded_capacity);
+    rec->fp = fopen(filename, "wb");
+    if (!rec->shown || !rec->next || !rec->encoded || !rec->fp) {
+        if (!rec->fp) perror("Failed to open recording");
+        if (rec->fp) fclose(rec->fp);
+        free(rec->shown);
+        free(rec->next);
+        free(rec->encoded);
+        free(rec);
+        return -1;
+    }
+    
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    
+    rec_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REC_FILE_MAGIC, 8);
+    header.width = display->width;
+    header.height = display->height;
+    header.buffer_size = (uint32_t)display->buffer_size;
+    header.keyframe_interval = keyframe_interval ? keyframe_interval : REC_DEFAULT_KEYFRAME_INTERVAL;
+    header.start_wall_us = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    
+    fwrite(&header, sizeof(header), 1, rec->fp);
+    fflush(rec->fp);
+    
+    rec->keyframe_interval = header.keyframe_interval;
+    rec->start_us = inky_display_now_us(display);
+    rec->offset = sizeof(header);
+    rec->stats.bytes = sizeof(header);
+    display->recorder = rec;
+    
+    return 0;
+}
+
+// Build the frame the panel shows after this update in rec->next
+static void compose_frame(inky_t *display, inky_recorder_t *rec, inky_update_type_t type,
+                          uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (type == INKY_UPDATE_FULL) {
+        memcpy(rec->next, display->buffer, display->buffer_size);
+        return;
+    }
+    
+    // Partial: only the region changes on the panel
+    memcpy(rec->next, rec->shown, display->buffer_size);
+    for (uint16_t row = y; row < y + height; row++) {
+        size_t first = (size_t)row * display->width + x;
+        size_t last = first + width - 1;
+        
+        size_t b0 = first / 2, b1 = last / 2;
+        if (first & 1) {
+            // Odd first pixel: only the low nibble belongs to the region
+            rec->next[b0] = (rec->next[b0] & 0xF0) | (display->buffer[b0] & 0x0F);
+            b0++;
+        }
+        if (!(last & 1) && b1 >= b0) {
+            // Even last pixel: only the high nibble belongs to the region
+            rec->next[b1] = (rec->next[b1] & 0x0F) | (display->buffer[b1] & 0xF0);
+            if (b1 == 0) continue;
+            b1--;
+        }
+        if (b1 + 1 > b0) {
+            memcpy(rec->next + b0, display->buffer + b0, b1 + 1 - b0);
+        }
+    }
+}
+
+void inky_record_frame(inky_t *display, inky_update_type_t type,
+                       uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    inky_recorder_t *rec = display->recorder;
+    if (!rec) return;
+    
+    INKY_TRACE_BEGIN("record_frame");
+    uint64_t t0 = inky_time_us();
+    
+    compose_frame(display, rec, type, x, y, width, height);
+    bool key = rec->stats.frames % rec->keyframe_interval == 0;
+    
+    rec_frame_header_t fh;
+    memset(&fh, 0, sizeof(fh));
+    fh.magic = REC_FRAME_MAGIC;
+    fh.flags = (key ? REC_FLAG_KEY : 0) | (type == INKY_UPDATE_PARTIAL ? REC_FLAG_PARTIAL : 0);
+    fh.x = x;
+    fh.y = y;
+    fh.width = width;
+    fh.height = height;
+    fh.timestamp_us = inky_display_now_us(display) - rec->start_us;
+    fh.payload_size = (uint32_t)inky_rle_encode(rec->next, key ? NULL : rec->shown,
+                                                display->buffer_size, rec->encoded);
+    
+    // Index grows with the recording; it is only written out on stop
+    if (rec->stats.frames == rec->index_capacity) {
+        size_t capacity = rec->index_capacity ? rec->index_capacity * 2 : 256;
+        rec_index_entry_t *index = realloc(rec->index, capacity * sizeof(rec_index_entry_t));
+        if (!index) {
+            fprintf(stderr, "Recorder: out of memory, frame dropped\n");
+            INKY_TRACE_END("record_frame");
+            return;
+        }
+        rec->index = index;
+        rec->index_capacity = capacity;
+    }
+    
+    if (fwrite(&fh, sizeof(fh), 1, rec->fp) != 1 ||
+        fwrite(rec->encoded, 1, fh.payload_size, rec->fp) != fh.payload_size ||
+        fflush(rec->fp) != 0) {
+        fprintf(stderr, "Recorder: write failed, frame dropped\n");
+        fseek(rec->fp, (long)rec->offset, SEEK_SET);
+        INKY_TRACE_END("record_frame");
+        return;
+    }
+    
+    rec->index[rec->stats.frames].offset = rec->offset;
+    rec->index[rec->stats.frames].header = fh;
+    rec->offset += sizeof(fh) + fh.payload_size;
+    
+    uint8_t *tmp = rec->shown;
+    rec->shown = rec->next;
+    rec->next = tmp;
+    
+    uint64_t elapsed = inky_time_us() - t0;
+    rec->stats.frames++;
+    rec->stats.keyframes += key;
+    rec->stats.bytes = rec->offset;
+    rec->stats.total_us += elapsed;
+    if (elapsed > rec->stats.max_us) rec->stats.max_us = elapsed;
+    INKY_TRACE_END("record_frame");
+}
+
+void inky_record_stop(inky_t *display) {
+    if (!display || !display->recorder) return;
+    inky_recorder_t *rec = display->recorder;
+    
+    // Seek index and trailer let readers skip the frame scan
+    rec_trailer_t trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.index_offset = rec->offset;
+    trailer.count = (uint32_t)rec->stats.frames;
+    memcpy(trailer.magic, REC_INDEX_MAGIC, 8);
+    
+    fwrite(rec->index, sizeof(rec_index_entry_t), rec->stats.frames, rec->fp);
+    fwrite(&trailer, sizeof(trailer), 1, rec->fp);
+    fclose(rec->fp);
+    
+    free(rec->shown);
+    free(rec->next);
+    free(rec->encoded);
+    free(rec->index);
+    free(rec);
+    display->recorder = NULL;
+}
+
+int inky_record_get_stats(inky_t *display, inky_record_stats_t *stats) {
+    if (!display || !stats || !display->recorder) return -1;
+    *stats = display->recorder->stats;
+    return 0;
+}
+
+// Rebuild the index of a file without a trailer by walking the frames
+static bool scan_frames(inky_recording_t *r) {
+    size_t capacity = 0;
+    uint64_t offset = sizeof(rec_file_header_t);
+    rec_frame_header_t fh;
+    
+    fseek(r->fp, (long)offset, SEEK_SET);
+    while (fread(&fh, sizeof(fh), 1, r->fp) == 1 && fh.magic == REC_FRAME_MAGIC) {
+        // A frame cut short by a crash ends the recording
+        if (fseek(r->fp, fh.payload_size, SEEK_CUR) != 0) break;
+        long end = ftell(r->fp);
+        fseek(r->fp, 0, SEEK_END);
+        if (end < 0 || end > ftell(r->fp)) break;
+        fseek(r->fp, end, SEEK_SET);
+        
+        if (r->count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            rec_index_entry_t *index = realloc(r->index, capacity * sizeof(rec_index_entry_t));
+            if (!index) return false;
+            r->index = index;
+        }
+        r->index[r->count].offset = offset;
+        r->index[r->count].header = fh;
+        r->count++;
+        offset = (uint64_t)end;
+    }
+    return true;
+}
+
+static bool load_index(inky_recording_t *r) {
+    rec_trailer_t trailer;
+    if (fseek(r->fp, -(long)sizeof(trailer), SEEK_END) != 0 ||
+        fread(&trailer, sizeof(trailer), 1, r->fp) != 1 ||
+        memcmp(trailer.magic, REC_INDEX_MAGIC, 8) != 0) {
+        return false;
+    }
+    
+    r->index = malloc((trailer.count ? trailer.count : 1) * sizeof(rec_index_entry_t));
+    if (!r->index) return false;
+    
+    fseek(r->fp, (long)trailer.index_offset, SEEK_SET);
+    if (fread(r->index, sizeof(rec_index_entry_t), trailer.count, r->fp) != trailer.count) {
+        free(r->index);
+        r->index = NULL;
+        return false;
+    }
+    r->count = trailer.count;
+    return true;
+}
+
+inky_recording_t *inky_recording_open(const char *filename) {
+    if (!filename) return NULL;
+    
+    inky_recording_t *r = calloc(1, sizeof(inky_recording_t));
+    if (!r) return NULL;
+    
+    r->fp = fopen(filename, "rb");
+    if (!r->fp || fread(&r->header, sizeof(r->header), 1, r->fp) != 1 ||
+        memcmp(r->header.magic, REC_FILE_MAGIC, 8) != 0 || r->header.keyframe_interval == 0) {
+        fprintf(stderr, "Not an Inky recording: %s\n", filename);
+        inky_recording_close(r);
+        return NULL;
+    }
+    
+    if (!load_index(r) && !scan_frames(r)) {
+        inky_recording_close(r);
+        return NULL;
+    }
+    
+    return r;
+}
+
+void inky_recording_close(inky_recording_t *recording) {
+    if (!recording) return;
+    if (recording->fp) fclose(recording->fp);
+    free(recording->index);
+    free(recording->payload);
+    free(recording);
+}
+
+size_t inky_recording_frame_count(inky_recording_t *recording) {
+    return recording ? recording->count : 0;
+}
+
+uint64_t inky_recording_start_time_us(inky_recording_t *recording) {
+    return recording ? recording->header.start_wall_us : 0;
+}
+
+int inky_recording_frame_info(inky_recording_t *recording, size_t index, inky_record_frame_t *info) {
+    if (!recording || !info || index >= recording->count) return -1;
+    
+    const rec_frame_header_t *fh = &recording->index[index].header;
+    info->timestamp_us = fh->timestamp_us;
+    info->type = (fh->flags & REC_FLAG_PARTIAL) ? INKY_UPDATE_PARTIAL : INKY_UPDATE_FULL;
+    info->x = fh->x;
+    info->y = fh->y;
+    info->width = fh->width;
+    info->height = fh->height;
+    info->keyframe = (fh->flags & REC_FLAG_KEY) != 0;
+    info->encoded_size = (uint32_t)sizeof(rec_frame_header_t) + fh->payload_size;
+    return 0;
+}
+
+int inky_recording_seek(inky_recording_t *recording, size_t index, inky_t *display) {
+    if (!recording || !display || index >= recording->count) return -1;
+    if (display->buffer_size != recording->header.buffer_size) return -1;
+    
+    // Start from the closest keyframe at or before index
+    size_t start = index;
+    while (start > 0 && !(recording->index[start].header.flags & REC_FLAG_KEY)) start--;
+    if (!(recording->index[start].header.flags & REC_FLAG_KEY)) return -1;
+    
+    for (size_t i = start; i <= index; i++) {
+        const rec_index_entry_t *entry = &recording->index[i];
+        size_t size = entry->header.payload_size;
+        
+        if (size > recording->payload_capacity) {
+            uint8_t *payload = realloc(recording->payload, size);
+            if (!payload) return -1;
+            recording->payload = payload;
+            recording->payload_capacity = size;
+        }
+        
+        fseek(recording->fp, (long)(entry->offset + sizeof(rec_frame_header_t)), SEEK_SET);
+        if (fread(recording->payload, 1, size, recording->fp) != size) return -1;
+        
+        if (i == start) {
+            memset(display->buffer, 0, display->buffer_size);
+        }
+        if (!inky_rle_decode(recording->payload, size, display->buffer, display->buffer_size, true)) {
+            fprintf(stderr, "Recording: frame %zu is corrupt\n", i);
+            return -1;
+        }
+    }
+    
+    return 0;
+}
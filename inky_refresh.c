@@ -0,0 +1,116 @@
+#include "inky_internal.h"
+#include <string.h>
+
+// Refresh duration model
+//
+// Observed DRF durations are kept per update type and per temperature band as
+// an exponentially weighted mean and mean deviation. The busy wait uses the
+// prediction to sleep through most of the refresh before polling BUSY, and to
+// pick a timeout that is much tighter than the 40 second worst case.
+
+#define EWMA_SHIFT 2            // New samples weigh 1/4
+#define PRESLEEP_PERCENT 85     // Share of the confident prediction to sleep through
+#define TIMEOUT_MARGIN_MS 2000  // Minimum slack on top of the prediction
+
+// Defaults before anything has been observed
+static const uint32_t default_refresh_ms[INKY_UPDATE_TYPES] = {
+    32000,  // INKY_UPDATE_FULL - 15-32 seconds depending on content
+    4000    // INKY_UPDATE_PARTIAL - 2-4 seconds
+};
+
+void inky_refresh_model_init(inky_refresh_model_t *model) {
+    memset(model, 0, sizeof(*model));
+}
+
+// Band 0 is below 0C, then 5C bands up to 40C, then everything hotter.
+// Unknown temperature gets its own band so it never pollutes the others.
+int inky_refresh_temp_band(int temperature) {
+    if (temperature == INKY_TEMP_UNKNOWN) return INKY_TEMP_BANDS;
+    if (temperature < 0) return 0;
+    int band = 1 + temperature / 5;
+    return band >= INKY_TEMP_BANDS ? INKY_TEMP_BANDS - 1 : band;
+}
+
+// The temperature's own band, or else the nearest known band that has been
+// observed (never the unknown band); *exact says which
+static const inky_refresh_cell_t *find_cell(const inky_refresh_model_t *model,
+                                            inky_update_type_t type, int temperature, bool *exact) {
+    int band = inky_refresh_temp_band(temperature);
+    const inky_refresh_cell_t *row = model->cells[type];
+    
+    *exact = row[band].samples > 0;
+    if (*exact) {
+        return &row[band];
+    }
+    
+    for (int distance = 1; distance <= INKY_TEMP_BANDS; distance++) {
+        if (band - distance >= 0 && row[band - distance].samples > 0) {
+            return &row[band - distance];
+        }
+        if (band + distance < INKY_TEMP_BANDS && row[band + distance].samples > 0) {
+            return &row[band + distance];
+        }
+    }
+    
+    return NULL;
+}
+
+uint32_t inky_refresh_predict_ms(const inky_refresh_model_t *model,
+                                 inky_update_type_t type, int temperature) {
+    bool exact;
+    const inky_refresh_cell_t *cell = find_cell(model, type, temperature, &exact);
+    return cell ? cell->mean_ms : default_refresh_ms[type];
+}
+
+void inky_refresh_plan(const inky_refresh_model_t *model, inky_update_type_t type,
+                       int temperature, inky_refresh_plan_t *plan) {
+    bool exact;
+    const inky_refresh_cell_t *cell = find_cell(model, type, temperature, &exact);
+    
+    // Another band's refresh time says little about this one's worst case
+    // (cold refreshes run much longer), so a borrowed prediction is only a
+    // prediction: no blind sleep and the full timeout
+    if (!cell || !exact) {
+        plan->predicted_ms = cell ? cell->mean_ms : default_refresh_ms[type];
+        plan->presleep_ms = 0;
+        plan->timeout_ms = INKY_BUSY_TIMEOUT_MS;
+        return;
+    }
+    
+    plan->predicted_ms = cell->mean_ms;
+    
+    // Only sleep blind once the band has settled and the spread is known
+    uint32_t spread = 2 * cell->dev_ms;
+    if (cell->samples >= INKY_REFRESH_MIN_SAMPLES && cell->mean_ms > spread) {
+        plan->presleep_ms = (cell->mean_ms - spread) * PRESLEEP_PERCENT / 100;
+    } else {
+        plan->presleep_ms = 0;
+    }
+    
+    uint32_t margin = 4 * cell->dev_ms + cell->mean_ms / 4;
+    if (margin < TIMEOUT_MARGIN_MS) margin = TIMEOUT_MARGIN_MS;
+    plan->timeout_ms = cell->mean_ms + margin;
+    if (cell->samples < INKY_REFRESH_MIN_SAMPLES || plan->timeout_ms > INKY_BUSY_TIMEOUT_MS) {
+        plan->timeout_ms = INKY_BUSY_TIMEOUT_MS;
+    }
+}
+
+void inky_refresh_record(inky_refresh_model_t *model, inky_update_type_t type,
+                         int temperature, uint32_t duration_ms) {
+    inky_refresh_cell_t *cell = &model->cells[type][inky_refresh_temp_band(temperature)];
+    
+    if (cell->samples == 0) {
+        cell->mean_ms = duration_ms;
+        cell->dev_ms = duration_ms / 10;
+    } else {
+        int32_t error = (int32_t)duration_ms - (int32_t)cell->mean_ms;
+        uint32_t abs_error = error < 0 ? (uint32_t)-error : (uint32_t)error;
+        cell->mean_ms = (uint32_t)((int32_t)cell->mean_ms + error / (1 << EWMA_SHIFT));
+        cell->dev_ms = (uint32_t)((int32_t)cell->dev_ms +
+                                  ((int32_t)abs_error - (int32_t)cell->dev_ms) / (1 << EWMA_SHIFT));
+    }
+    
+    if (cell->samples < UINT32_MAX) {
+        cell->samples++;
+    }
+}
@@ -0,0 +1,360 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Streaming image resampler
+//
+// Separable: every source row that some panel row needs is filtered
+// horizontally as it is pushed and kept in a ring of filtered rows; a panel
+// row is produced from the ring by the vertical filter as soon as its last
+// source row has arrived and handed to the row callback, so memory is one
+// source row plus as many filtered rows as the vertical filter has taps,
+// whatever the image size.
+//
+// Pixels are carried as four floats (R, G, B, unused) so that one SIMD
+// multiply-add applies a filter tap to a whole pixel horizontally, and four
+// channels at a time vertically.
+//
+// Coordinates: source pixel k covers [k, k + 1). Output pixel i of an axis
+// samples around src_offset + (i + 0.5) / scale; when shrinking, the
+// bilinear and Lanczos kernels are widened by 1 / scale so every source
+// pixel contributes, and the box filter averages exactly the footprint of
+// the output pixel.
+
+#define LANCZOS_LOBES 3
+
+typedef struct {
+    uint32_t dst_offset;     // Margin before the image on the panel
+    uint32_t dst_len;        // Image pixels on the panel along this axis
+    uint32_t src_len;
+    double scale;            // Output pixels per source pixel
+    double src_offset;       // Source coordinate of the first output pixel's edge
+    
+    // Filter taps of each output pixel: first source pixel and weights
+    uint32_t *first;
+    uint16_t *count;
+    float *weights;          // dst_len * max_taps
+    uint16_t max_taps;
+} resample_axis_t;
+
+struct inky_resampler {
+    resample_axis_t h, v;
+    uint32_t panel_width, panel_height;
+    inky_resample_row_callback_t callback;
+    void *user_data;
+    
+    float *src_row;          // Pushed row as four floats per pixel
+    float *ring;             // v.max_taps horizontally filtered rows
+    float *vert;             // One vertically filtered row
+    float *out;              // One panel row, three floats per pixel
+    uint32_t rows_pushed;
+    uint32_t rows_emitted;   // Panel rows handed to the callback
+};
+
+// Kernels
+
+static double sinc(double x) {
+    if (x == 0) return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double kernel(inky_filter_t filter, double x) {
+    x = fabs(x);
+    if (filter == INKY_FILTER_BILINEAR) {
+        return x < 1 ? 1 - x : 0;
+    }
+    return x < LANCZOS_LOBES ? sinc(x) * sinc(x / LANCZOS_LOBES) : 0;
+}
+
+static bool axis_build(resample_axis_t *axis, inky_filter_t filter) {
+    double footprint = 1.0 / axis->scale;           // Source pixels per output pixel
+    double widen = footprint > 1 ? footprint : 1;
+    double radius = filter == INKY_FILTER_BOX ? footprint / 2
+                  : (filter == INKY_FILTER_BILINEAR ? 1 : LANCZOS_LOBES) * widen;
+    uint32_t bound = (uint32_t)ceil(2 * radius) + 2;
+    if (bound > UINT16_MAX) return false;
+    
+    axis->first = malloc(axis->dst_len * sizeof(uint32_t));
+    axis->count = malloc(axis->dst_len * sizeof(uint16_t));
+    axis->weights = malloc((size_t)axis->dst_len * bound * sizeof(float));
+    if (!axis->first || !axis->count || !axis->weights) return false;
+    
+    axis->max_taps = 1;
+    for (uint32_t i = 0; i < axis->dst_len; i++) {
+        double center = axis->src_offset + (i + 0.5) * footprint;
+        int64_t lo = (int64_t)floor(center - radius);
+        int64_t hi = (int64_t)ceil(center + radius);
+        if (lo < 0) lo = 0;
+        if (hi > (int64_t)axis->src_len) hi = axis->src_len;
+        
+        float *w = axis->weights + (size_t)i * bound;
+        double sum = 0;
+        int64_t first = -1, last = -1;
+        for (int64_t k = lo; k < hi && k - lo < bound; k++) {
+            double weight;
+            if (filter == INKY_FILTER_BOX) {
+                // Overlap of the footprint with pixel k
+                double a = center - radius > k ? center - radius : k;
+                double b = center + radius < k + 1 ? center + radius : k + 1;
+                weight = b > a ? b - a : 0;
+            } else {
+                weight = kernel(filter, (k + 0.5 - center) / widen);
+                if (fabs(weight) < 1e-9) weight = 0;  // Zero crossings on whole pixels
+            }
+            if (weight == 0 && first < 0) continue;  // Leading zero taps
+            if (first < 0) first = k;
+            w[k - first] = (float)weight;
+            if (weight != 0) last = k;
+            sum += weight;
+        }
+        
+        if (first < 0 || sum == 0) {
+            // Footprint missed every source pixel: nearest one
+            int64_t k = (int64_t)floor(center);
+            if (k < 0) k = 0;
+            if (k >= (int64_t)axis->src_len) k = axis->src_len - 1;
+            first = last = k;
+            w[0] = 1;
+            sum = 1;
+        }
+        axis->first[i] = (uint32_t)first;
+        axis->count[i] = (uint16_t)(last - first + 1);
+        for (uint16_t t = 0; t < axis->count[i]; t++) {
+            w[t] = (float)(w[t] / sum);
+        }
+        if (axis->count[i] > axis->max_taps) axis->max_taps = axis->count[i];
+    }
+    
+    // Pack the weights to the widest filter actually seen
+    for (uint32_t i = 1; i < axis->dst_len; i++) {
+        memmove(axis->weights + (size_t)i * axis->max_taps, axis->weights + (size_t)i * bound,
+                axis->count[i] * sizeof(float));
+    }
+    return true;
+}
+
+static void axis_free(resample_axis_t *axis) {
+    free(axis->first);
+    free(axis->count);
+    free(axis->weights);
+}
+
+// Place the image along one axis of the panel
+static void axis_layout(resample_axis_t *axis, uint32_t src_len, uint32_t panel_len,
+                        inky_scale_mode_t mode, double uniform) {
+    axis->src_len = src_len;
+    axis->dst_offset = 0;
+    axis->src_offset = 0;
+    
+    switch (mode) {
+    case INKY_SCALE_STRETCH:
+        axis->dst_len = panel_len;
+        break;
+    case INKY_SCALE_FIT: {
+        uint32_t len = (uint32_t)(src_len * uniform + 0.5);
+        axis->dst_len = len < 1 ? 1 : len > panel_len ? panel_len : len;
+        axis->dst_offset = (panel_len - axis->dst_len) / 2;
+        break;
+    }
+    case INKY_SCALE_FILL:
+        axis->dst_len = panel_len;
+        axis->scale = uniform;
+        axis->src_offset = (src_len - panel_len / uniform) / 2;
+        return;
+    case INKY_SCALE_CROP:
+        // 1:1, centered; whole pixels so nothing is interpolated
+        axis->dst_len = src_len < panel_len ? src_len : panel_len;
+        axis->dst_offset = (panel_len - axis->dst_len) / 2;
+        axis->src_offset = (src_len - axis->dst_len) / 2;
+        axis->scale = 1;
+        return;
+    }
+    axis->scale = (double)axis->dst_len / src_len;
+}
+
+inky_resampler_t *inky_resampler_create(inky_t *display, uint32_t src_width, uint32_t src_height,
+                                        inky_filter_t filter, inky_scale_mode_t mode,
+                                        inky_resample_row_callback_t callback, void *user_data) {
+    if (!display || !callback || src_width == 0 || src_height == 0 ||
+        src_width > INKY_RESAMPLE_MAX_SOURCE || src_height > INKY_RESAMPLE_MAX_SOURCE) {
+        return NULL;
+    }
+    
+    inky_resampler_t *r = calloc(1, sizeof(inky_resampler_t));
+    if (!r) return NULL;
+    r->panel_width = inky_get_width(display);
+    r->panel_height = inky_get_height(display);
+    r->callback = callback;
+    r->user_data = user_data;
+    
+    double sx = (double)r->panel_width / src_width, sy = (double)r->panel_height / src_height;
+    double uniform = mode == INKY_SCALE_FILL ? (sx > sy ? sx : sy) : (sx < sy ? sx : sy);
+    axis_layout(&r->h, src_width, r->panel_width, mode, uniform);
+    axis_layout(&r->v, src_height, r->panel_height, mode, uniform);
+    
+    if (!axis_build(&r->h, filter) || !axis_build(&r->v, filter) ||
+        !(r->src_row = malloc((size_t)src_width * 4 * sizeof(float))) ||
+        !(r->ring = malloc((size_t)r->v.max_taps * r->h.dst_len * 4 * sizeof(float))) ||
+        !(r->vert = malloc((size_t)r->h.dst_len * 4 * sizeof(float))) ||
+        !(r->out = malloc((size_t)r->panel_width * 3 * sizeof(float)))) {
+        fprintf(stderr, "Resampler: out of memory for %ux%u source\n", src_width, src_height);
+        inky_resampler_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+void inky_resampler_destroy(inky_resampler_t *r) {
+    if (!r) return;
+    axis_free(&r->h);
+    axis_free(&r->v);
+    free(r->src_row);
+    free(r->ring);
+    free(r->vert);
+    free(r->out);
+    free(r);
+}
+
+void inky_resampler_get_layout(inky_resampler_t *r, inky_rect_t *image, uint32_t *window_rows) {
+    if (!r) return;
+    if (image) {
+        image->x = (uint16_t)r->h.dst_offset;
+        image->y = (uint16_t)r->v.dst_offset;
+        image->width = (uint16_t)r->h.dst_len;
+        image->height = (uint16_t)r->v.dst_len;
+    }
+    if (window_rows) *window_rows = r->v.max_taps;
+}
+
+// Filter kernels: sum of w[t] * pixel over the taps, four floats at a time
+
+static void filter_row(const resample_axis_t *axis, const float *src, float *dst) {
+    for (uint32_t i = 0; i < axis->dst_len; i++) {
+        const float *w = axis->weights + (size_t)i * axis->max_taps;
+        const float *p = src + (size_t)axis->first[i] * 4;
+        uint16_t n = axis->count[i];
+#if defined(__SSE2__)
+        __m128 acc = _mm_setzero_ps();
+        for (uint16_t t = 0; t < n; t++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[t]), _mm_loadu_ps(p + t * 4)));
+        }
+        _mm_storeu_ps(dst + i * 4, acc);
+#elif defined(__ARM_NEON)
+        float32x4_t acc = vdupq_n_f32(0);
+        for (uint16_t t = 0; t < n; t++) {
+            acc = vmlaq_n_f32(acc, vld1q_f32(p + t * 4), w[t]);
+        }
+        vst1q_f32(dst + i * 4, acc);
+#else
+        float acc[4] = {0, 0, 0, 0};
+        for (uint16_t t = 0; t < n; t++) {
+            for (int c = 0; c < 4; c++) acc[c] += w[t] * p[t * 4 + c];
+        }
+        memcpy(dst + i * 4, acc, sizeof(acc));
+#endif
+    }
+}
+
+// dst = w * src (first) or dst += w * src over n floats (a multiple of 4)
+static void scale_add(float *dst, const float *src, float w, size_t n, bool first) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128 wv = _mm_set1_ps(w);
+    for (; i < n; i += 4) {
+        __m128 v = _mm_mul_ps(wv, _mm_loadu_ps(src + i));
+        _mm_storeu_ps(dst + i, first ? v : _mm_add_ps(v, _mm_loadu_ps(dst + i)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i < n; i += 4) {
+        float32x4_t v = vmulq_n_f32(vld1q_f32(src + i), w);
+        vst1q_f32(dst + i, first ? v : vaddq_f32(v, vld1q_f32(dst + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = first ? w * src[i] : dst[i] + w * src[i];
+    }
+}
+
+// Hand panel row y to the callback: margins white, image clamped to 0..255
+static void emit_row(inky_resampler_t *r, uint32_t y, bool image) {
+    float *out = r->out;
+    uint32_t x0 = r->h.dst_offset, x1 = x0 + r->h.dst_len;
+    for (uint32_t x = 0; x < r->panel_width; x++) {
+        if (!image || x < x0 || x >= x1) {
+            out[x * 3] = out[x * 3 + 1] = out[x * 3 + 2] = 255;
+            continue;
+        }
+        const float *p = r->vert + (size_t)(x - x0) * 4;
+        for (int c = 0; c < 3; c++) {
+            float v = p[c];
+            out[x * 3 + c] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+    }
+    r->callback(y, out, r->user_data);
+    r->rows_emitted++;
+}
+
+// Emit every panel row whose source rows have all arrived
+static void emit_ready(inky_resampler_t *r) {
+    size_t floats = (size_t)r->h.dst_len * 4;
+    while (r->rows_emitted < r->panel_height) {
+        uint32_t y = r->rows_emitted;
+        if (y < r->v.dst_offset || y >= r->v.dst_offset + r->v.dst_len) {
+            // Margin: above the image at once, below it after the image's last row
+            emit_row(r, y, false);
+            continue;
+        }
+        
+        uint32_t j = y - r->v.dst_offset;
+        uint32_t first = r->v.first[j];
+        uint16_t n = r->v.count[j];
+        if (first + n > r->rows_pushed) break;
+        
+        const float *w = r->v.weights + (size_t)j * r->v.max_taps;
+        for (uint16_t t = 0; t < n; t++) {
+            const float *row = r->ring + (size_t)((first + t) % r->v.max_taps) * floats;
+            scale_add(r->vert, row, w[t], floats, t == 0);
+        }
+        emit_row(r, y, true);
+    }
+}
+
+int inky_resampler_push_row(inky_resampler_t *r, const uint8_t *rgb) {
+    if (!r || !rgb || r->rows_pushed >= r->v.src_len) return -1;
+    
+    // Only rows some panel row reads are filtered
+    uint32_t k = r->rows_pushed;
+    uint32_t needed_from = r->v.first[0];
+    uint32_t needed_to = r->v.first[r->v.dst_len - 1] + r->v.count[r->v.dst_len - 1];
+    if (k >= needed_from && k < needed_to) {
+        // Only the columns the horizontal filter reads are expanded
+        uint32_t lo = r->h.first[0];
+        uint32_t hi = r->h.first[r->h.dst_len - 1] + r->h.count[r->h.dst_len - 1];
+        for (uint32_t x = lo; x < hi; x++) {
+            r->src_row[x * 4] = rgb[x * 3];
+            r->src_row[x * 4 + 1] = rgb[x * 3 + 1];
+            r->src_row[x * 4 + 2] = rgb[x * 3 + 2];
+            r->src_row[x * 4 + 3] = 0;
+        }
+        filter_row(&r->h, r->src_row, r->ring + (size_t)(k % r->v.max_taps) * r->h.dst_len * 4);
+    }
+    r->rows_pushed++;
+    
+    emit_ready(r);
+    return 0;
+}
+
+int inky_resampler_finish(inky_resampler_t *r) {
+    if (!r) return -1;
+    emit_ready(r);
+    return r->rows_emitted == r->panel_height ? 0 : -1;
+}
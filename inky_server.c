@@ -0,0 +1,408 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+// Display server
+//
+// Runs inside an event loop: the listening socket and every client are loop
+// fds. A SUBMIT's memfd is checked for seals and size, mapped read-only and
+// its rectangle copied into `next`, the frame the panel is to show next;
+// the dirty area since the last update grows to cover it. Whenever the
+// panel is idle and something is dirty, `next` becomes the display buffer
+// and one update covers every request made since the last one started.
+//
+// Each client only needs to know how far its requests have got, so per
+// client two sequence numbers stand for its requests in the next update
+// and in the update on the panel now; when an update completes, every
+// client with requests in it gets one DONE for the latest of them.
+
+#ifdef __linux__
+
+#define MAX_FDS_PER_MESSAGE 4   // Extra fds are accepted only to be closed
+
+typedef struct {
+    inky_server_t *server;
+    int fd;                     // -1 = free slot
+    uint32_t pending_seq;       // Latest request merged into `next` (0 = none)
+    uint32_t inflight_seq;      // Latest request in the update in progress
+} server_client_t;
+
+struct inky_server {
+    inky_loop_t *loop;
+    inky_t *display;
+    int listen_fd;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    server_client_t clients[INKY_SERVER_MAX_CLIENTS];
+    
+    // Next frame, and what changed in it since the last update started
+    uint8_t *next;
+    bool dirty;
+    bool dirty_full;
+    uint16_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
+    bool updating;
+    
+    inky_loop_update_callback_t update_callback;
+    void *update_user_data;
+    inky_server_stats_t stats;
+};
+
+static void server_send(server_client_t *client, uint16_t type, uint32_t seq, int32_t status, uint32_t flags);
+static void server_start_update(inky_server_t *server);
+
+// Copy pixels [x, x + width) of rows [y, y + height) between two buffers
+// in display->buffer layout
+static void copy_rect(const inky_t *display, uint8_t *dst, const uint8_t *src,
+                      uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    for (uint32_t row = y; row < (uint32_t)y + height; row++) {
+        size_t p0 = (size_t)row * display->width + x, p1 = p0 + width;
+        if (p0 & 1) {
+            // Odd first pixel: low nibble
+            dst[p0 / 2] = (dst[p0 / 2] & 0xF0) | (src[p0 / 2] & 0x0F);
+            p0++;
+        }
+        if (p1 & 1) {
+            // Odd end: the last pixel is even, high nibble
+            dst[p1 / 2] = (dst[p1 / 2] & 0x0F) | (src[p1 / 2] & 0xF0);
+            p1--;
+        }
+        if (p1 > p0) memcpy(dst + p0 / 2, src + p0 / 2, (p1 - p0) / 2);
+    }
+}
+
+static void server_drop(server_client_t *client) {
+    if (client->fd < 0) return;
+    
+    inky_loop_remove_fd(client->server->loop, client->fd);
+    close(client->fd);
+    client->fd = -1;
+    client->pending_seq = client->inflight_seq = 0;
+    client->server->stats.clients--;
+}
+
+static void server_send(server_client_t *client, uint16_t type, uint32_t seq, int32_t status, uint32_t flags) {
+    inky_t *display = client->server->display;
+    inky_msg_t msg = {
+        .magic = INKY_SERVER_MAGIC, .version = INKY_SERVER_VERSION, .type = type,
+        .seq = seq, .status = status, .flags = flags, .width = display->width, .height = display->height
+    };
+    
+    // Answers are tiny; a client that lets its queue fill up is not reading them
+    if (send(client->fd, &msg, sizeof(msg), MSG_DONTWAIT | MSG_NOSIGNAL) != sizeof(msg)) {
+        server_drop(client);
+    }
+}
+
+static void server_merge(inky_server_t *server, bool full, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (full) {
+        server->dirty_full = true;
+    } else if (!server->dirty) {
+        server->dirty_x0 = x;
+        server->dirty_y0 = y;
+        server->dirty_x1 = x + width;
+        server->dirty_y1 = y + height;
+    } else {
+        if (x < server->dirty_x0) server->dirty_x0 = x;
+        if (y < server->dirty_y0) server->dirty_y0 = y;
+        if (x + width > server->dirty_x1) server->dirty_x1 = x + width;
+        if (y + height > server->dirty_y1) server->dirty_y1 = y + height;
+    }
+    server->dirty = true;
+}
+
+// Validate a SUBMIT and copy its pixels into the next frame; 0 or -errno
+static int server_accept_pixels(inky_server_t *server, const inky_msg_t *msg, int fd) {
+    inky_t *display = server->display;
+    bool full = msg->flags & INKY_MSG_FULL;
+    uint16_t x = 0, y = 0, width = display->width, height = display->height;
+    if (!full) {
+        x = msg->x;
+        y = msg->y;
+        width = msg->width;
+        height = msg->height;
+        if (width == 0 || height == 0 || (uint32_t)x + width > display->width ||
+            (uint32_t)y + height > display->height) {
+            return -EINVAL;
+        }
+    }
+    
+    // Sealed, so the pixels cannot change or vanish while they are read
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & INKY_SERVER_SEALS) != INKY_SERVER_SEALS) return -EPERM;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < display->buffer_size) return -EMSGSIZE;
+    
+    const uint8_t *pixels = mmap(NULL, display->buffer_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (pixels == MAP_FAILED) return -errno;
+    copy_rect(display, server->next, pixels, x, y, width, height);
+    munmap((void *)pixels, display->buffer_size);
+    
+    server_merge(server, full, x, y, width, height);
+    return 0;
+}
+
+static void server_client_ready(inky_loop_t *loop, int fd, uint32_t events, void *user_data) {
+    (void)loop;
+    (void)fd;
+    (void)events;
+    server_client_t *client = user_data;
+    inky_server_t *server = client->server;
+    
+    inky_msg_t msg;
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * MAX_FDS_PER_MESSAGE)];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {&msg, sizeof(msg)};
+    struct msghdr hdr = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = control.buf, .msg_controllen = sizeof(control.buf)
+    };
+    ssize_t n = recvmsg(client->fd, &hdr, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    if (n <= 0) {
+        server_drop(client);  // Closed or broken
+        return;
+    }
+    
+    // Take ownership of every fd that came with the message
+    int fds[MAX_FDS_PER_MESSAGE], fd_count = 0;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&hdr); c; c = CMSG_NXTHDR(&hdr, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        int count = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < count && fd_count < MAX_FDS_PER_MESSAGE; i++) {
+            memcpy(&fds[fd_count++], CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+        }
+    }
+    
+    bool valid = n == sizeof(msg) && !(hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) &&
+                 msg.magic == INKY_SERVER_MAGIC && msg.version == INKY_SERVER_VERSION &&
+                 msg.type == INKY_MSG_SUBMIT && msg.seq != 0;
+    int status = -EBADF;
+    if (valid && fd_count == 1) {
+        status = server_accept_pixels(server, &msg, fds[0]);
+    }
+    for (int i = 0; i < fd_count; i++) {
+        close(fds[i]);
+    }
+    
+    if (!valid) {
+        // Not speaking the protocol
+        server_drop(client);
+        return;
+    }
+    if (status < 0) {
+        server->stats.rejected++;
+        server_send(client, INKY_MSG_DONE, msg.seq, status, INKY_MSG_REJECTED);
+        return;
+    }
+    
+    server->stats.requests++;
+    client->pending_seq = msg.seq;
+    if (!server->updating) server_start_update(server);
+}
+
+static void server_accept(inky_loop_t *loop, int fd, uint32_t events, void *user_data) {
+    (void)events;
+    inky_server_t *server = user_data;
+    
+    int conn = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (conn < 0) return;
+    
+    server_client_t *client = NULL;
+    for (int i = 0; i < INKY_SERVER_MAX_CLIENTS && !client; i++) {
+        if (server->clients[i].fd < 0) client = &server->clients[i];
+    }
+    if (!client || inky_loop_add_fd(loop, conn, EPOLLIN, server_client_ready, client) < 0) {
+        close(conn);  // Full: the client sees the connection close
+        return;
+    }
+    
+    client->fd = conn;
+    client->pending_seq = client->inflight_seq = 0;
+    server->stats.clients++;
+    server->stats.connections++;
+    server_send(client, INKY_MSG_HELLO, 0, 0, 0);
+}
+
+// Answer everyone whose requests were in the update that just finished
+static void server_complete(inky_server_t *server, int32_t status) {
+    for (int i = 0; i < INKY_SERVER_MAX_CLIENTS; i++) {
+        server_client_t *client = &server->clients[i];
+        if (client->fd >= 0 && client->inflight_seq) {
+            uint32_t seq = client->inflight_seq;
+            client->inflight_seq = 0;
+            server_send(client, INKY_MSG_DONE, seq, status, 0);
+        }
+    }
+}
+
+static void server_update_done(inky_loop_t *loop, inky_t *display, void *user_data) {
+    inky_server_t *server = user_data;
+    server->updating = false;
+    server->stats.updates++;
+    server_complete(server, 0);
+    if (server->update_callback) {
+        server->update_callback(loop, display, server->update_user_data);
+    }
+    if (server->dirty) server_start_update(server);
+}
+
+static void server_start_update(inky_server_t *server) {
+    inky_t *display = server->display;
+    bool full = server->dirty_full;
+    uint16_t x = server->dirty_x0, y = server->dirty_y0;
+    uint16_t width = server->dirty_x1 - x, height = server->dirty_y1 - y;
+    
+    // Everything outside the dirty area already matches the display buffer
+    memcpy(display->buffer, server->next, display->buffer_size);
+    server->dirty = server->dirty_full = false;
+    for (int i = 0; i < INKY_SERVER_MAX_CLIENTS; i++) {
+        server_client_t *client = &server->clients[i];
+        if (client->pending_seq) {
+            client->inflight_seq = client->pending_seq;
+            client->pending_seq = 0;
+        }
+    }
+    
+    // Completion runs server_update_done(), inside this call if the
+    // update needs no refresh time (emulator without a clock)
+    server->updating = true;
+    int started = full ? inky_loop_update(server->loop) : inky_loop_update_region(server->loop, x, y, width, height);
+    if (started < 0) {
+        server->updating = false;
+        server_complete(server, -EIO);
+    } else if (started == 0 && !inky_loop_is_updating(server->loop)) {
+        // Nothing to send: the panel already shows these pixels
+        server->updating = false;
+        server->stats.unchanged++;
+        server_complete(server, 0);
+    }
+}
+
+// Bind, replacing a socket file nobody is listening on any more
+static int server_listen(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Failed to create server socket");
+        return -1;
+    }
+    int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if (bound < 0 && errno == EADDRINUSE) {
+        int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) {
+            fprintf(stderr, "Another display server is listening on %s\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+        bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+    if (bound < 0 || listen(fd, INKY_SERVER_MAX_CLIENTS) < 0) {
+        perror("Failed to listen on server socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inky_server_t *inky_server_create(inky_loop_t *loop, inky_t *display, const char *path) {
+    if (!loop || !display) return NULL;
+    if (!path) path = INKY_SERVER_SOCKET;
+    
+    inky_server_t *server = calloc(1, sizeof(inky_server_t));
+    if (!server) return NULL;
+    server->loop = loop;
+    server->display = display;
+    snprintf(server->path, sizeof(server->path), "%s", path);
+    for (int i = 0; i < INKY_SERVER_MAX_CLIENTS; i++) {
+        server->clients[i].server = server;
+        server->clients[i].fd = -1;
+    }
+    
+    // Clients draw over what the display holds now
+    server->next = malloc(display->buffer_size);
+    if (!server->next) {
+        free(server);
+        return NULL;
+    }
+    memcpy(server->next, display->buffer, display->buffer_size);
+    
+    server->listen_fd = server_listen(path);
+    if (server->listen_fd < 0 ||
+        inky_loop_add_fd(loop, server->listen_fd, EPOLLIN, server_accept, server) < 0) {
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+            unlink(path);
+        }
+        free(server->next);
+        free(server);
+        return NULL;
+    }
+    
+    inky_loop_set_update_callback(loop, server_update_done, server);
+    return server;
+}
+
+void inky_server_destroy(inky_server_t *server) {
+    if (!server) return;
+    
+    for (int i = 0; i < INKY_SERVER_MAX_CLIENTS; i++) {
+        server_drop(&server->clients[i]);
+    }
+    inky_loop_set_update_callback(server->loop, NULL, NULL);
+    inky_loop_remove_fd(server->loop, server->listen_fd);
+    close(server->listen_fd);
+    unlink(server->path);
+    free(server->next);
+    free(server);
+}
+
+void inky_server_set_update_callback(inky_server_t *server, inky_loop_update_callback_t callback,
+                                     void *user_data) {
+    if (!server) return;
+    server->update_callback = callback;
+    server->update_user_data = user_data;
+}
+
+void inky_server_get_stats(inky_server_t *server, inky_server_stats_t *stats) {
+    if (!server || !stats) return;
+    *stats = server->stats;
+}
+
+#else
+
+// The display server needs Unix sockets, memfd sealing and the event loop
+inky_server_t *inky_server_create(inky_loop_t *loop, inky_t *display, const char *path) {
+    (void)loop; (void)display; (void)path;
+    fprintf(stderr, "Display server not supported on this platform\n");
+    return NULL;
+}
+void inky_server_destroy(inky_server_t *server) { (void)server; }
+void inky_server_set_update_callback(inky_server_t *server, inky_loop_update_callback_t callback,
+                                     void *user_data) {
+    (void)server; (void)callback; (void)user_data;
+}
+void inky_server_get_stats(inky_server_t *server, inky_server_stats_t *stats) { (void)server; (void)stats; }
+
+#endif
@@ -0,0 +1,494 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// 2D primitives
+//
+// Every shape is reduced to horizontal runs of one color and every run goes
+// through inky_clip_span(), the only place coordinates are checked against
+// the clip rectangle. Runs are written into the packed buffer by
+// inky_fill_span(): half-bytes at the ends, one memset for the bytes in
+// between. The public functions clip to the panel; the draw list uses the
+// same code with a tile as the clip.
+
+#define POLY_STACK_EDGES 16
+#define SHAPE_MAX_RADIUS 32767   // Keeps the ellipse test within 64 bits
+
+static inline inky_clip_t panel_clip(const inky_t *display) {
+    inky_clip_t clip = {0, 0, display->width, display->height};
+    return clip;
+}
+
+static inline uint8_t get_nibble(const inky_t *display, int x, int y) {
+    size_t p = (size_t)y * display->width + x;
+    uint8_t byte = display->buffer[p / 2];
+    return (p & 1) ? byte & 0x0F : byte >> 4;
+}
+
+// Spans
+
+// Pixels [x0, x1) of row y, already clipped
+void inky_fill_span(inky_t *display, uint16_t y, uint16_t x0, uint16_t x1, uint8_t color) {
+    if (x0 >= x1) return;
+    
+    uint8_t *buffer = display->buffer;
+    size_t p0 = (size_t)y * display->width + x0;
+    size_t p1 = (size_t)y * display->width + x1;
+    color &= 0x0F;
+    
+    if (p0 & 1) {
+        buffer[p0 / 2] = (buffer[p0 / 2] & 0xF0) | color;
+        p0++;
+    }
+    if ((p1 & 1) && p1 > p0) {
+        buffer[p1 / 2] = (buffer[p1 / 2] & 0x0F) | (uint8_t)(color << 4);
+        p1--;
+    }
+    if (p1 > p0) {
+        memset(buffer + p0 / 2, (color << 4) | color, (p1 - p0) / 2);
+    }
+}
+
+void inky_clip_span(inky_t *display, const inky_clip_t *clip, int y, int x0, int x1, uint8_t color) {
+    if (y < clip->y0 || y >= clip->y1) return;
+    if (x0 < clip->x0) x0 = clip->x0;
+    if (x1 > clip->x1) x1 = clip->x1;
+    if (x0 < x1) {
+        inky_fill_span(display, (uint16_t)y, (uint16_t)x0, (uint16_t)x1, color);
+    }
+}
+
+// Lines
+
+// Integer line where the minor coordinate at each major step is
+// round((t * d_minor) / d_major) from the first endpoint, so any clip can
+// start mid-line and still produce exactly the pixels of the whole line.
+// X-major lines come out as horizontal runs.
+void inky_raster_line(inky_t *display, const inky_clip_t *clip, int x0, int y0, int x1, int y1, uint8_t color) {
+    int dx = abs(x1 - x0), dy = abs(y1 - y0);
+    bool x_major = dx >= dy;
+    
+    // Walk the major axis upwards
+    if ((x_major && x0 > x1) || (!x_major && y0 > y1)) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    
+    int major0 = x_major ? x0 : y0, major1 = x_major ? x1 : y1;
+    int minor0 = x_major ? y0 : x0;
+    int step = x_major ? (y1 >= y0 ? 1 : -1) : (x1 >= x0 ? 1 : -1);
+    int d_major = x_major ? dx : dy, d_minor = x_major ? dy : dx;
+    int clip_lo = x_major ? clip->x0 : clip->y0, clip_hi = x_major ? clip->x1 : clip->y1;
+    
+    int start = major0 > clip_lo ? major0 : clip_lo;
+    int end = major1 < clip_hi - 1 ? major1 : clip_hi - 1;
+    if (start > end) return;
+    
+    // Minor offset and remainder at `start`
+    int64_t den = 2 * (int64_t)(d_major ? d_major : 1);
+    int64_t num = (int64_t)(start - major0) * 2 * d_minor + d_major;
+    int minor = minor0 + step * (int)(num / den);
+    int64_t rem = num % den;
+    
+    int run_start = start;
+    for (int major = start; major <= end; major++) {
+        bool last = major == end;
+        int next_minor = minor;
+        if (!last) {
+            rem += 2 * (int64_t)d_minor;
+            if (rem >= den) {
+                rem -= den;
+                next_minor += step;
+            }
+        }
+        
+        if (!x_major) {
+            inky_clip_span(display, clip, major, minor, minor + 1, color);
+        } else if (last || next_minor != minor) {
+            // Emit the run when y is about to change
+            inky_clip_span(display, clip, minor, run_start, major + 1, color);
+            run_start = major + 1;
+        }
+        minor = next_minor;
+    }
+}
+
+void inky_draw_line(inky_t *display, int x0, int y0, int x1, int y1, uint8_t color) {
+    if (!display || !display->buffer) return;
+    inky_clip_t clip = panel_clip(display);
+    inky_raster_line(display, &clip, x0, y0, x1, y1, color);
+}
+
+// Rectangles
+
+void inky_fill_rect(inky_t *display, int x, int y, int width, int height, uint8_t color) {
+    if (!display || !display->buffer || width <= 0 || height <= 0) return;
+    inky_clip_t clip = panel_clip(display);
+    
+    int y0 = y > clip.y0 ? y : clip.y0;
+    int y1 = y + height < clip.y1 ? y + height : clip.y1;
+    for (int row = y0; row < y1; row++) {
+        inky_clip_span(display, &clip, row, x, x + width, color);
+    }
+}
+
+void inky_draw_rect(inky_t *display, int x, int y, int width, int height, uint8_t color) {
+    if (!display || !display->buffer || width <= 0 || height <= 0) return;
+    inky_clip_t clip = panel_clip(display);
+    
+    inky_clip_span(display, &clip, y, x, x + width, color);
+    if (height > 1) {
+        inky_clip_span(display, &clip, y + height - 1, x, x + width, color);
+    }
+    int y0 = y + 1 > clip.y0 ? y + 1 : clip.y0;
+    int y1 = y + height - 1 < clip.y1 ? y + height - 1 : clip.y1;
+    for (int row = y0; row < y1; row++) {
+        inky_clip_span(display, &clip, row, x, x + 1, color);
+        inky_clip_span(display, &clip, row, x + width - 1, x + width, color);
+    }
+}
+
+// Circles and ellipses
+//
+// A pixel at offset (x, y) from the center is inside when
+//   x^2 / (rx^2 + rx) + y^2 / (ry^2 + ry) <= 1
+// (the (r + 1/2)^2 boundary, rounded to integers), so a radius of r spans
+// exactly 2r + 1 pixels on each axis and a zero radius degenerates to a line
+// or a single pixel. The half-width of each row is found by stepping x down
+// as y grows, O(rx + ry) in all.
+
+typedef struct {
+    int64_t a, b, ab;     // rx^2 + rx, ry^2 + ry, their product
+    int ry;
+    int x;                // Half-width of the last row asked for
+} ellipse_rows_t;
+
+static void ellipse_rows_init(ellipse_rows_t *rows, int rx, int ry) {
+    rows->a = (int64_t)rx * rx + rx;
+    rows->b = (int64_t)ry * ry + ry;
+    rows->ab = rows->a * rows->b;
+    rows->ry = ry;
+    rows->x = rx;
+}
+
+// Half-width of row y (y ascending from 0 between calls), -1 past the edge
+static int ellipse_row(ellipse_rows_t *rows, int y) {
+    if (y > rows->ry) return -1;
+    int64_t yy = (int64_t)y * y * rows->a;
+    while (rows->x > 0 && (int64_t)rows->x * rows->x * rows->b + yy > rows->ab) {
+        rows->x--;
+    }
+    return rows->x;
+}
+
+static void raster_ellipse(inky_t *display, const inky_clip_t *clip, int cx, int cy,
+                           int rx, int ry, bool fill, uint8_t color) {
+    ellipse_rows_t rows;
+    ellipse_rows_init(&rows, rx, ry);
+    
+    // Rows the clip can see, as offsets from the center
+    int top = cy - clip->y0, bottom = clip->y1 - 1 - cy;
+    int nearest = top < 0 ? -top : bottom < 0 ? -bottom : 0;
+    int farthest = top > bottom ? top : bottom;
+    if (farthest > ry) farthest = ry;
+    
+    int w = ellipse_row(&rows, 0);
+    int w_next = ellipse_row(&rows, 1);
+    int w_prev = w_next;  // Row -1 mirrors row 1
+    for (int y = 0; y <= farthest; y++) {
+        if (y >= nearest) {
+            if (fill) {
+                inky_clip_span(display, clip, cy + y, cx - w, cx + w + 1, color);
+                if (y > 0) inky_clip_span(display, clip, cy - y, cx - w, cx + w + 1, color);
+            } else {
+                // Outline: pixels with a 4-neighbour outside the shape
+                int inner = w - 1;
+                if (w_prev < inner) inner = w_prev;
+                if (w_next < inner) inner = w_next;
+                for (int side = 0; side < (y > 0 ? 2 : 1); side++) {
+                    int row = side ? cy - y : cy + y;
+                    if (inner < 0) {
+                        inky_clip_span(display, clip, row, cx - w, cx + w + 1, color);
+                    } else {
+                        inky_clip_span(display, clip, row, cx - w, cx - inner, color);
+                        inky_clip_span(display, clip, row, cx + inner + 1, cx + w + 1, color);
+                    }
+                }
+            }
+        }
+        w_prev = w;
+        w = w_next;
+        w_next = ellipse_row(&rows, y + 2);
+    }
+}
+
+void inky_draw_ellipse(inky_t *display, int cx, int cy, int rx, int ry, uint8_t color) {
+    if (!display || !display->buffer || rx < 0 || ry < 0 || rx > SHAPE_MAX_RADIUS || ry > SHAPE_MAX_RADIUS) return;
+    inky_clip_t clip = panel_clip(display);
+    raster_ellipse(display, &clip, cx, cy, rx, ry, false, color);
+}
+
+void inky_fill_ellipse(inky_t *display, int cx, int cy, int rx, int ry, uint8_t color) {
+    if (!display || !display->buffer || rx < 0 || ry < 0 || rx > SHAPE_MAX_RADIUS || ry > SHAPE_MAX_RADIUS) return;
+    inky_clip_t clip = panel_clip(display);
+    raster_ellipse(display, &clip, cx, cy, rx, ry, true, color);
+}
+
+void inky_draw_circle(inky_t *display, int cx, int cy, int radius, uint8_t color) {
+    inky_draw_ellipse(display, cx, cy, radius, radius, color);
+}
+
+void inky_fill_circle(inky_t *display, int cx, int cy, int radius, uint8_t color) {
+    inky_fill_ellipse(display, cx, cy, radius, radius, color);
+}
+
+// Polygons
+//
+// Scanline fill with an active edge list. Each row is sampled at its pixel
+// centers (y + 0.5); edges cover the rows whose centers lie in [top, bottom),
+// and a pixel is filled when its center is at or right of an edge where the
+// winding becomes nonzero and left of the edge where it returns to zero.
+// With vertices on pixel corners, polygons sharing an edge never overlap or
+// leave a gap.
+
+typedef struct {
+    double x0, y0;        // Upper endpoint
+    double dxdy;
+    int row0, row1;       // Rows [row0, row1)
+    int winding;
+} poly_edge_t;
+
+static int compare_edges(const void *a, const void *b) {
+    const poly_edge_t *ea = a, *eb = b;
+    return (ea->row0 > eb->row0) - (ea->row0 < eb->row0);
+}
+
+static inline double edge_x(const poly_edge_t *edge, int row) {
+    return edge->x0 + (row + 0.5 - edge->y0) * edge->dxdy;
+}
+
+// First pixel whose center is at or right of x, kept within a pixel of the clip
+static inline int span_edge(double x, const inky_clip_t *clip) {
+    if (x < clip->x0 - 1) return clip->x0 - 1;
+    if (x > clip->x1 + 1) return clip->x1 + 1;
+    return (int)ceil(x - 0.5);
+}
+
+// xy: count vertex pairs, closed implicitly
+static int raster_polygon(inky_t *display, const inky_clip_t *clip, const double *xy,
+                          size_t count, uint8_t color) {
+    if (count < 3) return 0;
+    
+    poly_edge_t stack_edges[POLY_STACK_EDGES];
+    poly_edge_t *stack_active[POLY_STACK_EDGES];
+    double stack_xs[POLY_STACK_EDGES];
+    poly_edge_t *edges = stack_edges;
+    poly_edge_t **active = stack_active;
+    double *xs = stack_xs;              // Crossings of the active edges
+    if (count > POLY_STACK_EDGES) {
+        edges = malloc(count * (sizeof(poly_edge_t) + sizeof(poly_edge_t *) + sizeof(double)));
+        if (!edges) {
+            fprintf(stderr, "Polygon fill: out of memory (%zu vertices)\n", count);
+            return -1;
+        }
+        xs = (double *)(edges + count);
+        active = (poly_edge_t **)(xs + count);
+    }
+    
+    // Edges that cross at least one visible row center; horizontal edges
+    // never do
+    size_t n = 0;
+    int first_row = clip->y1, last_row = clip->y0;
+    for (size_t i = 0; i < count; i++) {
+        double ax = xy[2 * i], ay = xy[2 * i + 1];
+        double bx = xy[2 * ((i + 1) % count)], by = xy[2 * ((i + 1) % count) + 1];
+        int winding = 1;
+        if (ay > by) {
+            double t = ax; ax = bx; bx = t;
+            t = ay; ay = by; by = t;
+            winding = -1;
+        }
+        
+        double row0 = ceil(ay - 0.5), row1 = ceil(by - 0.5);
+        if (row0 < clip->y0) row0 = clip->y0;
+        if (row1 > clip->y1) row1 = clip->y1;
+        if (row0 >= row1) continue;
+        
+        poly_edge_t *edge = &edges[n];
+        edge->row0 = (int)row0;
+        edge->row1 = (int)row1;
+        edge->x0 = ax;
+        edge->y0 = ay;
+        edge->dxdy = (bx - ax) / (by - ay);
+        edge->winding = winding;
+        if (edge->row0 < first_row) first_row = edge->row0;
+        if (edge->row1 > last_row) last_row = edge->row1;
+        n++;
+    }
+    qsort(edges, n, sizeof(poly_edge_t), compare_edges);
+    
+    size_t next = 0, active_count = 0;
+    for (int row = first_row; row < last_row; row++) {
+        // Retire finished edges, admit starting ones
+        size_t kept = 0;
+        for (size_t i = 0; i < active_count; i++) {
+            if (active[i]->row1 > row) active[kept++] = active[i];
+        }
+        active_count = kept;
+        while (next < n && edges[next].row0 <= row) {
+            if (edges[next].row1 > row) active[active_count++] = &edges[next];
+            next++;
+        }
+        
+        // Insertion sort by crossing: the order barely changes between rows
+        for (size_t i = 0; i < active_count; i++) {
+            poly_edge_t *edge = active[i];
+            double x = edge_x(edge, row);
+            size_t j = i;
+            while (j > 0 && xs[j - 1] > x) {
+                xs[j] = xs[j - 1];
+                active[j] = active[j - 1];
+                j--;
+            }
+            xs[j] = x;
+            active[j] = edge;
+        }
+        
+        int winding = 0;
+        double span_start = 0;
+        for (size_t i = 0; i < active_count; i++) {
+            int before = winding;
+            winding += active[i]->winding;
+            if (before == 0 && winding != 0) {
+                span_start = xs[i];
+            } else if (before != 0 && winding == 0) {
+                inky_clip_span(display, clip, row, span_edge(span_start, clip), span_edge(xs[i], clip), color);
+            }
+        }
+    }
+    
+    if (edges != stack_edges) free(edges);
+    return 0;
+}
+
+int inky_fill_polygon(inky_t *display, const inky_point_t *points, size_t count, uint8_t color) {
+    if (!display || !display->buffer || !points) return -1;
+    if (count < 3) return 0;
+    
+    double stack_xy[2 * POLY_STACK_EDGES];
+    double *xy = count > POLY_STACK_EDGES ? malloc(count * 2 * sizeof(double)) : stack_xy;
+    if (!xy) {
+        fprintf(stderr, "Polygon fill: out of memory (%zu vertices)\n", count);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        xy[2 * i] = points[i].x;
+        xy[2 * i + 1] = points[i].y;
+    }
+    
+    inky_clip_t clip = panel_clip(display);
+    int result = raster_polygon(display, &clip, xy, count, color);
+    if (xy != stack_xy) free(xy);
+    return result;
+}
+
+// A quadrilateral around the line through the endpoint pixel centers,
+// extended half a pixel past each end so both endpoints are covered
+void inky_draw_thick_line(inky_t *display, int x0, int y0, int x1, int y1, int width, uint8_t color) {
+    if (!display || !display->buffer || width <= 0) return;
+    if (width == 1) {
+        inky_draw_line(display, x0, y0, x1, y1, color);
+        return;
+    }
+    
+    double dx = (double)x1 - x0, dy = (double)y1 - y0;
+    double length = sqrt(dx * dx + dy * dy);
+    double ux = length > 0 ? dx / length : 1.0, uy = length > 0 ? dy / length : 0.0;
+    double half = width / 2.0;
+    double nx = -uy * half, ny = ux * half;   // Across the line
+    double ex = ux * 0.5, ey = uy * 0.5;      // Along it, past each end
+    if (length == 0) {
+        ex = half;                            // A single point: a square
+    }
+    
+    double ax = x0 + 0.5 - ex, ay = y0 + 0.5 - ey;
+    double bx = x1 + 0.5 + ex, by = y1 + 0.5 + ey;
+    double quad[8] = {
+        ax + nx, ay + ny,
+        bx + nx, by + ny,
+        bx - nx, by - ny,
+        ax - nx, ay - ny
+    };
+    inky_clip_t clip = panel_clip(display);
+    raster_polygon(display, &clip, quad, 4, color);
+}
+
+// Flood fill
+//
+// Each seed grows into the whole run of the target color on its row, which
+// is filled as one span; the rows above and below are then scanned under
+// that run and one seed is pushed per run found there.
+
+typedef struct {
+    int x, y;
+} fill_seed_t;
+
+int inky_flood_fill(inky_t *display, int x, int y, uint8_t color) {
+    if (!display || !display->buffer) return -1;
+    inky_clip_t clip = panel_clip(display);
+    if (x < clip.x0 || x >= clip.x1 || y < clip.y0 || y >= clip.y1) return 0;
+    
+    color &= 0x0F;
+    uint8_t target = get_nibble(display, x, y);
+    if (target == color) return 0;
+    
+    size_t capacity = 256, count = 0;
+    fill_seed_t *stack = malloc(capacity * sizeof(fill_seed_t));
+    if (!stack) {
+        fprintf(stderr, "Flood fill: out of memory\n");
+        return -1;
+    }
+    stack[count++] = (fill_seed_t){x, y};
+    
+    int result = 0;
+    while (count > 0) {
+        fill_seed_t seed = stack[--count];
+        if (get_nibble(display, seed.x, seed.y) != target) continue;  // Filled since
+        
+        int left = seed.x, right = seed.x;
+        while (left > clip.x0 && get_nibble(display, left - 1, seed.y) == target) left--;
+        while (right + 1 < clip.x1 && get_nibble(display, right + 1, seed.y) == target) right++;
+        inky_clip_span(display, &clip, seed.y, left, right + 1, color);
+        
+        for (int dir = -1; dir <= 1; dir += 2) {
+            int row = seed.y + dir;
+            if (row < clip.y0 || row >= clip.y1) continue;
+            
+            bool in_run = false;
+            for (int px = left; px <= right; px++) {
+                bool match = get_nibble(display, px, row) == target;
+                if (match && !in_run) {
+                    if (count == capacity) {
+                        fill_seed_t *grown = realloc(stack, capacity * 2 * sizeof(fill_seed_t));
+                        if (!grown) {
+                            fprintf(stderr, "Flood fill: out of memory, region left partly filled\n");
+                            result = -1;
+                            count = 0;
+                            break;
+                        }
+                        stack = grown;
+                        capacity *= 2;
+                    }
+                    stack[count++] = (fill_seed_t){px, row};
+                }
+                in_run = match;
+            }
+            if (result < 0) break;
+        }
+    }
+    
+    free(stack);
+    return result;
+}
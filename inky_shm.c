@@ -0,0 +1,261 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+// Live shared-memory framebuffer
+//
+// Layout: one header page (inky_shm_header_t) followed by height RGB rows.
+// The writer is a seqlock: seq goes odd, changed rows and the dirty rectangle
+// are written, seq goes even and waiters are woken through the futex on seq.
+// Readers copy what they need between inky_shm_read_begin() and
+// inky_shm_read_retry() and start over if seq moved in between.
+// Rows are rendered into a scratch buffer first and only copied into the
+// segment when they differ, so a small partial refresh touches a few rows.
+
+#define SHM_HEADER_SIZE 4096
+
+#ifdef __linux__
+
+static long futex(uint32_t *addr, int op, uint32_t val, const struct timespec *timeout) {
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+int inky_emulator_share(inky_t *display, const char *name) {
+    if (!display || !display->is_emulator) return -1;
+    if (display->shm) return display->shm_fd;
+    
+    size_t stride = (size_t)display->width * 3;
+    size_t size = SHM_HEADER_SIZE + stride * display->height;
+    
+    int fd;
+    if (name) {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    } else {
+        fd = memfd_create("inky-framebuffer", MFD_CLOEXEC);
+    }
+    if (fd < 0) {
+        perror("Failed to create shared framebuffer");
+        return -1;
+    }
+    
+    if (ftruncate(fd, size) < 0) {
+        perror("Failed to size shared framebuffer");
+        close(fd);
+        return -1;
+    }
+    
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    uint8_t *row = malloc(stride);
+    if (map == MAP_FAILED || !row) {
+        perror("Failed to map shared framebuffer");
+        if (map != MAP_FAILED) munmap(map, size);
+        free(row);
+        close(fd);
+        return -1;
+    }
+    
+    inky_shm_header_t *shm = map;
+    shm->width = display->width;
+    shm->height = display->height;
+    shm->stride = (uint32_t)stride;
+    shm->data_offset = SHM_HEADER_SIZE;
+    shm->version = INKY_SHM_VERSION;
+    
+    display->shm_fd = fd;
+    display->shm = shm;
+    display->shm_size = size;
+    display->shm_row = row;
+    snprintf(display->shm_name, sizeof(display->shm_name), "%s", name ? name : "");
+    
+    // The first frame is whatever the display currently shows; magic goes
+    // last so a viewer that checks it never sees a half-built header
+    inky_shm_publish(display, 0, display->height);
+    __atomic_store_n(&shm->magic, INKY_SHM_MAGIC, __ATOMIC_RELEASE);
+    
+    return fd;
+}
+
+void inky_emulator_unshare(inky_t *display) {
+    if (!display || !display->shm) return;
+    
+    munmap(display->shm, display->shm_size);
+    close(display->shm_fd);
+    free(display->shm_row);
+    
+    // Viewers that already mapped the segment keep their mapping
+    if (display->shm_name[0]) {
+        shm_unlink(display->shm_name);
+        display->shm_name[0] = '\0';
+    }
+    
+    display->shm = NULL;
+    display->shm_fd = -1;
+    display->shm_size = 0;
+    display->shm_row = NULL;
+}
+
+void inky_shm_publish(inky_t *display, uint16_t y, uint16_t height) {
+    inky_shm_header_t *shm = display->shm;
+    if (!shm) return;
+    
+    INKY_TRACE_BEGIN("shm_publish");
+    uint8_t *pixels = (uint8_t *)shm + shm->data_offset;
+    uint32_t seq = shm->seq;
+    __atomic_store_n(&shm->seq, seq + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // Odd seq visible before any row or header write
+    
+    // Find the changed span of every row and copy only rows that differ
+    uint32_t x0 = UINT32_MAX, x1 = 0, y0 = UINT32_MAX, y1 = 0;
+    uint32_t rows = 0;
+    for (uint16_t row = y; row < y + height; row++) {
+        uint8_t *dst = pixels + (size_t)row * shm->stride;
+        inky_render_rgb_row(display, row, display->shm_row);
+        if (memcmp(dst, display->shm_row, shm->stride) == 0) continue;
+        
+        uint32_t first = 0, last = shm->width - 1;
+        while (memcmp(dst + first * 3, display->shm_row + first * 3, 3) == 0) first++;
+        while (memcmp(dst + last * 3, display->shm_row + last * 3, 3) == 0) last--;
+        
+        memcpy(dst, display->shm_row, shm->stride);
+        if (first < x0) x0 = first;
+        if (last > x1) x1 = last;
+        if (row < y0) y0 = row;
+        y1 = row;
+        rows++;
+    }
+    
+    shm->dirty_x = rows ? x0 : 0;
+    shm->dirty_y = rows ? y0 : 0;
+    shm->dirty_w = rows ? x1 - x0 + 1 : 0;
+    shm->dirty_h = rows ? y1 - y0 + 1 : 0;
+    shm->rows_written = rows;
+    shm->frame++;
+    shm->timestamp_us = inky_display_now_us(display);
+    
+    __atomic_store_n(&shm->seq, seq + 2, __ATOMIC_RELEASE);
+    futex(&shm->seq, FUTEX_WAKE, INT_MAX, NULL);
+    INKY_TRACE_END("shm_publish");
+}
+
+static const inky_shm_header_t *shm_map_fd(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < SHM_HEADER_SIZE) {
+        return NULL;
+    }
+    
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    
+    const inky_shm_header_t *shm = map;
+    if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != INKY_SHM_MAGIC ||
+        shm->version != INKY_SHM_VERSION ||
+        (size_t)st.st_size < shm->data_offset + (size_t)shm->stride * shm->height) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    
+    return shm;
+}
+
+const inky_shm_header_t *inky_shm_open(const char *name) {
+    if (!name) return NULL;
+    
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    
+    // The mapping stays valid after the descriptor is closed
+    const inky_shm_header_t *shm = shm_map_fd(fd);
+    close(fd);
+    return shm;
+}
+
+const inky_shm_header_t *inky_shm_map(int fd) {
+    return fd < 0 ? NULL : shm_map_fd(fd);
+}
+
+void inky_shm_close(const inky_shm_header_t *shm) {
+    if (!shm) return;
+    munmap((void *)shm, shm->data_offset + (size_t)shm->stride * shm->height);
+}
+
+int64_t inky_shm_wait(const inky_shm_header_t *shm, uint32_t last_seq, int timeout_ms) {
+    if (!shm) return -1;
+    
+    uint64_t deadline = timeout_ms >= 0 ? inky_time_us() + (uint64_t)timeout_ms * 1000 : 0;
+    uint32_t *word = (uint32_t *)&shm->seq;
+    
+    for (;;) {
+        uint32_t seq = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+        if (seq != last_seq && (seq & 1) == 0) {
+            return seq;
+        }
+        
+        struct timespec ts, *timeout = NULL;
+        if (timeout_ms >= 0) {
+            uint64_t now = inky_time_us();
+            if (now >= deadline) return -1;
+            ts.tv_sec = (deadline - now) / 1000000;
+            ts.tv_nsec = ((deadline - now) % 1000000) * 1000;
+            timeout = &ts;
+        }
+        
+        // Sleeps only while seq still holds the value just seen
+        if (futex(word, FUTEX_WAIT, seq, timeout) < 0 && errno != EAGAIN &&
+            errno != EINTR && errno != ETIMEDOUT) {
+            return -1;
+        }
+    }
+}
+
+uint32_t inky_shm_read_begin(const inky_shm_header_t *shm) {
+    uint32_t *word = (uint32_t *)&shm->seq;
+    for (;;) {
+        uint32_t seq = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0) return seq;
+        
+        // A frame is being written: sleep until seq moves on
+        futex(word, FUTEX_WAIT, seq, NULL);
+    }
+}
+
+bool inky_shm_read_retry(const inky_shm_header_t *shm, uint32_t seq) {
+    // Every read of the copy happens before seq is checked again
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&shm->seq, __ATOMIC_RELAXED) != seq;
+}
+
+#else
+
+// Shared framebuffer needs memfd/shm_open and futexes
+int inky_emulator_share(inky_t *display, const char *name) { (void)display; (void)name; return -1; }
+void inky_emulator_unshare(inky_t *display) { (void)display; }
+void inky_shm_publish(inky_t *display, uint16_t y, uint16_t height) { (void)display; (void)y; (void)height; }
+const inky_shm_header_t *inky_shm_open(const char *name) { (void)name; return NULL; }
+const inky_shm_header_t *inky_shm_map(int fd) { (void)fd; return NULL; }
+void inky_shm_close(const inky_shm_header_t *shm) { (void)shm; }
+int64_t inky_shm_wait(const inky_shm_header_t *shm, uint32_t last_seq, int timeout_ms) {
+    (void)shm; (void)last_seq; (void)timeout_ms;
+    return -1;
+}
+uint32_t inky_shm_read_begin(const inky_shm_header_t *shm) { return shm->seq & ~1u; }
+bool inky_shm_read_retry(const inky_shm_header_t *shm, uint32_t seq) { return shm->seq != seq; }
+
+#endif
+
+const uint8_t *inky_shm_pixels(const inky_shm_header_t *shm) {
+    return shm ? (const uint8_t *)shm + shm->data_offset : NULL;
+}
@@ -0,0 +1,81 @@
+#include "inky_internal.h"
+#include <string.h>
+
+// Per-phase latency histograms
+//
+// Buckets are powers of two in microseconds so recording is a clz and a few
+// adds - cheap enough to stay on in production.
+
+static const char *phase_names[INKY_PHASE_COUNT] = {
+    "setup",
+    "window",
+    "transfer",
+    "pon_settle",
+    "refresh_busy",
+    "pof_settle",
+    "extract"
+};
+
+const char *inky_phase_name(inky_phase_t phase) {
+    if ((unsigned)phase >= INKY_PHASE_COUNT) return "unknown";
+    return phase_names[phase];
+}
+
+static int bucket_for(uint32_t us) {
+    if (us < 2) return 0;
+    int bucket = 31 - __builtin_clz(us);
+    return bucket >= INKY_HIST_BUCKETS ? INKY_HIST_BUCKETS - 1 : bucket;
+}
+
+void inky_stats_record(inky_t *display, inky_update_type_t type, inky_phase_t phase, uint64_t duration_us) {
+    inky_histogram_t *hist = &display->stats.phases[type][phase];
+    uint32_t us = duration_us > UINT32_MAX ? UINT32_MAX : (uint32_t)duration_us;
+    
+    if (hist->count == 0 || us < hist->min_us) hist->min_us = us;
+    if (us > hist->max_us) hist->max_us = us;
+    hist->count++;
+    hist->total_us += us;
+    hist->buckets[bucket_for(us)]++;
+}
+
+uint64_t inky_stats_phase_end(inky_t *display, inky_update_type_t type, inky_phase_t phase, uint64_t start_us) {
+    uint64_t now = inky_time_us();
+    inky_stats_record(display, type, phase, now - start_us);
+    return now;
+}
+
+void inky_stats_begin_update(inky_t *display) {
+    memset(&display->stats.last_update, 0, sizeof(display->stats.last_update));
+    display->stats.last_update.submit_us = inky_display_now_us(display);
+}
+
+int inky_get_stats(inky_t *display, inky_stats_t *stats) {
+    if (!display || !stats) return -1;
+    
+    memcpy(stats, &display->stats, sizeof(*stats));
+    return 0;
+}
+
+void inky_reset_stats(inky_t *display) {
+    if (!display) return;
+    memset(&display->stats, 0, sizeof(display->stats));
+}
+
+uint32_t inky_histogram_percentile(const inky_histogram_t *hist, double percentile) {
+    if (!hist || hist->count == 0) return 0;
+    
+    uint64_t target = (uint64_t)(hist->count * percentile / 100.0);
+    if (target >= hist->count) target = hist->count - 1;
+    
+    uint64_t seen = 0;
+    for (int i = 0; i < INKY_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen > target) {
+            // Upper edge of the bucket, clamped to what was actually seen
+            uint32_t upper = i >= 31 ? UINT32_MAX : (2u << i) - 1;
+            return upper > hist->max_us ? hist->max_us : upper;
+        }
+    }
+    
+    return hist->max_us;
+}
@@ -0,0 +1,147 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Chrome trace event sink
+//
+// Events go into a power-of-two ring shared by every thread. A writer claims
+// a slot with one atomic add and publishes it by storing the slot's sequence
+// number last, so the flush can skip slots that are mid-write or have been
+// lapped. Nothing is locked and the ring never allocates after enable.
+
+typedef struct {
+    uint64_t seq;          // Claim index + 1 once the slot is complete
+    uint64_t ts_us;
+    const char *name;      // Must be a string literal or otherwise static
+    int64_t arg;
+    uint32_t tid;
+    char phase;            // 'B', 'E' or 'i'
+    bool has_arg;
+} trace_event_t;
+
+int inky_trace_active = 0;
+
+static trace_event_t *ring = NULL;
+static size_t ring_mask = 0;
+static uint64_t ring_head = 0;     // Next claim index
+static uint64_t ring_flushed = 0;  // Everything below has been written out
+
+static uint32_t current_tid(void) {
+    static __thread uint32_t tid = 0;
+    if (tid == 0) {
+#ifdef SYS_gettid
+        tid = (uint32_t)syscall(SYS_gettid);
+#else
+        tid = (uint32_t)(uintptr_t)&tid;
+#endif
+    }
+    return tid;
+}
+
+int inky_trace_enable(size_t capacity) {
+    if (!ring) {
+        // Round up to a power of two
+        size_t size = 1024;
+        while (size < capacity) size <<= 1;
+        
+        ring = calloc(size, sizeof(trace_event_t));
+        if (!ring) {
+            return -1;
+        }
+        ring_mask = size - 1;
+    }
+    
+    __atomic_store_n(&inky_trace_active, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void inky_trace_disable(void) {
+    __atomic_store_n(&inky_trace_active, 0, __ATOMIC_RELEASE);
+}
+
+void inky_trace_event(char phase, const char *name, bool has_arg, int64_t arg) {
+    if (!ring) return;
+    
+    uint64_t index = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+    trace_event_t *ev = &ring[index & ring_mask];
+    
+    // Unpublish while the slot is rewritten
+    __atomic_store_n(&ev->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    ev->ts_us = inky_time_us();
+    ev->name = name;
+    ev->arg = arg;
+    ev->has_arg = has_arg;
+    ev->tid = current_tid();
+    ev->phase = phase;
+    
+    __atomic_store_n(&ev->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+void inky_trace_begin(const char *name) {
+    if (INKY_TRACING()) inky_trace_event('B', name, false, 0);
+}
+
+void inky_trace_end(const char *name) {
+    if (INKY_TRACING()) inky_trace_event('E', name, false, 0);
+}
+
+void inky_trace_instant(const char *name) {
+    if (INKY_TRACING()) inky_trace_event('i', name, false, 0);
+}
+
+int inky_trace_flush(const char *filename) {
+    if (!filename) return -1;
+    
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        perror("Failed to open trace file");
+        return -1;
+    }
+    
+    int written = 0;
+    int pid = (int)getpid();
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    
+    if (ring) {
+        uint64_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        uint64_t start = ring_flushed;
+        if (head - start > ring_mask + 1) {
+            start = head - (ring_mask + 1);  // Oldest events were overwritten
+        }
+        
+        for (uint64_t index = start; index < head; index++) {
+            trace_event_t *ev = &ring[index & ring_mask];
+            if (__atomic_load_n(&ev->seq, __ATOMIC_ACQUIRE) != index + 1) {
+                continue;  // Still being written or already lapped
+            }
+            
+            trace_event_t copy = *ev;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&ev->seq, __ATOMIC_RELAXED) != index + 1) {
+                continue;  // Overwritten while copying
+            }
+            
+            fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%u",
+                    written ? ",\n" : "", copy.name, copy.phase,
+                    (unsigned long long)copy.ts_us, pid, copy.tid);
+            if (copy.phase == 'i') {
+                fprintf(fp, ",\"s\":\"t\"");
+            }
+            if (copy.has_arg) {
+                fprintf(fp, ",\"args\":{\"value\":%lld}", (long long)copy.arg);
+            }
+            fprintf(fp, "}");
+            written++;
+        }
+        
+        ring_flushed = head;
+    }
+    
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return written;
+}
@@ -0,0 +1,165 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+
+// Display daemon: owns the panel and serves it to other processes
+//
+// Clients use inky_client_connect() and submit frames or regions; see the
+// display server section of inky.h. SIGINT or SIGTERM stops the daemon and
+// removes its socket. In emulator mode the panel can be shared over shared
+// memory (--share, watch it with shm_viewer) or saved after every update
+// (--ppm), and --scale runs updates at the real panel's pace sped up by a
+// factor.
+
+typedef struct {
+    inky_server_t *server;
+    const char *ppm;
+    bool verbose;
+} daemon_t;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--emulator|--hardware] [--socket PATH] [--scale N] [--share NAME] [--ppm FILE] [--verbose]\n", prog_name);
+    printf("Options:\n");
+#ifdef HARDWARE_BUILD
+    printf("  --emulator    Use emulator mode\n");
+    printf("  --hardware    Use hardware mode (default)\n");
+#else
+    printf("  --emulator    Use emulator mode (default)\n");
+    printf("  --hardware    Use hardware mode\n");
+#endif
+    printf("  --socket PATH Listen on PATH (default %s)\n", INKY_SERVER_SOCKET);
+    printf("  --scale N     Emulator: take as long as the panel, N times faster (default: instant)\n");
+    printf("  --share NAME  Emulator: publish frames to shared memory NAME\n");
+    printf("  --ppm FILE    Emulator: save FILE after every update\n");
+    printf("  --verbose     Print server statistics after every update\n");
+    printf("  --help        Show this help message\n");
+}
+
+static void on_updated(inky_loop_t *loop, inky_t *display, void *user_data) {
+    (void)loop;
+    daemon_t *daemon = user_data;
+    
+    if (daemon->ppm) {
+        inky_emulator_save_ppm(display, daemon->ppm);
+    }
+    if (daemon->verbose) {
+        inky_server_stats_t stats;
+        inky_server_get_stats(daemon->server, &stats);
+        printf("Update %llu: %u clients, %llu requests (%llu rejected, %llu unchanged)\n",
+               (unsigned long long)stats.updates, stats.clients, (unsigned long long)stats.requests,
+               (unsigned long long)stats.rejected, (unsigned long long)stats.unchanged);
+        fflush(stdout);
+    }
+}
+
+static void on_signal(inky_loop_t *loop, int fd, uint32_t events, void *user_data) {
+    (void)events; (void)user_data;
+    struct signalfd_siginfo info;
+    if (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        printf("\nReceived signal %u, shutting down\n", info.ssi_signo);
+    }
+    inky_loop_stop(loop);
+}
+
+int main(int argc, char *argv[]) {
+#ifdef HARDWARE_BUILD
+    bool use_emulator = false;
+#else
+    bool use_emulator = true;
+#endif
+    const char *path = INKY_SERVER_SOCKET;
+    const char *share = NULL;
+    double scale = 0;
+    daemon_t daemon = {0};
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emulator") == 0) {
+            use_emulator = true;
+        } else if (strcmp(argv[i], "--hardware") == 0) {
+            use_emulator = false;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--share") == 0 && i + 1 < argc) {
+            share = argv[++i];
+        } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            daemon.ppm = argv[++i];
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            daemon.verbose = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!use_emulator) {
+        daemon.ppm = NULL;
+    }
+    
+    // Signals arrive through the loop so shutdown runs between updates
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    int signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        perror("Failed to create signalfd");
+        return 1;
+    }
+    
+    inky_t *display = inky_init(use_emulator);
+    if (!display) {
+        fprintf(stderr, "Failed to initialize display\n");
+        close(signal_fd);
+        return 1;
+    }
+    
+    inky_clock_t *clock = NULL;
+    if (use_emulator && scale > 0) {
+        clock = inky_clock_create(INKY_CLOCK_SCALED, scale);
+        inky_emulator_set_clock(display, clock);
+    }
+    if (use_emulator && share && inky_emulator_share(display, share) < 0) {
+        fprintf(stderr, "Failed to share display as %s\n", share);
+    }
+    
+    inky_loop_t *loop = inky_loop_create(display, NULL);
+    daemon.server = loop ? inky_server_create(loop, display, path) : NULL;
+    if (!daemon.server) {
+        inky_loop_destroy(loop);
+        inky_destroy(display);
+        inky_clock_destroy(clock);
+        close(signal_fd);
+        return 1;
+    }
+    inky_server_set_update_callback(daemon.server, on_updated, &daemon);
+    inky_loop_add_fd(loop, signal_fd, EPOLLIN, on_signal, &daemon);
+    
+    printf("Serving %ux%u %s panel on %s\n", inky_get_width(display), inky_get_height(display),
+           use_emulator ? "emulated" : "hardware", path);
+    fflush(stdout);
+    inky_loop_run(loop);
+    
+    inky_server_stats_t stats;
+    inky_server_get_stats(daemon.server, &stats);
+    printf("%llu connections, %llu requests, %llu rejected, %llu updates\n",
+           (unsigned long long)stats.connections, (unsigned long long)stats.requests,
+           (unsigned long long)stats.rejected, (unsigned long long)stats.updates);
+    
+    inky_server_destroy(daemon.server);
+    inky_loop_destroy(loop);
+    inky_destroy(display);
+    inky_clock_destroy(clock);
+    close(signal_fd);
+    return 0;
+}
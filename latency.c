@@ -0,0 +1,413 @@
+/*
+ * End-to-end interaction latency: button press to pixels on the glass
+ * Runs against the emulator backend on a virtual clock.
+ */
+
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+// Each run presses a button on the emulated buttons and lets an event loop
+// handle it like an application would: the handler draws a counter and
+// submits a partial update (button A) or a full update (button C). Host
+// stages are measured on CLOCK_MONOTONIC; panel stages come from the
+// update's timeline on the display clock, where the emulator models the
+// SPI transfer, settle delays and refresh. The virtual clock does not move
+// while host code runs, so the two add up to the press-to-glass time.
+//
+// Display-clock stages are deterministic and gated against --baseline on
+// any machine; host stages depend on the CPU, so they are only reported
+// there and gated against a baseline from the same machine
+// (--host-baseline).
+
+#define COUNTER_X   40
+#define COUNTER_Y   200
+#define COUNTER_W   520
+#define COUNTER_H   48
+
+#define MIN_REGRESSION_US 100  // Smaller changes are noise, whatever the percentage
+
+enum {
+    STAGE_DISPATCH,   // Press injected -> handler entered
+    STAGE_DRAW,       // Handler's drawing calls
+    STAGE_SUBMIT,     // inky_loop_update_region() / inky_loop_update() call
+    STAGE_TRANSFER,   // Submitted -> pixel data sent (display clock)
+    STAGE_REFRESH,    // Sent -> BUSY released, including the power-on settle
+    STAGE_POWER_OFF,  // BUSY released -> update complete
+    STAGE_TOTAL,
+    STAGE_COUNT
+};
+
+static const char *stage_names[STAGE_COUNT] = {
+    "dispatch", "draw", "submit", "transfer", "refresh", "power_off", "total"
+};
+
+enum { KIND_PARTIAL, KIND_FULL, KIND_COUNT };
+static const char *kind_names[KIND_COUNT] = { "partial", "full" };
+
+typedef struct {
+    char name[32];
+    int runs;
+    double median_us;
+    double p90_us;
+    double p99_us;
+    double max_us;
+    bool host;              // Measured on CLOCK_MONOTONIC, machine-dependent
+} result_t;
+
+typedef struct {
+    inky_t *display;
+    inky_buttons_t *buttons;
+    int presses;
+    uint64_t inject_us;     // CLOCK_MONOTONIC
+    double host_us[3];      // Dispatch, draw, submit of the run in progress
+    bool submitted;
+    bool updated;
+} harness_t;
+
+static int compare_double(const void *a, const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double *sorted, int count, double pct) {
+    int index = (int)(pct / 100.0 * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// The emulator reports every update; keep it out of the results
+static int redirect_stdout(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    fflush(stdout);
+    if (saved >= 0) {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+static void draw_counter(harness_t *h) {
+    for (int y = COUNTER_Y; y < COUNTER_Y + COUNTER_H; y++) {
+        for (int x = COUNTER_X; x < COUNTER_X + COUNTER_W; x++) {
+            int bar = (x - COUNTER_X) / 20;
+            bool filled = bar < h->presses % 26 && (x - COUNTER_X) % 20 < 14 &&
+                          y >= COUNTER_Y + 8 && y < COUNTER_Y + COUNTER_H - 8;
+            inky_set_pixel(h->display, x, y, filled ? (bar % 2 ? INKY_BLUE : INKY_GREEN) : INKY_WHITE);
+        }
+    }
+}
+
+static void on_button(inky_loop_t *loop, const inky_button_event_t *event, void *user_data) {
+    harness_t *h = user_data;
+    if (event->type != INKY_BUTTON_EVENT_PRESS) return;
+    
+    uint64_t entered = now_us();
+    h->presses++;
+    draw_counter(h);
+    uint64_t drawn = now_us();
+    if (event->button == INKY_BUTTON_C) {
+        inky_loop_update(loop);
+    } else {
+        inky_loop_update_region(loop, COUNTER_X, COUNTER_Y, COUNTER_W, COUNTER_H);
+    }
+    uint64_t submitted = now_us();
+    
+    h->host_us[STAGE_DISPATCH] = (double)(entered - h->inject_us);
+    h->host_us[STAGE_DRAW] = (double)(drawn - entered);
+    h->host_us[STAGE_SUBMIT] = (double)(submitted - drawn);
+    h->submitted = true;
+}
+
+static void on_updated(inky_loop_t *loop, inky_t *display, void *user_data) {
+    (void)loop; (void)display;
+    harness_t *h = user_data;
+    h->updated = true;
+}
+
+// One press through to the glass; fills stage durations in microseconds
+static bool run_once(inky_loop_t *loop, harness_t *h, bool full, double *stages) {
+    h->submitted = h->updated = false;
+    h->inject_us = now_us();
+    int button = full ? INKY_BUTTON_C : INKY_BUTTON_A;
+    inky_buttons_emulate_press(h->buttons, button);
+    inky_buttons_emulate_release(h->buttons, button);
+    
+    // The first dispatch delivers the press; the update then runs to the end
+    do {
+        if (inky_loop_dispatch(loop, -1) < 0) return false;
+    } while (!h->updated && inky_loop_is_updating(loop));
+    if (!h->submitted || !h->updated) {
+        return false;
+    }
+    
+    inky_stats_t stats;
+    inky_get_stats(h->display, &stats);
+    const inky_update_timeline_t *t = &stats.last_update;
+    stages[STAGE_DISPATCH] = h->host_us[STAGE_DISPATCH];
+    stages[STAGE_DRAW] = h->host_us[STAGE_DRAW];
+    stages[STAGE_SUBMIT] = h->host_us[STAGE_SUBMIT];
+    stages[STAGE_TRANSFER] = (double)(t->transfer_us - t->submit_us);
+    stages[STAGE_REFRESH] = (double)(t->busy_us - t->transfer_us);
+    stages[STAGE_POWER_OFF] = (double)(t->complete_us - t->busy_us);
+    stages[STAGE_TOTAL] = 0;
+    for (int s = 0; s < STAGE_TOTAL; s++) {
+        stages[STAGE_TOTAL] += stages[s];
+    }
+    return true;
+}
+
+// JSON output and baseline comparison
+
+static int write_json(const char *filename, const result_t *results, int count) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        perror("Failed to open JSON output");
+        return -1;
+    }
+    
+    fprintf(fp, "{\n  \"stages\": [\n");
+    for (int i = 0; i < count; i++) {
+        const result_t *r = &results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"runs\": %d, \"median_us\": %.1f, \"p90_us\": %.1f, "
+                    "\"p99_us\": %.1f, \"max_us\": %.1f}%s\n",
+                r->name, r->runs, r->median_us, r->p90_us, r->p99_us, r->max_us,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    
+    fclose(fp);
+    return 0;
+}
+
+// Find "median_us" for a named stage in a file written by write_json()
+static bool baseline_median(const char *json, const char *name, double *median) {
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%.64s\"", name);
+    
+    const char *entry = strstr(json, key);
+    if (!entry) return false;
+    
+    const char *field = strstr(entry, "\"median_us\":");
+    const char *end = strchr(entry, '}');
+    if (!field || (end && field > end)) return false;
+    
+    *median = strtod(field + strlen("\"median_us\":"), NULL);
+    return true;
+}
+
+static char *read_file(const char *filename) {
+    FILE *fp = fopen(filename, "r");
+    if (!fp) return NULL;
+    
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    char *data = malloc(size + 1);
+    if (data) {
+        size_t got = fread(data, 1, size, fp);
+        data[got] = '\0';
+    }
+    fclose(fp);
+    return data;
+}
+
+// Returns the number of gated stages slower than the baseline by more than
+// threshold percent (and MIN_REGRESSION_US). Host stages are gated only
+// with gate_host, display-clock stages only without it.
+static int compare_baseline(const char *filename, const result_t *results, int count, double threshold,
+                            bool gate_host) {
+    char *json = read_file(filename);
+    if (!json) {
+        fprintf(stderr, "No baseline at %s - skipping comparison\n", filename);
+        return 0;
+    }
+    
+    int regressions = 0;
+    printf("\nComparison against %s (threshold %.0f%%)\n", filename, threshold);
+    for (int i = 0; i < count; i++) {
+        double base;
+        if (!baseline_median(json, results[i].name, &base)) {
+            printf("  %-18s   (not in baseline)\n", results[i].name);
+            continue;
+        }
+        
+        double delta = results[i].median_us - base;
+        double change = base > 0 ? delta / base * 100.0 : 0;
+        bool gated = results[i].host == gate_host;
+        bool regressed = gated && change > threshold && delta > MIN_REGRESSION_US;
+        printf("  %-18s %+7.1f%% %+12.1fus%s\n", results[i].name, change, delta,
+               regressed ? "  REGRESSION" : gated ? "" : "  (not gated)");
+        regressions += regressed;
+    }
+    
+    free(json);
+    return regressions;
+}
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [options]\n", prog_name);
+    printf("Options:\n");
+    printf("  --runs N          Presses per update type (default: 200)\n");
+    printf("  --warmup N        Untimed presses first (default: 5)\n");
+    printf("  --json FILE       Write results as JSON\n");
+    printf("  --baseline FILE   Compare medians against a previous JSON run (display-clock stages fail)\n");
+    printf("  --host-baseline FILE  Compare host stages against a run on this machine and fail on them\n");
+    printf("  --threshold PCT   Allowed slowdown before failing (default: 25)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int runs = 200;
+    int warmup = 5;
+    const char *json_file = NULL;
+    const char *baseline_file = NULL;
+    const char *host_baseline_file = NULL;
+    double threshold = 25.0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_file = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "--host-baseline") == 0 && i + 1 < argc) {
+            host_baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (runs < 1) runs = 1;
+    if (warmup < 0) warmup = 0;
+    
+    harness_t h;
+    memset(&h, 0, sizeof(h));
+    inky_clock_t *clock = inky_clock_create(INKY_CLOCK_VIRTUAL, 1);
+    h.display = inky_init(true);
+    inky_button_config_t config;
+    inky_button_config_default(&config);
+    config.emulator = true;
+    h.buttons = inky_buttons_open(&config);
+    inky_loop_t *loop = NULL;
+    if (clock && h.display && h.buttons) {
+        inky_emulator_set_clock(h.display, clock);
+        inky_buttons_set_clock(h.buttons, clock);
+        loop = inky_loop_create(h.display, h.buttons);
+    }
+    if (!loop) {
+        fprintf(stderr, "Failed to set up the emulated display, buttons and loop\n");
+        inky_buttons_close(h.buttons);
+        inky_destroy(h.display);
+        inky_clock_destroy(clock);
+        return 1;
+    }
+    inky_loop_set_button_handler(loop, on_button, &h);
+    inky_loop_set_update_callback(loop, on_updated, &h);
+    
+    double *samples = malloc(sizeof(double) * KIND_COUNT * STAGE_COUNT * runs);
+    if (!samples) {
+        inky_loop_destroy(loop);
+        inky_buttons_close(h.buttons);
+        inky_destroy(h.display);
+        inky_clock_destroy(clock);
+        return 1;
+    }
+    
+    // Partial and full presses alternate so both see the same conditions
+    int saved = redirect_stdout();
+    bool ok = true;
+    for (int i = -warmup; i < runs && ok; i++) {
+        for (int kind = 0; kind < KIND_COUNT && ok; kind++) {
+            double stages[STAGE_COUNT];
+            ok = run_once(loop, &h, kind == KIND_FULL, stages);
+            for (int s = 0; ok && i >= 0 && s < STAGE_COUNT; s++) {
+                samples[((size_t)kind * STAGE_COUNT + s) * runs + i] = stages[s];
+            }
+        }
+    }
+    restore_stdout(saved);
+    
+    inky_loop_destroy(loop);
+    inky_buttons_close(h.buttons);
+    inky_destroy(h.display);
+    inky_clock_destroy(clock);
+    if (!ok) {
+        fprintf(stderr, "A press did not reach the glass\n");
+        free(samples);
+        return 1;
+    }
+    
+    result_t results[KIND_COUNT * STAGE_COUNT];
+    int count = 0;
+    printf("Press-to-glass latency (%d presses per update type, %d warm-up)\n", runs, warmup);
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        printf("\n%-18s %12s %12s %12s %12s %7s\n", kind_names[kind], "median", "p90", "p99", "max", "share");
+        double *total = samples + ((size_t)kind * STAGE_COUNT + STAGE_TOTAL) * runs;
+        qsort(total, runs, sizeof(double), compare_double);
+        double total_median = percentile(total, runs, 50);
+        
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            double *sorted = samples + ((size_t)kind * STAGE_COUNT + s) * runs;
+            qsort(sorted, runs, sizeof(double), compare_double);
+            
+            result_t *r = &results[count++];
+            snprintf(r->name, sizeof(r->name), "%s_%s", kind_names[kind], stage_names[s]);
+            r->runs = runs;
+            r->median_us = percentile(sorted, runs, 50);
+            r->p90_us = percentile(sorted, runs, 90);
+            r->p99_us = percentile(sorted, runs, 99);
+            r->max_us = sorted[runs - 1];
+            r->host = s < STAGE_TRANSFER;
+            printf("  %-16s %10.3fms %10.3fms %10.3fms %10.3fms %6.2f%%\n", stage_names[s],
+                   r->median_us / 1000.0, r->p90_us / 1000.0, r->p99_us / 1000.0, r->max_us / 1000.0,
+                   total_median > 0 ? r->median_us / total_median * 100.0 : 0);
+        }
+    }
+    free(samples);
+    
+    if (json_file && write_json(json_file, results, count) == 0) {
+        printf("Wrote %s\n", json_file);
+    }
+    
+    int regressions = 0;
+    if (baseline_file) {
+        regressions += compare_baseline(baseline_file, results, count, threshold, false);
+    }
+    if (host_baseline_file) {
+        regressions += compare_baseline(host_baseline_file, results, count, threshold, true);
+    }
+    if (regressions > 0) {
+        printf("%d stage(s) regressed\n", regressions);
+    }
+    
+    return regressions > 0 ? 1 : 0;
+}
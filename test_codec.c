@@ -0,0 +1,124 @@
+#include "inky.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Buffer codec self-check
+//
+// Round-trips a full frame and a region (decoded at its own place and one
+// pixel to the right) through inky_buffer_encode()/inky_buffer_decode(),
+// then feeds the decoder streams that lie about their size or are cut
+// short. A stream can come from another process or from storage, so every
+// one of those must be refused without writing outside the target.
+
+static int failures = 0;
+
+static void check(const char *what, bool ok) {
+    printf("  %-40s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static void draw_pattern(inky_t *display) {
+    inky_clear(display, INKY_WHITE);
+    inky_fill_rect(display, 40, 30, 200, 120, INKY_RED);
+    inky_fill_rect(display, 300, 200, 150, 90, INKY_BLUE);
+    for (uint16_t x = 0; x < inky_get_width(display); x += 3) {
+        inky_set_pixel(display, x, 400, (uint8_t)(x % INKY_PALETTE_COLORS));
+    }
+}
+
+static bool same_region(inky_t *a, uint16_t ax, uint16_t ay, inky_t *b, uint16_t bx, uint16_t by,
+                        uint16_t width, uint16_t height) {
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            if (inky_get_pixel(a, ax + x, ay + y) != inky_get_pixel(b, bx + x, by + y)) return false;
+        }
+    }
+    return true;
+}
+
+static size_t put_varint(uint8_t *out, uint64_t value) {
+    size_t o = 0;
+    while (value >= 0x80) {
+        out[o++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[o++] = (uint8_t)value;
+    return o;
+}
+
+// Header claiming width x height, followed by one run covering as many
+// bytes as the (wrapped) product says
+static size_t forge_stream(uint8_t *out, uint64_t width, uint64_t height) {
+    size_t o = 0;
+    out[o++] = 'I';
+    out[o++] = 'R';
+    out[o++] = 1;
+    o += put_varint(out + o, width);
+    o += put_varint(out + o, height);
+    out[o++] = 0;     // No literal
+    o += put_varint(out + o, (size_t)(width * height + 1) / 2);
+    out[o++] = 0x22;
+    return o;
+}
+
+int main(void) {
+    inky_t *source = inky_init(true);
+    inky_t *target = inky_init(true);
+    if (!source || !target) {
+        fprintf(stderr, "Failed to initialize display\n");
+        return 1;
+    }
+    uint16_t width = inky_get_width(source), height = inky_get_height(source);
+    size_t capacity = inky_buffer_encode_bound(width, height);
+    uint8_t *stream = malloc(capacity);
+    if (!stream) return 1;
+    
+    draw_pattern(source);
+    size_t len = inky_buffer_encode(source, 0, 0, width, height, stream, capacity);
+    inky_clear(target, INKY_BLACK);
+    check("full frame round trip", len > 0 && inky_buffer_decode(target, 0, 0, stream, len) == 0 &&
+          same_region(source, 0, 0, target, 0, 0, width, height));
+    printf("  (%zu bytes for a %ux%u frame)\n", len, width, height);
+    
+    len = inky_buffer_encode(source, 20, 25, 360, 200, stream, capacity);
+    inky_clear(target, INKY_BLACK);
+    check("region round trip", len > 0 && inky_buffer_decode(target, 20, 25, stream, len) == 0 &&
+          same_region(source, 20, 25, target, 20, 25, 360, 200));
+    inky_clear(target, INKY_BLACK);
+    check("region decoded one pixel over", inky_buffer_decode(target, 21, 25, stream, len) == 0 &&
+          same_region(source, 20, 25, target, 21, 25, 360, 200));
+    check("region past the right edge refused", inky_buffer_decode(target, width - 359, 25, stream, len) < 0);
+    check("truncated stream refused", inky_buffer_decode(target, 20, 25, stream, len / 2) < 0);
+    
+    // Sizes in the header that only pass a naive bounds check by overflowing
+    inky_clear(target, INKY_BLACK);
+    uint8_t forged[64];
+    len = forge_stream(forged, SIZE_MAX, 1);
+    check("width of SIZE_MAX refused", inky_buffer_decode(target, 1, 0, forged, len) < 0);
+    // x + width and y + height wrap to the panel size, width x height to
+    // the whole panel, and the row width truncates to 64936 pixels
+    len = forge_stream(forged, (uint64_t)0 - width, (uint64_t)0 - (height - 1));
+    check("wrapping width and height refused",
+          inky_buffer_decode(target, width, height - 1, forged, len) < 0);
+    len = forge_stream(forged, 1, SIZE_MAX);
+    check("height of SIZE_MAX refused", inky_buffer_decode(target, 0, 1, forged, len) < 0);
+    len = forge_stream(forged, (uint64_t)UINT16_MAX + 3, 1);
+    check("width wider than 16 bits refused", inky_buffer_decode(target, 0, 0, forged, len) < 0);
+    len = forge_stream(forged, (uint64_t)1 << 32, (uint64_t)1 << 32);
+    check("width x height overflow refused", inky_buffer_decode(target, 0, 0, forged, len) < 0);
+    len = forge_stream(forged, 1, 1);
+    check("position outside the panel refused", inky_buffer_decode(target, width + 1, 0, forged, len) < 0);
+    bool untouched = true;
+    for (uint16_t x = 0; x < width && untouched; x++) {
+        untouched = inky_get_pixel(target, x, 0) == INKY_BLACK && inky_get_pixel(target, x, 1) == INKY_BLACK;
+    }
+    check("refused streams wrote nothing", untouched);
+    
+    free(stream);
+    inky_destroy(source);
+    inky_destroy(target);
+    printf("%s\n", failures ? "Some checks FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
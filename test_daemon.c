@@ -0,0 +1,368 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Display server demo and self-check
+//
+// Runs a server on an emulated panel in a thread of this process, with
+// updates taking as long as on the panel but --scale times faster, and
+// drives it through the client library like separate processes would:
+// one client per quadrant submitting at once (merged into one update), an
+// unchanged frame, a frame that is not sealed, a client that disconnects
+// with a request in flight and a second server on the same socket. A
+// stand-in server then sends the client answers the emulated panel never
+// gives: several rejections in a row and a failed update covering merged
+// requests.
+
+#define CLIENTS 4
+
+typedef struct {
+    inky_loop_t *loop;
+    int stop_fd;
+} server_thread_t;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--scale N] [--socket PATH]\n", prog_name);
+    printf("Options:\n");
+    printf("  --scale N     Emulated updates run N times faster than the panel (default: 1000)\n");
+    printf("  --socket PATH Server socket (default: /tmp/inky-test-PID.sock)\n");
+}
+
+static void on_stop(inky_loop_t *loop, int fd, uint32_t events, void *user_data) {
+    (void)fd; (void)events; (void)user_data;
+    inky_loop_stop(loop);
+}
+
+static void *run_server(void *arg) {
+    server_thread_t *thread = arg;
+    inky_loop_run(thread->loop);
+    return NULL;
+}
+
+static int failures = 0;
+
+static void check(const char *what, bool ok) {
+    printf("  %-40s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Stand-in server: accepts one client and says hello, after which the test
+// reads its submits and writes the answers itself
+typedef struct {
+    int listen_fd;
+    int fd;
+} fake_server_t;
+
+static void fake_send(int fd, uint16_t type, uint32_t seq, int32_t status, uint32_t flags) {
+    inky_msg_t msg = {
+        .magic = INKY_SERVER_MAGIC, .version = INKY_SERVER_VERSION, .type = type,
+        .seq = seq, .status = status, .flags = flags, .width = INKY_WIDTH, .height = INKY_HEIGHT
+    };
+    if (send(fd, &msg, sizeof(msg), MSG_NOSIGNAL) != sizeof(msg)) perror("send");
+}
+
+static void *fake_accept(void *arg) {
+    fake_server_t *fake = arg;
+    fake->fd = accept4(fake->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fake->fd >= 0) fake_send(fake->fd, INKY_MSG_HELLO, 0, 0, 0);
+    return NULL;
+}
+
+// Read the submits that have arrived, closing their memfds
+static void fake_drain(fake_server_t *fake) {
+    for (;;) {
+        inky_msg_t msg;
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            struct cmsghdr align;
+        } control;
+        struct iovec iov = {&msg, sizeof(msg)};
+        struct msghdr hdr = {
+            .msg_iov = &iov, .msg_iovlen = 1,
+            .msg_control = control.buf, .msg_controllen = sizeof(control.buf)
+        };
+        if (recvmsg(fake->fd, &hdr, MSG_DONTWAIT) <= 0) return;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&hdr); c; c = CMSG_NXTHDR(&hdr, c)) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c), sizeof(int));
+            close(fd);
+        }
+    }
+}
+
+// Answers the emulated panel never gives, straight from a stand-in server
+static void check_answers(const char *path, inky_t *canvas) {
+    fake_server_t fake = {-1, -1};
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    fake.listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fake.listen_fd < 0 || bind(fake.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fake.listen_fd, 1) < 0) {
+        perror("Failed to start stand-in server");
+        check("stand-in server", false);
+        if (fake.listen_fd >= 0) close(fake.listen_fd);
+        return;
+    }
+    
+    pthread_t tid;
+    pthread_create(&tid, NULL, fake_accept, &fake);
+    inky_client_t *client = inky_client_connect(path);
+    pthread_join(tid, NULL);
+    if (!client || fake.fd < 0) {
+        check("client of the stand-in server", false);
+        inky_client_disconnect(client);
+        if (fake.fd >= 0) close(fake.fd);
+        close(fake.listen_fd);
+        unlink(path);
+        return;
+    }
+    
+    // Two refusals in a row, then an update: neither refusal is forgotten
+    int first = inky_client_submit(client, canvas);
+    int second = inky_client_submit(client, canvas);
+    int third = inky_client_submit(client, canvas);
+    fake_drain(&fake);
+    fake_send(fake.fd, INKY_MSG_DONE, first, -EBADF, INKY_MSG_REJECTED);
+    fake_send(fake.fd, INKY_MSG_DONE, second, -EBADF, INKY_MSG_REJECTED);
+    fake_send(fake.fd, INKY_MSG_DONE, third, 0, 0);
+    check("refusals survive a later update", inky_client_wait(client, third, 1000) == 0 &&
+          inky_client_wait(client, first, 0) == -1 && inky_client_wait(client, second, 0) == -1);
+    
+    // A refusal answered before the update holding an earlier request
+    int kept = inky_client_submit(client, canvas);
+    int refused = inky_client_submit(client, canvas);
+    fake_drain(&fake);
+    fake_send(fake.fd, INKY_MSG_DONE, refused, -EBADF, INKY_MSG_REJECTED);
+    fake_send(fake.fd, INKY_MSG_DONE, kept, 0, 0);
+    check("refusal does not fail earlier requests", inky_client_wait(client, kept, 1000) == 0 &&
+          inky_client_wait(client, refused, 0) == -1);
+    
+    // One failed answer for three merged requests fails all three
+    int merged[3];
+    for (int i = 0; i < 3; i++) {
+        merged[i] = inky_client_submit(client, canvas);
+    }
+    fake_drain(&fake);
+    fake_send(fake.fd, INKY_MSG_DONE, merged[2], -EIO, 0);
+    bool failed = true;
+    for (int i = 0; i < 3; i++) {
+        failed = failed && inky_client_wait(client, merged[i], 1000) == -1;
+    }
+    check("failed update fails merged requests", failed);
+    int after = inky_client_submit(client, canvas);
+    fake_drain(&fake);
+    fake_send(fake.fd, INKY_MSG_DONE, after, 0, 0);
+    check("next update after a failed one", inky_client_wait(client, after, 1000) == 0 &&
+          inky_client_wait(client, merged[0], 0) == -1);
+    
+    inky_client_disconnect(client);
+    close(fake.fd);
+    close(fake.listen_fd);
+    unlink(path);
+}
+
+// What a client does not get from the library: a SUBMIT with a memfd that
+// was never sealed
+static int submit_unsealed(inky_client_t *client, uint32_t seq) {
+    size_t size = ((size_t)INKY_WIDTH * INKY_HEIGHT + 1) / 2;
+    int fd = memfd_create("inky-unsealed", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    
+    inky_msg_t msg = {
+        .magic = INKY_SERVER_MAGIC, .version = INKY_SERVER_VERSION, .type = INKY_MSG_SUBMIT,
+        .seq = seq, .flags = INKY_MSG_FULL
+    };
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {&msg, sizeof(msg)};
+    struct msghdr hdr = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = control.buf, .msg_controllen = sizeof(control.buf)
+    };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&hdr);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    
+    ssize_t sent = sendmsg(inky_client_get_fd(client), &hdr, MSG_NOSIGNAL);
+    close(fd);
+    return sent == sizeof(msg) ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    double scale = 1000;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/inky-test-%d.sock", (int)getpid());
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            snprintf(path, sizeof(path), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    inky_t *display = inky_init(true);
+    inky_clock_t *clock = inky_clock_create(INKY_CLOCK_SCALED, scale);
+    if (!display || !clock) {
+        fprintf(stderr, "Failed to initialize display\n");
+        return 1;
+    }
+    inky_emulator_set_clock(display, clock);
+    
+    int stop[2];
+    if (pipe(stop) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    inky_loop_t *loop = inky_loop_create(display, NULL);
+    inky_server_t *server = loop ? inky_server_create(loop, display, path) : NULL;
+    if (!server) {
+        fprintf(stderr, "Failed to start display server on %s\n", path);
+        return 1;
+    }
+    inky_loop_add_fd(loop, stop[0], EPOLLIN, on_stop, NULL);
+    
+    server_thread_t thread = {loop, stop[1]};
+    pthread_t tid;
+    pthread_create(&tid, NULL, run_server, &thread);
+    printf("Display server on %s, updates %.0fx faster than the panel\n\n", path, scale);
+    
+    // The expected panel, drawn alongside the clients
+    inky_t *expected = inky_init(true);
+    inky_t *canvas[CLIENTS];
+    inky_client_t *client[CLIENTS];
+    bool connected = true;
+    for (int i = 0; i < CLIENTS; i++) {
+        canvas[i] = inky_init(true);
+        client[i] = inky_client_connect(path);
+        connected = connected && client[i];
+    }
+    check("clients connected", connected);
+    if (!connected) {
+        if (write(thread.stop_fd, "", 1) < 0) perror("write");
+        pthread_join(tid, NULL);
+        inky_server_destroy(server);
+        return 1;
+    }
+    
+    // A full white frame, then every client fills its quadrant while that
+    // update is still on its way
+    inky_clear(canvas[0], INKY_WHITE);
+    inky_clear(expected, INKY_WHITE);
+    int first = inky_client_submit(client[0], canvas[0]);
+    check("nothing on the glass right after submit", inky_client_wait(client[0], first, 0) == 1);
+    
+    static const uint8_t colors[CLIENTS] = {INKY_RED, INKY_GREEN, INKY_BLUE, INKY_YELLOW};
+    uint16_t qw = INKY_WIDTH / 2, qh = INKY_HEIGHT / 2;
+    int id[CLIENTS];
+    for (int i = 0; i < CLIENTS; i++) {
+        uint16_t x = (i & 1) * qw, y = (i >> 1) * qh;
+        inky_fill_rect(canvas[i], x, y, qw, qh, colors[i]);
+        inky_fill_rect(expected, x, y, qw, qh, colors[i]);
+        id[i] = inky_client_submit_region(client[i], canvas[i], x, y, qw, qh);
+    }
+    bool all_done = true;
+    for (int i = 0; i < CLIENTS; i++) {
+        all_done = all_done && inky_client_wait(client[i], id[i], 10000) == 0;
+    }
+    check("every quadrant reached the glass", all_done);
+    check("first frame covered by a later wait", inky_client_wait(client[0], first, 0) == 0);
+    
+    inky_server_stats_t stats;
+    inky_server_get_stats(server, &stats);
+    printf("  (%llu requests in %llu updates)\n", (unsigned long long)stats.requests,
+           (unsigned long long)stats.updates);
+    check("concurrent regions merged", stats.requests == CLIENTS + 1 && stats.updates < stats.requests);
+    
+    // The same pixels again: answered without touching the panel
+    check("unchanged region answered",
+          inky_client_update_region(client[1], canvas[1], qw, 0, qw, qh) == 0);
+    inky_server_get_stats(server, &stats);
+    check("unchanged region skipped the panel", stats.unchanged == 1);
+    
+    // A buffer the client could still change is refused, the client stays
+    inky_client_t *rogue = inky_client_connect(path);
+    check("unsealed frame rejected", rogue && submit_unsealed(rogue, 1) == 0 &&
+          inky_client_wait(rogue, 1, 10000) == -1);
+    
+    // A client leaving with a request in flight does not disturb the others
+    inky_client_t *leaver = inky_client_connect(path);
+    inky_fill_rect(canvas[2], 0, qh, 64, 64, INKY_BLACK);
+    inky_fill_rect(expected, 0, qh, 64, 64, INKY_BLACK);
+    check("submit then disconnect", leaver && inky_client_submit_region(leaver, canvas[2], 0, qh, 64, 64) > 0);
+    inky_client_disconnect(leaver);
+    inky_fill_rect(canvas[3], qw, qh, 64, 64, INKY_ORANGE);
+    inky_fill_rect(expected, qw, qh, 64, 64, INKY_ORANGE);
+    check("update after a disconnect",
+          inky_client_update_region(client[3], canvas[3], qw, qh, 64, 64) == 0);
+    
+    char fake_path[80];
+    snprintf(fake_path, sizeof(fake_path), "%s.fake", path);
+    check_answers(fake_path, canvas[0]);
+    
+    // Only one server per socket
+    inky_t *other = inky_init(true);
+    inky_loop_t *other_loop = inky_loop_create(other, NULL);
+    printf("  (a second server is expected to fail:)\n  ");
+    fflush(stdout);
+    inky_server_t *second = inky_server_create(other_loop, other, path);
+    check("second server on the socket refused", second == NULL);
+    inky_server_destroy(second);
+    inky_loop_destroy(other_loop);
+    inky_destroy(other);
+    
+    for (int i = 0; i < CLIENTS; i++) {
+        inky_client_disconnect(client[i]);
+    }
+    inky_client_disconnect(rogue);
+    if (write(thread.stop_fd, "", 1) < 0) perror("write");
+    pthread_join(tid, NULL);
+    
+    inky_server_get_stats(server, &stats);
+    check("panel shows every client's pixels",
+          memcmp(display->buffer, expected->buffer, display->buffer_size) == 0);
+    check("every connection counted", stats.connections >= CLIENTS + 2 && stats.rejected == 1);
+    
+    inky_emulator_save_ppm(display, "daemon.ppm");
+    printf("\n%llu requests, %llu updates, %llu unchanged, %llu rejected; panel saved to daemon.ppm\n",
+           (unsigned long long)stats.requests, (unsigned long long)stats.updates,
+           (unsigned long long)stats.unchanged, (unsigned long long)stats.rejected);
+    
+    inky_server_destroy(server);
+    check("socket removed", access(path, F_OK) != 0);
+    inky_loop_destroy(loop);
+    close(stop[0]);
+    close(stop[1]);
+    for (int i = 0; i < CLIENTS; i++) {
+        inky_destroy(canvas[i]);
+    }
+    inky_destroy(expected);
+    inky_destroy(display);
+    inky_clock_destroy(clock);
+    
+    printf("%s\n", failures ? "Some checks FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Tile-parallel drawing demo
+//
+// Builds a dense dashboard (gridded chart with a few thousand bars and
+// polylines, a striped table, a procedurally shaded map) three ways: with
+// inky_set_pixel() one pixel at a time, with a draw list on one thread and
+// with a draw list on the whole pool. All three must produce the same
+// buffer; the time per frame of each is printed.
+
+#define CHART_X  20
+#define CHART_Y  20
+#define CHART_W  360
+#define CHART_H  200
+#define TABLE_X  20
+#define TABLE_Y  240
+#define TABLE_W  360
+#define TABLE_H  190
+#define MAP_X    400
+#define MAP_Y    20
+#define MAP_W    180
+#define MAP_H    410
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--threads N] [--frames N]\n", prog_name);
+    printf("Options:\n");
+    printf("  --threads N   Pool size for the parallel run (default: online CPUs)\n");
+    printf("  --frames N    Frames to draw per method (default: 20)\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Value of series `s` at sample `i` for frame `frame`
+static int series(int s, int i, int frame) {
+    unsigned v = (unsigned)(i * 2654435761u) ^ (unsigned)(s * 40503 + frame * 977);
+    return (int)((v >> 8) % (CHART_H - 20)) / (s + 1) + (s * 30) % 60;
+}
+
+static uint8_t map_color(int x, int y, int frame) {
+    int h = ((x * 7 + frame) ^ (y * 13)) % 97 + ((x - MAP_X) * (y - MAP_Y) >> 6) % 31;
+    return h < 30 ? INKY_BLUE : h < 60 ? INKY_GREEN : h < 80 ? INKY_YELLOW : INKY_ORANGE;
+}
+
+// Map shading, once per tile it overlaps
+static void shade_map(inky_t *display, const inky_rect_t *clip, void *user_data) {
+    int frame = *(const int *)user_data;
+    for (int y = clip->y; y < clip->y + clip->height; y++) {
+        for (int x = clip->x; x < clip->x + clip->width; x++) {
+            inky_set_pixel(display, (uint16_t)x, (uint16_t)y, map_color(x, y, frame));
+        }
+    }
+}
+
+// The screen as a sequence of drawing operations, either recorded into a
+// list or drawn pixel by pixel
+typedef struct {
+    inky_t *display;
+    inky_draw_list_t *list;  // NULL: draw immediately
+} canvas_t;
+
+static void fill_rect(canvas_t *c, int x, int y, int w, int h, uint8_t color) {
+    if (c->list) {
+        inky_draw_list_fill_rect(c->list, x, y, w, h, color);
+        return;
+    }
+    for (int py = y; py < y + h; py++) {
+        for (int px = x; px < x + w; px++) {
+            if (px >= 0 && py >= 0) inky_set_pixel(c->display, (uint16_t)px, (uint16_t)py, color);
+        }
+    }
+}
+
+// Reference line: the minor coordinate rounds t * d_minor / d_major
+static void line(canvas_t *c, int x0, int y0, int x1, int y1, uint8_t color) {
+    if (c->list) {
+        inky_draw_list_line(c->list, x0, y0, x1, y1, color);
+        return;
+    }
+    int dx = abs(x1 - x0), dy = abs(y1 - y0);
+    bool x_major = dx >= dy;
+    if ((x_major && x0 > x1) || (!x_major && y0 > y1)) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    int d_major = x_major ? dx : dy, d_minor = x_major ? dy : dx;
+    int step = x_major ? (y1 >= y0 ? 1 : -1) : (x1 >= x0 ? 1 : -1);
+    for (int t = 0; t <= d_major; t++) {
+        int offset = d_major ? (int)(((long)t * 2 * d_minor + d_major) / (2L * d_major)) : 0;
+        int px = x_major ? x0 + t : x0 + step * offset;
+        int py = x_major ? y0 + step * offset : y0 + t;
+        if (px >= 0 && py >= 0) inky_set_pixel(c->display, (uint16_t)px, (uint16_t)py, color);
+    }
+}
+
+static void draw_screen(canvas_t *c, int frame) {
+    static int map_frame;
+    map_frame = frame;
+    
+    fill_rect(c, 0, 0, inky_get_width(c->display), inky_get_height(c->display), INKY_WHITE);
+    
+    // Chart: grid, bars, three polylines
+    for (int gx = 0; gx <= CHART_W; gx += 20) {
+        line(c, CHART_X + gx, CHART_Y, CHART_X + gx, CHART_Y + CHART_H, INKY_BLACK);
+    }
+    for (int gy = 0; gy <= CHART_H; gy += 20) {
+        line(c, CHART_X, CHART_Y + gy, CHART_X + CHART_W, CHART_Y + gy, INKY_BLACK);
+    }
+    for (int i = 0; i < CHART_W / 3; i++) {
+        int h = series(0, i, frame);
+        fill_rect(c, CHART_X + i * 3, CHART_Y + CHART_H - h, 2, h, INKY_GREEN);
+    }
+    for (int s = 1; s <= 3; s++) {
+        for (int i = 0; i + 1 < CHART_W / 4; i++) {
+            line(c, CHART_X + i * 4, CHART_Y + CHART_H - series(s, i, frame),
+                 CHART_X + (i + 1) * 4, CHART_Y + CHART_H - series(s, i + 1, frame),
+                 s == 1 ? INKY_RED : s == 2 ? INKY_BLUE : INKY_ORANGE);
+        }
+    }
+    
+    // Table: striped rows, cell borders, a bar per cell
+    for (int row = 0; row < TABLE_H / 10; row++) {
+        int y = TABLE_Y + row * 10;
+        if (row % 2) fill_rect(c, TABLE_X, y, TABLE_W, 10, INKY_YELLOW);
+        for (int col = 0; col < 6; col++) {
+            int w = series(col, row, frame) % 50 + 4;
+            fill_rect(c, TABLE_X + col * 60 + 4, y + 3, w, 4, (row + col) % 2 ? INKY_BLACK : INKY_RED);
+        }
+        line(c, TABLE_X, y, TABLE_X + TABLE_W, y, INKY_BLACK);
+    }
+    for (int col = 0; col <= 6; col++) {
+        line(c, TABLE_X + col * 60, TABLE_Y, TABLE_X + col * 60, TABLE_Y + TABLE_H, INKY_BLACK);
+    }
+    
+    // Map: shaded area, routes across it and off the panel edge
+    if (c->list) {
+        inky_draw_list_callback(c->list, MAP_X, MAP_Y, MAP_W, MAP_H, shade_map, &map_frame);
+    } else {
+        inky_rect_t area = {MAP_X, MAP_Y, MAP_W, MAP_H};
+        shade_map(c->display, &area, &map_frame);
+    }
+    for (int r = 0; r < 40; r++) {
+        line(c, MAP_X - 30 + r * 7, MAP_Y + MAP_H + 20, MAP_X + (r * 37) % MAP_W + 40, MAP_Y - 10,
+             r % 3 ? INKY_BLACK : INKY_RED);
+    }
+}
+
+static void snapshot(inky_t *display, uint8_t *pixels) {
+    uint16_t width = inky_get_width(display), height = inky_get_height(display);
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            *pixels++ = inky_get_pixel(display, x, y);
+        }
+    }
+}
+
+static double run(canvas_t *c, int frames) {
+    double start = now_ms();
+    for (int f = 0; f < frames; f++) {
+        if (c->list) {
+            inky_draw_list_reset(c->list);
+            draw_screen(c, f);
+            inky_draw_list_execute(c->list);
+        } else {
+            draw_screen(c, f);
+        }
+    }
+    return (now_ms() - start) / frames;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = 0;
+    int frames = 20;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1) frames = 1;
+    
+    inky_t *display = inky_init(true);
+    if (!display) {
+        fprintf(stderr, "Failed to initialize display\n");
+        return 1;
+    }
+    size_t size = (size_t)inky_get_width(display) * inky_get_height(display);
+    
+    // Every method draws into the same display; keep each result
+    uint8_t *immediate = malloc(size), *serial = malloc(size), *parallel = malloc(size);
+    inky_draw_list_t *one = inky_draw_list_create(display, 1);
+    inky_draw_list_t *pool = inky_draw_list_create(display, threads);
+    if (!immediate || !serial || !parallel || !one || !pool) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    canvas_t canvas = {display, NULL};
+    double immediate_ms = run(&canvas, frames);
+    snapshot(display, immediate);
+    
+    canvas.list = one;
+    double serial_ms = run(&canvas, frames);
+    snapshot(display, serial);
+    
+    canvas.list = pool;
+    double parallel_ms = run(&canvas, frames);
+    snapshot(display, parallel);
+    
+    printf("%zu commands per frame, %d frames per method\n", inky_draw_list_count(pool), frames);
+    char label[32];
+    snprintf(label, sizeof(label), "draw list, %d threads", inky_draw_list_threads(pool));
+    printf("  %-22s %8.3f ms per frame\n", "inky_set_pixel", immediate_ms);
+    printf("  %-22s %8.3f ms per frame (%.1fx)\n", "draw list, 1 thread", serial_ms, immediate_ms / serial_ms);
+    printf("  %-22s %8.3f ms per frame (%.1fx)\n", label, parallel_ms, immediate_ms / parallel_ms);
+    
+    bool same = memcmp(immediate, serial, size) == 0 && memcmp(serial, parallel, size) == 0;
+    printf("Buffers %s\n", same ? "identical" : "DIFFER");
+    inky_emulator_save_ppm(display, "draw.ppm");
+    
+    inky_draw_list_destroy(one);
+    inky_draw_list_destroy(pool);
+    free(immediate);
+    free(serial);
+    free(parallel);
+    inky_destroy(display);
+    return same ? 0 : 1;
+}
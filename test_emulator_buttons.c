@@ -12,6 +12,107 @@ void signal_handler(int sig) {
     printf("\nShutting down...\n");
 }
 
+// Gesture check: what one scripted interaction must queue, on a virtual
+// clock starting at 0 with the default timing (long press 800ms, double
+// press 400ms, repeat 200ms)
+typedef struct {
+    int button;
+    inky_button_event_type_t type;
+    uint32_t at_ms;
+} expected_event_t;
+
+static const expected_event_t expected_gestures[] = {
+    {INKY_BUTTON_A, INKY_BUTTON_EVENT_PRESS, 0},
+    {INKY_BUTTON_A, INKY_BUTTON_EVENT_LONG_PRESS, 800},
+    {INKY_BUTTON_A, INKY_BUTTON_EVENT_REPEAT, 1000},
+    {INKY_BUTTON_A, INKY_BUTTON_EVENT_REPEAT, 1200},
+    {INKY_BUTTON_A, INKY_BUTTON_EVENT_RELEASE, 1200},
+    {INKY_BUTTON_B, INKY_BUTTON_EVENT_PRESS, 1200},
+    {INKY_BUTTON_B, INKY_BUTTON_EVENT_RELEASE, 1300},
+    {INKY_BUTTON_B, INKY_BUTTON_EVENT_PRESS, 1400},
+    {INKY_BUTTON_B, INKY_BUTTON_EVENT_DOUBLE_PRESS, 1400},
+    {INKY_BUTTON_B, INKY_BUTTON_EVENT_RELEASE, 1400},
+    {INKY_BUTTON_C, INKY_BUTTON_EVENT_PRESS, 2000},
+    {INKY_BUTTON_C, INKY_BUTTON_EVENT_RELEASE, 2100},
+    {INKY_BUTTON_C, INKY_BUTTON_EVENT_PRESS, 2600},
+    {INKY_BUTTON_C, INKY_BUTTON_EVENT_RELEASE, 2700},
+};
+
+#define EXPECTED_GESTURES (sizeof(expected_gestures) / sizeof(expected_gestures[0]))
+
+// Advance the virtual clock in 100ms steps, polling like a main loop would
+static void advance(inky_buttons_t *buttons, inky_clock_t *clock, uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 100) {
+        inky_clock_advance_us(clock, 100000);
+        inky_buttons_poll(buttons);
+    }
+}
+
+// Hold A past the long-press time, double-press B, then press C twice too
+// far apart for a double press. Returns the number of mismatches.
+static int check_gestures(void) {
+    inky_button_config_t config;
+    inky_button_config_default(&config);
+    config.emulator = true;
+    inky_buttons_t *buttons = inky_buttons_open(&config);
+    inky_clock_t *clock = inky_clock_create(INKY_CLOCK_VIRTUAL, 1);
+    if (!buttons || !clock) {
+        fprintf(stderr, "Failed to set up emulated buttons\n");
+        inky_buttons_close(buttons);
+        inky_clock_destroy(clock);
+        return 1;
+    }
+    inky_buttons_set_clock(buttons, clock);
+    uint64_t start = inky_clock_now_us(clock);
+    
+    inky_buttons_emulate_press(buttons, INKY_BUTTON_A);
+    advance(buttons, clock, 1200);
+    inky_buttons_emulate_release(buttons, INKY_BUTTON_A);
+    
+    inky_buttons_emulate_press(buttons, INKY_BUTTON_B);
+    advance(buttons, clock, 100);
+    inky_buttons_emulate_release(buttons, INKY_BUTTON_B);
+    advance(buttons, clock, 100);
+    inky_buttons_emulate_press(buttons, INKY_BUTTON_B);
+    inky_buttons_emulate_release(buttons, INKY_BUTTON_B);
+    
+    advance(buttons, clock, 600);
+    inky_buttons_emulate_press(buttons, INKY_BUTTON_C);
+    advance(buttons, clock, 100);
+    inky_buttons_emulate_release(buttons, INKY_BUTTON_C);
+    advance(buttons, clock, 500);
+    inky_buttons_emulate_press(buttons, INKY_BUTTON_C);
+    advance(buttons, clock, 100);
+    inky_buttons_emulate_release(buttons, INKY_BUTTON_C);
+    
+    inky_button_event_t events[64];
+    size_t count = inky_buttons_read_events(buttons, events, 64);
+    int mismatches = 0;
+    printf("\nGesture check: %zu queued events\n", count);
+    for (size_t i = 0; i < count || i < EXPECTED_GESTURES; i++) {
+        const expected_event_t *want = i < EXPECTED_GESTURES ? &expected_gestures[i] : NULL;
+        bool ok = want && i < count && events[i].button == want->button && events[i].type == want->type &&
+                  events[i].timestamp_us - start == (uint64_t)want->at_ms * 1000;
+        if (i < count) {
+            printf("  +%6.1f ms  %c %-12s", (events[i].timestamp_us - start) / 1000.0,
+                   'A' + events[i].button, inky_button_event_name(events[i].type));
+        } else {
+            printf("  %-25s", "(missing)");
+        }
+        if (want) {
+            printf("  expected +%4u ms %c %-12s %s\n", want->at_ms, 'A' + want->button,
+                   inky_button_event_name(want->type), ok ? "ok" : "FAIL");
+        } else {
+            printf("  unexpected FAIL\n");
+        }
+        mismatches += !ok;
+    }
+    
+    inky_buttons_close(buttons);
+    inky_clock_destroy(clock);
+    return mismatches;
+}
+
 void button_callback(int button, void *user_data) {
     (void)user_data;
     
@@ -32,8 +133,9 @@ int main(void) {
     // Initialize button support (will automatically use emulator mode on non-Linux)
     printf("Initializing button support...\n");
     if (inky_button_init() < 0) {
-        fprintf(stderr, "Failed to initialize button support\n");
-        return 1;
+        // Linux with no GPIO chip: only the gesture check can run
+        fprintf(stderr, "Failed to initialize button support, skipping the press demo\n");
+        running = false;
     }
     
     // Set button callback
@@ -72,6 +174,11 @@ int main(void) {
     printf("\nCleaning up...\n");
     inky_button_cleanup();
     
+    // Gestures run on their own emulated set and a virtual clock, so the
+    // check holds whatever the default set is and however slow the machine
+    int mismatches = check_gestures();
+    printf("%s\n", mismatches ? "Gesture check FAILED" : "Gesture check passed");
+    
     printf("Emulated button test completed.\n");
-    return 0;
+    return mismatches ? 1 : 0;
 }
\ No newline at end of file
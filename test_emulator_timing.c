@@ -0,0 +1,210 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Clock dashboard on the emulator with realistic refresh latency
+//
+// Redraws a clock region once per minute of emulated time and falls back to a
+// full refresh whenever inky_should_full_refresh() asks for one (or after a
+// fixed number of partial refreshes). On the virtual clock hours of traffic
+// finish in well under a second of real time, so refresh policies can be
+// searched offline against the emulator's ghost score.
+
+#define SEARCH_MAX_PARTIALS 60
+
+typedef struct {
+    inky_clock_mode_t mode;
+    double scale;
+    double hours;
+    int temperature;
+    int full_every;     // Partial refreshes between full ones (0 = library policy)
+    bool report;
+} run_options_t;
+
+typedef struct {
+    uint64_t full_updates;
+    double mean_ghost;
+    double worst_ghost;
+} run_result_t;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--clock virtual|scaled|real] [--scale N] [--hours H] [--temp C]\n"
+           "          [--full-every N] [--search BOUND]\n", prog_name);
+    printf("Options:\n");
+    printf("  --clock MODE  Emulator clock: virtual (default), scaled or real\n");
+    printf("  --scale N     Speed-up for the scaled clock (default: 600)\n");
+    printf("  --hours H     Emulated hours to run (default: 2)\n");
+    printf("  --temp C      Panel temperature in Celsius (default: 22)\n");
+    printf("  --full-every N  Full refresh after N partial ones (default: inky_should_full_refresh)\n");
+    printf("  --search BOUND  Find the fewest full refreshes keeping the ghost score under BOUND\n");
+}
+
+static void print_histogram(const char *label, const inky_histogram_t *hist) {
+    if (hist->count == 0) return;
+    fprintf(stderr, "  %-16s n=%-5llu p50=%-8u p99=%-8u max=%llu us\n", label,
+           (unsigned long long)hist->count,
+           inky_histogram_percentile(hist, 50), inky_histogram_percentile(hist, 99),
+           (unsigned long long)hist->max_us);
+}
+
+static int run(const run_options_t *opt, run_result_t *result) {
+    inky_clock_t *clock = inky_clock_create(opt->mode, opt->scale);
+    inky_t *display = inky_init(true);
+    if (!clock || !display) {
+        fprintf(stderr, "Failed to initialize emulator\n");
+        inky_destroy(display);
+        inky_clock_destroy(clock);
+        return -1;
+    }
+    inky_emulator_set_clock(display, clock);
+    inky_emulator_set_temperature(display, opt->temperature);
+    
+    uint64_t real_start = inky_clock_now_us(NULL);
+    uint64_t start = inky_clock_now_us(clock);
+    uint64_t end = start + (uint64_t)(opt->hours * 3600e6);
+    uint64_t next_tick = start;
+    uint64_t frames = 0;
+    double ghost_total = 0.0;
+    
+    memset(result, 0, sizeof(*result));
+    inky_clear(display, INKY_WHITE);
+    inky_update(display);
+    
+    while (next_tick < end) {
+        // Wait for the next minute on the emulated clock
+        uint64_t now = inky_clock_now_us(clock);
+        if (next_tick > now) {
+            inky_clock_sleep_us(clock, next_tick - now);
+        }
+        next_tick += 60000000;
+        
+        uint32_t minute = (uint32_t)((next_tick - start) / 60000000);
+        for (uint16_t y = 200; y < 248; y++) {
+            for (uint16_t x = 250; x < 350; x++) {
+                inky_set_pixel(display, x, y, (minute * 3 + x / 10 + y / 12) % 4 ? INKY_WHITE : INKY_BLACK);
+            }
+        }
+        
+        bool full = opt->full_every > 0 ? inky_get_partial_count(display) >= opt->full_every
+                                        : inky_should_full_refresh(display);
+        if (full) {
+            inky_update(display);
+        } else {
+            inky_update_region(display, 250, 200, 100, 48);
+        }
+        
+        double ghost = inky_emulator_ghost_score(display);
+        ghost_total += ghost;
+        if (ghost > result->worst_ghost) result->worst_ghost = ghost;
+        frames++;
+    }
+    
+    inky_stats_t stats;
+    inky_get_stats(display, &stats);
+    result->full_updates = stats.updates[INKY_UPDATE_FULL];
+    result->mean_ghost = frames ? ghost_total / frames : 0.0;
+    
+    if (opt->report) {
+        double emulated_s = (inky_clock_now_us(clock) - start) / 1e6;
+        double real_s = (inky_clock_now_us(NULL) - real_start) / 1e6;
+        
+        fprintf(stderr, "Emulated %.0f s in %.3f s real time at %dC\n", emulated_s, real_s, opt->temperature);
+        fprintf(stderr, "Updates: %llu full, %llu partial, %llu bytes sent\n",
+                (unsigned long long)stats.updates[INKY_UPDATE_FULL],
+                (unsigned long long)stats.updates[INKY_UPDATE_PARTIAL],
+                (unsigned long long)stats.bytes_sent);
+        fprintf(stderr, "Ghost score: mean %.4f, worst %.4f\n", result->mean_ghost, result->worst_ghost);
+        fprintf(stderr, "Learned refresh estimates: full %u ms, partial %u ms\n",
+                inky_estimate_refresh_ms(display, INKY_UPDATE_FULL),
+                inky_estimate_refresh_ms(display, INKY_UPDATE_PARTIAL));
+        fprintf(stderr, "Refresh phase:\n");
+        print_histogram("full", &stats.phases[INKY_UPDATE_FULL][INKY_PHASE_REFRESH]);
+        print_histogram("partial", &stats.phases[INKY_UPDATE_PARTIAL][INKY_PHASE_REFRESH]);
+    }
+    
+    inky_destroy(display);
+    inky_clock_destroy(clock);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    run_options_t opt = {
+        .mode = INKY_CLOCK_VIRTUAL,
+        .scale = 600,
+        .hours = 2,
+        .temperature = 22,
+        .full_every = 0,
+        .report = true
+    };
+    double search_bound = -1;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "virtual") == 0) {
+                opt.mode = INKY_CLOCK_VIRTUAL;
+            } else if (strcmp(argv[i], "scaled") == 0) {
+                opt.mode = INKY_CLOCK_SCALED;
+            } else if (strcmp(argv[i], "real") == 0) {
+                opt.mode = INKY_CLOCK_REAL;
+            } else {
+                fprintf(stderr, "Unknown clock mode: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            opt.scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            opt.hours = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--temp") == 0 && i + 1 < argc) {
+            opt.temperature = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--full-every") == 0 && i + 1 < argc) {
+            opt.full_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--search") == 0 && i + 1 < argc) {
+            search_bound = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // Keep the per-update log lines out of the way
+    if (!freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Warning: could not silence update log\n");
+    }
+    
+    run_result_t result;
+    if (search_bound < 0) {
+        return run(&opt, &result) == 0 ? 0 : 1;
+    }
+    
+    // Policy search: stretch the gap between full refreshes until the
+    // worst frame crosses the bound
+    opt.mode = INKY_CLOCK_VIRTUAL;
+    opt.report = false;
+    int best = 0;
+    uint64_t best_full = 0;
+    fprintf(stderr, "%-12s %-12s %-12s %s\n", "full every", "full count", "mean ghost", "worst ghost");
+    for (int n = 1; n <= SEARCH_MAX_PARTIALS; n++) {
+        opt.full_every = n;
+        if (run(&opt, &result) < 0) return 1;
+        
+        fprintf(stderr, "%-12d %-12llu %-12.4f %.4f\n", n,
+                (unsigned long long)result.full_updates, result.mean_ghost, result.worst_ghost);
+        if (result.worst_ghost > search_bound) break;
+        best = n;
+        best_full = result.full_updates;
+    }
+    
+    if (best == 0) {
+        fprintf(stderr, "No policy keeps the ghost score under %.4f\n", search_bound);
+        return 1;
+    }
+    fprintf(stderr, "Fewest full refreshes under %.4f: every %d partial refreshes (%llu full in %.1f h)\n",
+            search_bound, best, (unsigned long long)best_full, opt.hours);
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+// Frame cache demo for rotating signage
+//
+// Prepares a set of dithered frames once (the expensive part of every cycle
+// without a cache), appends them to a cache file, then cycles through them
+// with inky_frame_cache_show() and compares the time per update with
+// preparing each frame again.
+
+#define DEFAULT_FRAMES 4
+
+// Approximate panel colors for dithering
+static const float palette[7][3] = {
+    {0, 0, 0}, {255, 255, 255}, {0, 160, 60}, {40, 60, 200},
+    {220, 40, 30}, {240, 220, 40}, {240, 130, 30}
+};
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--emulator|--hardware] [--cache FILE] [--frames N] [--cycles N] [--rebuild]\n", prog_name);
+    printf("Options:\n");
+#ifdef HARDWARE_BUILD
+    printf("  --emulator    Use emulator mode\n");
+    printf("  --hardware    Use hardware mode (default)\n");
+#else
+    printf("  --emulator    Use emulator mode (default)\n");
+    printf("  --hardware    Use hardware mode\n");
+#endif
+    printf("  --cache FILE  Frame cache to use (default: frames.inkycache)\n");
+    printf("  --frames N    Frames to prepare when building the cache (default: %d)\n", DEFAULT_FRAMES);
+    printf("  --cycles N    Times to show every cached frame (default: 3, 1 on hardware)\n");
+    printf("  --rebuild     Prepare the frames again even if the cache exists\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Render a synthetic poster (sky gradient, sun, text bars) and dither it to
+// the panel palette with Floyd-Steinberg error diffusion
+static void prepare_frame(inky_t *display, int index) {
+    int width = inky_get_width(display), height = inky_get_height(display);
+    float *err = calloc((size_t)(width + 2) * 2 * 3, sizeof(float));
+    if (!err) return;
+    
+    float hue = index * 1.3f;
+    for (int y = 0; y < height; y++) {
+        float *cur = err + (size_t)(y & 1) * (width + 2) * 3;
+        float *next = err + (size_t)((y + 1) & 1) * (width + 2) * 3;
+        memset(next, 0, (size_t)(width + 2) * 3 * sizeof(float));
+        
+        for (int x = 0; x < width; x++) {
+            float t = (float)y / height;
+            float rgb[3] = {
+                128 + 127 * sinf(hue + t * 3.0f),
+                128 + 127 * sinf(hue + 2.1f + t * 2.0f),
+                128 + 127 * sinf(hue + 4.2f + t * 1.5f)
+            };
+            float dx = x - width * (0.3f + 0.1f * index), dy = y - height * 0.35f;
+            if (dx * dx + dy * dy < 60 * 60) {
+                rgb[0] = 250; rgb[1] = 200; rgb[2] = 40;
+            }
+            if (y > height * 0.7f && (x / 12 + y / 16 + index) % 3 == 0 && (y % 16) < 10) {
+                rgb[0] = rgb[1] = rgb[2] = 10;
+            }
+            
+            float want[3];
+            int best = 0;
+            float best_dist = INFINITY;
+            for (int c = 0; c < 3; c++) want[c] = rgb[c] + cur[(x + 1) * 3 + c];
+            for (int p = 0; p < 7; p++) {
+                float d = 0;
+                for (int c = 0; c < 3; c++) d += (want[c] - palette[p][c]) * (want[c] - palette[p][c]);
+                if (d < best_dist) {
+                    best_dist = d;
+                    best = p;
+                }
+            }
+            inky_set_pixel(display, x, y, best);
+            
+            for (int c = 0; c < 3; c++) {
+                float e = want[c] - palette[best][c];
+                cur[(x + 2) * 3 + c] += e * 7 / 16;
+                next[x * 3 + c] += e * 3 / 16;
+                next[(x + 1) * 3 + c] += e * 5 / 16;
+                next[(x + 2) * 3 + c] += e * 1 / 16;
+            }
+        }
+    }
+    free(err);
+}
+
+static int build_cache(inky_t *display, const char *filename, int frames) {
+    remove(filename);
+    double prepare_ms = 0;
+    
+    for (int i = 0; i < frames; i++) {
+        double start = now_ms();
+        prepare_frame(display, i);
+        prepare_ms += now_ms() - start;
+        if (inky_frame_cache_append(filename, display) != i) {
+            return -1;
+        }
+    }
+    
+    printf("Prepared %d frames into %s: %.1f ms per frame\n", frames, filename, prepare_ms / frames);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+#ifdef HARDWARE_BUILD
+    bool use_emulator = false;
+#else
+    bool use_emulator = true;
+#endif
+    const char *filename = "frames.inkycache";
+    int frames = DEFAULT_FRAMES;
+    int cycles = 0;
+    bool rebuild = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emulator") == 0) {
+            use_emulator = true;
+        } else if (strcmp(argv[i], "--hardware") == 0) {
+            use_emulator = false;
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            filename = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rebuild") == 0) {
+            rebuild = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1) frames = 1;
+    if (cycles < 1) cycles = use_emulator ? 3 : 1;
+    
+    inky_t *display = inky_init(use_emulator);
+    if (!display) {
+        fprintf(stderr, "Failed to initialize display\n");
+        return 1;
+    }
+    
+    if ((rebuild || access(filename, R_OK) != 0) && build_cache(display, filename, frames) < 0) {
+        fprintf(stderr, "Failed to build %s\n", filename);
+        inky_destroy(display);
+        return 1;
+    }
+    
+    double start = now_ms();
+    inky_frame_cache_t *cache = inky_frame_cache_open(filename);
+    if (!cache) {
+        inky_destroy(display);
+        return 1;
+    }
+    size_t count = inky_frame_cache_count(cache);
+    printf("Opened %s (%zu frames) in %.3f ms\n", filename, count, now_ms() - start);
+    
+    // The first cycle pays the page faults, later ones come from the page cache
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        double cycle_start = now_ms();
+        for (size_t i = 0; i < count; i++) {
+            inky_frame_cache_show(display, cache, i);
+        }
+        printf("Cycle %d: %.3f ms per cached update\n", cycle + 1, (now_ms() - cycle_start) / count);
+    }
+    
+    // Without a cache every update prepares its frame first
+    double uncached_start = now_ms();
+    for (size_t i = 0; i < count; i++) {
+        prepare_frame(display, (int)i);
+        inky_update(display);
+    }
+    printf("Without cache: %.3f ms per update\n", (now_ms() - uncached_start) / count);
+    
+    if (use_emulator) {
+        inky_emulator_save_ppm(display, "frame_cache.ppm");
+    }
+    
+    inky_frame_cache_close(cache);
+    inky_destroy(display);
+    return 0;
+}
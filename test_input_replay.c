@@ -0,0 +1,312 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// Input replay harness for CI
+//
+// Runs many short interaction sessions back to back, each with its own
+// emulated display, buttons and event loop on a virtual clock, replaying a
+// script of timestamped button input through the normal event path. The
+// application logic is the one from test_loop: A bumps a counter (partial
+// update), a long press of B asks for a full refresh, C repeats redraw the
+// counter and D ends the session. Reports sessions per minute, handled
+// events per second and the press-to-glass latency on the display clock.
+
+#define COUNTER_X   40
+#define COUNTER_Y   200
+#define COUNTER_W   520
+#define COUNTER_H   48
+
+#define SESSION_LIMIT_MS (30 * 60 * 1000)  // Display time before a session is cut off
+
+typedef struct {
+    inky_t *display;
+    inky_buttons_t *buttons;
+    inky_clock_t *clock;
+    int presses;
+    int events;
+    int updates;
+    uint64_t request_us;    // Event behind the update in progress
+    uint64_t queued_us;     // First event queued behind it (0 = none)
+    uint64_t latency_sum_us;
+    uint64_t latency_max_us;
+    bool done;
+    
+    // --pipe: the script is written into a pipe while the session runs
+    const char *feed;
+    size_t feed_len;
+    size_t feed_pos;
+    int feed_fd;            // Write end, -1 once the script is written
+} session_t;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--script FILE] [--sessions N] [--pipe] [--verbose]\n", prog_name);
+    printf("Options:\n");
+    printf("  --script FILE Input to replay (default: sample_input.script)\n");
+    printf("  --sessions N  Sessions to run (default: 200)\n");
+    printf("  --pipe        Feed the script through a pipe instead of opening the file\n");
+    printf("  --verbose     Keep the emulator's per-update output\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void fill_rect(inky_t *display, int x, int y, int w, int h, uint8_t color) {
+    for (int py = y; py < y + h; py++) {
+        for (int px = x; px < x + w; px++) {
+            inky_set_pixel(display, px, py, color);
+        }
+    }
+}
+
+static void draw_counter(session_t *session) {
+    fill_rect(session->display, COUNTER_X, COUNTER_Y, COUNTER_W, COUNTER_H, INKY_WHITE);
+    for (int i = 0; i < session->presses % 26; i++) {
+        fill_rect(session->display, COUNTER_X + i * 20, COUNTER_Y + 8, 14, COUNTER_H - 16,
+                  i % 2 ? INKY_BLUE : INKY_GREEN);
+    }
+}
+
+// Latency is measured from the input's own timestamp, so time spent queued
+// behind a refresh counts
+static void note_request(inky_loop_t *loop, session_t *session, uint64_t timestamp_us) {
+    if (!inky_loop_is_updating(loop)) {
+        session->request_us = timestamp_us;
+    } else if (!session->queued_us) {
+        session->queued_us = timestamp_us;
+    }
+}
+
+static void on_button(inky_loop_t *loop, const inky_button_event_t *event, void *user_data) {
+    session_t *session = user_data;
+    session->events++;
+    
+    bool counter = (event->button == INKY_BUTTON_A && event->type == INKY_BUTTON_EVENT_PRESS) ||
+                   (event->button == INKY_BUTTON_C && event->type == INKY_BUTTON_EVENT_REPEAT);
+    if (counter) {
+        session->presses++;
+        draw_counter(session);
+        note_request(loop, session, event->timestamp_us);
+        inky_loop_update_region(loop, COUNTER_X, COUNTER_Y, COUNTER_W, COUNTER_H);
+    } else if (event->button == INKY_BUTTON_B && event->type == INKY_BUTTON_EVENT_LONG_PRESS) {
+        note_request(loop, session, event->timestamp_us);
+        inky_loop_update(loop);
+    } else if (event->button == INKY_BUTTON_D && event->type == INKY_BUTTON_EVENT_PRESS) {
+        session->done = true;
+    }
+}
+
+static void on_updated(inky_loop_t *loop, inky_t *display, void *user_data) {
+    (void)loop; (void)display;
+    session_t *session = user_data;
+    uint64_t latency = inky_clock_now_us(session->clock) - session->request_us;
+    session->updates++;
+    session->latency_sum_us += latency;
+    if (latency > session->latency_max_us) {
+        session->latency_max_us = latency;
+    }
+    
+    if (session->queued_us) {
+        session->request_us = session->queued_us;
+        session->queued_us = 0;
+    }
+}
+
+static void on_feed(inky_loop_t *loop, int fd, uint32_t events, void *user_data) {
+    (void)events;
+    session_t *session = user_data;
+    ssize_t len = write(fd, session->feed + session->feed_pos, session->feed_len - session->feed_pos);
+    if (len > 0) {
+        session->feed_pos += (size_t)len;
+    }
+    if (len < 0 || session->feed_pos == session->feed_len) {
+        inky_loop_remove_fd(loop, fd);
+        close(fd);
+        session->feed_fd = -1;
+    }
+}
+
+static char *read_file(const char *filename, size_t *len) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        perror("Failed to open input script");
+        return NULL;
+    }
+    
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = size > 0 ? malloc((size_t)size) : NULL;
+    if (data && fread(data, 1, (size_t)size, fp) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    if (!data) {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        return NULL;
+    }
+    *len = (size_t)size;
+    return data;
+}
+
+// One session: returns 0 when it ran to the end of its input
+static int run_session(session_t *session, const char *script) {
+    int read_fd = -1;
+    
+    session->display = inky_init(true);
+    session->clock = inky_clock_create(INKY_CLOCK_VIRTUAL, 1);
+    inky_button_config_t config;
+    inky_button_config_default(&config);
+    config.emulator = true;
+    session->buttons = inky_buttons_open(&config);
+    if (!session->display || !session->clock || !session->buttons) {
+        inky_buttons_close(session->buttons);
+        inky_clock_destroy(session->clock);
+        inky_destroy(session->display);
+        return -1;
+    }
+    inky_emulator_set_clock(session->display, session->clock);
+    inky_buttons_set_clock(session->buttons, session->clock);
+    
+    inky_loop_t *loop = inky_loop_create(session->display, session->buttons);
+    int result = loop ? 0 : -1;
+    if (loop && session->feed) {
+        int fds[2];
+        if (pipe(fds) < 0) {
+            result = -1;
+        } else {
+            fcntl(fds[1], F_SETFL, O_NONBLOCK);
+            read_fd = fds[0];
+            session->feed_fd = fds[1];
+            inky_buttons_replay_fd(session->buttons, read_fd);
+            inky_loop_add_fd(loop, fds[1], EPOLLOUT, on_feed, session);
+        }
+    } else if (loop && inky_buttons_replay(session->buttons, script) < 0) {
+        result = -1;
+    }
+    
+    if (result == 0) {
+        inky_loop_set_button_handler(loop, on_button, session);
+        inky_loop_set_update_callback(loop, on_updated, session);
+        
+        inky_clear(session->display, INKY_WHITE);
+        draw_counter(session);
+        note_request(loop, session, inky_clock_now_us(session->clock));
+        inky_loop_update(loop);
+        
+        // Until the input ends (or D is pressed) and the last update is shown
+        uint64_t limit = inky_clock_now_us(session->clock) + (uint64_t)SESSION_LIMIT_MS * 1000;
+        while ((!session->done && inky_buttons_replay_active(session->buttons)) ||
+               inky_loop_is_updating(loop)) {
+            if (inky_loop_dispatch(loop, -1) < 0 || inky_clock_now_us(session->clock) > limit) {
+                result = -1;
+                break;
+            }
+        }
+    }
+    
+    if (session->feed_fd >= 0) {
+        close(session->feed_fd);  // The writer never finished
+        result = -1;
+    }
+    inky_loop_destroy(loop);
+    inky_buttons_replay_stop(session->buttons);
+    if (read_fd >= 0) {
+        close(read_fd);
+    }
+    inky_buttons_close(session->buttons);
+    inky_destroy(session->display);
+    inky_clock_destroy(session->clock);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    const char *script = "sample_input.script";
+    int sessions = 200;
+    bool use_pipe = false;
+    bool verbose = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script = argv[++i];
+        } else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pipe") == 0) {
+            use_pipe = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (sessions < 1) sessions = 1;
+    
+    size_t feed_len = 0;
+    char *feed = NULL;
+    if (use_pipe && !(feed = read_file(script, &feed_len))) {
+        return 1;
+    }
+    
+    // The emulator reports every update; keep the report readable
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (!verbose) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            close(devnull);
+        }
+    }
+    
+    int failed = 0;
+    long events = 0, updates = 0;
+    uint64_t latency_sum = 0, latency_max = 0;
+    double start = now_ms();
+    for (int i = 0; i < sessions; i++) {
+        session_t session;
+        memset(&session, 0, sizeof(session));
+        session.feed = feed;
+        session.feed_len = feed_len;
+        session.feed_fd = -1;
+        
+        if (run_session(&session, script) < 0) {
+            failed++;
+        }
+        events += session.events;
+        updates += session.updates;
+        latency_sum += session.latency_sum_us;
+        if (session.latency_max_us > latency_max) {
+            latency_max = session.latency_max_us;
+        }
+    }
+    double elapsed = now_ms() - start;
+    
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    free(feed);
+    
+    printf("Replayed %s %d times%s in %.0f ms\n", script, sessions, use_pipe ? " (pipe)" : "", elapsed);
+    printf("  %.0f sessions/min, %.0f events/s handled\n",
+           sessions * 60000.0 / elapsed, events * 1000.0 / elapsed);
+    printf("  %ld events, %ld updates, %d failed sessions\n", events, updates, failed);
+    if (updates > 0) {
+        printf("  Input to glass (display clock): mean %.2f s, max %.2f s\n",
+               latency_sum / 1e6 / updates, latency_max / 1e6);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,340 @@
+#include "inky_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// Event loop demo: one thread, no polling
+//
+// A minute ticker redraws a progress bar with a scheduled partial update,
+// button A bumps a counter (partial update), a long press of B asks for a full
+// refresh and D quits. Lines typed on stdin ("a".."d") press buttons too,
+// showing an application fd served by the same loop. Presses made while a
+// refresh is running are queued and handled as soon as the loop gets to them.
+// In emulator mode a timer presses A every few seconds of display time, or
+// --script replays recorded input against the display clock instead.
+// --polled checks the loop against buttons on the polled GPIO path (chips
+// without edge events), with the lines faked in this process.
+
+#define BAR_Y       40
+#define BAR_HEIGHT  32
+#define COUNTER_X   40
+#define COUNTER_Y   200
+#define COUNTER_W   520
+#define COUNTER_H   48
+
+typedef struct {
+    inky_t *display;
+    inky_buttons_t *buttons;
+    inky_clock_t *clock;
+    int presses;
+    int minutes;
+    int updates;
+    uint64_t start_us;
+    uint64_t request_us;    // First request behind the update in progress
+    uint64_t queued_us;     // First request queued behind it (0 = none)
+} demo_t;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--emulator|--hardware] [--clock scaled|virtual|real] [--scale N] [--minutes M] [--script FILE] [--polled]\n", prog_name);
+    printf("Options:\n");
+#ifdef HARDWARE_BUILD
+    printf("  --emulator    Use emulator mode\n");
+    printf("  --hardware    Use hardware mode (default)\n");
+#else
+    printf("  --emulator    Use emulator mode (default)\n");
+    printf("  --hardware    Use hardware mode\n");
+#endif
+    printf("  --clock MODE  Emulator clock (default: scaled)\n");
+    printf("  --scale N     Speed-up for the scaled clock (default: 20)\n");
+    printf("  --minutes M   Display-clock minutes to run (default: 3)\n");
+    printf("  --script FILE Replay button input from FILE (emulator, e.g. sample_input.script)\n");
+    printf("  --polled      Check polled buttons (no GPIO edge events) in the loop and exit\n");
+}
+
+static void fill_rect(inky_t *display, int x, int y, int w, int h, uint8_t color) {
+    for (int py = y; py < y + h; py++) {
+        for (int px = x; px < x + w; px++) {
+            inky_set_pixel(display, px, py, color);
+        }
+    }
+}
+
+static double elapsed_s(demo_t *demo) {
+    return (inky_clock_now_us(demo->clock) - demo->start_us) / 1e6;
+}
+
+// Note when a request was made, for the latency printed once it is shown
+static void note_request(inky_loop_t *loop, demo_t *demo) {
+    uint64_t now = inky_clock_now_us(demo->clock);
+    if (!inky_loop_is_updating(loop)) {
+        demo->request_us = now;
+    } else if (!demo->queued_us) {
+        demo->queued_us = now;
+    }
+}
+
+static void request_region(inky_loop_t *loop, demo_t *demo, int x, int y, int w, int h) {
+    note_request(loop, demo);
+    inky_loop_update_region(loop, x, y, w, h);
+}
+
+static void draw_counter(demo_t *demo) {
+    fill_rect(demo->display, COUNTER_X, COUNTER_Y, COUNTER_W, COUNTER_H, INKY_WHITE);
+    for (int i = 0; i < demo->presses && i < 26; i++) {
+        fill_rect(demo->display, COUNTER_X + i * 20, COUNTER_Y + 8, 14, COUNTER_H - 16,
+                  i % 2 ? INKY_BLUE : INKY_GREEN);
+    }
+}
+
+static void on_minute(inky_loop_t *loop, int timer_id, void *user_data) {
+    (void)timer_id;
+    demo_t *demo = user_data;
+    int width = inky_get_width(demo->display);
+    
+    demo->minutes++;
+    fill_rect(demo->display, 0, BAR_Y, width, BAR_HEIGHT, INKY_WHITE);
+    fill_rect(demo->display, 0, BAR_Y, (demo->minutes * 40) % width, BAR_HEIGHT, INKY_ORANGE);
+    printf("[%7.1fs] Minute %d: redrawing the progress bar\n", elapsed_s(demo), demo->minutes);
+    request_region(loop, demo, 0, BAR_Y, width, BAR_HEIGHT);
+}
+
+static void on_button(inky_loop_t *loop, const inky_button_event_t *event, void *user_data) {
+    demo_t *demo = user_data;
+    printf("[%7.1fs] Button %c %s%s\n", elapsed_s(demo), 'A' + event->button,
+           inky_button_event_name(event->type), inky_loop_is_updating(loop) ? " (during refresh)" : "");
+    
+    if (event->button == INKY_BUTTON_A && event->type == INKY_BUTTON_EVENT_PRESS) {
+        demo->presses++;
+        draw_counter(demo);
+        request_region(loop, demo, COUNTER_X, COUNTER_Y, COUNTER_W, COUNTER_H);
+    } else if (event->button == INKY_BUTTON_B && event->type == INKY_BUTTON_EVENT_LONG_PRESS) {
+        note_request(loop, demo);
+        inky_loop_update(loop);
+    } else if (event->button == INKY_BUTTON_D && event->type == INKY_BUTTON_EVENT_PRESS) {
+        inky_loop_stop(loop);
+    }
+}
+
+static void on_updated(inky_loop_t *loop, inky_t *display, void *user_data) {
+    (void)loop; (void)display;
+    demo_t *demo = user_data;
+    demo->updates++;
+    printf("[%7.1fs] Update %d on the glass (%.1fs after the request)\n", elapsed_s(demo), demo->updates,
+           (inky_clock_now_us(demo->clock) - demo->request_us) / 1e6);
+    
+    // Queued requests start now as one merged update
+    if (demo->queued_us) {
+        demo->request_us = demo->queued_us;
+        demo->queued_us = 0;
+    }
+}
+
+static void on_stdin(inky_loop_t *loop, int fd, uint32_t events, void *user_data) {
+    (void)events;
+    demo_t *demo = user_data;
+    char line[64];
+    ssize_t len = read(fd, line, sizeof(line));
+    if (len <= 0) {
+        inky_loop_remove_fd(loop, fd);
+        return;
+    }
+    
+    for (ssize_t i = 0; i < len; i++) {
+        int button = line[i] >= 'a' && line[i] <= 'd' ? line[i] - 'a' : -1;
+        if (button >= 0) {
+            inky_buttons_emulate_press(demo->buttons, button);
+            inky_buttons_emulate_release(demo->buttons, button);
+        }
+    }
+}
+
+static void on_emulated_press(inky_loop_t *loop, int timer_id, void *user_data) {
+    (void)loop; (void)timer_id;
+    demo_t *demo = user_data;
+    inky_buttons_emulate_press(demo->buttons, INKY_BUTTON_A);
+    inky_buttons_emulate_release(demo->buttons, INKY_BUTTON_A);
+}
+
+static void on_done(inky_loop_t *loop, int timer_id, void *user_data) {
+    (void)timer_id; (void)user_data;
+    inky_loop_stop(loop);
+}
+
+// Polled path: button A reads as held from 50 to 150ms after the start
+#define POLLED_PRESS_US   50000
+#define POLLED_RELEASE_US 150000
+#define POLLED_RUN_MS     400
+
+typedef struct {
+    uint64_t start_us;
+    int samples;             // Reads of line A
+    inky_button_event_t events[8];
+    int count;
+} polled_t;
+
+static bool polled_line(int button, void *user_data) {
+    polled_t *polled = user_data;
+    if (button != INKY_BUTTON_A) return false;
+    polled->samples++;
+    uint64_t t = inky_time_us() - polled->start_us;
+    return t >= POLLED_PRESS_US && t < POLLED_RELEASE_US;
+}
+
+static void on_polled_button(inky_loop_t *loop, const inky_button_event_t *event, void *user_data) {
+    (void)loop;
+    polled_t *polled = user_data;
+    if (polled->count < 8) {
+        polled->events[polled->count++] = *event;
+    }
+}
+
+// The loop has to sample polled lines on its own, every few milliseconds
+// rather than continuously, and deliver the debounced edges
+static int run_polled_check(void) {
+    polled_t polled;
+    memset(&polled, 0, sizeof(polled));
+    polled.start_us = inky_time_us();
+    
+    inky_t *display = inky_init(true);
+    inky_buttons_t *buttons = inky_buttons_open_polled(polled_line, &polled);
+    inky_loop_t *loop = display && buttons ? inky_loop_create(display, buttons) : NULL;
+    if (!loop) {
+        fprintf(stderr, "Failed to set up polled buttons\n");
+        return 1;
+    }
+    inky_loop_set_button_handler(loop, on_polled_button, &polled);
+    inky_loop_add_timer(loop, POLLED_RUN_MS, 0, on_done, NULL);
+    inky_loop_run(loop);
+    
+    int failures = 0;
+    bool edges = polled.count == 2 &&
+                 polled.events[0].button == INKY_BUTTON_A && polled.events[0].type == INKY_BUTTON_EVENT_PRESS &&
+                 polled.events[1].button == INKY_BUTTON_A && polled.events[1].type == INKY_BUTTON_EVENT_RELEASE;
+    printf("  %-40s %s\n", "press and release delivered", edges ? "ok" : "FAIL");
+    failures += !edges;
+    
+    // Edges carry the time the level settled: within a sample or two of it
+    bool timed = edges &&
+                 polled.events[0].timestamp_us >= polled.start_us + POLLED_PRESS_US &&
+                 polled.events[0].timestamp_us < polled.start_us + POLLED_PRESS_US + 25000 &&
+                 polled.events[1].timestamp_us >= polled.start_us + POLLED_RELEASE_US &&
+                 polled.events[1].timestamp_us < polled.start_us + POLLED_RELEASE_US + 25000;
+    printf("  %-40s %s\n", "edges timestamped when they settled", timed ? "ok" : "FAIL");
+    failures += !timed;
+    
+    // One sample per 10ms interval, not one per loop pass
+    int expected = POLLED_RUN_MS / 10;
+    bool paced = polled.samples >= expected / 2 && polled.samples <= expected + 10;
+    printf("  %-40s %s (%d samples in %dms)\n", "lines sampled at the poll interval", paced ? "ok" : "FAIL",
+           polled.samples, POLLED_RUN_MS);
+    failures += !paced;
+    
+    inky_loop_destroy(loop);
+    inky_buttons_close(buttons);
+    inky_destroy(display);
+    printf("%s\n", failures ? "Some checks FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+#ifdef HARDWARE_BUILD
+    bool use_emulator = false;
+#else
+    bool use_emulator = true;
+#endif
+    inky_clock_mode_t mode = INKY_CLOCK_SCALED;
+    double scale = 20;
+    int minutes = 3;
+    const char *script = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emulator") == 0) {
+            use_emulator = true;
+        } else if (strcmp(argv[i], "--hardware") == 0) {
+            use_emulator = false;
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            mode = strcmp(name, "virtual") == 0 ? INKY_CLOCK_VIRTUAL :
+                   strcmp(name, "real") == 0 ? INKY_CLOCK_REAL : INKY_CLOCK_SCALED;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            minutes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script = argv[++i];
+        } else if (strcmp(argv[i], "--polled") == 0) {
+            return run_polled_check();
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    demo_t demo;
+    memset(&demo, 0, sizeof(demo));
+    demo.display = inky_init(use_emulator);
+    if (!demo.display) {
+        fprintf(stderr, "Failed to initialize display\n");
+        return 1;
+    }
+    
+    inky_button_config_t config;
+    inky_button_config_default(&config);
+    config.emulator = config.emulator || use_emulator;
+    demo.buttons = inky_buttons_open(&config);
+    
+    if (use_emulator) {
+        demo.clock = inky_clock_create(mode, scale);
+        inky_emulator_set_clock(demo.display, demo.clock);
+        inky_buttons_set_clock(demo.buttons, demo.clock);
+    }
+    demo.start_us = inky_clock_now_us(demo.clock);
+    
+    inky_loop_t *loop = inky_loop_create(demo.display, demo.buttons);
+    if (!loop) {
+        inky_buttons_close(demo.buttons);
+        inky_destroy(demo.display);
+        inky_clock_destroy(demo.clock);
+        return 1;
+    }
+    
+    inky_loop_set_button_handler(loop, on_button, &demo);
+    inky_loop_set_update_callback(loop, on_updated, &demo);
+    inky_loop_add_timer(loop, 60000, 60000, on_minute, &demo);
+    inky_loop_add_timer(loop, (uint32_t)minutes * 60000, 0, on_done, &demo);
+    if (use_emulator && script) {
+        if (inky_buttons_replay(demo.buttons, script) < 0) {
+            fprintf(stderr, "Failed to replay %s\n", script);
+        }
+    } else if (use_emulator) {
+        inky_loop_add_timer(loop, 5000, 9000, on_emulated_press, &demo);
+    }
+    if (use_emulator && mode != INKY_CLOCK_VIRTUAL) {
+        inky_loop_add_fd(loop, STDIN_FILENO, EPOLLIN, on_stdin, &demo);
+    }
+    
+    inky_clear(demo.display, INKY_WHITE);
+    draw_counter(&demo);
+    note_request(loop, &demo);
+    inky_loop_update(loop);
+    
+    printf("Running for %d display-clock minutes (loop fd %d)\n", minutes, inky_loop_get_fd(loop));
+    inky_loop_run(loop);
+    
+    printf("\n%d updates, %d presses of A in %.1fs of display time\n", demo.updates, demo.presses, elapsed_s(&demo));
+    inky_loop_destroy(loop);
+    if (use_emulator) {
+        inky_emulator_save_ppm(demo.display, "loop.ppm");
+    }
+    
+    inky_buttons_close(demo.buttons);
+    inky_destroy(demo.display);
+    inky_clock_destroy(demo.clock);
+    return 0;
+}
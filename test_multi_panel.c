@@ -0,0 +1,130 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PANELS 8
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--emulator|--hardware] [--panel SPI,RESET,BUSY,DC,CS]...\n", prog_name);
+    printf("Options:\n");
+#ifdef HARDWARE_BUILD
+    printf("  --emulator    Use emulator mode\n");
+    printf("  --hardware    Use hardware mode (default)\n");
+#else
+    printf("  --emulator    Use emulator mode (default)\n");
+    printf("  --hardware    Use hardware mode\n");
+#endif
+    printf("  --panel DEF   Add a panel, e.g. /dev/spidev0.0,27,17,22,8\n");
+    printf("                (default: one panel on the standard HAT pins)\n");
+    printf("  --count N     Number of emulated panels (default: 3)\n");
+}
+
+// Parse "SPI,RESET,BUSY,DC,CS" into a config
+static bool parse_panel(const char *def, inky_config_t *config, char *spi_buf, size_t spi_len) {
+    const char *comma = strchr(def, ',');
+    if (!comma || (size_t)(comma - def) >= spi_len) return false;
+    
+    memcpy(spi_buf, def, comma - def);
+    spi_buf[comma - def] = '\0';
+    config->spi_device = spi_buf;
+    
+    return sscanf(comma + 1, "%d,%d,%d,%d", &config->reset_pin, &config->busy_pin,
+                  &config->dc_pin, &config->cs_pin) == 4;
+}
+
+int main(int argc, char *argv[]) {
+#ifdef HARDWARE_BUILD
+    bool use_emulator = false;
+#else
+    bool use_emulator = true;
+#endif
+    inky_config_t configs[MAX_PANELS];
+    char spi_devices[MAX_PANELS][64];
+    int panel_count = 0;
+    int emulated_count = 3;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emulator") == 0) {
+            use_emulator = true;
+        } else if (strcmp(argv[i], "--hardware") == 0) {
+            use_emulator = false;
+        } else if (strcmp(argv[i], "--panel") == 0 && i + 1 < argc && panel_count < MAX_PANELS) {
+            inky_config_default(&configs[panel_count]);
+            if (!parse_panel(argv[++i], &configs[panel_count], spi_devices[panel_count], sizeof(spi_devices[0]))) {
+                fprintf(stderr, "Invalid panel definition: %s\n", argv[i]);
+                return 1;
+            }
+            panel_count++;
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            emulated_count = atoi(argv[++i]);
+            if (emulated_count < 1 || emulated_count > MAX_PANELS) {
+                fprintf(stderr, "Error: Count must be 1-%d\n", MAX_PANELS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (panel_count == 0) {
+        panel_count = use_emulator ? emulated_count : 1;
+        for (int i = 0; i < panel_count; i++) {
+            inky_config_default(&configs[i]);
+        }
+    }
+    
+    printf("Inky Multi-Panel Test\n");
+    printf("=====================\n");
+    printf("Mode: %s\n", use_emulator ? "Emulator" : "Hardware");
+    printf("Panels: %d\n\n", panel_count);
+    
+    inky_t *displays[MAX_PANELS];
+    for (int i = 0; i < panel_count; i++) {
+        configs[i].emulator = use_emulator;
+        printf("Initializing panel %d (%s)...\n", i, configs[i].spi_device);
+        displays[i] = inky_init_ex(&configs[i]);
+        if (!displays[i]) {
+            fprintf(stderr, "Failed to initialize panel %d\n", i);
+            for (int j = 0; j < i; j++) {
+                inky_destroy(displays[j]);
+            }
+            return 1;
+        }
+        
+        // Each panel gets its own color with a black frame
+        inky_clear(displays[i], (uint8_t)(INKY_GREEN + i % 5));
+        for (int x = 0; x < inky_get_width(displays[i]); x++) {
+            inky_set_pixel(displays[i], x, 0, INKY_BLACK);
+            inky_set_pixel(displays[i], x, inky_get_height(displays[i]) - 1, INKY_BLACK);
+        }
+    }
+    
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    printf("Updating all panels...\n");
+    inky_update_many(displays, panel_count);
+    
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("All %d panels updated in %.1f seconds\n", panel_count, elapsed);
+    
+    for (int i = 0; i < panel_count; i++) {
+        if (use_emulator) {
+            char filename[64];
+            snprintf(filename, sizeof(filename), "multi_panel_%d.ppm", i);
+            inky_emulator_save_ppm(displays[i], filename);
+        }
+        inky_destroy(displays[i]);
+    }
+    
+    printf("Multi-panel test completed!\n");
+    return 0;
+}
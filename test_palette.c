@@ -0,0 +1,319 @@
+#include "inky.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Palette lookup table demo
+//
+// Compares inky_palette_lookup() and inky_palette_nearest() with a direct
+// per-pixel CIELAB search over a grid of RGB values, shows how often plain
+// RGB distance picks a different color, times all four, and checks that a
+// calibrated palette drives both quantization and the emulator's PPM colors.
+
+#define GRID_STEP 3    // Every third value per channel: 86^3 colors
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--palette FILE] [--rounds N]\n", prog_name);
+    printf("Options:\n");
+    printf("  --palette FILE  Measured colors, one \"R G B\" line per color (default: nominal)\n");
+    printf("  --rounds N      Repetitions per timing (default: 5)\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Reference: sRGB to CIELAB in double precision, nearest by distance
+
+static void reference_lab(const uint8_t rgb[3], double lab[3]) {
+    double lin[3], f[3];
+    for (int c = 0; c < 3; c++) {
+        double v = rgb[c] / 255.0;
+        lin[c] = v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+    }
+    double xyz[3] = {
+        (0.4124564 * lin[0] + 0.3575761 * lin[1] + 0.1804375 * lin[2]) / 0.95047,
+        0.2126729 * lin[0] + 0.7151522 * lin[1] + 0.0721750 * lin[2],
+        (0.0193339 * lin[0] + 0.1191920 * lin[1] + 0.9503041 * lin[2]) / 1.08883
+    };
+    for (int c = 0; c < 3; c++) {
+        f[c] = xyz[c] > 216.0 / 24389 ? cbrt(xyz[c]) : (24389.0 / 27 * xyz[c] + 16) / 116;
+    }
+    lab[0] = 116 * f[1] - 16;
+    lab[1] = 500 * (f[0] - f[1]);
+    lab[2] = 200 * (f[1] - f[2]);
+}
+
+typedef struct {
+    const inky_palette_t *palette;
+    double lab[INKY_PALETTE_COLORS][3];
+} reference_t;
+
+static void reference_init(reference_t *ref, const inky_palette_t *palette) {
+    ref->palette = palette;
+    for (uint8_t p = 0; p < INKY_PALETTE_COLORS; p++) {
+        reference_lab(inky_palette_get_rgb(palette, p), ref->lab[p]);
+    }
+}
+
+static double lab_distance(const double a[3], const double b[3]) {
+    return sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+static uint8_t reference_nearest(const reference_t *ref, const uint8_t rgb[3]) {
+    double lab[3];
+    reference_lab(rgb, lab);
+    uint8_t best = 0;
+    for (uint8_t p = 1; p < INKY_PALETTE_COLORS; p++) {
+        if (lab_distance(lab, ref->lab[p]) < lab_distance(lab, ref->lab[best])) best = p;
+    }
+    return best;
+}
+
+static uint8_t rgb_nearest(const inky_palette_t *palette, const uint8_t rgb[3]) {
+    uint8_t best = 0;
+    int best_dist = 1 << 30;
+    for (uint8_t p = 0; p < INKY_PALETTE_COLORS; p++) {
+        const uint8_t *q = inky_palette_get_rgb(palette, p);
+        int dr = rgb[0] - q[0], dg = rgb[1] - q[1], db = rgb[2] - q[2];
+        int d = dr * dr + dg * dg + db * db;
+        if (d < best_dist) {
+            best_dist = d;
+            best = p;
+        }
+    }
+    return best;
+}
+
+typedef struct {
+    size_t samples;
+    size_t differ;       // Picked another color than the reference
+    size_t worse;        // ... that is perceptibly further away (over 0.01)
+    double extra;        // Summed extra Lab distance of those picks
+} accuracy_t;
+
+static void score(const reference_t *ref, const uint8_t rgb[3], uint8_t want, uint8_t got, accuracy_t *acc) {
+    acc->samples++;
+    if (got == want) return;
+    acc->differ++;
+    double lab[3];
+    reference_lab(rgb, lab);
+    double extra = lab_distance(lab, ref->lab[got]) - lab_distance(lab, ref->lab[want]);
+    if (extra > 0.01) {
+        acc->worse++;
+        acc->extra += extra;
+    }
+}
+
+static void print_accuracy(const char *name, const accuracy_t *acc) {
+    printf("  %-22s %6.3f%% differ, %6.3f%% worse, mean extra dE %.2f\n", name,
+           100.0 * acc->differ / acc->samples, 100.0 * acc->worse / acc->samples,
+           acc->worse ? acc->extra / acc->worse : 0.0);
+}
+
+// Accuracy of every method against the reference; returns 1 if nearest missed
+static int run_accuracy(const inky_palette_t *palette) {
+    reference_t ref;
+    reference_init(&ref, palette);
+    accuracy_t lookup = {0}, nearest = {0}, rgb = {0};
+    
+    for (int r = 0; r < 256; r += GRID_STEP) {
+        for (int g = 0; g < 256; g += GRID_STEP) {
+            for (int b = 0; b < 256; b += GRID_STEP) {
+                uint8_t px[3] = {(uint8_t)r, (uint8_t)g, (uint8_t)b};
+                uint8_t want = reference_nearest(&ref, px);
+                score(&ref, px, want, inky_palette_lookup(palette, px[0], px[1], px[2]), &lookup);
+                score(&ref, px, want, inky_palette_nearest(palette, px[0], px[1], px[2]), &nearest);
+                score(&ref, px, want, rgb_nearest(palette, px), &rgb);
+            }
+        }
+    }
+    
+    printf("Against a per-pixel Lab search (%zu colors):\n", lookup.samples);
+    print_accuracy("inky_palette_lookup", &lookup);
+    print_accuracy("inky_palette_nearest", &nearest);
+    print_accuracy("RGB distance", &rgb);
+    
+    bool exact = nearest.worse == 0;
+    printf("  %-40s %s\n", "nearest agrees with the Lab search", exact ? "ok" : "FAIL");
+    return !exact;
+}
+
+// Timing on a photo-like frame of smooth gradients
+
+static volatile uint32_t sink;
+
+static void run_timing(const inky_palette_t *palette, int rounds) {
+    size_t pixels = (size_t)INKY_WIDTH * INKY_HEIGHT;
+    uint8_t *frame = malloc(pixels * 3);
+    if (!frame) return;
+    for (size_t i = 0; i < pixels; i++) {
+        int x = (int)(i % INKY_WIDTH), y = (int)(i / INKY_WIDTH);
+        frame[i * 3] = (uint8_t)(x * 255 / INKY_WIDTH);
+        frame[i * 3 + 1] = (uint8_t)(y * 255 / INKY_HEIGHT);
+        frame[i * 3 + 2] = (uint8_t)((x + y) * 7 & 255);
+    }
+    reference_t ref;
+    reference_init(&ref, palette);
+    
+    const char *names[4] = {"per-pixel Lab", "RGB distance", "inky_palette_lookup", "inky_palette_nearest"};
+    printf("Timing (%d rounds of %zu pixels):\n", rounds, pixels);
+    for (int method = 0; method < 4; method++) {
+        uint32_t total = 0;
+        double start = now_ms();
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < pixels; i++) {
+                const uint8_t *px = frame + i * 3;
+                switch (method) {
+                case 0: total += reference_nearest(&ref, px); break;
+                case 1: total += rgb_nearest(palette, px); break;
+                case 2: total += inky_palette_lookup(palette, px[0], px[1], px[2]); break;
+                case 3: total += inky_palette_nearest(palette, px[0], px[1], px[2]); break;
+                }
+            }
+        }
+        sink = total;
+        printf("  %-22s %7.2f ns per pixel\n", names[method], (now_ms() - start) * 1e6 / ((double)rounds * pixels));
+    }
+    free(frame);
+}
+
+// Save the frame as palette.ppm and read back its first row
+static bool save_first_row(inky_t *display, uint8_t *row) {
+    const char *path = "palette.ppm";
+    if (inky_emulator_save_ppm(display, path) != 0) return false;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    
+    // P6, optional "# ghost_score" comment, size, maxval
+    char line[128];
+    int lines = 0;
+    while (lines < 3 && fgets(line, sizeof(line), fp)) {
+        if (line[0] != '#') lines++;
+    }
+    bool ok = lines == 3 && fread(row, 3, INKY_WIDTH, fp) == INKY_WIDTH;
+    fclose(fp);
+    return ok;
+}
+
+// Calibrated colors must quantize to themselves and show up in the PPM
+static int run_calibration(void) {
+    static const uint8_t measured[INKY_PALETTE_COLORS][3] = {
+        {35, 30, 40}, {205, 200, 190}, {45, 85, 60}, {55, 60, 100},
+        {150, 60, 60}, {200, 180, 60}, {180, 100, 60}
+    };
+    int failures = 0;
+    printf("Calibration:\n");
+    
+    inky_palette_t *palette = inky_palette_create();
+    inky_t *display = inky_init(true);
+    if (!palette || !display) {
+        fprintf(stderr, "Failed to initialize\n");
+        return 1;
+    }
+    inky_palette_calibrate(palette, measured);
+    
+    bool self = true;
+    for (uint8_t p = 0; p < INKY_PALETTE_COLORS; p++) {
+        const uint8_t *c = measured[p];
+        self &= inky_palette_lookup(palette, c[0], c[1], c[2]) == p;
+        self &= inky_palette_nearest(palette, c[0], c[1], c[2]) == p;
+    }
+    printf("  %-40s %s\n", "measured colors map to themselves", self ? "ok" : "FAIL");
+    failures += !self;
+    
+    // The same colors through a calibration file
+    const char *file = "palette.txt";
+    FILE *fp = fopen(file, "w");
+    if (fp) {
+        fprintf(fp, "# Measured panel colors\n");
+        for (int p = 0; p < INKY_PALETTE_COLORS; p++) {
+            fprintf(fp, "%d %d %d\n", measured[p][0], measured[p][1], measured[p][2]);
+        }
+        fclose(fp);
+    }
+    inky_palette_t *loaded = inky_palette_create();
+    bool load = loaded && inky_palette_load(loaded, file) == 0;
+    for (uint8_t p = 0; load && p < INKY_PALETTE_COLORS; p++) {
+        load = memcmp(inky_palette_get_rgb(loaded, p), measured[p], 3) == 0;
+    }
+    inky_palette_destroy(loaded);
+    remove(file);
+    printf("  %-40s %s\n", "loaded from a calibration file", load ? "ok" : "FAIL");
+    failures += !load;
+    
+    // One stripe per color, read back from the saved frame
+    inky_set_palette(display, palette);
+    for (uint16_t x = 0; x < INKY_WIDTH; x++) {
+        for (uint16_t y = 0; y < INKY_HEIGHT; y++) {
+            inky_set_pixel(display, x, y, (uint8_t)(x * INKY_PALETTE_COLORS / INKY_WIDTH));
+        }
+    }
+    uint8_t row[INKY_WIDTH * 3];
+    bool ppm = save_first_row(display, row);
+    for (uint8_t p = 0; ppm && p < INKY_PALETTE_COLORS; p++) {
+        int x = (2 * p + 1) * INKY_WIDTH / (2 * INKY_PALETTE_COLORS);
+        ppm = memcmp(row + x * 3, measured[p], 3) == 0;
+    }
+    printf("  %-40s %s\n", "PPM rendered in calibrated colors", ppm ? "ok" : "FAIL");
+    failures += !ppm;
+    
+    inky_set_palette(display, NULL);
+    bool nominal = save_first_row(display, row) && row[0] == 57 && row[1] == 48 && row[2] == 57;
+    printf("  %-40s %s\n", "NULL restores the nominal colors", nominal ? "ok" : "FAIL");
+    failures += !nominal;
+    
+    inky_destroy(display);
+    inky_palette_destroy(palette);
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    const char *palette_file = NULL;
+    int rounds = 5;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--palette") == 0 && i + 1 < argc) {
+            palette_file = argv[++i];
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (rounds < 1) rounds = 1;
+    
+    inky_palette_t *palette = inky_palette_create();
+    if (!palette) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if (palette_file && inky_palette_load(palette, palette_file) != 0) {
+        inky_palette_destroy(palette);
+        return 1;
+    }
+    
+    // Rebuild with the same colors to time the table
+    uint8_t colors[INKY_PALETTE_COLORS][3];
+    memcpy(colors, inky_palette_get_rgb(palette, 0), sizeof(colors));
+    double start = now_ms();
+    inky_palette_calibrate(palette, colors);
+    printf("Table built in %.2f ms\n", now_ms() - start);
+    
+    int failures = run_accuracy(palette);
+    run_timing(palette, rounds);
+    failures += run_calibration();
+    printf("%d checks failed\n", failures);
+    
+    inky_palette_destroy(palette);
+    return failures ? 1 : 0;
+}
@@ -22,6 +22,38 @@ void print_usage(const char *prog_name) {
     printf("                random   - Random region updates\n");
     printf("                Default: clock\n");
     printf("  --output FILE Save emulator output to FILE (default: partial_test.ppm)\n");
+    printf("  --stats       Print per-phase timing statistics at the end\n");
+    printf("  --trace FILE  Write a Chrome trace (chrome://tracing, Perfetto) to FILE\n");
+    printf("  --shm NAME    Publish emulator frames to shared memory NAME (e.g. /inky)\n");
+    printf("                for test_shm_viewer --name NAME (paced at 10x panel speed)\n");
+}
+
+// Print the per-phase latency summary collected by the library
+void print_stats(inky_t *display) {
+    inky_stats_t stats;
+    if (inky_get_stats(display, &stats) < 0) return;
+    
+    const char *type_names[INKY_UPDATE_TYPES] = {"full", "partial"};
+    
+    printf("\nUpdate statistics\n");
+    printf("-----------------\n");
+    for (int type = 0; type < INKY_UPDATE_TYPES; type++) {
+        printf("%s updates: %llu (%llu skipped unchanged)\n", type_names[type],
+               (unsigned long long)stats.updates[type], (unsigned long long)stats.skipped[type]);
+        for (int phase = 0; phase < INKY_PHASE_COUNT; phase++) {
+            const inky_histogram_t *hist = &stats.phases[type][phase];
+            if (hist->count == 0) continue;
+            printf("  %-13s n=%-4llu mean=%8.1fms p50=%8.1fms p99=%8.1fms max=%8.1fms\n",
+                   inky_phase_name(phase), (unsigned long long)hist->count,
+                   hist->total_us / 1000.0 / hist->count,
+                   inky_histogram_percentile(hist, 50) / 1000.0,
+                   inky_histogram_percentile(hist, 99) / 1000.0,
+                   hist->max_us / 1000.0);
+        }
+    }
+    printf("bytes sent: %llu, commands: %llu, syscalls: %llu\n",
+           (unsigned long long)stats.bytes_sent, (unsigned long long)stats.commands_sent,
+           (unsigned long long)stats.syscalls);
 }
 
 // Draw a digit at specified position
@@ -255,6 +287,9 @@ int main(int argc, char *argv[]) {
 #endif
     const char *test_type = "clock";
     const char *output_file = "partial_test.ppm";
+    bool show_stats = false;
+    const char *trace_file = NULL;
+    const char *shm_name = NULL;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -266,6 +301,12 @@ int main(int argc, char *argv[]) {
             test_type = argv[++i];
         } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
             output_file = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
         } else if (strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -285,6 +326,11 @@ int main(int argc, char *argv[]) {
     }
     printf("\n");
     
+    if (trace_file && inky_trace_enable(65536) < 0) {
+        fprintf(stderr, "Failed to enable tracing\n");
+        return 1;
+    }
+    
     // Initialize display
     printf("Initializing display...\n");
     inky_t *display = inky_init(use_emulator);
@@ -293,6 +339,18 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Emulated refreshes are instant; pace them so a viewer can follow
+    inky_clock_t *clock = NULL;
+    if (shm_name && use_emulator) {
+        if (inky_emulator_share(display, shm_name) < 0) {
+            fprintf(stderr, "Failed to share framebuffer as %s\n", shm_name);
+        } else {
+            printf("Publishing frames to shared memory %s\n", shm_name);
+            clock = inky_clock_create(INKY_CLOCK_SCALED, 10);
+            inky_emulator_set_clock(display, clock);
+        }
+    }
+    
     int result = 0;
     
     // Run selected test
@@ -305,9 +363,19 @@ int main(int argc, char *argv[]) {
         result = 1;
     }
     
+    if (show_stats) {
+        print_stats(display);
+    }
+    
+    if (trace_file) {
+        int events = inky_trace_flush(trace_file);
+        printf("Wrote %d trace events to %s\n", events, trace_file);
+    }
+    
     // Clean up
     printf("Cleaning up...\n");
     inky_destroy(display);
+    inky_clock_destroy(clock);
     
     printf("Partial update test completed!\n");
     return result;
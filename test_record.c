@@ -0,0 +1,246 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Frame recorder demo and inspection tool
+//
+// Without a file argument it records a simulated day of a clock dashboard
+// (minute partial updates, a full refresh every few), reports size and
+// overhead, then reads the recording back and checks every frame - once
+// from the seek index and once from a copy cut short as if the process had
+// crashed mid-write.
+
+#define DEMO_UPDATES 600
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--output FILE]\n", prog_name);
+    printf("       %s --info FILE\n", prog_name);
+    printf("       %s --extract FILE N --output IMAGE.ppm\n", prog_name);
+    printf("Options:\n");
+    printf("  --output FILE   Recording to write (default: recording.inkyrec) or image to extract\n");
+    printf("  --info FILE     List the frames of a recording\n");
+    printf("  --extract FILE N  Reconstruct frame N and save it as PPM\n");
+}
+
+// FNV-1a over the packed frame, via the public pixel API
+static uint64_t frame_hash(inky_t *display) {
+    uint64_t h = 1469598103934665603ULL;
+    for (uint16_t y = 0; y < inky_get_height(display); y++) {
+        for (uint16_t x = 0; x < inky_get_width(display); x++) {
+            h = (h ^ inky_get_pixel(display, x, y)) * 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+static int show_info(const char *filename) {
+    inky_recording_t *rec = inky_recording_open(filename);
+    if (!rec) return 1;
+    
+    size_t count = inky_recording_frame_count(rec);
+    printf("%s: %zu frames, started at %llu us since epoch\n", filename, count,
+           (unsigned long long)inky_recording_start_time_us(rec));
+    printf("%-6s %-12s %-8s %-20s %-4s %s\n", "frame", "time (s)", "type", "region", "key", "bytes");
+    
+    for (size_t i = 0; i < count; i++) {
+        inky_record_frame_t info;
+        inky_recording_frame_info(rec, i, &info);
+        
+        char region[32];
+        snprintf(region, sizeof(region), "(%u,%u) %ux%u", info.x, info.y, info.width, info.height);
+        printf("%-6zu %-12.3f %-8s %-20s %-4s %u\n", i, info.timestamp_us / 1e6,
+               info.type == INKY_UPDATE_FULL ? "full" : "partial", region,
+               info.keyframe ? "yes" : "", info.encoded_size);
+    }
+    
+    inky_recording_close(rec);
+    return 0;
+}
+
+static int extract(const char *filename, size_t index, const char *output) {
+    inky_recording_t *rec = inky_recording_open(filename);
+    inky_t *display = inky_init(true);
+    int result = 1;
+    
+    if (rec && display && inky_recording_seek(rec, index, display) == 0) {
+        result = inky_emulator_save_ppm(display, output) == 0 ? 0 : 1;
+    } else {
+        fprintf(stderr, "Could not reconstruct frame %zu of %s\n", index, filename);
+    }
+    
+    inky_destroy(display);
+    inky_recording_close(rec);
+    return result;
+}
+
+// Check every readable frame of a recording against the hashes taken live
+static size_t verify(const char *filename, const uint64_t *hashes, size_t expected, bool *ok) {
+    inky_recording_t *rec = inky_recording_open(filename);
+    inky_t *display = inky_init(true);
+    size_t count = 0;
+    *ok = rec && display;
+    
+    if (*ok) {
+        count = inky_recording_frame_count(rec);
+        if (count > expected) *ok = false;
+        for (size_t i = 0; *ok && i < count; i++) {
+            if (inky_recording_seek(rec, i, display) < 0 || frame_hash(display) != hashes[i]) {
+                fprintf(stderr, "Frame %zu does not match\n", i);
+                *ok = false;
+            }
+        }
+    }
+    
+    inky_destroy(display);
+    inky_recording_close(rec);
+    return count;
+}
+
+// Copy the first part of a file, as if writing stopped mid-frame
+static bool truncate_copy(const char *src, const char *dst, double fraction) {
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    bool ok = in && out;
+    
+    if (ok) {
+        fseek(in, 0, SEEK_END);
+        long keep = (long)(ftell(in) * fraction);
+        fseek(in, 0, SEEK_SET);
+        
+        char buf[4096];
+        while (keep > 0) {
+            size_t n = fread(buf, 1, keep < (long)sizeof(buf) ? (size_t)keep : sizeof(buf), in);
+            if (n == 0) break;
+            fwrite(buf, 1, n, out);
+            keep -= (long)n;
+        }
+    }
+    
+    if (in) fclose(in);
+    if (out) fclose(out);
+    return ok;
+}
+
+static int demo(const char *filename) {
+    inky_clock_t *clock = inky_clock_create(INKY_CLOCK_VIRTUAL, 1);
+    inky_t *display = inky_init(true);
+    uint64_t *hashes = malloc(DEMO_UPDATES * sizeof(uint64_t));
+    if (!clock || !display || !hashes) {
+        fprintf(stderr, "Failed to initialize emulator\n");
+        return 1;
+    }
+    inky_emulator_set_clock(display, clock);
+    
+    if (inky_record_start(display, filename, 0) < 0) {
+        fprintf(stderr, "Failed to start recording to %s\n", filename);
+        return 1;
+    }
+    
+    // Update log lines would swamp the summary
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+    
+    inky_clear(display, INKY_WHITE);
+    for (int i = 0; i < DEMO_UPDATES; i++) {
+        inky_clock_advance_us(clock, 60000000);
+        
+        // Clock digits: a few blocks in a 100x48 region that change every minute
+        for (uint16_t y = 200; y < 248; y++) {
+            for (uint16_t x = 250; x < 350; x++) {
+                int digit = (x - 250) / 25;
+                int value = (i / (digit == 3 ? 1 : digit == 2 ? 10 : 60)) % 10;
+                bool on = ((x / 5 + y / 6 + value) % 3) == 0;
+                inky_set_pixel(display, x, y, on ? INKY_BLACK : INKY_WHITE);
+            }
+        }
+        
+        if (i % 10 == 0) {
+            // Status line along the bottom changes with every full refresh
+            for (uint16_t x = 0; x < 600; x++) {
+                inky_set_pixel(display, x, 440, (x + i) % 7 == 0 ? INKY_RED : INKY_WHITE);
+            }
+            inky_update(display);
+        } else {
+            inky_update_region(display, 250, 200, 100, 48);
+        }
+        hashes[i] = frame_hash(display);
+    }
+    
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+    
+    inky_record_stats_t stats;
+    inky_record_get_stats(display, &stats);
+    inky_record_stop(display);
+    
+    printf("Recorded %llu updates (%llu keyframes) to %s\n", (unsigned long long)stats.frames,
+           (unsigned long long)stats.keyframes, filename);
+    printf("Size: %llu bytes, %.1f bytes per update (raw frame: %zu bytes)\n",
+           (unsigned long long)stats.bytes, (double)stats.bytes / stats.frames,
+           (size_t)inky_get_width(display) * inky_get_height(display) / 2);
+    printf("Recording overhead: mean %.1f us, max %llu us per update\n",
+           (double)stats.total_us / stats.frames, (unsigned long long)stats.max_us);
+    
+    bool ok;
+    size_t count = verify(filename, hashes, DEMO_UPDATES, &ok);
+    printf("Indexed read back: %zu frames %s\n", count, ok && count == DEMO_UPDATES ? "match" : "MISMATCH");
+    int result = ok && count == DEMO_UPDATES ? 0 : 1;
+    
+    char crashed[512];
+    snprintf(crashed, sizeof(crashed), "%s.partial", filename);
+    if (truncate_copy(filename, crashed, 0.6)) {
+        count = verify(crashed, hashes, DEMO_UPDATES, &ok);
+        printf("Truncated copy: %zu complete frames %s\n", count, ok && count > 0 ? "match" : "MISMATCH");
+        if (!ok || count == 0) result = 1;
+        remove(crashed);
+    }
+    
+    inky_destroy(display);
+    inky_clock_destroy(clock);
+    free(hashes);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    const char *info_file = NULL;
+    const char *extract_file = NULL;
+    size_t extract_index = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--info") == 0 && i + 1 < argc) {
+            info_file = argv[++i];
+        } else if (strcmp(argv[i], "--extract") == 0 && i + 2 < argc) {
+            extract_file = argv[++i];
+            extract_index = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (info_file) {
+        return show_info(info_file);
+    }
+    if (extract_file) {
+        return extract(extract_file, extract_index, output ? output : "frame.ppm");
+    }
+    return demo(output ? output : "recording.inkyrec");
+}
@@ -0,0 +1,345 @@
+#include "inky.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Primitives demo
+//
+// Draws a gallery of every primitive (saved as shapes.ppm), then checks the
+// span-based primitives against per-pixel versions of the same rules built
+// on inky_set_pixel(), and times both.
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--output FILE] [--rounds N]\n", prog_name);
+    printf("Options:\n");
+    printf("  --output FILE Gallery image (default: shapes.ppm)\n");
+    printf("  --rounds N    Repetitions per timing (default: 20)\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void snapshot(inky_t *display, uint8_t *pixels) {
+    uint16_t width = inky_get_width(display), height = inky_get_height(display);
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            *pixels++ = inky_get_pixel(display, x, y);
+        }
+    }
+}
+
+static void set_pixel(inky_t *display, int x, int y, uint8_t color) {
+    if (x >= 0 && y >= 0) inky_set_pixel(display, (uint16_t)x, (uint16_t)y, color);
+}
+
+// Per-pixel references
+
+static void slow_fill_ellipse(inky_t *display, int cx, int cy, int rx, int ry, uint8_t color) {
+    int64_t a = (int64_t)rx * rx + rx, b = (int64_t)ry * ry + ry;
+    for (int y = -ry; y <= ry; y++) {
+        for (int x = -rx; x <= rx; x++) {
+            if ((int64_t)x * x * b + (int64_t)y * y * a <= a * b) set_pixel(display, cx + x, cy + y, color);
+        }
+    }
+}
+
+// The minor coordinate rounds t * d_minor / d_major from the lower end
+static void slow_line(inky_t *display, int x0, int y0, int x1, int y1, uint8_t color) {
+    int dx = abs(x1 - x0), dy = abs(y1 - y0);
+    bool x_major = dx >= dy;
+    if ((x_major && x0 > x1) || (!x_major && y0 > y1)) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    int d_major = x_major ? dx : dy, d_minor = x_major ? dy : dx;
+    int step = x_major ? (y1 >= y0 ? 1 : -1) : (x1 >= x0 ? 1 : -1);
+    for (int t = 0; t <= d_major; t++) {
+        int offset = d_major ? (int)(((long)t * 2 * d_minor + d_major) / (2L * d_major)) : 0;
+        set_pixel(display, x_major ? x0 + t : x0 + step * offset, x_major ? y0 + step * offset : y0 + t, color);
+    }
+}
+
+// Nonzero winding at each pixel center, counting edges crossed at or left of it
+static void slow_fill_polygon(inky_t *display, const inky_point_t *points, size_t count, uint8_t color) {
+    int width = inky_get_width(display), height = inky_get_height(display);
+    for (int py = 0; py < height; py++) {
+        for (int px = 0; px < width; px++) {
+            int winding = 0;
+            for (size_t i = 0; i < count; i++) {
+                double ax = points[i].x, ay = points[i].y;
+                double bx = points[(i + 1) % count].x, by = points[(i + 1) % count].y;
+                int dir = 1;
+                if (ay > by) {
+                    double t = ax; ax = bx; bx = t;
+                    t = ay; ay = by; by = t;
+                    dir = -1;
+                }
+                if (py < ceil(ay - 0.5) || py >= ceil(by - 0.5)) continue;
+                double x = ax + (py + 0.5 - ay) * ((bx - ax) / (by - ay));
+                if (x - 0.5 <= px) winding += dir;
+            }
+            if (winding != 0) set_pixel(display, px, py, color);
+        }
+    }
+}
+
+// Checks
+
+typedef struct {
+    inky_t *display;
+    uint8_t *expected;
+    uint8_t *actual;
+    size_t size;
+    int failures;
+} checker_t;
+
+static void check(checker_t *c, const char *name) {
+    snapshot(c->display, c->actual);
+    size_t diff = 0;
+    for (size_t i = 0; i < c->size; i++) {
+        diff += c->expected[i] != c->actual[i];
+    }
+    printf("  %-40s %s", name, diff ? "FAIL" : "ok");
+    if (diff) {
+        printf(" (%zu pixels differ)", diff);
+        c->failures++;
+    }
+    printf("\n");
+}
+
+static void expect(checker_t *c) {
+    snapshot(c->display, c->expected);
+    inky_clear(c->display, INKY_WHITE);
+}
+
+static const inky_point_t star[] = {
+    {300, 30}, {420, 400}, {105, 170}, {495, 170}, {180, 400}
+};
+
+static const inky_point_t comb[] = {
+    {40, 40}, {560, 40}, {560, 420}, {480, 420}, {480, 120}, {400, 120}, {400, 420},
+    {320, 420}, {320, 120}, {240, 120}, {240, 420}, {160, 420}, {160, 120}, {80, 120}, {40, 420}
+};
+
+static void run_checks(checker_t *c) {
+    inky_t *display = c->display;
+    printf("Checks:\n");
+    
+    inky_clear(display, INKY_WHITE);
+    slow_fill_ellipse(display, 300, 220, 180, 120, INKY_GREEN);
+    expect(c);
+    inky_fill_ellipse(display, 300, 220, 180, 120, INKY_GREEN);
+    check(c, "fill_ellipse matches per-pixel test");
+    
+    inky_clear(display, INKY_WHITE);
+    slow_fill_ellipse(display, -40, 470, 250, 250, INKY_RED);
+    expect(c);
+    inky_fill_circle(display, -40, 470, 250, INKY_RED);
+    check(c, "fill_circle clipped at two edges");
+    
+    inky_clear(display, INKY_WHITE);
+    inky_fill_circle(display, 250, 200, 150, INKY_BLUE);
+    expect(c);
+    inky_draw_circle(display, 250, 200, 150, INKY_BLUE);
+    inky_flood_fill(display, 250, 200, INKY_BLUE);
+    check(c, "draw_circle + flood_fill = fill_circle");
+    
+    inky_clear(display, INKY_WHITE);
+    inky_fill_ellipse(display, 300, 200, 250, 40, INKY_ORANGE);
+    expect(c);
+    inky_draw_ellipse(display, 300, 200, 250, 40, INKY_ORANGE);
+    inky_flood_fill(display, 300, 200, INKY_ORANGE);
+    check(c, "draw_ellipse + flood_fill = fill_ellipse");
+    
+    inky_clear(display, INKY_WHITE);
+    slow_fill_polygon(display, star, 5, INKY_RED);
+    expect(c);
+    inky_fill_polygon(display, star, 5, INKY_RED);
+    check(c, "self-intersecting star (nonzero)");
+    
+    inky_clear(display, INKY_WHITE);
+    slow_fill_polygon(display, comb, sizeof(comb) / sizeof(comb[0]), INKY_BLACK);
+    expect(c);
+    inky_fill_polygon(display, comb, sizeof(comb) / sizeof(comb[0]), INKY_BLACK);
+    check(c, "concave comb (heap edge list)");
+    
+    inky_clear(display, INKY_WHITE);
+    inky_fill_rect(display, 17, 33, 301, 151, INKY_YELLOW);
+    expect(c);
+    inky_point_t box[] = {{17, 33}, {318, 33}, {318, 184}, {17, 184}};
+    inky_fill_polygon(display, box, 4, INKY_YELLOW);
+    check(c, "rectangle polygon = fill_rect");
+    
+    // Two triangles sharing a diagonal cover the box exactly once
+    inky_point_t upper[] = {{17, 33}, {318, 33}, {318, 184}};
+    inky_point_t lower[] = {{17, 33}, {318, 184}, {17, 184}};
+    inky_clear(display, INKY_WHITE);
+    inky_fill_polygon(display, upper, 3, INKY_YELLOW);
+    inky_fill_polygon(display, lower, 3, INKY_YELLOW);
+    check(c, "shared edge: no gap");
+    inky_clear(display, INKY_WHITE);
+    inky_fill_polygon(display, upper, 3, INKY_GREEN);
+    inky_fill_polygon(display, lower, 3, INKY_BLUE);
+    size_t green = 0, blue = 0;
+    for (int y = 33; y < 184; y++) {
+        for (int x = 17; x < 318; x++) {
+            uint8_t p = inky_get_pixel(display, x, y);
+            green += p == INKY_GREEN;
+            blue += p == INKY_BLUE;
+        }
+    }
+    inky_clear(display, INKY_WHITE);
+    inky_fill_polygon(display, upper, 3, INKY_GREEN);
+    size_t alone = 0;
+    for (int y = 33; y < 184; y++) {
+        for (int x = 17; x < 318; x++) alone += inky_get_pixel(display, x, y) == INKY_GREEN;
+    }
+    bool no_overlap = green == alone && green + blue == 301 * 151;
+    printf("  %-40s %s\n", "shared edge: no overlap", no_overlap ? "ok" : "FAIL");
+    if (!no_overlap) c->failures++;
+    
+    inky_clear(display, INKY_WHITE);
+    inky_draw_line(display, 10, 10, 589, 10, INKY_BLACK);
+    inky_draw_line(display, 589, 10, 589, 437, INKY_BLACK);
+    inky_draw_line(display, 589, 437, 10, 437, INKY_BLACK);
+    inky_draw_line(display, 10, 437, 10, 10, INKY_BLACK);
+    expect(c);
+    inky_draw_rect(display, 10, 10, 580, 428, INKY_BLACK);
+    check(c, "draw_rect = four lines");
+    
+    inky_clear(display, INKY_WHITE);
+    slow_line(display, -500, 700, 900, -200, INKY_RED);
+    slow_line(display, 300, -1000, 250, 1000, INKY_BLUE);
+    expect(c);
+    inky_draw_line(display, -500, 700, 900, -200, INKY_RED);
+    inky_draw_line(display, 300, -1000, 250, 1000, INKY_BLUE);
+    check(c, "lines clipped at the panel edges");
+}
+
+// Gallery
+
+static void draw_gallery(inky_t *display) {
+    inky_clear(display, INKY_WHITE);
+    
+    for (int i = 0; i < 12; i++) {
+        inky_draw_line(display, 20, 20, 20 + i * 16, 200, i % 2 ? INKY_BLACK : INKY_RED);
+    }
+    for (int w = 2; w <= 12; w += 2) {
+        inky_draw_thick_line(display, 220, 20 + w * 12, 380, 40 + w * 6, w, INKY_BLUE);
+    }
+    inky_draw_rect(display, 400, 20, 180, 90, INKY_BLACK);
+    inky_fill_rect(display, 410, 30, 160, 70, INKY_YELLOW);
+    
+    inky_fill_circle(display, 450, 190, 60, INKY_GREEN);
+    inky_draw_circle(display, 450, 190, 70, INKY_BLACK);
+    inky_fill_ellipse(display, 530, 290, 50, 25, INKY_ORANGE);
+    inky_draw_ellipse(display, 530, 290, 60, 35, INKY_RED);
+    
+    inky_point_t star_small[5];
+    for (int i = 0; i < 5; i++) {
+        star_small[i].x = 120 + (star[i].x - 300) / 3;
+        star_small[i].y = 260 + (star[i].y - 215) / 3;
+    }
+    inky_fill_polygon(display, star_small, 5, INKY_RED);
+    
+    // Flood fill a region bounded by a thick outline
+    inky_draw_thick_line(display, 250, 260, 380, 330, 4, INKY_BLACK);
+    inky_draw_thick_line(display, 380, 330, 260, 430, 4, INKY_BLACK);
+    inky_draw_thick_line(display, 260, 430, 250, 260, 4, INKY_BLACK);
+    inky_flood_fill(display, 290, 330, INKY_BLUE);
+    
+    // Off-screen parts are clipped away
+    inky_fill_circle(display, 0, 447, 60, INKY_YELLOW);
+    inky_draw_thick_line(display, -100, 300, 700, 460, 6, INKY_ORANGE);
+}
+
+// Timing
+
+typedef void (*draw_fn_t)(inky_t *display);
+
+static void fast_disk(inky_t *display) { inky_fill_circle(display, 300, 224, 200, INKY_GREEN); }
+static void slow_disk(inky_t *display) { slow_fill_ellipse(display, 300, 224, 200, 200, INKY_GREEN); }
+static void fast_star(inky_t *display) { inky_fill_polygon(display, star, 5, INKY_RED); }
+static void slow_star(inky_t *display) { slow_fill_polygon(display, star, 5, INKY_RED); }
+
+static double time_ms(inky_t *display, draw_fn_t fn, int rounds) {
+    double start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        fn(display);
+    }
+    return (now_ms() - start) / rounds;
+}
+
+static void compare(inky_t *display, const char *name, draw_fn_t fast, draw_fn_t slow, int rounds) {
+    double fast_ms = time_ms(display, fast, rounds);
+    double slow_ms = time_ms(display, slow, rounds < 5 ? 1 : rounds / 5);
+    printf("  %-12s %8.3f ms   per pixel %8.3f ms   (%.0fx)\n", name, fast_ms, slow_ms, slow_ms / fast_ms);
+}
+
+static void time_flood(inky_t *display, int rounds) {
+    double total = 0;
+    for (int i = 0; i < rounds; i++) {
+        inky_clear(display, INKY_WHITE);
+        inky_draw_circle(display, 300, 224, 200, INKY_BLACK);
+        double start = now_ms();
+        inky_flood_fill(display, 300, 224, i % 2 ? INKY_BLUE : INKY_GREEN);
+        total += now_ms() - start;
+    }
+    printf("  %-12s %8.3f ms\n", "flood fill", total / rounds);
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = "shapes.ppm";
+    int rounds = 20;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (rounds < 1) rounds = 1;
+    
+    inky_t *display = inky_init(true);
+    if (!display) {
+        fprintf(stderr, "Failed to initialize display\n");
+        return 1;
+    }
+    
+    checker_t checker = {display, NULL, NULL, 0, 0};
+    checker.size = (size_t)inky_get_width(display) * inky_get_height(display);
+    checker.expected = malloc(checker.size);
+    checker.actual = malloc(checker.size);
+    if (!checker.expected || !checker.actual) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    run_checks(&checker);
+    
+    printf("Timing (per shape):\n");
+    compare(display, "circle r200", fast_disk, slow_disk, rounds);
+    compare(display, "star", fast_star, slow_star, rounds);
+    time_flood(display, rounds);
+    
+    draw_gallery(display);
+    inky_emulator_save_ppm(display, output);
+    
+    printf("%d checks failed\n", checker.failures);
+    free(checker.expected);
+    free(checker.actual);
+    inky_destroy(display);
+    return checker.failures ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+#include "inky.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Shared-memory framebuffer viewer
+//
+// Attaches to an emulator's live framebuffer and sleeps on its futex until a
+// frame lands, then reports what changed. Without --name it forks: the parent
+// drives an emulated display through partial updates on an anonymous memfd
+// and the child watches it and checks every dirty rectangle against the
+// pattern it expects.
+
+#define SELF_TEST_FRAMES 8
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [--name NAME] [--frames N] [--timeout S] [--output FILE]\n", prog_name);
+    printf("Options:\n");
+    printf("  --name NAME   Watch a segment published with inky_emulator_share(display, NAME)\n");
+    printf("                (default: self-test against a forked emulator)\n");
+    printf("  --frames N    Stop after N frames (default: run until the publisher exits)\n");
+    printf("  --timeout S   Stop after S seconds without a frame (default: 60)\n");
+    printf("  --output FILE Save the last frame seen as PPM\n");
+}
+
+// Header fields of one frame, copied while it was stable
+typedef struct {
+    uint32_t seq;
+    uint32_t dirty_x, dirty_y, dirty_w, dirty_h;
+    uint32_t rows_written;
+} frame_info_t;
+
+static void read_info(const inky_shm_header_t *shm, frame_info_t *info) {
+    do {
+        info->seq = inky_shm_read_begin(shm);
+        info->dirty_x = shm->dirty_x;
+        info->dirty_y = shm->dirty_y;
+        info->dirty_w = shm->dirty_w;
+        info->dirty_h = shm->dirty_h;
+        info->rows_written = shm->rows_written;
+    } while (inky_shm_read_retry(shm, info->seq));
+}
+
+static void save_frame(const inky_shm_header_t *shm, const char *filename) {
+    size_t size = (size_t)shm->stride * shm->height;
+    uint8_t *copy = malloc(size);
+    FILE *fp = copy ? fopen(filename, "wb") : NULL;
+    if (!fp) {
+        perror("Failed to open file");
+        free(copy);
+        return;
+    }
+    
+    uint32_t seq;
+    do {
+        seq = inky_shm_read_begin(shm);
+        memcpy(copy, inky_shm_pixels(shm), size);
+    } while (inky_shm_read_retry(shm, seq));
+    
+    fprintf(fp, "P6\n%u %u\n255\n", shm->width, shm->height);
+    fwrite(copy, shm->stride, shm->height, fp);
+    fclose(fp);
+    free(copy);
+    printf("Saved frame to %s\n", filename);
+}
+
+// Print every frame until the publisher goes quiet for timeout_ms
+static int watch(const inky_shm_header_t *shm, int max_frames, int timeout_ms, const char *output) {
+    uint32_t seq = shm->seq & ~1u;
+    int frames = 0;
+    
+    printf("Watching %ux%u framebuffer (frame %llu)\n", shm->width, shm->height,
+           (unsigned long long)shm->frame);
+    
+    while (max_frames <= 0 || frames < max_frames) {
+        if (inky_shm_wait(shm, seq, timeout_ms) < 0) break;
+        
+        // The frame may have moved on again since the wait returned
+        frame_info_t info;
+        read_info(shm, &info);
+        bool skipped = info.seq - seq > 2;
+        seq = info.seq;
+        frames++;
+        
+        if (skipped) {
+            printf("seq %u: skipped frames, whole display dirty\n", seq);
+        } else if (info.dirty_w == 0) {
+            printf("seq %u: refresh with no visible change\n", seq);
+        } else {
+            printf("seq %u: dirty (%u,%u) %ux%u, %u rows written\n", seq,
+                   info.dirty_x, info.dirty_y, info.dirty_w, info.dirty_h, info.rows_written);
+        }
+    }
+    
+    if (output) {
+        save_frame(shm, output);
+    }
+    return frames;
+}
+
+// Child side of the self-test: every frame must show the expected square
+static int check_frames(const inky_shm_header_t *shm) {
+    const uint8_t *pixels = inky_shm_pixels(shm);
+    uint32_t seq = shm->seq & ~1u;
+    int errors = 0;
+    
+    for (int frame = 0; frame < SELF_TEST_FRAMES; frame++) {
+        if (inky_shm_wait(shm, seq, 5000) < 0) {
+            fprintf(stderr, "Viewer: timed out waiting for frame %d\n", frame);
+            return 1;
+        }
+        
+        // Square of 40x40 pixels stepping right by 50 each frame; the pixel
+        // and the dirty rectangle must come from the same stable frame
+        uint32_t x = 50 + frame * 50, y = 100;
+        const uint8_t *px = pixels + (size_t)(y + 20) * shm->stride + (size_t)(x + 20) * 3;
+        frame_info_t info;
+        uint8_t red;
+        do {
+            read_info(shm, &info);
+            red = px[0];
+        } while (inky_shm_read_retry(shm, info.seq));
+        seq = info.seq;
+        bool dark = red < 128;
+        bool covered = info.dirty_w > 0 && info.dirty_x <= x && info.dirty_x + info.dirty_w >= x + 40;
+        
+        printf("Viewer: seq %u dirty (%u,%u) %ux%u rows %u -> %s\n", seq, info.dirty_x, info.dirty_y,
+               info.dirty_w, info.dirty_h, info.rows_written, dark && covered ? "ok" : "MISMATCH");
+        if (!dark || !covered) errors++;
+    }
+    
+    return errors ? 1 : 0;
+}
+
+static int self_test(void) {
+    inky_t *display = inky_init(true);
+    if (!display) {
+        fprintf(stderr, "Failed to initialize emulator\n");
+        return 1;
+    }
+    
+    int fd = inky_emulator_share(display, NULL);
+    const inky_shm_header_t *shm = inky_shm_map(fd);
+    if (fd < 0 || !shm) {
+        fprintf(stderr, "Shared framebuffer not available\n");
+        inky_destroy(display);
+        return 1;
+    }
+    
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        inky_destroy(display);
+        return 1;
+    }
+    if (pid == 0) {
+        int rc = check_frames(shm);
+        fflush(stdout);
+        _exit(rc);
+    }
+    
+    // Publisher: move a black square along, erasing the previous one
+    for (int frame = 0; frame < SELF_TEST_FRAMES; frame++) {
+        usleep(20000);
+        uint16_t x = 50 + frame * 50;
+        uint16_t update_x = frame ? x - 50 : x;
+        for (uint16_t yy = 100; yy < 140; yy++) {
+            for (uint16_t xx = update_x; xx < x + 40; xx++) {
+                inky_set_pixel(display, xx, yy, xx >= x ? INKY_BLACK : INKY_WHITE);
+            }
+        }
+        inky_update_region(display, update_x, 100, x + 40 - update_x, 40);
+    }
+    
+    int status = 0;
+    waitpid(pid, &status, 0);
+    inky_shm_close(shm);
+    inky_destroy(display);
+    
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    printf("Shared framebuffer self-test %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = NULL;
+    const char *output = NULL;
+    int max_frames = 0;
+    int timeout_s = 60;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            max_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeout_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (!name) {
+        return self_test();
+    }
+    
+    // Give a publisher started at the same time a moment to create it
+    const inky_shm_header_t *shm = inky_shm_open(name);
+    for (int tries = 0; !shm && tries < 100; tries++) {
+        usleep(100000);
+        shm = inky_shm_open(name);
+    }
+    if (!shm) {
+        fprintf(stderr, "No framebuffer published as %s\n", name);
+        return 1;
+    }
+    
+    // A long quiet spell most likely means the publisher exited
+    int frames = watch(shm, max_frames, timeout_s * 1000, output);
+    printf("Saw %d frames\n", frames);
+    
+    inky_shm_close(shm);
+    return 0;
+}